@@ -240,9 +240,13 @@ echo "# Save and restore OpenGL state when drawing on-screen keyboard for apps t
 echo CompatibilityHacksTouchscreenKeyboardSaveRestoreOpenGLState=$CompatibilityHacksTouchscreenKeyboardSaveRestoreOpenGLState >> AndroidAppSettings.cfg
 echo >> AndroidAppSettings.cfg
 echo "# Application uses SDL_UpdateRects() properly, and does not draw in any region outside those rects." >> AndroidAppSettings.cfg
-echo "# This improves drawing speed, but I know only one application that does that, and it's written by me (y)/(n)" >> AndroidAppSettings.cfg
+echo "# Only the rows covered by those rects are uploaded to the GL texture, which greatly improves drawing speed (y)/(n)" >> AndroidAppSettings.cfg
 echo CompatibilityHacksProperUsageOfSDL_UpdateRects=$CompatibilityHacksProperUsageOfSDL_UpdateRects >> AndroidAppSettings.cfg
 echo >> AndroidAppSettings.cfg
+echo "# Pack small HW surfaces into shared atlas textures, so sprites drawn one after another use the same texture." >> AndroidAppSettings.cfg
+echo "# Saves texture memory and texture switches, for applications which create many small SDL_HWSURFACE sprites (y)/(n)" >> AndroidAppSettings.cfg
+echo CompatibilityHacksHwSurfacesTextureAtlas=$CompatibilityHacksHwSurfacesTextureAtlas >> AndroidAppSettings.cfg
+echo >> AndroidAppSettings.cfg
 echo "# Application uses mouse (y) or (n), this will show mouse emulation dialog to the user" >> AndroidAppSettings.cfg
 echo AppUsesMouse=$AppUsesMouse >> AndroidAppSettings.cfg
 echo >> AndroidAppSettings.cfg
@@ -557,6 +561,12 @@ else
 	CompatibilityHacksProperUsageOfSDL_UpdateRects=
 fi
 
+if [ "$CompatibilityHacksHwSurfacesTextureAtlas" = "y" ]; then
+	CompatibilityHacksHwSurfacesTextureAtlas=-DSDL_COMPATIBILITY_HACKS_HW_SURFACES_TEXTURE_ATLAS=1
+else
+	CompatibilityHacksHwSurfacesTextureAtlas=
+fi
+
 if [ "$AppUsesMouse" = "y" ] ; then
 	AppUsesMouse=true
 else
@@ -915,6 +925,7 @@ cat project/jni/SettingsTemplate.mk | \
 		$CompatibilityHacksSlowCompatibleEventQueue \
 		$CompatibilityHacksTouchscreenKeyboardSaveRestoreOpenGLState \
 		$CompatibilityHacksProperUsageOfSDL_UpdateRects \
+		$CompatibilityHacksHwSurfacesTextureAtlas \
 		$UseGlshimCFlags^" | \
 	sed "s^APPLICATION_SUBDIRS_BUILD :=.*^APPLICATION_SUBDIRS_BUILD := $AppSubdirsBuild^" | \
 	sed "s^APPLICATION_BUILD_EXCLUDE :=.*^APPLICATION_BUILD_EXCLUDE := $AppBuildExclude^" | \
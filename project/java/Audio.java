@@ -107,6 +107,12 @@ class AudioThread
 			return mVirtualBufSize;
 	}
 	
+	public int getNativeSampleRate()
+	{
+		// Playing at this rate bypasses resampler inside AudioFlinger
+		return AudioTrack.getNativeOutputSampleRate(AudioManager.STREAM_MUSIC);
+	}
+
 	public byte[] getBuffer()
 	{
 		return mAudioBuffer;
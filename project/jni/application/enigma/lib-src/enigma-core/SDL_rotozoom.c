@@ -17,6 +17,12 @@
 
 #include "SDL_rotozoom.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #define MAX(a,b)    (((a) > (b)) ? (a) : (b))
 #define MIN(a,b)    (((a) < (b)) ? (a) : (b))
 
@@ -228,6 +234,197 @@ static void zoomLanczos (SDL_Surface *src, SDL_Surface *dst)
 #endif
 }
 
+/*
+ * Bilinear kernels shared by the smooth zoomer and rotozoomer.  Every
+ * weight is applied as ((c1 - c0) * e >> 16) + c0 with e in 0..65535, so
+ * the SSE2 and NEON versions give exactly the same pixels as the C code.
+ */
+
+INLINE void lerp_rgba (tColorRGBA *dp, const tColorRGBA *c0, const tColorRGBA *c1, int e)
+{
+    dp->r = (((c1->r - c0->r) * e) >> 16) + c0->r;
+    dp->g = (((c1->g - c0->g) * e) >> 16) + c0->g;
+    dp->b = (((c1->b - c0->b) * e) >> 16) + c0->b;
+    dp->a = (((c1->a - c0->a) * e) >> 16) + c0->a;
+}
+
+/* Horizontally interpolate one source row into dp */
+static void interp_row (tColorRGBA *dp, const tColorRGBA *sp, const int *xa, const int *xb, 
+                        const Uint16 *ex, int n)
+{
+    int x;
+    for (x = 0; x < n; x++)
+        lerp_rgba (&dp[x], &sp[xa[x]], &sp[xb[x]], ex[x]);
+}
+
+static void blend_row_c (Uint8 *dp, const Uint8 *t1, const Uint8 *t2, int ey, int n)
+{
+    int i;
+    for (i = 0; i < n; i++)
+        dp[i] = (((t2[i] - t1[i]) * ey) >> 16) + t1[i];
+}
+
+/* Rotozoom n pixels whose 2x2 source neighbourhoods lie inside the source */
+static void transform_span_c (tColorRGBA *dp, const Uint8 *pixels, int pitch,
+                              int sdx, int sdy, int icos, int isin, int n)
+{
+    const tColorRGBA *sp;
+    tColorRGBA t1, t2;
+
+    for (; n > 0; n--, dp++) {
+        sp = (const tColorRGBA *) (pixels + (sdy >> 16) * pitch) + (sdx >> 16);
+        lerp_rgba (&t1, sp, sp + 1, sdx & 0xffff);
+        sp = (const tColorRGBA *) ((const Uint8 *) sp + pitch);
+        lerp_rgba (&t2, sp, sp + 1, sdx & 0xffff);
+        lerp_rgba (dp, &t1, &t2, sdy & 0xffff);
+        sdx += icos;
+        sdy += isin;
+    }
+}
+
+#if defined(__SSE2__)
+
+/* ((b - a) * e >> 16) + a on 16 bit lanes; weights above 32767 come out of
+   the signed multiply short by exactly (b - a), which is added back */
+static __m128i lerp_sse2 (__m128i a, __m128i b, __m128i e)
+{
+    __m128i d = _mm_sub_epi16(b, a);
+    return _mm_add_epi16(a, _mm_add_epi16(_mm_mulhi_epi16(d, e), _mm_and_si128(d, _mm_srai_epi16(e, 15))));
+}
+
+static __m128i pair_sse2 (const tColorRGBA *p0, const tColorRGBA *p1)
+{
+    return _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(*(const int *) p0),
+                                                _mm_cvtsi32_si128(*(const int *) p1)),
+                             _mm_setzero_si128());
+}
+
+static __m128i weights_sse2 (int e0, int e1)
+{
+    return _mm_set_epi16((short)e1, (short)e1, (short)e1, (short)e1, (short)e0, (short)e0, (short)e0, (short)e0);
+}
+
+static void blend_row (Uint8 *dp, const Uint8 *t1, const Uint8 *t2, int ey, int n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i e = _mm_set1_epi16((short)ey);
+
+    for (; n >= 16; n -= 16, dp += 16, t1 += 16, t2 += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *) t1);
+        __m128i b = _mm_loadu_si128((const __m128i *) t2);
+        __m128i lo = lerp_sse2(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), e);
+        __m128i hi = lerp_sse2(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), e);
+        _mm_storeu_si128((__m128i *) dp, _mm_packus_epi16(lo, hi));
+    }
+    blend_row_c (dp, t1, t2, ey, n);
+}
+
+static void transform_span (tColorRGBA *dp, const Uint8 *pixels, int pitch,
+                            int sdx, int sdy, int icos, int isin, int n)
+{
+    for (; n >= 2; n -= 2, dp += 2) {
+        const tColorRGBA *p0 = (const tColorRGBA *) (pixels + (sdy >> 16) * pitch) + (sdx >> 16);
+        const tColorRGBA *p1 = (const tColorRGBA *) (pixels + ((sdy + isin) >> 16) * pitch) + ((sdx + icos) >> 16);
+        const tColorRGBA *q0 = (const tColorRGBA *) ((const Uint8 *) p0 + pitch);
+        const tColorRGBA *q1 = (const tColorRGBA *) ((const Uint8 *) p1 + pitch);
+        __m128i ex = weights_sse2(sdx & 0xffff, (sdx + icos) & 0xffff);
+        __m128i t1 = lerp_sse2(pair_sse2(p0, p1), pair_sse2(p0 + 1, p1 + 1), ex);
+        __m128i t2 = lerp_sse2(pair_sse2(q0, q1), pair_sse2(q0 + 1, q1 + 1), ex);
+        __m128i r = lerp_sse2(t1, t2, weights_sse2(sdy & 0xffff, (sdy + isin) & 0xffff));
+        _mm_storel_epi64((__m128i *) dp, _mm_packus_epi16(r, r));
+        sdx += 2 * icos;
+        sdy += 2 * isin;
+    }
+    transform_span_c (dp, pixels, pitch, sdx, sdy, icos, isin, n);
+}
+
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+/* ((b - a) * e >> 16) + a on 16 bit lanes, see lerp_sse2 */
+static int16x8_t lerp_neon (int16x8_t a, int16x8_t b, int16x8_t e)
+{
+    int16x8_t d = vsubq_s16(b, a);
+    int16x4_t lo = vshrn_n_s32(vmull_s16(vget_low_s16(d), vget_low_s16(e)), 16);
+    int16x4_t hi = vshrn_n_s32(vmull_s16(vget_high_s16(d), vget_high_s16(e)), 16);
+    return vaddq_s16(a, vaddq_s16(vcombine_s16(lo, hi), vandq_s16(d, vshrq_n_s16(e, 15))));
+}
+
+static int16x8_t pair_neon (const tColorRGBA *p0, const tColorRGBA *p1)
+{
+    return vreinterpretq_s16_u16(vmovl_u8(vcreate_u8(*(const Uint32 *) p0 | ((Uint64) *(const Uint32 *) p1 << 32))));
+}
+
+static int16x8_t weights_neon (int e0, int e1)
+{
+    return vcombine_s16(vdup_n_s16((Sint16)e0), vdup_n_s16((Sint16)e1));
+}
+
+static void blend_row (Uint8 *dp, const Uint8 *t1, const Uint8 *t2, int ey, int n)
+{
+    const int16x8_t e = vdupq_n_s16((Sint16)ey);
+
+    for (; n >= 8; n -= 8, dp += 8, t1 += 8, t2 += 8) {
+        int16x8_t a = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(t1)));
+        int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(t2)));
+        vst1_u8(dp, vqmovun_s16(lerp_neon(a, b, e)));
+    }
+    blend_row_c (dp, t1, t2, ey, n);
+}
+
+static void transform_span (tColorRGBA *dp, const Uint8 *pixels, int pitch,
+                            int sdx, int sdy, int icos, int isin, int n)
+{
+    for (; n >= 2; n -= 2, dp += 2) {
+        const tColorRGBA *p0 = (const tColorRGBA *) (pixels + (sdy >> 16) * pitch) + (sdx >> 16);
+        const tColorRGBA *p1 = (const tColorRGBA *) (pixels + ((sdy + isin) >> 16) * pitch) + ((sdx + icos) >> 16);
+        const tColorRGBA *q0 = (const tColorRGBA *) ((const Uint8 *) p0 + pitch);
+        const tColorRGBA *q1 = (const tColorRGBA *) ((const Uint8 *) p1 + pitch);
+        int16x8_t ex = weights_neon(sdx & 0xffff, (sdx + icos) & 0xffff);
+        int16x8_t t1 = lerp_neon(pair_neon(p0, p1), pair_neon(p0 + 1, p1 + 1), ex);
+        int16x8_t t2 = lerp_neon(pair_neon(q0, q1), pair_neon(q0 + 1, q1 + 1), ex);
+        vst1_u8((Uint8 *) dp, vqmovun_s16(lerp_neon(t1, t2, weights_neon(sdy & 0xffff, (sdy + isin) & 0xffff))));
+        sdx += 2 * icos;
+        sdy += 2 * isin;
+    }
+    transform_span_c (dp, pixels, pitch, sdx, sdy, icos, isin, n);
+}
+
+#else
+#define blend_row      blend_row_c
+#define transform_span transform_span_c
+#endif
+
+/* floor(n / d) for d > 0 */
+static Sint64 floor_div (Sint64 n, Sint64 d)
+{
+    Sint64 q = n / d;
+    if ((n % d) != 0 && n < 0)
+        q--;
+    return q;
+}
+
+/* Narrow [*x0, *x1) to the x for which lo <= ((s + x * d) >> 16) <= hi.
+   The result stays inside the original range. */
+static void clip_span (int s, int d, int lo, int hi, int *x0, int *x1)
+{
+    Sint64 l = (Sint64) lo * 65536 - s;
+    Sint64 h = (Sint64) hi * 65536 + 0xffff - s;
+    Sint64 a, b;
+
+    if (d > 0) {
+        a = -floor_div(-l, d);
+        b = floor_div(h, d) + 1;
+    } else if (d < 0) {
+        a = -floor_div(h, -d);
+        b = floor_div(-l, -d) + 1;
+    } else {
+        a = (l <= 0 && h >= 0) ? *x0 : *x1;
+        b = *x1;
+    }
+    if (a > *x0) *x0 = (a < *x1) ? (int) a : *x1;
+    if (b < *x1) *x1 = (b > *x0) ? (int) b : *x0;
+}
+
 /*
 
  32bit Zoomer with optional anti-aliasing by bilinear interpolation.
@@ -312,7 +509,7 @@ int zoomSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int smooth)
     }
     else
     {
-        int x, y, sx, sy, *sax, *say, *csax, *csay, csx, csy, ex, ey, t1, t2, sstep;
+        int x, y, sx, sy, *sax, *say, *csax, *csay, csx, csy, sstep;
         tColorRGBA *sp, *csp, *dp;
         int sgap, dgap;
 
@@ -385,46 +582,56 @@ int zoomSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int smooth)
          */
         csay = say;
         if (smooth == 1) {
-            /* Interpolating Zoom */
-            for (y = 0; y < dst->h; y++) {
-                /* Setup color source pointers */
-                tColorRGBA *c00, *c01, *c10, *c11;
-
-                c00  = csp;
-                c01  = csp+1;
-                c10  = (tColorRGBA *) ((Uint8 *) csp + src->pitch);
-                c11  = c10+1;
-                csax = sax;
-                for (x = 0; x < dst->w; x++, dp++) {
+            /*
+             * Interpolating Zoom: the two source rows an output row needs
+             * are scaled horizontally once and kept while the next output
+             * rows still sample them, then blended vertically.
+             */
+            int *xa, *xb, ya, yb, row0 = -1, row1 = -1;
+            Uint16 *exs;
+            tColorRGBA *buf, *r0, *r1, *tmp;
+
+            if ((buf = (tColorRGBA *) malloc(dst->w * (2 * sizeof(tColorRGBA) + 2 * sizeof(int) + sizeof(Uint16)))) == NULL) {
+                free(sax);
+                free(say);
+                return (-1);
+            }
+            r0  = buf;
+            r1  = r0 + dst->w;
+            xa  = (int *) (r1 + dst->w);
+            xb  = xa + dst->w;
+            exs = (Uint16 *) (xb + dst->w);
+
+            sx = 0;
+            for (x = 0; x < dst->w; x++) {
+                xa[x]  = sx;
+                xb[x]  = MIN(sx + 1, src->w - 1);
+                exs[x] = sax[x] & 0xffff;
+                sx    += sax[x + 1] >> 16;
+            }
 
-                    /* Interpolate colors */
-                    ex = *csax & 0xffff;
-                    ey = *csay & 0xffff;
-                    t1 = ((((c01->r - c00->r) * ex) >> 16) + c00->r) & 0xff;
-                    t2 = ((((c11->r - c10->r) * ex) >> 16) + c10->r) & 0xff;
-                    dp->r = (((t2 - t1) * ey) >> 16) + t1;
-                    t1 = ((((c01->g - c00->g) * ex) >> 16) + c00->g) & 0xff;
-                    t2 = ((((c11->g - c10->g) * ex) >> 16) + c10->g) & 0xff;
-                    dp->g = (((t2 - t1) * ey) >> 16) + t1;
-                    t1 = ((((c01->b - c00->b) * ex) >> 16) + c00->b) & 0xff;
-                    t2 = ((((c11->b - c10->b) * ex) >> 16) + c10->b) & 0xff;
-                    dp->b = (((t2 - t1) * ey) >> 16) + t1;
-                    t1 = ((((c01->a - c00->a) * ex) >> 16) + c00->a) & 0xff;
-                    t2 = ((((c11->a - c10->a) * ex) >> 16) + c10->a) & 0xff;
-                    dp->a = (((t2 - t1) * ey) >> 16) + t1;
-
-                    /* Advance source pointers */
-                    csax++;
-                    sstep = (*csax >> 16);
-                    c00 += sstep;
-                    c01 += sstep;
-                    c10 += sstep;
-                    c11 += sstep;
+            sy = 0;
+            for (y = 0; y < dst->h; y++) {
+                ya = sy;
+                yb = MIN(sy + 1, src->h - 1);
+                if (ya != row0) {
+                    if (ya == row1) {
+                        tmp = r0; r0 = r1; r1 = tmp;
+                        row1 = row0;
+                    } else {
+                        interp_row (r0, (tColorRGBA *) ((Uint8 *) src->pixels + ya * src->pitch), xa, xb, exs, dst->w);
+                    }
+                    row0 = ya;
                 }
-                csay++;
-                csp = (tColorRGBA *) ((Uint8 *) csp + (*csay >> 16) * src->pitch);
-                dp  = (tColorRGBA *) ((Uint8 *) dp + dgap);
+                if (yb != row1) {
+                    interp_row (r1, (tColorRGBA *) ((Uint8 *) src->pixels + yb * src->pitch), xa, xb, exs, dst->w);
+                    row1 = yb;
+                }
+                blend_row ((Uint8 *) dp, (Uint8 *) r0, (Uint8 *) r1, say[y] & 0xffff, dst->w * 4);
+                sy += say[y + 1] >> 16;
+                dp  = (tColorRGBA *) ((Uint8 *) dp + dst->pitch);
             }
+            free(buf);
         }
         else if (smooth > 1) { 
             // stronger blur for image shrinking
@@ -603,6 +810,106 @@ int zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst)
     return (0);
 }
 
+/* Rotozoom a single destination pixel, handling the source border */
+static void transform_pixel (SDL_Surface * src, tColorRGBA *pc, int sdx, int sdy, int sw, int sh)
+{
+    int dx, dy, t1, t2, ex, ey;
+    tColorRGBA c00, c01, c10, c11;
+    tColorRGBA *sp;
+
+    dx = (sdx >> 16);
+    dy = (sdy >> 16);
+    if ((dx >= -1) && (dy >= -1) && (dx < src->w) && (dy < src->h)) {
+        if ((dx >= 0) && (dy >= 0) && (dx < sw) && (dy < sh)) {
+            sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
+            sp += dx;
+            c00 = *sp;
+            sp += 1;
+            c01 = *sp;
+            sp = (tColorRGBA *) ((Uint8 *) sp + src->pitch);
+            sp -= 1;
+            c10 = *sp;
+            sp += 1;
+            c11 = *sp;
+        } else if ((dx == sw) && (dy == sh)) {
+            sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
+            sp += dx;
+            c00 = *sp;
+            c01 = *sp;
+            c10 = *sp;
+            c11 = *sp;
+        } else if ((dx == -1) && (dy == -1)) {
+            sp = (tColorRGBA *) (src->pixels);
+            c00 = *sp;
+            c01 = *sp;
+            c10 = *sp;
+            c11 = *sp;
+        } else if ((dx == -1) && (dy == sh)) {
+            sp = (tColorRGBA *) (src->pixels);
+            sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
+            c00 = *sp;
+            c01 = *sp;
+            c10 = *sp;
+            c11 = *sp;
+        } else if ((dx == sw) && (dy == -1)) {
+            sp = (tColorRGBA *) (src->pixels);
+            sp += dx;
+            c00 = *sp;
+            c01 = *sp;
+            c10 = *sp;
+            c11 = *sp;
+        } else if (dx == -1) {
+            sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
+            c00 = *sp;
+            c01 = *sp;
+            c10 = *sp;
+            sp = (tColorRGBA *) ((Uint8 *) sp + src->pitch);
+            c11 = *sp;
+        } else if (dy == -1) {
+            sp = (tColorRGBA *) (src->pixels);
+            sp += dx;
+            c00 = *sp;
+            c01 = *sp;
+            c10 = *sp;
+            sp += 1;
+            c11 = *sp;
+        } else if (dx == sw) {
+            sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
+            sp += dx;
+            c00 = *sp;
+            c01 = *sp;
+            sp = (tColorRGBA *) ((Uint8 *) sp + src->pitch);
+            c10 = *sp;
+            c11 = *sp;
+        } else if (dy == sh) {
+            sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
+            sp += dx;
+            c00 = *sp;
+            sp += 1;
+            c01 = *sp;
+            c10 = *sp;
+            c11 = *sp;
+        }
+        /*
+         * Interpolate colors
+         */
+        ex = (sdx & 0xffff);
+        ey = (sdy & 0xffff);
+        t1 = ((((c01.r - c00.r) * ex) >> 16) + c00.r) & 0xff;
+        t2 = ((((c11.r - c10.r) * ex) >> 16) + c10.r) & 0xff;
+        pc->r = (((t2 - t1) * ey) >> 16) + t1;
+        t1 = ((((c01.g - c00.g) * ex) >> 16) + c00.g) & 0xff;
+        t2 = ((((c11.g - c10.g) * ex) >> 16) + c10.g) & 0xff;
+        pc->g = (((t2 - t1) * ey) >> 16) + t1;
+        t1 = ((((c01.b - c00.b) * ex) >> 16) + c00.b) & 0xff;
+        t2 = ((((c11.b - c10.b) * ex) >> 16) + c10.b) & 0xff;
+        pc->b = (((t2 - t1) * ey) >> 16) + t1;
+        t1 = ((((c01.a - c00.a) * ex) >> 16) + c00.a) & 0xff;
+        t2 = ((((c11.a - c10.a) * ex) >> 16) + c10.a) & 0xff;
+        pc->a = (((t2 - t1) * ey) >> 16) + t1;
+    }
+}
+
 /*
 
  32bit Rotozoomer with optional anti-aliasing by bilinear interpolation.
@@ -613,9 +920,8 @@ int zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst)
 
 void transformSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int cx, int cy, int isin, int icos, int smooth)
 {
-    int x, y, t1, t2, dx, dy, xd, yd, sdx, sdy, ax, ay, ex, ey, sw, sh;
-    tColorRGBA c00, c01, c10, c11;
-    tColorRGBA *pc, *sp, *spb;
+    int x, x0, x1, y, dx, dy, xd, yd, sdx, sdy, ax, ay, sw, sh;
+    tColorRGBA *pc, *sp;
     int gap;
 
     /*
@@ -638,102 +944,21 @@ void transformSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int cx, int cy,
 	    dy = cy - y;
 	    sdx = (ax + (isin * dy)) + xd;
 	    sdy = (ay - (icos * dy)) + yd;
-	    for (x = 0; x < dst->w; x++) {
-		dx = (sdx >> 16);
-		dy = (sdy >> 16);
-		if ((dx >= -1) && (dy >= -1) && (dx < src->w) && (dy < src->h)) {
-		    if ((dx >= 0) && (dy >= 0) && (dx < sw) && (dy < sh)) {
-			sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
-			sp += dx;
-			c00 = *sp;
-			sp += 1;
-			c01 = *sp;
-			sp = (tColorRGBA *) ((Uint8 *) sp + src->pitch);
-			sp -= 1;
-			c10 = *sp;
-			sp += 1;
-			c11 = *sp;
-		    } else if ((dx == sw) && (dy == sh)) {
-			sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
-			sp += dx;
-			c00 = *sp;
-			c01 = *sp;
-			c10 = *sp;
-			c11 = *sp;
-		    } else if ((dx == -1) && (dy == -1)) {
-			sp = (tColorRGBA *) (src->pixels);
-			c00 = *sp;
-			c01 = *sp;
-			c10 = *sp;
-			c11 = *sp;
-		    } else if ((dx == -1) && (dy == sh)) {
-			sp = (tColorRGBA *) (src->pixels);
-			sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
-			c00 = *sp;
-			c01 = *sp;
-			c10 = *sp;
-			c11 = *sp;
-		    } else if ((dx == sw) && (dy == -1)) {
-			sp = (tColorRGBA *) (src->pixels);
-			sp += dx;
-			c00 = *sp;
-			c01 = *sp;
-			c10 = *sp;
-			c11 = *sp;
-		    } else if (dx == -1) {
-			sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
-			c00 = *sp;
-			c01 = *sp;
-			c10 = *sp;
-			sp = (tColorRGBA *) ((Uint8 *) sp + src->pitch);
-			c11 = *sp;
-		    } else if (dy == -1) {
-			sp = (tColorRGBA *) (src->pixels);
-			sp += dx;
-			c00 = *sp;
-			c01 = *sp;
-			c10 = *sp;
-			sp += 1;
-			c11 = *sp;
-		    } else if (dx == sw) {
-			sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
-			sp += dx;
-			c00 = *sp;
-			c01 = *sp;
-			sp = (tColorRGBA *) ((Uint8 *) sp + src->pitch);
-			c10 = *sp;
-			c11 = *sp;
-		    } else if (dy == sh) {
-			sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
-			sp += dx;
-			c00 = *sp;
-			sp += 1;
-			c01 = *sp;
-			c10 = *sp;
-			c11 = *sp;
-		    }
-		    /*
-		     * Interpolate colors
-		     */
-		    ex = (sdx & 0xffff);
-		    ey = (sdy & 0xffff);
-		    t1 = ((((c01.r - c00.r) * ex) >> 16) + c00.r) & 0xff;
-		    t2 = ((((c11.r - c10.r) * ex) >> 16) + c10.r) & 0xff;
-		    pc->r = (((t2 - t1) * ey) >> 16) + t1;
-		    t1 = ((((c01.g - c00.g) * ex) >> 16) + c00.g) & 0xff;
-		    t2 = ((((c11.g - c10.g) * ex) >> 16) + c10.g) & 0xff;
-		    pc->g = (((t2 - t1) * ey) >> 16) + t1;
-		    t1 = ((((c01.b - c00.b) * ex) >> 16) + c00.b) & 0xff;
-		    t2 = ((((c11.b - c10.b) * ex) >> 16) + c10.b) & 0xff;
-		    pc->b = (((t2 - t1) * ey) >> 16) + t1;
-		    t1 = ((((c01.a - c00.a) * ex) >> 16) + c00.a) & 0xff;
-		    t2 = ((((c11.a - c10.a) * ex) >> 16) + c10.a) & 0xff;
-		    pc->a = (((t2 - t1) * ey) >> 16) + t1;
-		}
-		sdx += icos;
-		sdy += isin;
-		pc++;
-	    }
+	    /*
+	     * Pixels whose 2x2 neighbourhood lies inside the source form one
+	     * run; they go through the span kernel, the border the slow way.
+	     */
+	    x0 = 0;
+	    x1 = dst->w;
+	    clip_span(sdx, icos, 0, sw - 1, &x0, &x1);
+	    clip_span(sdy, isin, 0, sh - 1, &x0, &x1);
+	    for (x = 0; x < x0; x++, pc++)
+		transform_pixel(src, pc, sdx + x * icos, sdy + x * isin, sw, sh);
+	    transform_span(pc, (const Uint8 *) src->pixels, src->pitch,
+			   sdx + x0 * icos, sdy + x0 * isin, icos, isin, x1 - x0);
+	    pc += x1 - x0;
+	    for (x = x1; x < dst->w; x++, pc++)
+		transform_pixel(src, pc, sdx + x * icos, sdy + x * isin, sw, sh);
 	    pc = (tColorRGBA *) ((Uint8 *) pc + gap);
 	}
     } else {
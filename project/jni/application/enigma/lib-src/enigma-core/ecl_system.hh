@@ -33,6 +33,7 @@ namespace ecl
 
     bool        FileExists (const std::string &fname);
     std::time_t FileModTime (const std::string &fname);
+    long        FileSize (const std::string &fname);
         
     bool FolderExists (const std::string &fname);
     bool FolderCreate (const std::string &fname);
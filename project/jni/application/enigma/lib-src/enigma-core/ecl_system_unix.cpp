@@ -74,6 +74,16 @@ time_t ecl::FileModTime (const std::string &fname)
     return 0;                   // beginning of time
 }
 
+long ecl::FileSize (const std::string &fname)
+{
+    struct stat s;
+    if (stat(fname.c_str(), &s) == 0) {
+        return s.st_size;
+    }
+
+    return -1;
+}
+
 bool ecl::FolderExists (const std::string &fname)
 {
     struct stat s;
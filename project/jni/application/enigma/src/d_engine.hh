@@ -82,6 +82,7 @@ namespace display
 
     private:
         void update_layer (DisplayLayer *l, WorldArea wa);
+        void set_redrawp (int x, int y, int d);
 
         /* ---------- Variables ---------- */
 
@@ -101,6 +102,10 @@ namespace display
         int m_width, m_height;
 
         ecl::Array2<char> m_redrawp;
+        std::vector<int>  m_redraw_rows; // Non-zero entries in each row of m_redrawp
+
+        // Scratch space for merging updated tiles in update_screen()
+        std::vector<WorldArea> m_runs, m_rects, m_next_rects;
     };
 
 
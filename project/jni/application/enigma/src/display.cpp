@@ -497,6 +497,7 @@ void DisplayEngine::new_world (int w, int h)
     m_offset = m_new_offset = V2();
     m_screenoffset[0] = m_screenoffset[1] = 0;
     m_redrawp.resize(w, h, 1);
+    m_redraw_rows.assign(h, w);
 
     for (unsigned i=0; i<m_layers.size(); ++i)
         m_layers[i]->new_world(w,h);
@@ -564,15 +565,24 @@ V2 DisplayEngine::to_world (const V2 &pos) {
         V2((pos[0]-get_area().x)/m_tilew, (pos[1]-get_area().y)/m_tileh);
 }
 
+/* Set the redraw counter of tile (x,y) and keep the per-row count of
+   pending tiles up to date. */
+inline void DisplayEngine::set_redrawp (int x, int y, int d)
+{
+    char &p = m_redrawp(x, y);
+    m_redraw_rows[y] += (char(d) != 0) - (p != 0);
+    p = d;
+}
+
 void DisplayEngine::mark_redraw_area (const WorldArea &wa, int delay) 
 {
     int x2 = Min(m_width, wa.x+wa.w);
     int y2 = Min(m_height, wa.y+wa.h);
-    for (int x=Max(0,wa.x); x <x2; x++)
-        for (int y=Max(0,wa.y); y<y2; y++) {
+    for (int y=Max(0,wa.y); y<y2; y++)
+        for (int x=Max(0,wa.x); x <x2; x++) {
             int d = m_redrawp(x, y);
             if (d == 0 || 1+delay < d)
-                m_redrawp(x,y) = 1 + delay;
+                set_redrawp (x, y, 1 + delay);
         }
 }
 
@@ -618,6 +628,8 @@ void DisplayEngine::update_layer (DisplayLayer *l, WorldArea wa)
 
     l->prepare_draw (wa);
     for (int y=wa.y; y<y2; y++, ypos += m_tileh) {
+        if (m_redraw_rows[y] == 0)
+            continue;
         int xpos = xpos0;
         for (int x=wa.x; x<x2; x++, xpos += m_tilew) {
             if (m_redrawp(x,y) == 1)
@@ -644,14 +656,52 @@ void DisplayEngine::update_screen()
     for (unsigned i=0; i<m_layers.size(); ++i) {
         update_layer (m_layers[i], wa);
     }
+
+    // Count down the redraw delays.  Tiles that are done are handed
+    // to the video layer as few rectangles as possible: first as runs
+    // of tiles in a row, then runs with the same extent in successive
+    // rows are merged.  m_rects holds the rectangles that reached the
+    // previous row, sorted by x.
     int x2 = wa.x+wa.w;
     int y2 = wa.y+wa.h;
-    for (int x=wa.x; x<x2; x++)
-        for (int y=wa.y; y<y2; y++)
-            if (m_redrawp(x,y) >= 1) {
-                if ((m_redrawp(x,y) -= 1) == 0)
-                    screen->update_rect (world_to_screen (WorldArea (x, y, 1, 1)));
-            } 
+    m_rects.clear();
+    for (int y=wa.y; y<=y2; y++) {
+        m_runs.clear();
+        if (y < y2 && m_redraw_rows[y] != 0) {
+            int run = -1;
+            for (int x=wa.x; x<x2; x++) {
+                char &d = m_redrawp(x,y);
+                if (d >= 1 && (d -= 1) == 0) {
+                    m_redraw_rows[y] -= 1;
+                    if (run < 0)
+                        run = x;
+                } else if (run >= 0) {
+                    m_runs.push_back (WorldArea (run, y, x-run, 1));
+                    run = -1;
+                }
+            }
+            if (run >= 0)
+                m_runs.push_back (WorldArea (run, y, x2-run, 1));
+        }
+
+        m_next_rects.clear();
+        size_t i = 0, j = 0;
+        while (i < m_rects.size() || j < m_runs.size()) {
+            if (j == m_runs.size() || (i < m_rects.size() && m_rects[i].x < m_runs[j].x)) {
+                screen->update_rect (world_to_screen (m_rects[i++]));
+            } else if (i == m_rects.size() || m_runs[j].x < m_rects[i].x) {
+                m_next_rects.push_back (m_runs[j++]);
+            } else if (m_rects[i].w == m_runs[j].w) {
+                m_rects[i].h += 1;
+                m_next_rects.push_back (m_rects[i++]);
+                j++;
+            } else {
+                screen->update_rect (world_to_screen (m_rects[i++]));
+                m_next_rects.push_back (m_runs[j++]);
+            }
+        }
+        m_rects.swap (m_next_rects);
+    }
 }
 
 
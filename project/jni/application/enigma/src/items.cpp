@@ -193,15 +193,13 @@ namespace
             }
         }
 
-        virtual Value message(const string &m, const Value &val) {
-            if (m=="onoff")
-                set_on(!is_on());
-            else if (m=="signal")
-                set_on (to_int(val) != 0);
-            else if (m == "on")
-                set_on(true);
-            else if (m=="off")
-                set_on(false);
+        virtual Value on_message (const Message &m) {
+            switch (m.id) {
+            case MSG_ONOFF:  set_on(!is_on()); break;
+            case MSG_SIGNAL: set_on (to_int(m.value) != 0); break;
+            case MSG_ON:     set_on(true); break;
+            case MSG_OFF:    set_on(false); break;
+            }
             return Value();
         }
 
@@ -3088,11 +3086,11 @@ namespace
 
         void on_drop(Actor *a) {
             if (!wears_glasses(a)) // 'this' was the only it-glasses
-                BroadcastMessage("glasses", 0.0, GRID_STONES_BIT);
+                BroadcastMessage(MSG_GLASSES, 0.0, GRID_STONES_BIT);
         }
         void on_pickup(Actor *a) {
             if (!wears_glasses(a)) // no glasses before
-                BroadcastMessage("glasses", 1.0, GRID_STONES_BIT);
+                BroadcastMessage(MSG_GLASSES, 1.0, GRID_STONES_BIT);
         }
         void on_stonehit(Stone *) {
             sound_event ("shatter");
@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2026 The Enigma Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "lev/IndexCache.hh"
+#include "main.hh"
+#include "ecl_system.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+namespace enigma { namespace lev {
+
+    namespace {
+        // "EIXC" followed by the format version - increase the version on
+        // any change of the layout or of the cached pack contents
+        const char     CACHE_MAGIC[4] = {'E', 'I', 'X', 'C'};
+        const unsigned CACHE_VERSION  = 1;
+        const char    *CACHE_FILENAME = "levelindex.cache";
+
+        /* -------------------- Writer -------------------- */
+
+        void put_uint(ByteVec &out, unsigned value) {
+            // little endian independent of the host
+            out.push_back(static_cast<char>(value & 0xff));
+            out.push_back(static_cast<char>((value >> 8) & 0xff));
+            out.push_back(static_cast<char>((value >> 16) & 0xff));
+            out.push_back(static_cast<char>((value >> 24) & 0xff));
+        }
+
+        void put_string(ByteVec &out, const std::string &value) {
+            put_uint(out, value.size());
+            out.insert(out.end(), value.begin(), value.end());
+        }
+
+        void put_double(ByteVec &out, double value) {
+            // the bits of the double - a text form would depend on the locale
+            unsigned words[2];
+            memcpy(words, &value, sizeof(words));
+            put_uint(out, words[0]);
+            put_uint(out, words[1]);
+        }
+
+        /* -------------------- Reader -------------------- */
+
+        class Reader {
+        public:
+            Reader(const ByteVec &in) : pos(in.empty() ? NULL : &in[0]),
+                    end(pos + in.size()), failed(false) {}
+
+            bool ok() const { return !failed; }
+            bool at_end() const { return pos == end; }
+
+            bool has(size_t n) {
+                if (failed || static_cast<size_t>(end - pos) < n)
+                    failed = true;
+                return !failed;
+            }
+
+            unsigned get_uint() {
+                if (!has(4))
+                    return 0;
+                const unsigned char *p = reinterpret_cast<const unsigned char *>(pos);
+                pos += 4;
+                return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<unsigned>(p[3]) << 24);
+            }
+
+            std::string get_string() {
+                unsigned len = get_uint();
+                if (!has(len))
+                    return "";
+                std::string result(pos, len);
+                pos += len;
+                return result;
+            }
+
+            double get_double() {
+                unsigned words[2];
+                words[0] = get_uint();
+                words[1] = get_uint();
+                double value;
+                memcpy(&value, words, sizeof(value));
+                return value;
+            }
+
+        private:
+            const char *pos;
+            const char *end;
+            bool failed;
+        };
+
+        void put_level(ByteVec &out, const CachedLevel &level) {
+            put_string(out, level.path);
+            put_string(out, level.id);
+            put_string(out, level.title);
+            put_string(out, level.author);
+            put_uint(out, level.scoreVersion);
+            put_uint(out, level.releaseVersion);
+            put_uint(out, level.revisionVersion);
+            put_uint(out, level.hasEasymode ? 1 : 0);
+            put_uint(out, level.var.ctrl);
+            put_uint(out, level.var.unit);
+            put_string(out, level.var.target);
+            put_uint(out, level.var.extensions.size());
+            for (std::map<std::string, std::string>::const_iterator i = level.var.extensions.begin();
+                    i != level.var.extensions.end(); ++i) {
+                put_string(out, i->first);
+                put_string(out, i->second);
+            }
+        }
+
+        void get_level(Reader &in, CachedLevel &level) {
+            level.path = in.get_string();
+            level.id = in.get_string();
+            level.title = in.get_string();
+            level.author = in.get_string();
+            level.scoreVersion = in.get_uint();
+            level.releaseVersion = in.get_uint();
+            level.revisionVersion = in.get_uint();
+            level.hasEasymode = in.get_uint() != 0;
+            level.var.ctrl = static_cast<controlType>(in.get_uint());
+            level.var.unit = static_cast<scoreUnitType>(in.get_uint());
+            level.var.target = in.get_string();
+            for (unsigned i = 0, n = in.get_uint(); i < n && in.ok(); i++) {
+                std::string name = in.get_string();
+                level.var.extensions[name] = in.get_string();
+            }
+        }
+
+        void put_pack(ByteVec &out, const CachedPack &pack) {
+            put_string(out, pack.title);
+            put_string(out, pack.group);
+            put_string(out, pack.owner);
+            put_uint(out, pack.release);
+            put_uint(out, pack.revision);
+            put_double(out, pack.compatibility);
+            put_double(out, pack.location);
+            put_uint(out, pack.hasUpdate ? 1 : 0);
+            put_string(out, pack.indexUrl);
+            put_uint(out, pack.levels.size());
+            for (size_t i = 0; i < pack.levels.size(); i++)
+                put_level(out, pack.levels[i]);
+        }
+
+        void get_pack(Reader &in, CachedPack &pack) {
+            pack.title = in.get_string();
+            pack.group = in.get_string();
+            pack.owner = in.get_string();
+            pack.release = in.get_uint();
+            pack.revision = in.get_uint();
+            pack.compatibility = in.get_double();
+            pack.location = in.get_double();
+            pack.hasUpdate = in.get_uint() != 0;
+            pack.indexUrl = in.get_string();
+            unsigned n = in.get_uint();
+            // every level takes at least 40 bytes - do not trust a damaged
+            // count with a huge allocation
+            if (!in.has(n / 40))
+                return;
+            pack.levels.resize(n);
+            for (unsigned i = 0; i < n && in.ok(); i++)
+                get_level(in, pack.levels[i]);
+        }
+    }
+
+    /* -------------------- IndexStamp -------------------- */
+
+    IndexStamp::IndexStamp() : mtime (0), size (0), hash (0) {
+    }
+
+    IndexStamp IndexStamp::ofFile(const std::string &path) {
+        IndexStamp stamp;
+        stamp.mtime = ecl::FileModTime(path);
+        stamp.size = ecl::FileSize(path);
+        return stamp;
+    }
+
+    IndexStamp IndexStamp::ofCode(const ByteVec &code) {
+        IndexStamp stamp;
+        stamp.size = code.size();
+        // FNV-1a
+        stamp.hash = 2166136261u;
+        for (size_t i = 0; i < code.size(); i++) {
+            stamp.hash ^= static_cast<unsigned char>(code[i]);
+            stamp.hash *= 16777619u;
+        }
+        return stamp;
+    }
+
+    bool IndexStamp::operator == (const IndexStamp &other) const {
+        return mtime == other.mtime && size == other.size && hash == other.hash;
+    }
+
+    /* -------------------- IndexCache -------------------- */
+
+    IndexCache *IndexCache::theSingleton = 0;
+
+    IndexCache* IndexCache::instance() {
+        if (theSingleton == 0) {
+            theSingleton = new IndexCache();
+        }
+        return theSingleton;
+    }
+
+    IndexCache::IndexCache() : isModified (false) {
+        cachePath = app.userPath + "/" + CACHE_FILENAME;
+        load();
+    }
+
+    IndexCache::~IndexCache() {
+    }
+
+    const CachedPack *IndexCache::lookup(const std::string &key, const IndexStamp &stamp) {
+        std::map<std::string, Entry>::iterator i = entries.find(key);
+        if (i == entries.end() || !(i->second.stamp == stamp))
+            return NULL;
+        i->second.used = true;
+        return &i->second.pack;
+    }
+
+    void IndexCache::store(const std::string &key, const IndexStamp &stamp,
+            const CachedPack &pack) {
+        Entry &entry = entries[key];
+        entry.stamp = stamp;
+        entry.pack = pack;
+        entry.used = true;
+        isModified = true;
+    }
+
+    void IndexCache::load() {
+        ByteVec code;
+        std::ifstream ifs(cachePath.c_str(), ios::binary | ios::in);
+        if (!ifs)
+            return;    // no cache yet
+        Readfile(ifs, code, 65536);
+
+        Reader in(code);
+        if (!in.has(sizeof(CACHE_MAGIC)) || memcmp(&code[0], CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0) {
+            Log << "IndexCache: ignoring unknown cache file " << cachePath << "\n";
+            return;
+        }
+        in.get_uint();    // the magic
+        if (in.get_uint() != CACHE_VERSION) {
+            Log << "IndexCache: ignoring cache of other version\n";
+            return;
+        }
+        for (unsigned i = 0, n = in.get_uint(); i < n && in.ok(); i++) {
+            std::string key = in.get_string();
+            Entry &entry = entries[key];
+            entry.stamp.mtime = in.get_uint();
+            entry.stamp.size = in.get_uint();
+            entry.stamp.hash = in.get_uint();
+            entry.used = false;
+            get_pack(in, entry.pack);
+        }
+        if (!in.ok() || !in.at_end()) {
+            Log << "IndexCache: discarding damaged cache file " << cachePath << "\n";
+            entries.clear();
+            isModified = true;
+        }
+    }
+
+    void IndexCache::save(bool prune) {
+        if (prune) {
+            for (std::map<std::string, Entry>::iterator i = entries.begin(); i != entries.end(); ) {
+                if (!i->second.used) {
+                    entries.erase(i++);
+                    isModified = true;
+                } else
+                    ++i;
+            }
+        }
+        if (!isModified)
+            return;
+
+        ByteVec out;
+        out.insert(out.end(), CACHE_MAGIC, CACHE_MAGIC + sizeof(CACHE_MAGIC));
+        put_uint(out, CACHE_VERSION);
+        put_uint(out, entries.size());
+        for (std::map<std::string, Entry>::iterator i = entries.begin(); i != entries.end(); ++i) {
+            put_string(out, i->first);
+            put_uint(out, i->second.stamp.mtime);
+            put_uint(out, i->second.stamp.size);
+            put_uint(out, i->second.stamp.hash);
+            put_pack(out, i->second.pack);
+        }
+
+        // write a new file and replace the old one to never leave a
+        // truncated cache behind
+        std::string tmpPath = cachePath + ".tmp";
+        std::ofstream ofs(tmpPath.c_str(), ios::binary | ios::out | ios::trunc);
+        if (ofs)
+            ofs.write(&out[0], out.size());
+        ofs.close();
+        bool written = !ofs.fail();
+        if (written && std::rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+            // rename does not replace an existing file on all platforms
+            std::remove(cachePath.c_str());
+            written = std::rename(tmpPath.c_str(), cachePath.c_str()) == 0;
+        }
+        if (!written) {
+            Log << "IndexCache: save fault on " << cachePath << "\n";
+            std::remove(tmpPath.c_str());
+            return;
+        }
+        isModified = false;
+    }
+
+}} // namespace enigma::lev
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2026 The Enigma Team
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef LEV_INDEXCACHE_HH_INCLUDED
+#define LEV_INDEXCACHE_HH_INCLUDED
+
+#include "lev/PersistentIndex.hh"
+#include "file.hh"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace enigma { namespace lev {
+
+    /**
+     * The attributes of a level element of a levelpack index as they are
+     * stored in the xml file, before they are handed to Proxy::registerLevel.
+     */
+    struct CachedLevel {
+        std::string path;
+        std::string id;
+        std::string title;
+        std::string author;
+        int         scoreVersion;
+        int         releaseVersion;
+        int         revisionVersion;
+        bool        hasEasymode;
+        Variation   var;
+    };
+
+    /**
+     * The contents of a levelpack index that are needed to register the
+     * pack and its levels. Filled by PersistentIndex from the DOM or from
+     * the IndexCache.
+     */
+    struct CachedPack {
+        std::string title;
+        std::string group;
+        std::string owner;
+        int         release;
+        int         revision;
+        double      compatibility;
+        double      location;
+        bool        hasUpdate;
+        std::string indexUrl;
+        std::vector<CachedLevel> levels;
+    };
+
+    /**
+     * Identifies the version of an index file. Plain files are identified
+     * by modification time and size. Zipped indices are identified by size
+     * and a hash of their contents as the zip member has no usable time.
+     */
+    struct IndexStamp {
+        IndexStamp();
+        static IndexStamp ofFile(const std::string &path);
+        static IndexStamp ofCode(const ByteVec &code);
+        bool operator == (const IndexStamp &other) const;
+
+        unsigned mtime;
+        unsigned size;
+        unsigned hash;
+    };
+
+    /**
+     * A singleton cache of the parsed levelpack indices. The startup
+     * registration of all packs looks up each index in this cache and
+     * parses the xml with Xerces only if the index is new or has been
+     * modified since it was cached. The cache is kept as a compact binary
+     * file on the user path. It is loaded on first use and saved at the end
+     * of the pack registration if any entry has changed.
+     *
+     * A cache file with a different format version or any damage is
+     * silently discarded and rebuilt from the xml indices.
+     */
+    class IndexCache {
+    public:
+        static IndexCache *instance();
+        ~IndexCache();
+
+        /**
+         * Returns the cached pack for the given key if its stamp matches,
+         * otherwise NULL.
+         */
+        const CachedPack *lookup(const std::string &key, const IndexStamp &stamp);
+        void store(const std::string &key, const IndexStamp &stamp, const CachedPack &pack);
+
+        /**
+         * Write the cache file if it has been modified. With prune set all
+         * entries that have not been looked up or stored in this session are
+         * dropped, too.
+         */
+        void save(bool prune);
+
+    protected:
+        IndexCache();
+
+    private:
+        struct Entry {
+            IndexStamp stamp;
+            CachedPack pack;
+            bool       used;
+        };
+
+        static IndexCache *theSingleton;
+        std::string cachePath;
+        std::map<std::string, Entry> entries;
+        bool isModified;
+
+        void load();
+    };
+
+}} // namespace enigma::lev
+#endif
@@ -17,6 +17,7 @@
  */
 
 #include "lev/PersistentIndex.hh"
+#include "lev/IndexCache.hh"
 #include "lev/Proxy.hh"
 #include "lev/RatingManager.hh"
 #include "errors.hh"
@@ -140,8 +141,10 @@ namespace enigma { namespace lev {
         }
         delete dirIter;
         
-        if (onlySystemIndices)
+        if (onlySystemIndices) {
+            IndexCache::instance()->save(false);
             return;
+        }
         
         // UserPath: register dirs and zips with xml-indices excl auto
         dirIter = DirIter::instance(app.userPath + "/levels");
@@ -226,6 +229,9 @@ namespace enigma { namespace lev {
             Index::registerIndex(historyIndex);
         }
         historyIndex->isEditable = false;
+        
+        // drop the entries of packs that have been removed
+        IndexCache::instance()->save(true);
     }
     
     void PersistentIndex::addCurrentToHistory() {
@@ -250,16 +256,82 @@ namespace enigma { namespace lev {
             Index(anIndexName, aGroupName, defaultLocation), packPath (thePackPath), 
             indexFilename(theIndexFilename), isModified (false),
             isUserOwned (true), isEditable (true), release (1), revision (1),
-            compatibility (1.00), doc(NULL) {
+            compatibility (1.00), doc(NULL), hasUpdateInfo (false),
+            isDocDeferred (false), loadedSystemOnly (systemOnly) {
 //        Log << "PersistentIndex AddLevelPack " << thePackPath << " - " << anIndexName <<  " - " << indexDefaultLocation <<"\n";
         load(systemOnly);
     }
     
+    bool PersistentIndex::locateIndexFile(bool systemOnly, std::auto_ptr<std::istream> &isptr) {
+        absIndexPath = "";
+        std::string relIndexPath = "levels/" + packPath + "/" + indexFilename;
+        return (!systemOnly && app.resourceFS->findFile(relIndexPath, absIndexPath, isptr)) ||
+                (systemOnly && app.systemFS->findFile(relIndexPath, absIndexPath, isptr));
+    }
+    
+    void PersistentIndex::readIndex(std::auto_ptr<std::istream> &isptr, ByteVec &indexCode) {
+        if (isptr.get() != NULL) {
+            // zipped file
+            Readfile (*isptr, indexCode);
+        } else {
+            // plain file
+            std::basic_ifstream<char> ifs(absIndexPath.c_str(), ios::binary | ios::in);
+            Readfile(ifs, indexCode);
+        }
+    }
+    
+    std::string PersistentIndex::parseIndex(const ByteVec &indexCode, bool update) {
+        std::string errMessage;
+        try {
+            std::ostringstream errStream;
+            app.domParserErrorHandler->resetErrors();
+            app.domParserErrorHandler->reportToOstream(&errStream);
+            app.domParserSchemaResolver->resetResolver();
+            app.domParserSchemaResolver->addSchemaId("index.xsd","index.xsd");
+            if (update) {
+                // local xml file or URL
+                doc = app.domParser->parseURI(indexUrl.c_str());
+            } else {
+                // preloaded  xml or zipped xml
+#if _XERCES_VERSION >= 30000
+                std::auto_ptr<DOMLSInput> domInputIndexSource ( new Wrapper4InputSource(
+                        new MemBufInputSource(reinterpret_cast<const XMLByte *>(&(indexCode[0])),
+                        indexCode.size(), absIndexPath.c_str(), false)));
+             doc = app.domParser->parse(domInputIndexSource.get());
+#else    
+                std::auto_ptr<Wrapper4InputSource> domInputIndexSource ( new Wrapper4InputSource(
+                        new MemBufInputSource(reinterpret_cast<const XMLByte *>(&(indexCode[0])),
+                        indexCode.size(), absIndexPath.c_str(), false)));
+                doc = app.domParser->parse(*domInputIndexSource);
+#endif
+            }
+
+            if (doc != NULL && !app.domParserErrorHandler->getSawErrors()) {
+                infoElem = reinterpret_cast<DOMElement *>(doc->getElementsByTagName(
+                        Utf8ToXML("info").x_str())->item(0));
+                updateElem = reinterpret_cast<DOMElement *>(doc->getElementsByTagName(
+                        Utf8ToXML("update").x_str())->item(0));
+                levelsElem = reinterpret_cast<DOMElement *>(doc->getElementsByTagName(
+                        Utf8ToXML("levels").x_str())->item(0));
+            }
+
+            if(app.domParserErrorHandler->getSawErrors()) {
+                errMessage = errStream.str();
+            }
+            app.domParserErrorHandler->reportToNull();  // do not report to errStream any more
+        }
+        catch (...) {
+            errMessage = "Unexpected XML Exception on load of index\n";
+        }
+        return errMessage;
+    }
+    
     void PersistentIndex::load(bool systemOnly, bool update) {
         if (doc != NULL) {
             doc->release();
             doc = NULL;
         }
+        isDocDeferred = false;
         // auto and new levelpacks are not loadable
         if (packPath == " " || packPath == "auto")
             return;    // as long as Auto is not editable
@@ -267,60 +339,30 @@ namespace enigma { namespace lev {
         std::auto_ptr<std::istream> isptr;
         ByteVec indexCode;
         std::string errMessage;
-        absIndexPath = "";
-        std::string relIndexPath = "levels/" + packPath + "/" + indexFilename;
-        if ((!systemOnly && app.resourceFS->findFile(relIndexPath, absIndexPath, isptr)) ||
-                (systemOnly && app.systemFS->findFile(relIndexPath, absIndexPath, isptr))) {
-            // preload index file or zipped index
+        if (locateIndexFile(systemOnly, isptr)) {
+            // plain files are identified by stat, zipped indices need to be
+            // read to be identified
+            IndexStamp stamp;
             if (isptr.get() != NULL) {
-                // zipped file
-                Readfile (*isptr, indexCode);
-            } else {
-                // plain file
-                std::basic_ifstream<char> ifs(absIndexPath.c_str(), ios::binary | ios::in);
-                Readfile(ifs, indexCode);
-            }
-            try {
-                std::ostringstream errStream;
-                app.domParserErrorHandler->resetErrors();
-                app.domParserErrorHandler->reportToOstream(&errStream);
-                app.domParserSchemaResolver->resetResolver();
-                app.domParserSchemaResolver->addSchemaId("index.xsd","index.xsd");
-                if (update) {
-                    // local xml file or URL
-                    doc = app.domParser->parseURI(indexUrl.c_str());
-                } else {
-                    // preloaded  xml or zipped xml
-#if _XERCES_VERSION >= 30000
-                    std::auto_ptr<DOMLSInput> domInputIndexSource ( new Wrapper4InputSource(
-                            new MemBufInputSource(reinterpret_cast<const XMLByte *>(&(indexCode[0])),
-                            indexCode.size(), absIndexPath.c_str(), false)));
-                 doc = app.domParser->parse(domInputIndexSource.get());
-#else    
-                    std::auto_ptr<Wrapper4InputSource> domInputIndexSource ( new Wrapper4InputSource(
-                            new MemBufInputSource(reinterpret_cast<const XMLByte *>(&(indexCode[0])),
-                            indexCode.size(), absIndexPath.c_str(), false)));
-                    doc = app.domParser->parse(*domInputIndexSource);
-#endif
-                }
-
-                if (doc != NULL && !app.domParserErrorHandler->getSawErrors()) {
-                    infoElem = reinterpret_cast<DOMElement *>(doc->getElementsByTagName(
-                            Utf8ToXML("info").x_str())->item(0));
-                    updateElem = reinterpret_cast<DOMElement *>(doc->getElementsByTagName(
-                            Utf8ToXML("update").x_str())->item(0));
-                    levelsElem = reinterpret_cast<DOMElement *>(doc->getElementsByTagName(
-                            Utf8ToXML("levels").x_str())->item(0));
-                }
-
-                if(app.domParserErrorHandler->getSawErrors()) {
-                    errMessage = errStream.str();
+                readIndex(isptr, indexCode);
+                stamp = IndexStamp::ofCode(indexCode);
+            } else
+                stamp = IndexStamp::ofFile(absIndexPath);
+            std::string cacheKey = std::string(systemOnly ? "S:" : "R:") +
+                    "levels/" + packPath + "/" + indexFilename + "|" + absIndexPath;
+            if (!update) {
+                const CachedPack *cached = IndexCache::instance()->lookup(cacheKey, stamp);
+                if (cached != NULL) {
+                    // the doc is just needed on a reload or save
+                    loadPack(*cached);
+                    isDocDeferred = true;
+                    loadedSystemOnly = systemOnly;
+                    return;
                 }
-                app.domParserErrorHandler->reportToNull();  // do not report to errStream any more
-            }
-            catch (...) {
-                errMessage = "Unexpected XML Exception on load of index\n";
             }
+            if (isptr.get() == NULL)
+                readIndex(isptr, indexCode);
+            errMessage = parseIndex(indexCode, update);
             if (!errMessage.empty()) {
                 Log << errMessage;   // make long error messages readable
                 std::string message;
@@ -347,107 +389,158 @@ namespace enigma { namespace lev {
                 return;
             } else if (doc != NULL) {
                 //TODO check if an updated index exists for system packs
-                loadDoc();
+                CachedPack pack;
+                readDoc(pack);
+                loadPack(pack);
+                loadedSystemOnly = systemOnly;
+                if (!update)
+                    IndexCache::instance()->store(cacheKey, stamp, pack);
             }
         }        
     }
     
+    void PersistentIndex::parseDeferredDoc() {
+        if (!isDocDeferred)
+            return;
+        isDocDeferred = false;
+        std::auto_ptr<std::istream> isptr;
+        ByteVec indexCode;
+        if (locateIndexFile(loadedSystemOnly, isptr)) {
+            readIndex(isptr, indexCode);
+            std::string errMessage = parseIndex(indexCode, false);
+            if (!errMessage.empty()) {
+                Log << errMessage;
+                if (doc != NULL) {
+                    doc->release();           // empty or errornous doc 
+                    doc = NULL;
+                }
+            }
+        }
+    }
+    
     void PersistentIndex::loadDoc() {
+        parseDeferredDoc();
         if (doc != NULL) {
-            clear();  // allow a reload of an index
-            indexName = XMLtoUtf8(infoElem->getAttribute( 
-                    Utf8ToXML("title").x_str())).c_str();                
-            indexGroup = XMLtoUtf8(infoElem->getAttribute( 
-                    Utf8ToXML("group").x_str())).c_str();
-            defaultGroup = indexGroup;
-            owner = XMLtoUtf8(infoElem->getAttribute( 
-                    Utf8ToXML("owner").x_str())).c_str();                
-            release = XMLString::parseInt(infoElem->getAttribute( 
-                    Utf8ToXML("release").x_str()));
-            revision = XMLString::parseInt(infoElem->getAttribute( 
-                    Utf8ToXML("revision").x_str()));
-            XMLDouble * result = new XMLDouble(infoElem->getAttribute( 
-                    Utf8ToXML("enigma").x_str()));
-            compatibility = result->getValue();
-            delete result;
-            result = new XMLDouble(infoElem->getAttribute( 
-                    Utf8ToXML("location").x_str()));
-            indexDefaultLocation = result->getValue();
-            indexLocation = indexDefaultLocation;
-            delete result;
-            
-            if (updateElem != NULL) {
-                indexUrl = XMLtoUtf8(updateElem->getAttribute( 
-                        Utf8ToXML("indexurl").x_str())).c_str();
-            }
-            DOMNodeList *levelList = levelsElem->getElementsByTagName(
-                    Utf8ToXML("level").x_str());
-            std::set<std::string> knownAttributes;
-            knownAttributes.insert("_seq");
-            knownAttributes.insert("_title");
-            knownAttributes.insert("_xpath");
-            knownAttributes.insert("id");
-            knownAttributes.insert("author");
-            knownAttributes.insert("score");
-            knownAttributes.insert("rel");
-            knownAttributes.insert("rev");
-            knownAttributes.insert("easy");
-            knownAttributes.insert("ctrl");
-            knownAttributes.insert("unit");
-            knownAttributes.insert("target");
-            for (int i = 0, l = levelList->getLength();  i < l; i++) {
-                DOMElement *levelElem = reinterpret_cast<DOMElement *>(levelList->item(i));
-                std::string path = XMLtoUtf8(levelElem->getAttribute( 
-                        Utf8ToXML("_xpath").x_str())).c_str();
-                std::string id = XMLtoUtf8(levelElem->getAttribute( 
-                        Utf8ToXML("id").x_str())).c_str();
-                std::string title = XMLtoUtf8(levelElem->getAttribute( 
-                        Utf8ToXML("_title").x_str())).c_str();
-                std::string author = XMLtoUtf8(levelElem->getAttribute( 
-                        Utf8ToXML("author").x_str())).c_str();
-                int scoreVersion = XMLString::parseInt(levelElem->getAttribute( 
-                        Utf8ToXML("score").x_str()));
-                int releaseVersion = XMLString::parseInt(levelElem->getAttribute( 
-                        Utf8ToXML("rel").x_str()));
-                int revisionVersion = XMLString::parseInt(levelElem->getAttribute( 
-                        Utf8ToXML("rev").x_str()));
-                bool hasEasymodeFlag = boolValue(levelElem->getAttribute( 
-                        Utf8ToXML("easy").x_str()));
-                Proxy * newProxy = Proxy::registerLevel(path, packPath, id, title,
-                        author, scoreVersion, releaseVersion, hasEasymodeFlag, 
-                        GAMET_ENIGMA, STATUS_RELEASED, revisionVersion);
-                Variation var;
-                std::string controlString = XMLtoUtf8(levelElem->getAttribute( 
-                        Utf8ToXML("ctrl").x_str())).c_str();
-                if (controlString == "balance")
-                    var.ctrl = balance;
-                else if  (controlString == "key")
-                    var.ctrl = key;
-                else if  (controlString == "other")
-                    var.ctrl = other;
-                std::string txt = XMLtoUtf8(levelElem->getAttribute( 
-                    Utf8ToXML("unit").x_str())).c_str();
-                if (txt == "number")
-                    var.unit = number;
-                else
-                    // default
-                    var.unit = duration;
-                var.target = XMLtoUtf8(levelElem->getAttribute( 
-                        Utf8ToXML("target").x_str())).c_str();
-                DOMNamedNodeMap * attrMap = levelElem->getAttributes();
-                for (int j = 0, k = attrMap->getLength();  j < k; j++) {
-                    DOMAttr * levelAttr = reinterpret_cast<DOMAttr *>(attrMap->item(j));
-                    std::string attrName = XMLtoUtf8(levelAttr->getName()).c_str();
-                    if (knownAttributes.find(attrName) == knownAttributes.end()) {
-                        Log << "PersistentIndex Load unknown Attribut: " << attrName << "\n";
-                        var.extensions[attrName]= XMLtoUtf8(levelAttr->getValue()).c_str();
-                    }
-                    
+            CachedPack pack;
+            readDoc(pack);
+            loadPack(pack);
+        }
+    }
+    
+    void PersistentIndex::readDoc(CachedPack &pack) {
+        pack.title = XMLtoUtf8(infoElem->getAttribute( 
+                Utf8ToXML("title").x_str())).c_str();                
+        pack.group = XMLtoUtf8(infoElem->getAttribute( 
+                Utf8ToXML("group").x_str())).c_str();
+        pack.owner = XMLtoUtf8(infoElem->getAttribute( 
+                Utf8ToXML("owner").x_str())).c_str();                
+        pack.release = XMLString::parseInt(infoElem->getAttribute( 
+                Utf8ToXML("release").x_str()));
+        pack.revision = XMLString::parseInt(infoElem->getAttribute( 
+                Utf8ToXML("revision").x_str()));
+        XMLDouble * result = new XMLDouble(infoElem->getAttribute( 
+                Utf8ToXML("enigma").x_str()));
+        pack.compatibility = result->getValue();
+        delete result;
+        result = new XMLDouble(infoElem->getAttribute( 
+                Utf8ToXML("location").x_str()));
+        pack.location = result->getValue();
+        delete result;
+        
+        pack.hasUpdate = updateElem != NULL;
+        if (updateElem != NULL) {
+            pack.indexUrl = XMLtoUtf8(updateElem->getAttribute( 
+                    Utf8ToXML("indexurl").x_str())).c_str();
+        }
+        DOMNodeList *levelList = levelsElem->getElementsByTagName(
+                Utf8ToXML("level").x_str());
+        std::set<std::string> knownAttributes;
+        knownAttributes.insert("_seq");
+        knownAttributes.insert("_title");
+        knownAttributes.insert("_xpath");
+        knownAttributes.insert("id");
+        knownAttributes.insert("author");
+        knownAttributes.insert("score");
+        knownAttributes.insert("rel");
+        knownAttributes.insert("rev");
+        knownAttributes.insert("easy");
+        knownAttributes.insert("ctrl");
+        knownAttributes.insert("unit");
+        knownAttributes.insert("target");
+        pack.levels.resize(levelList->getLength());
+        for (int i = 0, l = levelList->getLength();  i < l; i++) {
+            DOMElement *levelElem = reinterpret_cast<DOMElement *>(levelList->item(i));
+            CachedLevel &level = pack.levels[i];
+            level.path = XMLtoUtf8(levelElem->getAttribute( 
+                    Utf8ToXML("_xpath").x_str())).c_str();
+            level.id = XMLtoUtf8(levelElem->getAttribute( 
+                    Utf8ToXML("id").x_str())).c_str();
+            level.title = XMLtoUtf8(levelElem->getAttribute( 
+                    Utf8ToXML("_title").x_str())).c_str();
+            level.author = XMLtoUtf8(levelElem->getAttribute( 
+                    Utf8ToXML("author").x_str())).c_str();
+            level.scoreVersion = XMLString::parseInt(levelElem->getAttribute( 
+                    Utf8ToXML("score").x_str()));
+            level.releaseVersion = XMLString::parseInt(levelElem->getAttribute( 
+                    Utf8ToXML("rel").x_str()));
+            level.revisionVersion = XMLString::parseInt(levelElem->getAttribute( 
+                    Utf8ToXML("rev").x_str()));
+            level.hasEasymode = boolValue(levelElem->getAttribute( 
+                    Utf8ToXML("easy").x_str()));
+            Variation &var = level.var;
+            std::string controlString = XMLtoUtf8(levelElem->getAttribute( 
+                    Utf8ToXML("ctrl").x_str())).c_str();
+            if (controlString == "balance")
+                var.ctrl = balance;
+            else if  (controlString == "key")
+                var.ctrl = key;
+            else if  (controlString == "other")
+                var.ctrl = other;
+            std::string txt = XMLtoUtf8(levelElem->getAttribute( 
+                Utf8ToXML("unit").x_str())).c_str();
+            if (txt == "number")
+                var.unit = number;
+            else
+                // default
+                var.unit = duration;
+            var.target = XMLtoUtf8(levelElem->getAttribute( 
+                    Utf8ToXML("target").x_str())).c_str();
+            DOMNamedNodeMap * attrMap = levelElem->getAttributes();
+            for (int j = 0, k = attrMap->getLength();  j < k; j++) {
+                DOMAttr * levelAttr = reinterpret_cast<DOMAttr *>(attrMap->item(j));
+                std::string attrName = XMLtoUtf8(levelAttr->getName()).c_str();
+                if (knownAttributes.find(attrName) == knownAttributes.end()) {
+                    Log << "PersistentIndex Load unknown Attribut: " << attrName << "\n";
+                    var.extensions[attrName]= XMLtoUtf8(levelAttr->getValue()).c_str();
                 }
-                appendProxy(newProxy, var.ctrl, var.unit, var.target, var.extensions);                 
+                
             }
         }
     }
+    
+    void PersistentIndex::loadPack(const CachedPack &pack) {
+        clear();  // allow a reload of an index
+        indexName = pack.title;
+        indexGroup = pack.group;
+        defaultGroup = indexGroup;
+        owner = pack.owner;
+        release = pack.release;
+        revision = pack.revision;
+        compatibility = pack.compatibility;
+        indexDefaultLocation = pack.location;
+        indexLocation = indexDefaultLocation;
+        hasUpdateInfo = pack.hasUpdate;
+        if (pack.hasUpdate)
+            indexUrl = pack.indexUrl;
+        for (size_t i = 0; i < pack.levels.size(); i++) {
+            const CachedLevel &level = pack.levels[i];
+            Proxy * newProxy = Proxy::registerLevel(level.path, packPath, level.id,
+                    level.title, level.author, level.scoreVersion, level.releaseVersion,
+                    level.hasEasymode, GAMET_ENIGMA, STATUS_RELEASED, level.revisionVersion);
+            appendProxy(newProxy, level.var.ctrl, level.var.unit, level.var.target,
+                    level.var.extensions);                 
+        }
+    }
         
     PersistentIndex::~PersistentIndex() {
        if (doc != NULL)
@@ -486,6 +579,7 @@ namespace enigma { namespace lev {
                     app.resourceFS->findFile(relIndexPath2, absIndexPath, isptr)) {
                 return false;
             }
+            parseDeferredDoc();   // while the old index file can be found
             if (packPath == " ") {
                 packPath = fileName;
                 indexFilename = INDEX_STD_FILENAME;
@@ -502,7 +596,7 @@ namespace enigma { namespace lev {
     }
     
     bool PersistentIndex::isUpdatable() {
-        return (updateElem != NULL) && !indexUrl.empty();
+        return hasUpdateInfo && !indexUrl.empty();
     }
     
     bool PersistentIndex::isCross() {
@@ -648,6 +742,7 @@ namespace enigma { namespace lev {
     bool PersistentIndex::save(bool allowOverwrite) {
         bool result = true;
         
+        parseDeferredDoc();
         if (doc == NULL) {
             std::string errMessage;
             std::string indexTemplatePath;
@@ -836,7 +931,8 @@ namespace enigma { namespace lev {
             Index(anIndexName, INDEX_DEFAULT_GROUP, Index::getNextUserLocation()), 
             indexFilename(theIndexFilename), isModified (false), 
             isUserOwned (true), isEditable (true), release (1), revision (1),
-            compatibility (1.00), doc(NULL) {
+            compatibility (1.00), doc(NULL), hasUpdateInfo (false),
+            isDocDeferred (false), loadedSystemOnly (false) {
         Log << "PersistentIndex convert 0.92 index " << thePackPath << " - " << anIndexName <<"\n";
         lev::RatingManager *theRatingMgr = lev::RatingManager::instance();
 
@@ -23,6 +23,8 @@
 
 #include <string>
 #include <istream>
+#include <memory>
+#include <vector>
 #include <xercesc/dom/DOMDocument.hpp>
 
 
@@ -30,6 +32,8 @@
 
 namespace enigma { namespace lev {    
     
+    struct CachedPack;
+
     struct Variation {
         // Constructor
         Variation(controlType ctrlValue = force, scoreUnitType unitValue = duration,
@@ -121,8 +125,21 @@ namespace enigma { namespace lev {
         XERCES_CPP_NAMESPACE_QUALIFIER DOMElement *infoElem;
         XERCES_CPP_NAMESPACE_QUALIFIER DOMElement *updateElem;
         XERCES_CPP_NAMESPACE_QUALIFIER DOMElement *levelsElem;
+        bool hasUpdateInfo;    // index has an update element
+        bool isDocDeferred;    // loaded from IndexCache, doc not yet parsed
+        bool loadedSystemOnly;
         
 	static void checkCandidate(PersistentIndex * candidate);
+        bool locateIndexFile(bool systemOnly, std::auto_ptr<std::istream> &isptr);
+        void readIndex(std::auto_ptr<std::istream> &isptr, std::vector<char> &indexCode);
+        std::string parseIndex(const std::vector<char> &indexCode, bool update);
+        /**
+         * Parse the index file if it has been loaded from the IndexCache.
+         * Needed for a reload or a save of the index.
+         */
+        void parseDeferredDoc();
+        void readDoc(CachedPack &pack);
+        void loadPack(const CachedPack &pack);
         // legacy 0.92
         void parsePar(const string& par, int& par_value, std::string& par_text);
     };
@@ -429,7 +429,7 @@ namespace
 
         virtual Value on_message (const Message &m)
         {
-            if (m.message == "signal" || m.message == "trigger")
+            if (m.id == MSG_SIGNAL || m.id == MSG_TRIGGER)
                 turn();
             return Value();
         }
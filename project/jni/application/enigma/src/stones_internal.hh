@@ -103,15 +103,12 @@ namespace stones
 
         virtual Value on_message(const world::Message &msg)
         {
-            const std::string &m = msg.message;
-            if (m=="onoff")
-                set_on(!is_on());
-            else if (m=="signal")
-                set_on (to_int(msg.value) != 0);
-            else if (m == "on")
-                set_on(true);
-            else if (m=="off")
-                set_on(false);
+            switch (msg.id) {
+            case world::MSG_ONOFF:  set_on(!is_on()); break;
+            case world::MSG_SIGNAL: set_on (to_int(msg.value) != 0); break;
+            case world::MSG_ON:     set_on(true); break;
+            case world::MSG_OFF:    set_on(false); break;
+            }
             return Value();
         }
     };
@@ -131,7 +131,7 @@ namespace
 
         virtual Value on_message (const Message &m)
         {
-            if (traits->hollow && m.message == "glasses") {
+            if (traits->hollow && m.id == MSG_GLASSES) {
                 if (to_int(m.value)) {
                     if (!sunglasses) {
                         sunglasses = true;
@@ -16,11 +16,9 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
-#include <list>
+#include <vector>
+#include <map>
 #include <algorithm>
-#include <functional>
-
-#include "ecl_util.hh"
 
 #include "util.hh"
 
@@ -33,73 +31,367 @@ using namespace std;
 
 namespace
 {
-    /** This class helps #Timer keep track of the current list of
-        registered TimeHandlers. */
-    class Alarm {
-    public:
-        Alarm (enigma::TimeHandler* h, double interval, bool repeatp);
-        void tick (double dtime);
-        bool expired() const;
-        void mark_removed();
-        bool has_handler (enigma::TimeHandler *th) const;
-    private:
-        // Variables
+    // The timing wheel has WHEEL_LEVELS levels of WHEEL_SIZE slots;
+    // slots on level n cover WHEEL_SIZE^n ticks each.  Alarms that
+    // are further away than the wheel reaches (about 46 hours of game
+    // time) are parked and never go off.
+    const unsigned      WHEEL_BITS   = 6;
+    const unsigned      WHEEL_SIZE   = 1 << WHEEL_BITS;
+    const unsigned      WHEEL_MASK   = WHEEL_SIZE - 1;
+    const unsigned      WHEEL_LEVELS = 4;
+    const unsigned long WHEEL_RANGE  = 1UL << (WHEEL_BITS * WHEEL_LEVELS);
+
+    /** A registered alarm.  Every alarm is linked into the list of
+        all alarms (in the order they were set, which is also the
+        order in which alarms going off in the same tick are fired),
+        the wheel slot it is due in, and the chain of alarms of its
+        handler. */
+    struct Alarm {
         enigma::TimeHandler *handler;
         double               interval;
-        double               timeleft;
+        double               timeleft;  // time left before tick `first'
+        double               left;      // time left after tick `due'
+        unsigned long        first;     // first tick that counts down
+        unsigned long        due;       // tick in which timeleft drops to <= 0
+        unsigned long        seq;
         bool                 repeatp;
         bool                 removed;
+
+        Alarm  *prev, *next;            // all alarms
+        Alarm  *slot_next, **slot_pprev;
+        Alarm  *handler_prev, *handler_next;
     };
-}
 
+    bool alarm_before (const Alarm *a, const Alarm *b)
+    {
+        return a->seq < b->seq;
+    }
 
-Alarm::Alarm(TimeHandler* h, double i, bool r)
-: handler(h), interval(i), timeleft(i), repeatp(r), removed(false)
-{}
+    /** Number of ticks of length `dtime' it takes `timeleft' to drop
+        to zero and the time left after that tick. */
+    struct Countdown {
+        unsigned long ticks;
+        double        left;
+    };
 
+    /** Maps TimeHandlers to their alarms and to their index in the
+        list of active handlers.  Open addressing with linear probing,
+        entries are removed by shifting the rest of their cluster back. */
+    class HandlerIndex {
+    public:
+        struct Entry {
+            enigma::TimeHandler *key;
+            Alarm               *alarms;
+            size_t               slot;
+        };
+        static const size_t NOSLOT = size_t(-1);
+
+        HandlerIndex() : entries(16), count(0) { clear(); }
+
+        Entry *find (enigma::TimeHandler *th);
+        Entry *insert (enigma::TimeHandler *th);
+        void release (Entry *e);
+        void clear();
+    private:
+        size_t home (enigma::TimeHandler *th) const;
+        void grow();
 
-bool Alarm::expired() const 
-{
-    return removed || timeleft <= 0; 
+        std::vector<Entry> entries;
+        size_t             count;
+    };
 }
 
 
-void Alarm::mark_removed() 
-{ 
-    removed = true; 
+size_t HandlerIndex::home (TimeHandler *th) const
+{
+    size_t h = reinterpret_cast<size_t>(th);
+    h ^= h >> 4;
+    h *= 0x9e3779b1u;
+    h ^= h >> 16;
+    return h & (entries.size() - 1);
 }
 
+HandlerIndex::Entry *HandlerIndex::find (TimeHandler *th)
+{
+    size_t mask = entries.size() - 1;
+    for (size_t i = home(th); entries[i].key; i = (i + 1) & mask)
+        if (entries[i].key == th)
+            return &entries[i];
+    return 0;
+}
 
-void Alarm::tick (double dtime) 
+HandlerIndex::Entry *HandlerIndex::insert (TimeHandler *th)
 {
-    if (!removed) {
-        timeleft -= dtime;
-        if (repeatp) {
-            while (timeleft <= 0) {
-                handler->alarm();
-                timeleft += interval;
-            }
-        } else if (timeleft <= 0) {
-            handler->alarm();
+    if (Entry *e = find(th))
+        return e;
+    if (2 * (count + 1) > entries.size())
+        grow();
+    size_t mask = entries.size() - 1;
+    size_t i = home(th);
+    while (entries[i].key)
+        i = (i + 1) & mask;
+    entries[i].key = th;
+    entries[i].alarms = 0;
+    entries[i].slot = NOSLOT;
+    ++count;
+    return &entries[i];
+}
+
+/** Remove `e' once the handler has neither alarms nor an active slot. */
+void HandlerIndex::release (Entry *e)
+{
+    if (e->alarms || e->slot != NOSLOT)
+        return;
+    size_t mask = entries.size() - 1;
+    size_t i = e - &entries[0];
+    for (size_t j = (i + 1) & mask; entries[j].key; j = (j + 1) & mask) {
+        size_t h = home(entries[j].key);
+        // Move j into the hole at i unless its home lies in (i, j]
+        if (i <= j ? (h <= i || h > j) : (h <= i && h > j)) {
+            entries[i] = entries[j];
+            i = j;
         }
     }
+    entries[i].key = 0;
+    --count;
 }
 
+void HandlerIndex::grow()
+{
+    std::vector<Entry> old;
+    old.swap(entries);
+    entries.resize(old.size() * 2);
+    clear();
+    for (size_t i = 0; i < old.size(); ++i) {
+        if (old[i].key) {
+            Entry *e = insert(old[i].key);
+            e->alarms = old[i].alarms;
+            e->slot = old[i].slot;
+        }
+    }
+}
 
-bool Alarm::has_handler (TimeHandler *th) const 
+void HandlerIndex::clear()
 {
-    return handler == th;
+    for (size_t i = 0; i < entries.size(); ++i)
+        entries[i].key = 0;
+    count = 0;
 }
 
 
 /* -------------------- Timer implementation -------------------- */
 
+/*
+ * Alarms used to be kept in a list that was walked at every tick,
+ * subtracting `dtime' from every alarm.  Now they sit in a
+ * hierarchical timing wheel and only the alarms that are due are
+ * touched.  To keep the exact tick in which an alarm goes off (and
+ * with it the behaviour of existing levels) unchanged, the wheel counts down
+ * in floating point: `countdown' repeats the old subtractions once
+ * per distinct interval and remembers the result.
+ *
+ * The old walk also decided in which tick alarms set from inside
+ * alarm() started counting down: if the alarm being fired was not the
+ * last one in the list, the new alarm (appended to the end) was
+ * visited in the same tick.  `walk_open' tracks this.
+ */
 struct Timer::Rep {
-    std::list<TimeHandler*>  handlers;
-    std::list<Alarm>         alarms;
+    Rep();
+
+    void link (Alarm *a);
+    void unlink_slot (Alarm *a);
+    void schedule (Alarm *a);
+    unsigned cascade (unsigned level);
+    void collect();
+    void rebase (double dtime);
+    const Countdown &countdown (double timeleft);
+    void drop (Alarm *a);
+    void release (Alarm *a);
+
+    std::vector<TimeHandler*> handlers;
+    size_t                    holes;        // deactivated entries in `handlers'
+    HandlerIndex              index;
+
+    Alarm                    *wheel[WHEEL_LEVELS][WHEEL_SIZE];
+    Alarm                    *head, *tail;  // all alarms in order of set_alarm
+    std::vector<Alarm*>       due;          // alarms going off in this tick
+    std::vector<Alarm*>       garbage;      // alarms to free after the next tick
+    std::vector<Alarm*>       pool;
+
+    std::map<double, Countdown> countdowns;
+    double                    quantum;      // dtime of the last tick
+    unsigned long             now;          // current (or next) tick
+    unsigned long             seq;
+    bool                      in_tick;
+    bool                      walk_open;
+
+    size_t                    npending;
+    unsigned                  nfired;
+    unsigned long             nfired_total;
 };
 
 
+Timer::Rep::Rep()
+: holes(0), head(0), tail(0), quantum(0), now(0), seq(0),
+  in_tick(false), walk_open(false),
+  npending(0), nfired(0), nfired_total(0)
+{
+    std::fill(&wheel[0][0], &wheel[0][0] + WHEEL_LEVELS * WHEEL_SIZE,
+              static_cast<Alarm*>(0));
+}
+
+/** Put `a' into the wheel slot for a->due. */
+void Timer::Rep::link (Alarm *a)
+{
+    unsigned long delta = a->due - now;
+    unsigned level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1UL << (WHEEL_BITS * (level + 1))))
+        ++level;
+    Alarm **slot = &wheel[level][(a->due >> (WHEEL_BITS * level)) & WHEEL_MASK];
+    a->slot_next = *slot;
+    if (*slot)
+        (*slot)->slot_pprev = &a->slot_next;
+    a->slot_pprev = slot;
+    *slot = a;
+}
+
+void Timer::Rep::unlink_slot (Alarm *a)
+{
+    if (a->slot_pprev) {
+        *a->slot_pprev = a->slot_next;
+        if (a->slot_next)
+            a->slot_next->slot_pprev = a->slot_pprev;
+        a->slot_next = 0;
+        a->slot_pprev = 0;
+    }
+}
+
+const Countdown &Timer::Rep::countdown (double timeleft)
+{
+    std::map<double, Countdown>::iterator i = countdowns.find(timeleft);
+    if (i != countdowns.end())
+        return i->second;
+    if (countdowns.size() >= 4096)
+        countdowns.clear();
+
+    Countdown c;
+    if (timeleft / quantum >= WHEEL_RANGE) {
+        c.ticks = WHEEL_RANGE;
+        c.left = timeleft;
+    } else {
+        c.ticks = 0;
+        c.left = timeleft;
+        do {
+            c.left -= quantum;
+            ++c.ticks;
+        } while (c.left > 0);
+    }
+    return countdowns.insert(std::make_pair(timeleft, c)).first->second;
+}
+
+/** Compute when `a' goes off and enter it in the wheel, or in the
+    list of due alarms if that is the current tick. */
+void Timer::Rep::schedule (Alarm *a)
+{
+    if (quantum <= 0)
+        return;                 // until the first tick
+    const Countdown &c = countdown(a->timeleft);
+    if (c.ticks >= WHEEL_RANGE)
+        return;                 // parked
+    a->due = a->first + c.ticks - 1;
+    a->left = c.left;
+    if (in_tick && a->due == now)
+        due.push_back(a);
+    else
+        link(a);
+}
+
+unsigned Timer::Rep::cascade (unsigned level)
+{
+    unsigned idx = (now >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    Alarm *a = wheel[level][idx];
+    wheel[level][idx] = 0;
+    while (a) {
+        Alarm *n = a->slot_next;
+        a->slot_pprev = 0;
+        link(a);
+        a = n;
+    }
+    return idx;
+}
+
+/** Move the alarms due in tick `now' from the wheel to `due'. */
+void Timer::Rep::collect()
+{
+    unsigned idx = now & WHEEL_MASK;
+    if (idx == 0)
+        for (unsigned level = 1; level < WHEEL_LEVELS && cascade(level) == 0; ++level)
+            ;
+    due.clear();
+    for (Alarm *a = wheel[0][idx]; a; ) {
+        Alarm *n = a->slot_next;
+        a->slot_next = 0;
+        a->slot_pprev = 0;
+        due.push_back(a);
+        a = n;
+    }
+    wheel[0][idx] = 0;
+    std::sort(due.begin(), due.end(), alarm_before);
+}
+
+/** Switch to ticks of length `dtime'.  Only happens on the first tick,
+    dtime is fixed after that (cf. server.cc). */
+void Timer::Rep::rebase (double dtime)
+{
+    for (Alarm *a = head; a; a = a->next) {
+        if (a->removed)
+            continue;
+        for (; a->first < now; ++a->first)
+            a->timeleft -= quantum;
+        unlink_slot(a);
+    }
+    quantum = dtime;
+    countdowns.clear();
+    for (Alarm *a = head; a; a = a->next)
+        if (!a->removed)
+            schedule(a);
+}
+
+/** Take `a' out of its handler's chain and stop it from going off. */
+void Timer::Rep::drop (Alarm *a)
+{
+    HandlerIndex::Entry *e = index.find(a->handler);
+    if (a->handler_prev)
+        a->handler_prev->handler_next = a->handler_next;
+    else
+        e->alarms = a->handler_next;
+    if (a->handler_next)
+        a->handler_next->handler_prev = a->handler_prev;
+    if (!e->alarms)
+        index.release(e);
+
+    unlink_slot(a);
+    a->removed = true;
+    --npending;
+    // Stays in the list of all alarms until the end of the next tick,
+    // like removed entries in the old list did
+    garbage.push_back(a);
+}
+
+void Timer::Rep::release (Alarm *a)
+{
+    if (a->prev)
+        a->prev->next = a->next;
+    else
+        head = a->next;
+    if (a->next)
+        a->next->prev = a->prev;
+    else
+        tail = a->prev;
+    pool.push_back(a);
+}
+
+
 Timer::Timer() 
 : self(*new Rep) 
 {
@@ -109,62 +401,192 @@ Timer::Timer()
 Timer::~Timer() 
 {
     clear();
+    for (size_t i = 0; i < self.pool.size(); ++i)
+        delete self.pool[i];
     delete &self;
 }
 
 
 void Timer::deactivate(TimeHandler* th) 
 {
-    std::list<TimeHandler*>::iterator i;
-
-    i = find(self.handlers.begin(), self.handlers.end(), th);
-    if (i != self.handlers.end()) {
-        *i = 0;
+    HandlerIndex::Entry *e = self.index.find(th);
+    if (e && e->slot != HandlerIndex::NOSLOT) {
+        self.handlers[e->slot] = 0;
+        e->slot = HandlerIndex::NOSLOT;
+        ++self.holes;
+        self.index.release(e);
     }
 }
 
 
 void Timer::activate(TimeHandler *th) 
 {
-    if (find(self.handlers.begin(), self.handlers.end(), th) == self.handlers.end())
+    HandlerIndex::Entry *e = self.index.insert(th);
+    if (e->slot == HandlerIndex::NOSLOT) {
+        e->slot = self.handlers.size();
         self.handlers.push_back(th);
+    }
 }
 
 
 void Timer::set_alarm(TimeHandler *th, double interval, bool repeatp) 
 {
-    if (interval > 0)
-        self.alarms.push_back(Alarm(th, interval, repeatp));
+    if (!(interval > 0))
+        return;
+
+    Alarm *a;
+    if (self.pool.empty())
+        a = new Alarm;
+    else {
+        a = self.pool.back();
+        self.pool.pop_back();
+    }
+    a->handler = th;
+    a->interval = interval;
+    a->timeleft = interval;
+    a->left = 0;
+    a->first = self.now;
+    if (self.in_tick && !self.walk_open)
+        a->first += 1;
+    a->due = 0;
+    a->seq = self.seq++;
+    a->repeatp = repeatp;
+    a->removed = false;
+    a->slot_next = 0;
+    a->slot_pprev = 0;
+
+    a->next = 0;
+    a->prev = self.tail;
+    if (self.tail)
+        self.tail->next = a;
+    else
+        self.head = a;
+    self.tail = a;
+
+    HandlerIndex::Entry *e = self.index.insert(th);
+    a->handler_prev = 0;
+    a->handler_next = e->alarms;
+    if (e->alarms)
+        e->alarms->handler_prev = a;
+    e->alarms = a;
+
+    ++self.npending;
+    self.schedule(a);
 }
 
 
 void Timer::remove_alarm(TimeHandler *th) 
 {
-    list<Alarm>::iterator e = self.alarms.end();
-    for (list<Alarm>::iterator it = self.alarms.begin(); it != e; ++it) 
-        if (it->has_handler (th))
-            it->mark_removed();
+    HandlerIndex::Entry *e = self.index.find(th);
+    if (!e)
+        return;
+    Alarm *a = e->alarms;
+    while (a) {
+        Alarm *n = a->handler_next;
+        bool last = (n == 0);
+        self.drop(a);           // may release `e'
+        if (last)
+            break;
+        a = n;
+    }
 }
 
 
 void Timer::tick (double dtime) 
 {
-    self.handlers.remove (0);     // remove inactive entries
-    for_each (self.handlers.begin(), self.handlers.end(),
-              std::bind2nd (std::mem_fun (&TimeHandler::tick), dtime));
+    if (dtime != self.quantum)
+        self.rebase(dtime);
+
+    // remove inactive entries
+    if (self.holes) {
+        size_t j = 0;
+        for (size_t i = 0; i < self.handlers.size(); ++i) {
+            if (TimeHandler *th = self.handlers[i]) {
+                self.index.find(th)->slot = j;
+                self.handlers[j++] = th;
+            }
+        }
+        self.handlers.resize(j);
+        self.holes = 0;
+    }
 
-    // Explicit loop to allow remove_alarm() to be called from inside alarm()
-    for (list<Alarm>::iterator i=self.alarms.begin(); i != self.alarms.end(); ) {
-        list<Alarm>::iterator n = ecl::next(i);
-        i->tick(dtime);
-        i = n;
+    self.in_tick = true;
+    self.walk_open = true;
+    self.nfired = 0;
+    self.collect();
+
+    for (size_t i = 0; i < self.handlers.size(); ++i)
+        if (TimeHandler *th = self.handlers[i])
+            th->tick(dtime);
+
+    // Alarms set or removed from inside alarm() modify `due'
+    for (size_t i = 0; i < self.due.size(); ++i) {
+        Alarm *a = self.due[i];
+        if (a->removed)
+            continue;
+        if (a->next == 0)
+            self.walk_open = false;
+        double timeleft = a->left;
+        if (a->repeatp) {
+            while (timeleft <= 0) {
+                ++self.nfired;
+                a->handler->alarm();
+                timeleft += a->interval;
+            }
+            if (!a->removed) {
+                a->timeleft = timeleft;
+                a->first = self.now + 1;
+                self.schedule(a);
+            }
+        } else {
+            ++self.nfired;
+            a->handler->alarm();
+            if (!a->removed)
+                self.drop(a);
+        }
     }
-    self.alarms.remove_if (mem_fun_ref(&Alarm::expired));
+    self.due.clear();
+
+    for (size_t i = 0; i < self.garbage.size(); ++i)
+        self.release(self.garbage[i]);
+    self.garbage.clear();
+
+    self.nfired_total += self.nfired;
+    self.walk_open = false;
+    self.in_tick = false;
+    ++self.now;
 }
 
 
 void Timer::clear() 
 {
     self.handlers.clear();
-    self.alarms.clear();
+    self.holes = 0;
+    self.index.clear();
+    std::fill(&self.wheel[0][0], &self.wheel[0][0] + WHEEL_LEVELS * WHEEL_SIZE,
+              static_cast<Alarm*>(0));
+    self.due.clear();
+    self.garbage.clear();
+    while (Alarm *a = self.head) {
+        self.head = a->next;
+        self.pool.push_back(a);
+    }
+    self.tail = 0;
+    self.npending = 0;
+}
+
+
+unsigned Timer::alarms_fired() const
+{
+    return self.nfired;
+}
+
+unsigned long Timer::alarms_fired_total() const
+{
+    return self.nfired_total;
+}
+
+size_t Timer::alarms_pending() const
+{
+    return self.npending;
 }
@@ -25,7 +25,8 @@ namespace enigma
      * the TimeHandler is registered using #activate, it is invoked at
      * every tick, the #set_alarm method can be used to register a
      * time handler that is invoked (either once or repeatedly) after
-     * a specified time interval.
+     * a specified time interval.  Alarms that go off in the same tick
+     * are invoked in the order in which they were set.
      */
     class Timer : public ecl::Nocopy {
     public:
@@ -38,6 +39,12 @@ namespace enigma
         void clear();
 
         void tick(double dtime);
+
+        /* Alarms that went off during the last tick and in total, and
+           the number of alarms still waiting. */
+        unsigned alarms_fired() const;
+        unsigned long alarms_fired_total() const;
+        size_t alarms_pending() const;
     private:
         struct Rep;
         Rep &self;
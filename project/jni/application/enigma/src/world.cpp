@@ -121,7 +121,61 @@ ActorInfo::ActorInfo()
 
 /* -------------------- Messages -------------------- */
 
+namespace
+{
+    /* Message names, indexed by MessageId.  Must match the MSG_*
+       constants in world.hh. */
+    const char *predefined_messages[MSG_PREDEFINED_COUNT] = {
+        "", "signal", "trigger", "on", "off", "onoff",
+        "open", "close", "openclose",
+        "init", "expl", "ignite", "bombstone", "heat",
+        "shatter", "glasses", "scramble"
+    };
+
+    class MessageNames {
+    public:
+        MessageNames() {
+            for (int i=0; i<MSG_PREDEFINED_COUNT; ++i)
+                intern(predefined_messages[i]);
+        }
+
+        MessageId intern (const string &name) {
+            map<string, MessageId>::iterator i = ids.find(name);
+            if (i != ids.end())
+                return i->second;
+            MessageId id = static_cast<MessageId>(names.size());
+            names.push_back(name);
+            ids.insert(make_pair(name, id));
+            return id;
+        }
+
+        const string &name (MessageId id) const {
+            return names[id];
+        }
+    private:
+        vector<string>         names;
+        map<string, MessageId> ids;
+    };
+
+    MessageNames &message_names()
+    {
+        static MessageNames instance;
+        return instance;
+    }
+}
+
+MessageId world::InternMessage (const std::string &name)
+{
+    return message_names().intern(name);
+}
+
+const std::string &world::MessageName (MessageId id)
+{
+    return message_names().name(id);
+}
+
 Message::Message ()
+: id (MSG_NONE)
 {
 }
  
@@ -129,6 +183,17 @@ Message::Message (const std::string &message_,
                   const enigma::Value &value_,
                   GridPos from_)
 : message (message_),
+  id (InternMessage (message_)),
+  value (value_),
+  gridpos (from_)
+{
+}
+
+Message::Message (MessageId id_,
+                  const enigma::Value &value_,
+                  GridPos from_)
+: message (MessageName (id_)),
+  id (id_),
   value (value_),
   gridpos (from_)
 {
@@ -147,7 +212,7 @@ namespace
 
 #if defined(VERBOSE_MESSAGES)
         src->warning("emit_from: msg='%s'", // dest=%i/%i obj=%p",
-                     s->message.c_str()
+                     MessageName(s->message).c_str()
 //                      destloc.pos.x, destloc.pos.y,
 //                      dst);
                      );
@@ -158,13 +223,21 @@ namespace
             SendMessage (dst, Message (s->message, value));
     }
 
-    void emit_from (const SignalList &sl, Object *source, int value)
+    /* Index of the first signal from `source', or -1.  The signals
+       of one source are chained through Signal::next in the order in
+       which they were added. */
+    int first_signal (const SignalSources &sources, Object *source)
     {
-        size_t size = sl.size();
-        for (unsigned i=0; i<size; ++i) {
-            if (sl[i].source == source)
-                emit_signal (&sl[i], value);
-        }
+        SignalSources::const_iterator i = sources.find(source);
+        return i != sources.end() ? i->second.first : -1;
+    }
+
+    void emit_from (const SignalList &sl, const SignalSources &sources,
+                    Object *source, int value)
+    {
+        int size = static_cast<int>(sl.size());
+        for (int i=first_signal(sources, source); i != -1 && i < size; i = sl[i].next)
+            emit_signal (&sl[i], value);
 //         // signals may have side effects. To minimize them
 //         //   1. collect all targets and then
 //         //   2. emit signals to targets
@@ -181,20 +254,18 @@ namespace
 //         }
     }
 
-    bool emit_by_index (const SignalList &sl, Object *source, int signalidx, int value) 
+    bool emit_by_index (const SignalList &sl, const SignalSources &sources,
+                        Object *source, int signalidx, int value) 
     {
-        size_t size      = sl.size();
-        int    signalcnt = 0;
-        for (unsigned i=0; i<size; ++i) {
-            if (sl[i].source == source) {
-                if (signalcnt == signalidx) {
-                    emit_signal (&sl[i], value);
-                    return true;
-                }
-                signalcnt += 1;
-            }
-        }
-        return false;
+        if (signalidx < 0)
+            return false;
+        int i = first_signal(sources, source);
+        for (int signalcnt = 0; i != -1 && signalcnt < signalidx; ++signalcnt)
+            i = sl[i].next;
+        if (i == -1)
+            return false;
+        emit_signal (&sl[i], value);
+        return true;
     }
 
     Object *find_single_destination (const SignalList &sl, Object *src)
@@ -534,7 +605,7 @@ void World::scramble_puzzles()
         for (; i != e; ++i) {
             Stone *puzz = GetStone(i->pos);
             if (puzz && i->intensity) {
-                SendMessage(puzz, "scramble", Value(double(i->dir)));
+                SendMessage(puzz, MSG_SCRAMBLE, Value(double(i->dir)));
                 --i->intensity;
             }
             else {
@@ -623,17 +694,15 @@ V2 World::get_global_force (Actor *a)
 {
     V2 f;
     // Electrostatic forces between actors.
+    // (m_charged_actors lists the actors with nonzero charge, cf. move_actors())
     if (double q = get_charge(a)) {
-        for (ActorList::iterator i=actorlist.begin();
-             i != actorlist.end(); ++i)
-        {
-            Actor *a2 = *i;
+        for (size_t i=0; i<m_charged_actors.size(); ++i) {
+            Actor *a2 = actorlist[m_charged_actors[i]];
             if (a2 == a) continue;
-            if (double q2 = get_charge(a2)) {
-                V2 distv = a->get_pos() - a2->get_pos();
-                if (double dist = distv.normalize())
-                    f += server::ElectricForce * q * q2 / (dist) * distv;
-            }
+            double q2 = get_charge(a2);
+            V2 distv = a->get_pos() - a2->get_pos();
+            if (double dist = distv.normalize())
+                f += server::ElectricForce * q * q2 / (dist) * distv;
         }
     }
 
@@ -845,40 +914,71 @@ void World::handle_stone_contact (StoneContact &sc)
     }
 }
 
-namespace {
-    struct ActorEntry {
-        double pos;
-        size_t idx;
+/* Copy the actors' positions and radii into the flat arrays the
+   contact search runs on. */
+void World::update_actor_buffers ()
+{
+    size_t nactors = actorlist.size();
 
-        ActorEntry () { pos = 0; idx = 0; }
-        ActorEntry (double pos_, size_t idx_) { pos = pos_; idx = idx_; }
+    m_actor_x.resize (nactors);
+    m_actor_y.resize (nactors);
+    m_actor_r.resize (nactors);
+    for (size_t i=0; i<nactors; ++i) {
+        const ActorInfo *ai = actorlist[i]->get_actorinfo();
+        m_actor_x[i] = ai->pos[0];
+        m_actor_y[i] = ai->pos[1];
+        m_actor_r[i] = ai->radius;
+    }
+}
 
-        bool operator < (const ActorEntry &x) const {
-            return pos < x.pos;
-        }
-    };
-};
+/* Bring `m_xlist' in order for the current positions.  Actors move
+   only a little per time step, so the list left by the last step is
+   nearly sorted and an insertion sort needs about linear time.  Ties
+   are broken by actor index, so the order in which contacts are
+   handled never depends on earlier steps. */
+void World::sort_actor_xlist ()
+{
+    size_t nactors = m_actor_x.size();
+
+    if (m_xlist.size() != nactors) {
+        m_xlist.resize (nactors);
+        for (size_t i=0; i<nactors; ++i)
+            m_xlist[i] = ActorEntry (m_actor_x[i], i);
+        sort (m_xlist.begin(), m_xlist.end());
+        return;
+    }
+    for (size_t i=0; i<nactors; ++i)
+        m_xlist[i].pos = m_actor_x[m_xlist[i].idx];
+    for (size_t i=1; i<nactors; ++i) {
+        ActorEntry e = m_xlist[i];
+        size_t j = i;
+        for (; j>0 && e < m_xlist[j-1]; --j)
+            m_xlist[j] = m_xlist[j-1];
+        m_xlist[j] = e;
+    }
+}
 
 void World::handle_actor_contacts () {
-    size_t nactors = actorlist.size();
-    vector<ActorEntry> xlist (nactors);
+    update_actor_buffers();
+    sort_actor_xlist();
 
+    size_t nactors = m_xlist.size();
     for (size_t i=0; i<nactors; ++i) {
-        ActorInfo *ai = actorlist[i]->get_actorinfo();
-        xlist[i] = ActorEntry (ai->pos[0], i);
-    }
-    sort (xlist.begin(), xlist.end());
-    for (size_t i=0; i<nactors; ++i) {
-        size_t a1 = xlist[i].idx;
-        ActorInfo &ai1 = *actorlist[a1]->get_actorinfo();
-        double r1 = ai1.radius;
-        double x1 = ai1.pos[0];
+        size_t a1 = m_xlist[i].idx;
+        double x1 = m_xlist[i].pos;
+        double y1 = m_actor_y[a1];
+        double r1 = m_actor_r[a1];
         for (size_t j=i+1; j<nactors; ++j) {
-            size_t a2 = xlist[j].idx;
-            if (xlist[j].pos - x1 < r1 + get_radius(actorlist[a2])) 
-                handle_actor_contact (a1, a2);
-            else
+            size_t a2 = m_xlist[j].idx;
+            double r = r1 + m_actor_r[a2];
+            if (!(m_xlist[j].pos - x1 < r))
                 break;
+            // Too far apart vertically to touch.  The small margin
+            // keeps rounding in handle_actor_contact()'s distance from
+            // ever deciding differently.
+            if (fabs (m_actor_y[a2] - y1) > r + 1e-9)
+                continue;
+            handle_actor_contact (a1, a2);
         }
     }
 }
@@ -942,9 +1042,10 @@ void World::handle_contacts (unsigned actoridx)
         return;
 
     // Handle contacts with stones
-    StoneContactList cl;
-    find_stone_contacts(actor1, cl);
-    for (StoneContactList::iterator i=cl.begin(); i != cl.end(); ++i)
+    m_stone_contacts.clear();
+    find_stone_contacts(actor1, m_stone_contacts);
+    for (StoneContactList::iterator i=m_stone_contacts.begin();
+         i != m_stone_contacts.end(); ++i)
         handle_stone_contact (*i);
 }
 
@@ -958,10 +1059,14 @@ void World::move_actors (double dtime)
     rest_time += dtime;
 
     size_t nactors = actorlist.size();
-    vector<V2> global_forces (nactors);
+    m_charged_actors.clear();
+    for (size_t i=0; i<nactors; ++i)
+        if (get_charge (actorlist[i]))
+            m_charged_actors.push_back (i);
+    m_global_forces.resize (nactors);
     for (unsigned i=0; i<nactors; ++i) {
         Actor *a = actorlist[i];
-        global_forces[i] = get_global_force (a);
+        m_global_forces[i] = get_global_force (a);
     }
 
     while (rest_time > 0) {
@@ -971,7 +1076,7 @@ void World::move_actors (double dtime)
 
             // the "6" is a historical accident, don't change it!
             ai.force     = ai.forceacc * 6;
-            ai.force += global_forces[i]; 
+            ai.force += m_global_forces[i]; 
             ai.force += get_local_force (a);
 
             ai.forceacc  = V2();
@@ -1162,7 +1267,7 @@ bool world::InitWorld()
     if (!seen_player0) 
         throw XLevelLoading("Error: No player 0 defined!");
 
-    world::BroadcastMessage("init", Value(),
+    world::BroadcastMessage(MSG_INIT, Value(),
         GridLayerBits(GRID_ITEMS_BIT | GRID_STONES_BIT | GRID_FLOOR_BIT));
 
     server::InitMoveCounter();
@@ -1355,7 +1460,17 @@ void world::AddSignal (const GridLoc &srcloc,
 
     if (Object *src = GetObject(srcloc)) {
         src->set_attrib("action", "signal");
-        level->m_signals.push_back (Signal (src, dstloc, msg));
+
+        int idx = static_cast<int>(level->m_signals.size());
+        level->m_signals.push_back (Signal (src, dstloc, InternMessage(msg)));
+
+        SignalSources::iterator i = level->m_signal_sources.find(src);
+        if (i == level->m_signal_sources.end())
+            level->m_signal_sources[src] = make_pair(idx, idx);
+        else {
+            level->m_signals[i->second.second].next = idx;
+            i->second.second = idx;
+        }
     }
     else {
         Log << "AddSignal: Invalid signal source\n";
@@ -1364,35 +1479,28 @@ void world::AddSignal (const GridLoc &srcloc,
 
 bool world::HaveSignals (Object *src) 
 {
-    SignalList::const_iterator i=level->m_signals.begin(),
-        end = level->m_signals.end();
-    for (; i != end; ++i) 
-        if (i->source == src) 
-            return true;
-    return false;
+    return first_signal (level->m_signal_sources, src) != -1;
 }
 
 
 bool world::EmitSignalByIndex (Object *src, int signalidx, int value) 
 {
-    return emit_by_index (level->m_signals, src, signalidx, value);
+    return emit_by_index (level->m_signals, level->m_signal_sources,
+                          src, signalidx, value);
 }
 
 bool world::GetSignalTargetPos (Object *src, GridPos &pos, int signalidx) 
 {
-    SignalList::const_iterator i = level->m_signals.begin(),
-        end = level->m_signals.end();
-    int idx = 0;
-    for (; i != end; ++i) {
-        if (i->source == src) {
-            if (idx == signalidx) {
-                pos = i->destloc.pos;
-                return true;
-            }
-            idx += 1;
-        }
-    }
-    return false;
+    if (signalidx < 0)
+        return false;
+    const SignalList &sl = level->m_signals;
+    int i = first_signal (level->m_signal_sources, src);
+    for (int idx = 0; i != -1 && idx < signalidx; ++idx)
+        i = sl[i].next;
+    if (i == -1)
+        return false;
+    pos = sl[i].destloc.pos;
+    return true;
 }
 
 
@@ -1406,6 +1514,11 @@ Value world::SendMessage(Object *o, const std::string &msg, const Value& value)
     return SendMessage (o, Message (msg, value));
 }
 
+Value world::SendMessage(Object *o, MessageId id, const Value& value)
+{
+    return SendMessage (o, Message (id, value));
+}
+
 Value world::SendMessage (Object *o, const Message &m)
 {
     if (o) {
@@ -1425,6 +1538,14 @@ void world::BroadcastMessage (const std::string& msg,
                               const Value& value, 
                               GridLayerBits grids)
 {
+    BroadcastMessage (InternMessage (msg), value, grids);
+}
+
+void world::BroadcastMessage (MessageId id, 
+                              const Value& value, 
+                              GridLayerBits grids)
+{
+    Message m (id, value);
     int  width     = level->w;
     int  height    = level->h;
     bool to_floors = (grids & GRID_FLOOR_BIT) != 0;
@@ -1435,9 +1556,9 @@ void world::BroadcastMessage (const std::string& msg,
         for (int x = 0; x<width; ++x) {
             GridPos p(x, y);
             Field *f = level->get_field(p);
-            if (to_floors && f->floor) SendMessage (f->floor, msg, value);
-            if (to_items && f->item)  SendMessage (f->item,  msg, value);
-            if (to_stones && f->stone) SendMessage (f->stone, msg, value);
+            if (to_floors && f->floor) SendMessage (f->floor, m);
+            if (to_items && f->item)  SendMessage (f->item,  m);
+            if (to_stones && f->stone) SendMessage (f->stone, m);
         }
     }
 }
@@ -1461,7 +1582,7 @@ void world::PerformAction (Object *o, bool onoff)
         }
     }
     else if (action == "signal") {
-        emit_from (level->m_signals, o, onoff);
+        emit_from (level->m_signals, level->m_signal_sources, o, onoff);
     }
     else if (Object *t = GetNamedObject(target)) {
         if (GridObject *go = dynamic_cast<GridObject*>(o))
@@ -1481,17 +1602,17 @@ namespace
     void explosion (GridPos p, ItemID explosion_item)
     {
         if (Stone *stone = GetStone(p))
-            SendMessage(stone, "expl");
+            SendMessage(stone, MSG_EXPL);
         if (Item  *item  = GetItem(p)) {
             if (has_flags(item, itf_indestructible))
-                SendMessage(item, "expl");
+                SendMessage(item, MSG_EXPL);
             else
                 SetItem(p, explosion_item);
         }
         else
             SetItem(p, explosion_item);
         if (Floor *floor = GetFloor(p))
-            SendMessage(floor, "expl");
+            SendMessage(floor, MSG_EXPL);
     }
 }
 
@@ -1508,9 +1629,9 @@ void world::SendExplosionEffect(GridPos center, ExplosionType type)
 
         switch (type) {
         case EXPLOSION_DYNAMITE:
-            if (stone) SendMessage(stone, "ignite");
-            if (item) SendMessage(item, "ignite");
-            if (floor) SendMessage(floor, "ignite");
+            if (stone) SendMessage(stone, MSG_IGNITE);
+            if (item) SendMessage(item, MSG_IGNITE);
+            if (floor) SendMessage(floor, MSG_IGNITE);
             break;
 
         case EXPLOSION_BLACKBOMB:
@@ -1518,9 +1639,9 @@ void world::SendExplosionEffect(GridPos center, ExplosionType type)
                 explosion (dest, it_explosion1);
             } else {
                 // Note: should not ignite in non-enigma-mode!
-                if (stone) SendMessage(stone, "ignite");
-                if (item) SendMessage(item, "ignite");
-                if (floor) SendMessage(floor, "ignite");
+                if (stone) SendMessage(stone, MSG_IGNITE);
+                if (item) SendMessage(item, MSG_IGNITE);
+                if (floor) SendMessage(floor, MSG_IGNITE);
             }
             break;
 
@@ -1532,9 +1653,9 @@ void world::SendExplosionEffect(GridPos center, ExplosionType type)
 
         case EXPLOSION_BOMBSTONE:
             if (direct_neighbor) {
-                if (stone) SendMessage(stone, "bombstone");
-                if (item) SendMessage(item, "bombstone");
-                if (floor) SendMessage(floor, "bombstone");
+                if (stone) SendMessage(stone, MSG_BOMBSTONE);
+                if (item) SendMessage(item, MSG_BOMBSTONE);
+                if (floor) SendMessage(floor, MSG_BOMBSTONE);
             }
             break;
 
@@ -1800,7 +1921,7 @@ void world::ShatterActorsInsideField (const GridPos &p)
     vector<Actor *>::iterator i=actors.begin(),
         end = actors.end();
     for (; i != end; ++i) 
-        SendMessage(*i, "shatter");
+        SendMessage(*i, MSG_SHATTER);
 }
 
 
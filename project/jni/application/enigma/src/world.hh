@@ -49,9 +49,42 @@ namespace world
         {}
     };
 
+    /*!
+     * Messages are identified by small integers.  The names used in
+     * level descriptions are mapped to ids once by InternMessage(), so
+     * objects can dispatch on `Message::id' instead of comparing
+     * strings.  The messages the C++ code sends itself are predefined.
+     */
+    typedef int MessageId;
+
+    enum {
+        MSG_NONE,               // ""
+        MSG_SIGNAL,
+        MSG_TRIGGER,
+        MSG_ON,
+        MSG_OFF,
+        MSG_ONOFF,
+        MSG_OPEN,
+        MSG_CLOSE,
+        MSG_OPENCLOSE,
+        MSG_INIT,
+        MSG_EXPL,
+        MSG_IGNITE,
+        MSG_BOMBSTONE,
+        MSG_HEAT,
+        MSG_SHATTER,
+        MSG_GLASSES,
+        MSG_SCRAMBLE,
+        MSG_PREDEFINED_COUNT
+    };
+
+    MessageId          InternMessage (const std::string &name);
+    const std::string &MessageName (MessageId id);
+
     struct Message {
         // Variables
         std::string    message;
+        MessageId      id;
         enigma::Value  value;
         GridPos        gridpos;
 
@@ -60,6 +93,9 @@ namespace world
         Message (const std::string &message,
                  const enigma::Value &value,
                  GridPos gridpos = GridPos());
+        Message (MessageId id,
+                 const enigma::Value &value,
+                 GridPos gridpos = GridPos());
 
     };
 
@@ -251,9 +287,12 @@ namespace world
 
     void BroadcastMessage (const std::string& msg, const enigma::Value& value, 
                            GridLayerBits grids);
+    void BroadcastMessage (MessageId id, const enigma::Value& value, 
+                           GridLayerBits grids);
 
     Value SendMessage (Object *o, const string &msg);
     Value SendMessage (Object *o, const string &msg, const enigma::Value& value);
+    Value SendMessage (Object *o, MessageId id, const enigma::Value& value = Value());
     Value SendMessage (Object *o, const Message &m);
 
     /*! This function is used by all triggers, switches etc. that
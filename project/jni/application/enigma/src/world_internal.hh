@@ -17,6 +17,7 @@
  *
  */
 
+#include <map>
 #include <memory>
 
 namespace world
@@ -36,16 +37,21 @@ namespace world
 
     struct Signal {
         // Variables
-        Object *source;
-        GridLoc destloc;
-        string message;
+        Object    *source;
+        GridLoc    destloc;
+        MessageId  message;
+        int        next;    // next signal from the same source, or -1
 
         // Constructor
-        Signal (Object *src, GridLoc dstloc, const string &msg)
-        : source (src), destloc(dstloc), message(msg)
+        Signal (Object *src, GridLoc dstloc, MessageId msg)
+        : source (src), destloc(dstloc), message(msg), next(-1)
         {}
     };
 
+    /*! Indices of the first and the last signal of every signal
+      source in World::m_signals. */
+    typedef std::map<Object*, std::pair<int, int> > SignalSources;
+
 /* -------------------- RubberBand -------------------- */
     
     /*! Stores the physical information about a rubber band (to which
@@ -319,6 +325,8 @@ typedef list<sound::SoundDamping> SoundDampingList;
         void find_contact_with_stone (Actor *a, GridPos p, StoneContact &c);
         void find_stone_contacts (Actor *a, StoneContactList &cl);
         void handle_stone_contact (StoneContact &sc);
+        void update_actor_buffers ();
+        void sort_actor_xlist ();
         void handle_actor_contacts ();
         void handle_actor_contact (size_t a1, size_t a2);
         void handle_contacts (unsigned actoridx);
@@ -336,6 +344,7 @@ typedef list<sound::SoundDamping> SoundDampingList;
         ActorList            actorlist; // List of movable, dynamic objects
         vector<RubberBand *> m_rubberbands;
         SignalList           m_signals;
+        SignalSources        m_signal_sources;
         MouseForce           m_mouseforce;
         ConstantForce        m_flatforce;
         int                  scrambleIntensity;
@@ -353,6 +362,31 @@ typedef list<sound::SoundDamping> SoundDampingList;
         StoneLayer      st_layer;
 
     private:
+        /* ---------- Physics buffers ---------- */
+
+        // Entry of the actor list sorted by x, used for finding
+        // actor-actor contacts
+        struct ActorEntry {
+            double pos;
+            size_t idx;
+
+            ActorEntry () { pos = 0; idx = 0; }
+            ActorEntry (double pos_, size_t idx_) { pos = pos_; idx = idx_; }
+
+            bool operator < (const ActorEntry &x) const {
+                return pos < x.pos || (pos == x.pos && idx < x.idx);
+            }
+        };
+
+        // Kept from one time step to the next so nothing is allocated
+        // while the actors move.  Positions and radii are copied out of
+        // the ActorInfos once per step, indexed like `actorlist'.
+        vector<double>       m_actor_x, m_actor_y, m_actor_r;
+        vector<ActorEntry>   m_xlist;
+        vector<V2>           m_global_forces;
+        vector<size_t>       m_charged_actors;
+        StoneContactList     m_stone_contacts;
+
         ecl::Dict<Object *> m_objnames; // Name -> object mapping
 
         list<Scramble> scrambles;
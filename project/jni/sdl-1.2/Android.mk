@@ -55,12 +55,22 @@ LOCAL_CPP_EXTENSION := .cpp
 # Note this "simple" makefile var substitution, you can find even more complex examples in different Android projects
 LOCAL_SRC_FILES := $(foreach F, $(SDL_SRCS), $(addprefix $(dir $(F)),$(notdir $(wildcard $(LOCAL_PATH)/$(F)))))
 
+# NEON blitters and audio routines are picked at runtime with SDL_HasNEON(), so on armeabi-v7a only their files are compiled with NEON
+SDL_NEON_SRCS := src/video/SDL_blit_neon.c src/audio/SDL_audio_neon.c
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_CFLAGS += -DSDL_NEON_BLITTERS=1 -DSDL_NEON_AUDIO=1
+LOCAL_SRC_FILES := $(filter-out $(SDL_NEON_SRCS),$(LOCAL_SRC_FILES)) $(addsuffix .neon,$(SDL_NEON_SRCS))
+endif
+ifeq ($(TARGET_ARCH_ABI),arm64-v8a)
+LOCAL_CFLAGS += -DSDL_NEON_BLITTERS=1 -DSDL_NEON_AUDIO=1
+endif
+
 LOCAL_SHARED_LIBRARIES := sdl_native_helpers # Not really a dependency, needed for CustomBuildScript
 
 ifdef USE_GLSHIM 
 LOCAL_STATIC_LIBRARIES := glshim
 endif
 
-LOCAL_LDLIBS := -lGLESv1_CM -ldl -llog
+LOCAL_LDLIBS := -lGLESv1_CM -lOpenSLES -ldl -llog
 
 include $(BUILD_SHARED_LIBRARY)
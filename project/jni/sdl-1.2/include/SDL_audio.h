@@ -135,6 +135,14 @@ typedef struct SDL_AudioCVT {
 	double len_ratio; 	/**< Given len, final size is len*len_ratio */
 	void (SDLCALL *filters[10])(struct SDL_AudioCVT *cvt, Uint16 format);
 	int filter_index;		/**< Current audio conversion function */
+	Uint8 src_channels;		/**< Channels going into the fused converter */
+	Uint8 dst_channels;		/**< Channels coming out of it */
+	int src_rate;			/**< Source rate, 0 if it isn't changed */
+	int dst_rate;			/**< Target rate */
+	int rate_kept;			/**< Input frames kept from the last buffer, -1 before the first */
+	int rate_pos;			/**< Resampler position in the kept frames */
+	Uint32 rate_rem;		/**< ...and its fraction, in 1/dst_rate */
+	Sint16 rate_history[96*8];	/**< The kept frames, up to 96 per channel */
 } SDL_AudioCVT;
 
 
@@ -228,6 +236,13 @@ extern DECLSPEC void SDLCALL SDL_FreeWAV(Uint8 *audio_buf);
  * and rate, and initializes the 'cvt' structure with information needed
  * by SDL_ConvertAudio() to convert a buffer of audio data from one format
  * to the other.
+ * Any rate change is supported, with a band-limited resampler, so the
+ * converted length cvt->len_cvt is not always cvt->len*cvt->len_ratio.
+ * The resampler keeps the last few frames of each buffer, so buffers
+ * converted one after another join up like one long buffer.  The frames
+ * that need input from the next buffer come out with it, which holds
+ * back well under a millisecond of the last buffer.  Build the 'cvt'
+ * again to start an unrelated stream.
  *
  * @return This function returns 0, or -1 if there was an error.
  */
@@ -941,6 +941,13 @@ extern DECLSPEC SDL_GrabMode SDLCALL SDL_WM_GrabInput(SDL_GrabMode mode);
 /** @internal Not in public API at the moment - do not use! */
 extern DECLSPEC int SDLCALL SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                                     SDL_Surface *dst, SDL_Rect *dstrect);
+
+/** @internal Same as SDL_SoftStretch(), but with bilinear filtering of 16
+ *  and 32 bpp surfaces.  Integer scale factors use pixel replication.
+ *  Software YUV overlays stretch with it when SDL_VIDEO_YUV_SMOOTH=1.
+ */
+extern DECLSPEC int SDLCALL SDL_SoftStretchLinear(SDL_Surface *src, SDL_Rect *srcrect,
+                                    SDL_Surface *dst, SDL_Rect *dstrect);
                     
 /* Ends C function definitions when using C++ */
 #ifdef __cplusplus
@@ -526,7 +526,7 @@ int SDL_OpenAudio(SDL_AudioSpec *desired, SDL_AudioSpec *obtained)
                     desired->format != audio->spec.format ||
 	            desired->channels != audio->spec.channels ) {
 		/* Build an audio conversion block */
-		if ( SDL_BuildAudioCVT(&audio->convert,
+		if ( SDL_BuildDeviceAudioCVT(&audio->convert,
 			desired->format, desired->channels,
 					desired->freq,
 			audio->spec.format, audio->spec.channels,
@@ -33,3 +33,17 @@ extern void SDL_CalculateAudioSpec(SDL_AudioSpec *spec);
 /* The actual mixing thread function */
 extern int SDLCALL SDL_RunAudio(void *audiop);
 
+/* SDL_BuildAudioCVT() limited to power of two rate changes, so the
+   converted buffer is always len*len_ratio bytes (SDL_audiocvt.c) */
+extern int SDL_BuildDeviceAudioCVT(SDL_AudioCVT *cvt,
+	Uint16 src_format, Uint8 src_channels, int src_rate,
+	Uint16 dst_format, Uint8 dst_channels, int dst_rate);
+
+#if SDL_NEON_AUDIO
+/* Functions found in SDL_audio_neon.c, use them only if SDL_AudioNEONEnabled() */
+extern int SDL_AudioNEONEnabled(void);
+extern Sint32 SDL_ResampleDotNEON(const Sint16 *samples, const Sint16 *coeffs, int taps);
+extern Uint32 SDL_MixAudioS16NEON(Uint8 *dst, const Uint8 *src, Uint32 len, int volume, int bigendian);
+extern Uint32 SDL_MixAudioS8NEON(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+extern Uint32 SDL_MixAudioU8NEON(Uint8 *dst, const Uint8 *src, Uint32 len, int volume);
+#endif
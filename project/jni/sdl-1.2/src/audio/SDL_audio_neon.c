@@ -0,0 +1,291 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* ARM NEON audio routines.
+   On armeabi-v7a this file is the only audio file built with NEON enabled,
+   the routines are used only when SDL_AudioNEONEnabled() says the CPU
+   has NEON, and give the same results as the C versions.
+ */
+
+#include "SDL_audio.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_audio_c.h"
+
+#if SDL_NEON_AUDIO
+
+#include <arm_neon.h>
+
+/* Set SDL_NEON_AUDIO=0 to get the C routines, for comparison */
+int SDL_AudioNEONEnabled(void)
+{
+	const char *hint = SDL_getenv("SDL_NEON_AUDIO");
+
+	if ( hint && *hint == '0' ) {
+		return 0;
+	}
+	return SDL_HasNEON();
+}
+
+/* Resampler filter tap, 'taps' is a multiple of 8 */
+Sint32 SDL_ResampleDotNEON(const Sint16 *samples, const Sint16 *coeffs, int taps)
+{
+	int32x4_t sum = vdupq_n_s32(0);
+	int32x2_t half;
+
+	for ( ; taps; taps -= 8, samples += 8, coeffs += 8 ) {
+		sum = vmlal_s16(sum, vld1_s16(samples), vld1_s16(coeffs));
+		sum = vmlal_s16(sum, vld1_s16(samples+4), vld1_s16(coeffs+4));
+	}
+	half = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+	half = vpadd_s32(half, half);
+	return vget_lane_s32(half, 0);
+}
+
+/* Scale eight samples by volume/SDL_MIX_MAXVOLUME, rounding toward zero
+   like the integer division in SDL_MixAudio() */
+static int16x8_t SDL_MixVolumeS16NEON(int16x8_t s, int16x4_t vol)
+{
+	const int32x4_t bias = vdupq_n_s32(SDL_MIX_MAXVOLUME-1);
+	int32x4_t lo = vmull_s16(vget_low_s16(s), vol);
+	int32x4_t hi = vmull_s16(vget_high_s16(s), vol);
+
+	lo = vaddq_s32(lo, vandq_s32(vshrq_n_s32(lo, 31), bias));
+	hi = vaddq_s32(hi, vandq_s32(vshrq_n_s32(hi, 31), bias));
+	return vcombine_s16(vshrn_n_s32(lo, 7), vshrn_n_s32(hi, 7));
+}
+
+/* Same for sixteen 8-bit samples already widened to two halves */
+static int8x16_t SDL_MixVolumeS8NEON(int16x8_t lo, int16x8_t hi, int volume)
+{
+	const int16x8_t bias = vdupq_n_s16(SDL_MIX_MAXVOLUME-1);
+
+	lo = vmulq_n_s16(lo, (Sint16)volume);
+	hi = vmulq_n_s16(hi, (Sint16)volume);
+	lo = vaddq_s16(lo, vandq_s16(vshrq_n_s16(lo, 15), bias));
+	hi = vaddq_s16(hi, vandq_s16(vshrq_n_s16(hi, 15), bias));
+	return vcombine_s8(vshrn_n_s16(lo, 7), vshrn_n_s16(hi, 7));
+}
+
+/* SDL_MixAudio() kernels.  They mix whole 16 byte blocks and return the
+   number of bytes done, SDL_MixAudio() mixes what is left.  'volume' must
+   be 1..SDL_MIX_MAXVOLUME.
+ */
+Uint32 SDL_MixAudioS16NEON(Uint8 *dst, const Uint8 *src, Uint32 len, int volume, int bigendian)
+{
+	const int16x4_t vol = vdup_n_s16((Sint16)volume);
+	const Uint32 done = len & ~15;
+	uint8x16_t s8, d8;
+	int16x8_t s;
+
+	for ( len = done; len; len -= 16, src += 16, dst += 16 ) {
+		s8 = vld1q_u8(src);
+		d8 = vld1q_u8(dst);
+		if ( bigendian ) {
+			s8 = vrev16q_u8(s8);
+			d8 = vrev16q_u8(d8);
+		}
+		s = vreinterpretq_s16_u8(s8);
+		if ( volume < SDL_MIX_MAXVOLUME ) {
+			s = SDL_MixVolumeS16NEON(s, vol);
+		}
+		d8 = vreinterpretq_u8_s16(vqaddq_s16(vreinterpretq_s16_u8(d8), s));
+		if ( bigendian ) {
+			d8 = vrev16q_u8(d8);
+		}
+		vst1q_u8(dst, d8);
+	}
+	return done;
+}
+
+Uint32 SDL_MixAudioS8NEON(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const Uint32 done = len & ~15;
+	int8x16_t s;
+
+	for ( len = done; len; len -= 16, src += 16, dst += 16 ) {
+		s = vld1q_s8((const int8_t *)src);
+		if ( volume < SDL_MIX_MAXVOLUME ) {
+			s = SDL_MixVolumeS8NEON(vmovl_s8(vget_low_s8(s)),
+			                        vmovl_s8(vget_high_s8(s)), volume);
+		}
+		vst1q_s8((int8_t *)dst, vqaddq_s8(vld1q_s8((const int8_t *)dst), s));
+	}
+	return done;
+}
+
+/* The C mixer looks U8 sums up in a table that clamps to 0..254 */
+Uint32 SDL_MixAudioU8NEON(Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	const Uint32 done = len & ~15;
+	const uint8x8_t mid = vdup_n_u8(0x80);
+	const uint16x8_t bias = vdupq_n_u16(0x80);
+	const uint16x8_t top = vdupq_n_u16(0xFE);
+	uint8x16_t s, d;
+	uint16x8_t lo, hi;
+
+	for ( len = done; len; len -= 16, src += 16, dst += 16 ) {
+		s = vld1q_u8(src);
+		d = vld1q_u8(dst);
+		if ( volume < SDL_MIX_MAXVOLUME ) {
+			int8x16_t t = SDL_MixVolumeS8NEON(
+				vreinterpretq_s16_u16(vsubl_u8(vget_low_u8(s), mid)),
+				vreinterpretq_s16_u16(vsubl_u8(vget_high_u8(s), mid)),
+				volume);
+			s = veorq_u8(vreinterpretq_u8_s8(t), vdupq_n_u8(0x80));
+		}
+		lo = vaddl_u8(vget_low_u8(d), vget_low_u8(s));
+		hi = vaddl_u8(vget_high_u8(d), vget_high_u8(s));
+		lo = vminq_u16(vqsubq_u16(lo, bias), top);
+		hi = vminq_u16(vqsubq_u16(hi, bias), top);
+		vst1q_u8(dst, vcombine_u8(vmovn_u16(lo), vmovn_u16(hi)));
+	}
+	return done;
+}
+
+#ifdef TEST_MAIN
+
+/* Mixer benchmark, checks the NEON kernels against the C loops of
+   SDL_MixAudio() at every volume, then prints Msamples/s of both.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_LEN	4096	/* bytes, 1024 stereo S16 frames */
+#define BENCH_MIXES	20000
+
+/* The C loops of SDL_MixAudio(), S16 is either endianness */
+static void MixC(Uint16 format, Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	int sample;
+
+	switch ( format ) {
+	case AUDIO_U8:
+		for ( ; len; --len, ++dst, ++src ) {
+			sample = *dst + ((*src - 128) * volume) / SDL_MIX_MAXVOLUME;
+			*dst = (Uint8)((sample < 0) ? 0 : (sample > 0xFE) ? 0xFE : sample);
+		}
+		break;
+	case AUDIO_S8:
+		for ( ; len; --len, ++dst, ++src ) {
+			sample = *(Sint8 *)dst + (*(const Sint8 *)src * volume) / SDL_MIX_MAXVOLUME;
+			*dst = (Uint8)((sample < -128) ? -128 : (sample > 127) ? 127 : sample);
+		}
+		break;
+	default:
+		for ( len /= 2; len; --len, dst += 2, src += 2 ) {
+			if ( format == AUDIO_S16MSB ) {
+				sample = (Sint16)(dst[0] << 8 | dst[1]) +
+				         ((Sint16)(src[0] << 8 | src[1]) * volume) / SDL_MIX_MAXVOLUME;
+			} else {
+				sample = (Sint16)(dst[1] << 8 | dst[0]) +
+				         ((Sint16)(src[1] << 8 | src[0]) * volume) / SDL_MIX_MAXVOLUME;
+			}
+			sample = (sample < -32768) ? -32768 : (sample > 32767) ? 32767 : sample;
+			if ( format == AUDIO_S16MSB ) {
+				dst[0] = (Uint8)(sample >> 8);
+				dst[1] = (Uint8)sample;
+			} else {
+				dst[0] = (Uint8)sample;
+				dst[1] = (Uint8)(sample >> 8);
+			}
+		}
+		break;
+	}
+}
+
+/* What SDL_MixAudio() does with NEON: the kernel, then C for the tail */
+static void MixNEON(Uint16 format, Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
+{
+	Uint32 done;
+
+	switch ( format ) {
+	case AUDIO_U8:
+		done = SDL_MixAudioU8NEON(dst, src, len, volume);
+		break;
+	case AUDIO_S8:
+		done = SDL_MixAudioS8NEON(dst, src, len, volume);
+		break;
+	default:
+		done = SDL_MixAudioS16NEON(dst, src, len, volume, format == AUDIO_S16MSB);
+		break;
+	}
+	MixC(format, dst + done, src + done, len - done, volume);
+}
+
+static double Bench(void (*mix)(Uint16, Uint8 *, const Uint8 *, Uint32, int),
+                    Uint16 format, Uint8 *dst, const Uint8 *src, int volume)
+{
+	clock_t start, ticks;
+	int i;
+
+	start = clock();
+	for ( i = 0; i < BENCH_MIXES; ++i ) {
+		mix(format, dst, src, BENCH_LEN, volume);
+	}
+	ticks = clock() - start;
+	return (double)BENCH_LEN / ((format & 0xFF) / 8) * BENCH_MIXES / 1e6 *
+	       CLOCKS_PER_SEC / (ticks ? ticks : 1);
+}
+
+int main(int argc, char *argv[])
+{
+	static const Uint16 formats[] = { AUDIO_U8, AUDIO_S8, AUDIO_S16LSB, AUDIO_S16MSB };
+	static const char *names[] = { "U8", "S8", "S16LSB", "S16MSB" };
+	static Uint8 src[BENCH_LEN], dst[BENCH_LEN], ref[BENCH_LEN];
+	int f, volume, len, i, errors = 0;
+
+	printf("NEON: %d\n", SDL_HasNEON());
+
+	/* Every volume, with lengths that leave a tail for the C loop */
+	for ( f = 0; f < 4; ++f ) {
+		for ( volume = 1; volume <= SDL_MIX_MAXVOLUME; ++volume ) {
+			for ( len = BENCH_LEN - 17; len <= BENCH_LEN; ++len ) {
+				for ( i = 0; i < BENCH_LEN; ++i ) {
+					src[i] = (Uint8)(i * 7 + (i >> 8) * 13 + volume);
+					dst[i] = ref[i] = (Uint8)(i * 11 + (i >> 7) * 3);
+				}
+				MixC(formats[f], ref, src, len, volume);
+				MixNEON(formats[f], dst, src, len, volume);
+				if ( SDL_memcmp(ref, dst, BENCH_LEN) != 0 ) {
+					++errors;
+				}
+			}
+		}
+	}
+	printf("%s\n", errors ? "MISMATCH" : "NEON mixing matches C");
+
+	for ( f = 0; f < 4; ++f ) {
+		for ( volume = 100; volume <= SDL_MIX_MAXVOLUME; volume += SDL_MIX_MAXVOLUME - 100 ) {
+			printf("%-6s volume %3d: C %8.1f Msamples/s, NEON %8.1f Msamples/s\n",
+			       names[f], volume,
+			       Bench(MixC, formats[f], dst, src, volume),
+			       Bench(MixNEON, formats[f], dst, src, volume));
+		}
+	}
+	return errors != 0;
+}
+
+#endif /* TEST_MAIN */
+
+#endif /* SDL_NEON_AUDIO */
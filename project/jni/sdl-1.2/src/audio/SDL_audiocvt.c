@@ -23,7 +23,14 @@
 
 /* Functions for audio drivers to perform runtime conversion of audio format */
 
+#include <math.h>	/* Used for building the resampling filter */
+
 #include "SDL_audio.h"
+#include "SDL_audio_c.h"
+
+#ifndef M_PI
+#define M_PI	3.14159265358979323846
+#endif
 
 
 /* Effectively mix right and left channels into a single channel */
@@ -1300,6 +1307,549 @@ void SDLCALL SDL_RateSLOW(SDL_AudioCVT *cvt, Uint16 format)
 	}
 }
 
+/* Single pass conversion, set up by SDL_BuildAudioCVT().
+   Every sample is decoded to signed 16-bit, remixed between mono and
+   stereo and encoded to the target format in one loop.  Rate changes
+   go through a windowed sinc resampler: the input is decoded into
+   planar 16-bit channels, and each output sample is the dot product of
+   16 to 48 input samples with one of RESAMPLER_PHASES filter phases.
+   The resampler carries its input history and position in the cvt
+   from one buffer of a stream to the next.
+*/
+#define RESAMPLER_ZERO_CROSSINGS	8	/* per side, when upsampling */
+#define RESAMPLER_MAX_TAPS	48
+#define RESAMPLER_PHASES	128
+#define RESAMPLER_TABLE_RES	256	/* table entries per zero crossing */
+#define RESAMPLER_BITS		14	/* filter coefficients are 2.14 */
+
+#define RESAMPLER_HISTORY	(2*RESAMPLER_MAX_TAPS)	/* input frames kept per channel */
+
+SDL_COMPILE_TIME_ASSERT(rate_history,
+	sizeof(((SDL_AudioCVT *)0)->rate_history) == RESAMPLER_HISTORY*8*sizeof(Sint16));
+
+static float resampler_sinc[(RESAMPLER_MAX_TAPS/2)*RESAMPLER_TABLE_RES+2];
+static float resampler_window[RESAMPLER_TABLE_RES+2];
+static int resampler_ready = 0;
+
+/* SDL_mixer converts streamed music from the audio callback, so the
+   filter banks and the plane buffers are kept between calls instead of
+   being built and allocated for every chunk.  Slots are claimed with an
+   atomic compare and swap; when all are taken, or without the atomics,
+   the conversion allocates a bank and a buffer for the call. */
+#define RESAMPLER_BANKS		8	/* one per source rate, the destination is the device rate */
+#define RESAMPLER_SCRATCH	4
+#define RESAMPLER_SCRATCH_MAX	(256*1024)	/* larger buffers aren't kept */
+
+/* Flags go 0 -> 1 when claimed, and from 1 to 'value' when done */
+#if defined(__GNUC__)
+#define RESAMPLER_CLAIM(flag)	__sync_bool_compare_and_swap(&(flag), 0, 1)
+#define RESAMPLER_IS(flag, value)	__sync_bool_compare_and_swap(&(flag), value, value)
+#define RESAMPLER_SET(flag, value)	__sync_bool_compare_and_swap(&(flag), 1, value)
+#else
+#define RESAMPLER_CLAIM(flag)	0
+#define RESAMPLER_IS(flag, value)	0
+#define RESAMPLER_SET(flag, value)	((flag) = (value))
+#endif
+
+static struct {
+	volatile int state;	/* 0 free, 1 being built, 2 ready */
+	Uint32 src_rate;
+	Uint32 dst_rate;
+	int taps;
+	Sint16 coeffs[RESAMPLER_PHASES*RESAMPLER_MAX_TAPS];
+} resampler_banks[RESAMPLER_BANKS];
+
+static struct {
+	volatile int busy;
+	int size;		/* in samples */
+	Sint16 *samples;
+} resampler_scratch[RESAMPLER_SCRATCH];
+
+#define FUSED_BLOCK	256	/* frames converted at a time */
+
+/* Decode 'count' samples to signed 16-bit */
+static void DecodeBlock(const Uint8 *src, Uint16 format, int count, Sint16 *dst)
+{
+	switch (format) {
+	    case AUDIO_U8:
+		while ( count-- ) {
+			*dst++ = (Sint16)((*src++ ^ 0x80) << 8);
+		}
+		break;
+	    case AUDIO_S8:
+		while ( count-- ) {
+			*dst++ = (Sint16)(*src++ << 8);
+		}
+		break;
+	    case AUDIO_U16LSB:
+		while ( count-- ) {
+			*dst++ = (Sint16)((src[0] | (src[1] << 8)) ^ 0x8000);
+			src += 2;
+		}
+		break;
+	    case AUDIO_S16LSB:
+		while ( count-- ) {
+			*dst++ = (Sint16)(src[0] | (src[1] << 8));
+			src += 2;
+		}
+		break;
+	    case AUDIO_U16MSB:
+		while ( count-- ) {
+			*dst++ = (Sint16)(((src[0] << 8) | src[1]) ^ 0x8000);
+			src += 2;
+		}
+		break;
+	    case AUDIO_S16MSB:
+		while ( count-- ) {
+			*dst++ = (Sint16)((src[0] << 8) | src[1]);
+			src += 2;
+		}
+		break;
+	}
+}
+
+/* Encode 'count' signed 16-bit samples */
+static void EncodeBlock(const Sint16 *src, Uint16 format, int count, Uint8 *dst)
+{
+	switch (format) {
+	    case AUDIO_U8:
+		while ( count-- ) {
+			*dst++ = (Uint8)((*src++ >> 8) ^ 0x80);
+		}
+		break;
+	    case AUDIO_S8:
+		while ( count-- ) {
+			*dst++ = (Uint8)(*src++ >> 8);
+		}
+		break;
+	    case AUDIO_U16LSB:
+		while ( count-- ) {
+			Uint16 sample = (Uint16)*src++ ^ 0x8000;
+			dst[0] = (Uint8)sample;
+			dst[1] = (Uint8)(sample >> 8);
+			dst += 2;
+		}
+		break;
+	    case AUDIO_S16LSB:
+		while ( count-- ) {
+			Uint16 sample = (Uint16)*src++;
+			dst[0] = (Uint8)sample;
+			dst[1] = (Uint8)(sample >> 8);
+			dst += 2;
+		}
+		break;
+	    case AUDIO_U16MSB:
+		while ( count-- ) {
+			Uint16 sample = (Uint16)*src++ ^ 0x8000;
+			dst[0] = (Uint8)(sample >> 8);
+			dst[1] = (Uint8)sample;
+			dst += 2;
+		}
+		break;
+	    case AUDIO_S16MSB:
+		while ( count-- ) {
+			Uint16 sample = (Uint16)*src++;
+			dst[0] = (Uint8)(sample >> 8);
+			dst[1] = (Uint8)sample;
+			dst += 2;
+		}
+		break;
+	}
+}
+
+/* Decode 'frames' frames and remix them between mono and stereo,
+   'block' must hold frames*max(src_channels, dst_channels) samples */
+static void DecodeFrames(const Uint8 *src, Uint16 format, int frames,
+                         int src_channels, int dst_channels, Sint16 *block)
+{
+	int i;
+
+	DecodeBlock(src, format, frames*src_channels, block);
+	if ( src_channels == dst_channels ) {
+		return;
+	}
+	if ( src_channels == 1 ) {
+		for ( i=frames-1; i>=0; --i ) {
+			block[2*i] = block[2*i+1] = block[i];
+		}
+	} else {
+		for ( i=0; i<frames; ++i ) {
+			block[i] = (Sint16)((block[2*i] + block[2*i+1]) / 2);
+		}
+	}
+}
+
+static void InitResampler(void)
+{
+	int i;
+	double x;
+
+	/* Both tables come out the same every time, so a race is harmless */
+	if ( resampler_ready ) {
+		return;
+	}
+	resampler_sinc[0] = 1.0f;
+	for ( i=1; i<(int)SDL_arraysize(resampler_sinc); ++i ) {
+		x = M_PI * i / RESAMPLER_TABLE_RES;
+		resampler_sinc[i] = (float)(sin(x) / x);
+	}
+	/* Blackman window over [0, 1] */
+	for ( i=0; i<(int)SDL_arraysize(resampler_window); ++i ) {
+		x = M_PI * i / RESAMPLER_TABLE_RES;
+		resampler_window[i] = (float)(0.42 + 0.5*cos(x) + 0.08*cos(2*x));
+	}
+	resampler_window[RESAMPLER_TABLE_RES] = 0.0f;
+	resampler_window[RESAMPLER_TABLE_RES+1] = 0.0f;
+	resampler_ready = 1;
+}
+
+static __inline__ float ResamplerLookup(const float *table, float pos)
+{
+	int i = (int)pos;
+	float frac = pos - i;
+
+	return table[i] + (table[i+1] - table[i]) * frac;
+}
+
+/* Fill 'bank' with RESAMPLER_PHASES phases of the filter, returns the
+   number of taps of each phase, a multiple of 8.
+*/
+static int BuildResamplerBank(Sint16 *bank, int src_rate, int dst_rate)
+{
+	float weight[RESAMPLER_MAX_TAPS];
+	float cutoff, sum, x;
+	int half, taps;
+	int phase, i;
+
+	InitResampler();
+
+	/* Cut a bit below the lower Nyquist frequency, so the transition
+	   band doesn't alias back into the passband. */
+	cutoff = 0.95f;
+	if ( dst_rate < src_rate ) {
+		cutoff = cutoff * dst_rate / src_rate;
+	}
+	half = (int)ceil(RESAMPLER_ZERO_CROSSINGS / cutoff);
+	half = (half + 3) & ~3;
+	if ( half > RESAMPLER_MAX_TAPS/2 ) {
+		half = RESAMPLER_MAX_TAPS/2;
+	}
+	taps = half*2;
+
+	for ( phase=0; phase<RESAMPLER_PHASES; ++phase ) {
+		sum = 0.0f;
+		for ( i=0; i<taps; ++i ) {
+			x = (float)(i - half + 1) - (float)phase / RESAMPLER_PHASES;
+			if ( x < 0.0f ) {
+				x = -x;
+			}
+			weight[i] = cutoff *
+			  ResamplerLookup(resampler_sinc, x*cutoff*RESAMPLER_TABLE_RES) *
+			  ResamplerLookup(resampler_window, x*RESAMPLER_TABLE_RES/half);
+			sum += weight[i];
+		}
+		/* Unity gain for every phase */
+		for ( i=0; i<taps; ++i ) {
+			bank[i] = (Sint16)floor(weight[i] / sum * (1<<RESAMPLER_BITS) + 0.5f);
+		}
+		bank += taps;
+	}
+	return(taps);
+}
+
+/* Returns the bank for the rate pair, from the cache when possible,
+   otherwise built into '*fallback', which the caller frees */
+static const Sint16 *GetResamplerBank(Uint32 src_rate, Uint32 dst_rate,
+                                      Sint16 **fallback, int *taps)
+{
+	int i;
+
+	for ( i=0; i<RESAMPLER_BANKS; ++i ) {
+		if ( RESAMPLER_IS(resampler_banks[i].state, 2) ) {
+			if ( (resampler_banks[i].src_rate == src_rate) &&
+			     (resampler_banks[i].dst_rate == dst_rate) ) {
+				*taps = resampler_banks[i].taps;
+				return(resampler_banks[i].coeffs);
+			}
+		}
+	}
+	for ( i=0; i<RESAMPLER_BANKS; ++i ) {
+		if ( RESAMPLER_CLAIM(resampler_banks[i].state) ) {
+			resampler_banks[i].src_rate = src_rate;
+			resampler_banks[i].dst_rate = dst_rate;
+			resampler_banks[i].taps = BuildResamplerBank(
+				resampler_banks[i].coeffs, src_rate, dst_rate);
+			RESAMPLER_SET(resampler_banks[i].state, 2);
+			*taps = resampler_banks[i].taps;
+			return(resampler_banks[i].coeffs);
+		}
+	}
+	*fallback = (Sint16 *)SDL_malloc(
+		RESAMPLER_PHASES*RESAMPLER_MAX_TAPS*sizeof(Sint16));
+	if ( *fallback == NULL ) {
+		return(NULL);
+	}
+	*taps = BuildResamplerBank(*fallback, src_rate, dst_rate);
+	return(*fallback);
+}
+
+/* Returns a buffer of at least 'count' samples, release it with
+   PutResamplerScratch().  A cached buffer only grows, so a stream of
+   similar chunks allocates on its first chunk only. */
+static Sint16 *GetResamplerScratch(int count, int *slot)
+{
+	int i;
+
+	if ( count <= RESAMPLER_SCRATCH_MAX ) {
+		for ( i=0; i<RESAMPLER_SCRATCH; ++i ) {
+			if ( !RESAMPLER_CLAIM(resampler_scratch[i].busy) ) {
+				continue;
+			}
+			if ( resampler_scratch[i].size < count ) {
+				SDL_free(resampler_scratch[i].samples);
+				resampler_scratch[i].size = (count + 4095) & ~4095;
+				resampler_scratch[i].samples = (Sint16 *)SDL_malloc(
+				  resampler_scratch[i].size*sizeof(Sint16));
+				if ( resampler_scratch[i].samples == NULL ) {
+					resampler_scratch[i].size = 0;
+					RESAMPLER_SET(resampler_scratch[i].busy, 0);
+					break;
+				}
+			}
+			*slot = i;
+			return(resampler_scratch[i].samples);
+		}
+	}
+	*slot = -1;
+	return((Sint16 *)SDL_malloc(count*sizeof(Sint16)));
+}
+
+static void PutResamplerScratch(Sint16 *samples, int slot)
+{
+	if ( slot < 0 ) {
+		SDL_free(samples);
+	} else {
+		RESAMPLER_SET(resampler_scratch[slot].busy, 0);
+	}
+}
+
+static Sint32 ResampleDot(const Sint16 *samples, const Sint16 *coeffs, int taps)
+{
+	Sint32 sum = 0;
+	int i;
+
+	for ( i=0; i<taps; ++i ) {
+		sum += samples[i] * coeffs[i];
+	}
+	return(sum);
+}
+
+/* Resamples a buffer of a stream.  The input the next output frame
+   needs and the position are kept in the cvt, so the next buffer goes
+   on exactly where this one stopped.  An output frame needs input up to
+   half the filter ahead of it, the last few of them wait for the next
+   buffer, as do frames that don't fit this one. */
+static void ResampleFused(SDL_AudioCVT *cvt, Uint16 format)
+{
+	Sint16 block[FUSED_BLOCK*8];
+	Sint16 *fallback = NULL;
+	const Sint16 *bank;
+	Sint16 *planes;
+	int scratch;
+	Sint32 (*dot)(const Sint16 *, const Sint16 *, int) = ResampleDot;
+	const int src_channels = cvt->src_channels;
+	const int channels = cvt->dst_channels;
+	const int src_frame = ((format & 0xFF) / 8) * src_channels;
+	const int dst_frame = ((cvt->dst_format & 0xFF) / 8) * channels;
+	const Uint32 src_rate = cvt->src_rate;
+	const Uint32 dst_rate = cvt->dst_rate;
+	int src_frames, frames, kept, start, max_frames, dst_frames;
+	int taps, half;
+	int first, phase;
+	Uint32 pos, rem;
+	int i, j, n, c;
+	Sint32 sum;
+	Uint8 *p;
+
+	src_frames = cvt->len_cvt / src_frame;
+	if ( src_frames == 0 ) {
+		cvt->len_cvt = 0;
+		return;
+	}
+	bank = GetResamplerBank(src_rate, dst_rate, &fallback, &taps);
+	if ( bank == NULL ) {
+		SDL_OutOfMemory();
+		cvt->len_cvt = 0;
+		return;
+	}
+	half = taps/2;
+	kept = (cvt->rate_kept < 0) ? taps : cvt->rate_kept;
+	frames = kept + src_frames;
+	planes = GetResamplerScratch(frames*channels, &scratch);
+	if ( planes == NULL ) {
+		SDL_OutOfMemory();
+		SDL_free(fallback);
+		cvt->len_cvt = 0;
+		return;
+	}
+
+	/* The kept frames, then the new ones decoded and remixed, one
+	   plane per channel */
+	p = cvt->buf;
+	for ( i=0; i<src_frames; i+=n ) {
+		n = src_frames - i;
+		if ( n > FUSED_BLOCK ) {
+			n = FUSED_BLOCK;
+		}
+		DecodeFrames(p, format, n, src_channels, channels, block);
+		for ( c=0; c<channels; ++c ) {
+			Sint16 *plane = planes + c*frames + kept + i;
+			for ( j=0; j<n; ++j ) {
+				plane[j] = block[j*channels+c];
+			}
+		}
+		p += n*src_frame;
+	}
+	if ( cvt->rate_kept < 0 ) {
+		/* A stream starts with its first frame repeated */
+		for ( c=0; c<channels; ++c ) {
+			Sint16 *plane = planes + c*frames;
+			for ( j=0; j<kept; ++j ) {
+				plane[j] = plane[kept];
+			}
+		}
+		pos = kept;
+		rem = 0;
+	} else {
+		for ( c=0; c<channels; ++c ) {
+			SDL_memcpy(planes + c*frames, cvt->rate_history + c*kept,
+			           kept*sizeof(Sint16));
+		}
+		pos = cvt->rate_pos;
+		rem = cvt->rate_rem;
+	}
+
+#if SDL_NEON_AUDIO
+	if ( SDL_AudioNEONEnabled() ) {
+		dot = SDL_ResampleDotNEON;
+	}
+#endif
+
+	/* Output frames are at steps of src_rate/dst_rate input frames, kept
+	   as an integer part and a remainder so long streams don't drift */
+	max_frames = (cvt->len*cvt->len_mult) / dst_frame;
+	dst_frames = 0;
+	n = 0;
+	while ( dst_frames+n < max_frames ) {
+		phase = (rem*RESAMPLER_PHASES + dst_rate/2) / dst_rate;
+		first = (int)pos - half + 1;
+		if ( phase == RESAMPLER_PHASES ) {
+			phase = 0;
+			++first;
+		}
+		if ( first+taps > frames ) {
+			break;
+		}
+		for ( c=0; c<channels; ++c ) {
+			sum = dot(planes + c*frames + first, bank + phase*taps, taps);
+			sum = (sum + (1<<(RESAMPLER_BITS-1))) >> RESAMPLER_BITS;
+			if ( sum > 32767 ) {
+				sum = 32767;
+			} else if ( sum < -32768 ) {
+				sum = -32768;
+			}
+			block[n*channels+c] = (Sint16)sum;
+		}
+		if ( ++n == FUSED_BLOCK ) {
+			EncodeBlock(block, cvt->dst_format, n*channels,
+			            cvt->buf + dst_frames*dst_frame);
+			dst_frames += n;
+			n = 0;
+		}
+		rem += src_rate;
+		while ( rem >= dst_rate ) {
+			rem -= dst_rate;
+			++pos;
+		}
+	}
+	EncodeBlock(block, cvt->dst_format, n*channels,
+	            cvt->buf + dst_frames*dst_frame);
+	dst_frames += n;
+
+	/* Keep the input from the next frame's first tap on, at least the
+	   last 'taps' frames.  Buffers of one or two frames can fall behind
+	   by more than the history holds, the oldest frames are skipped. */
+	while ( (frames - ((int)pos - half + 1)) > RESAMPLER_HISTORY ) {
+		rem += src_rate;
+		while ( rem >= dst_rate ) {
+			rem -= dst_rate;
+			++pos;
+		}
+	}
+	start = (int)pos - half + 1;
+	if ( start > frames - taps ) {
+		start = frames - taps;
+	}
+	kept = frames - start;
+	for ( c=0; c<channels; ++c ) {
+		SDL_memcpy(cvt->rate_history + c*kept,
+		           planes + c*frames + start, kept*sizeof(Sint16));
+	}
+	cvt->rate_kept = kept;
+	cvt->rate_pos = (int)pos - start;
+	cvt->rate_rem = rem;
+
+	PutResamplerScratch(planes, scratch);
+	SDL_free(fallback);
+
+	cvt->len_cvt = dst_frames*dst_frame;
+}
+
+void SDLCALL SDL_ConvertFused(SDL_AudioCVT *cvt, Uint16 format)
+{
+	Sint16 block[FUSED_BLOCK*8];
+	const int src_channels = cvt->src_channels;
+	const int dst_channels = cvt->dst_channels;
+	const int src_frame = ((format & 0xFF) / 8) * src_channels;
+	const int dst_frame = ((cvt->dst_format & 0xFF) / 8) * dst_channels;
+	int frames, i, n;
+
+#ifdef DEBUG_CONVERT
+	fprintf(stderr, "Converting %04x/%d/%d to %04x/%d/%d in one pass\n",
+		format, src_channels, cvt->src_rate,
+		cvt->dst_format, dst_channels, cvt->dst_rate);
+#endif
+	if ( cvt->src_rate ) {
+		ResampleFused(cvt, format);
+	} else {
+		/* In place, a block at a time: each block is read before it
+		   is written, and the blocks go backwards when the data grows
+		   so unread frames are never overwritten */
+		frames = cvt->len_cvt / src_frame;
+		if ( dst_frame > src_frame ) {
+			for ( i=frames; i>0; i-=n ) {
+				n = (i > FUSED_BLOCK) ? FUSED_BLOCK : i;
+				DecodeFrames(cvt->buf + (i-n)*src_frame, format, n,
+				             src_channels, dst_channels, block);
+				EncodeBlock(block, cvt->dst_format, n*dst_channels,
+				            cvt->buf + (i-n)*dst_frame);
+			}
+		} else {
+			for ( i=0; i<frames; i+=n ) {
+				n = (frames-i > FUSED_BLOCK) ? FUSED_BLOCK : frames-i;
+				DecodeFrames(cvt->buf + i*src_frame, format, n,
+				             src_channels, dst_channels, block);
+				EncodeBlock(block, cvt->dst_format, n*dst_channels,
+				            cvt->buf + i*dst_frame);
+			}
+		}
+		cvt->len_cvt = frames*dst_frame;
+	}
+	if ( cvt->filters[++cvt->filter_index] ) {
+		cvt->filters[cvt->filter_index](cvt, cvt->dst_format);
+	}
+}
+
 int SDL_ConvertAudio(SDL_AudioCVT *cvt)
 {
 	/* Make sure there's data to convert */
@@ -1322,9 +1872,11 @@ int SDL_ConvertAudio(SDL_AudioCVT *cvt)
 /* Creates a set of audio filters to convert from one format to another. 
    Returns -1 if the format conversion is not supported, or 1 if the
    audio filter is set up.
+   Rates are only changed by powers of two, so the converted length is
+   always len*len_ratio, as the audio thread needs.
 */
   
-int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
+int SDL_BuildDeviceAudioCVT(SDL_AudioCVT *cvt,
 	Uint16 src_format, Uint8 src_channels, int src_rate,
 	Uint16 dst_format, Uint8 dst_channels, int dst_rate)
 {
@@ -1336,6 +1888,7 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	cvt->filters[0] = NULL;
 	cvt->len_mult = 1;
 	cvt->len_ratio = 1.0;
+	cvt->src_rate = 0;
 
 	/* First filter:  Endian conversion from src to dst */
 	if ( (src_format & 0x1000) != (dst_format & 0x1000)
@@ -1508,3 +2061,80 @@ int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
 	}
 	return(cvt->needed);
 }
+
+/* Sets up SDL_ConvertFused(), which does the whole conversion in one pass
+   over the data and resamples with a band-limited filter.  Surround
+   remixing still goes through the filter chain, with the resampler last.
+*/
+int SDL_BuildAudioCVT(SDL_AudioCVT *cvt,
+	Uint16 src_format, Uint8 src_channels, int src_rate,
+	Uint16 dst_format, Uint8 dst_channels, int dst_rate)
+{
+	Uint16 format;
+	double ratio;
+	int src_size, dst_size;
+
+	if ( (src_channels == 0) || (dst_channels == 0) ||
+	     (src_rate <= 0) || (dst_rate <= 0) ) {
+		SDL_SetError("Invalid audio conversion parameters");
+		return(-1);
+	}
+	if ( (src_channels != dst_channels) &&
+	     ((src_channels > 2) || (dst_channels > 2)) ) {
+		SDL_BuildDeviceAudioCVT(cvt, src_format, src_channels, src_rate,
+		                        dst_format, dst_channels, src_rate);
+		format = dst_format;
+		src_channels = dst_channels;
+	} else if ( src_channels > 8 ) {
+		return SDL_BuildDeviceAudioCVT(cvt,
+		                 src_format, src_channels, src_rate,
+		                 dst_format, dst_channels, dst_rate);
+	} else {
+		cvt->needed = 0;
+		cvt->filter_index = 0;
+		cvt->filters[0] = NULL;
+		cvt->len_mult = 1;
+		cvt->len_ratio = 1.0;
+		format = src_format;
+	}
+
+	/* See if the fused stage has anything to do */
+	cvt->rate_incr = 0.0;
+	cvt->src_rate = 0;
+	if ( (src_rate/100) != (dst_rate/100) ) {
+		cvt->src_rate = src_rate;
+		cvt->dst_rate = dst_rate;
+		cvt->rate_incr = (double)src_rate/dst_rate;
+	} else if ( (format == dst_format) && (src_channels == dst_channels) ) {
+		return(cvt->needed);
+	}
+	cvt->src_channels = src_channels;
+	cvt->dst_channels = dst_channels;
+
+	src_size = (format & 0xFF) / 8;
+	dst_size = (dst_format & 0xFF) / 8;
+	ratio = (double)(dst_size*dst_channels) / (src_size*src_channels);
+	if ( cvt->src_rate ) {
+		ratio = ratio * dst_rate / src_rate;
+	}
+	cvt->len_ratio *= ratio;
+	if ( cvt->len_mult < (int)ceil(cvt->len_ratio) ) {
+		cvt->len_mult = (int)ceil(cvt->len_ratio);
+	}
+	if ( cvt->src_rate ) {
+		/* Frames held back from the last buffer come out with this one */
+		cvt->len_mult += 1;
+		cvt->rate_kept = -1;
+	}
+
+	if ( cvt->filter_index == 0 ) {
+		cvt->src_format = src_format;
+		cvt->dst_format = dst_format;
+		cvt->len = 0;
+		cvt->buf = NULL;
+	}
+	cvt->needed = 1;
+	cvt->filters[cvt->filter_index++] = SDL_ConvertFused;
+	cvt->filters[cvt->filter_index] = NULL;
+	return(cvt->needed);
+}
@@ -27,6 +27,7 @@
 #include "SDL_timer.h"
 #include "SDL_audio.h"
 #include "SDL_sysaudio.h"
+#include "SDL_audio_c.h"
 #include "SDL_mixer_MMX.h"
 #include "SDL_mixer_MMX_VC.h"
 #include "SDL_mixer_m68k.h"
@@ -90,6 +91,27 @@ static const Uint8 mix8[] =
 #define ADJUST_VOLUME(s, v)	(s = (s*v)/SDL_MIX_MAXVOLUME)
 #define ADJUST_VOLUME_U8(s, v)	(s = (((s-128)*v)/SDL_MIX_MAXVOLUME)+128)
 
+#if SDL_NEON_AUDIO
+/* The NEON kernels mix the bulk of the buffer and leave the tail to the
+   C loops below; they only handle volumes 1..SDL_MIX_MAXVOLUME */
+static int mix_neon = -1;
+
+#define MIX_NEON(call)							\
+	if ( volume > 0 && volume <= SDL_MIX_MAXVOLUME ) {		\
+		if ( mix_neon < 0 ) {					\
+			mix_neon = SDL_AudioNEONEnabled();		\
+		}							\
+		if ( mix_neon ) {					\
+			Uint32 done = call;				\
+			dst += done;					\
+			src += done;					\
+			len -= done;					\
+		}							\
+	}
+#else
+#define MIX_NEON(call)
+#endif
+
 void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 {
 	Uint16 format;
@@ -116,6 +138,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 #else
 			Uint8 src_sample;
 
+			MIX_NEON(SDL_MixAudioU8NEON(dst, src, len, volume))
 			while ( len-- ) {
 				src_sample = *src;
 				ADJUST_VOLUME_U8(src_sample, volume);
@@ -154,6 +177,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 			const int max_audioval = ((1<<(8-1))-1);
 			const int min_audioval = -(1<<(8-1));
 
+			MIX_NEON(SDL_MixAudioS8NEON(dst, src, len, volume))
 			src8 = (Sint8 *)src;
 			dst8 = (Sint8 *)dst;
 			while ( len-- ) {
@@ -202,6 +226,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 			const int max_audioval = ((1<<(16-1))-1);
 			const int min_audioval = -(1<<(16-1));
 
+			MIX_NEON(SDL_MixAudioS16NEON(dst, src, len, volume, 0))
 			len /= 2;
 			while ( len-- ) {
 				src1 = ((src[1])<<8|src[0]);
@@ -234,6 +259,7 @@ void SDL_MixAudio (Uint8 *dst, const Uint8 *src, Uint32 len, int volume)
 			const int max_audioval = ((1<<(16-1))-1);
 			const int min_audioval = -(1<<(16-1));
 
+			MIX_NEON(SDL_MixAudioS16NEON(dst, src, len, volume, 1))
 			len /= 2;
 			while ( len-- ) {
 				src1 = ((src[0])<<8|src[1]);
@@ -40,7 +40,15 @@ If you compile this code with SDL 1.3 or newer, or use in some other way, the li
 #include <jni.h>
 #include <android/log.h>
 #include <string.h> // for memset()
+#include <math.h>
 #include <pthread.h>
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Android.h>
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
@@ -149,6 +157,7 @@ static jmethodID JavaInitAudio = NULL;
 static jmethodID JavaDeinitAudio = NULL;
 static jmethodID JavaPauseAudioPlayback = NULL;
 static jmethodID JavaResumeAudioPlayback = NULL;
+static jmethodID JavaGetNativeSampleRate = NULL;
 
 // Audio recording
 
@@ -156,9 +165,284 @@ static SDL_AudioSpec recording;
 static jbyteArray recordingBufferJNI = NULL;
 static size_t recordingBufferSize = 0;
 
+// Native audio output through OpenSL ES buffer queue: SDL mixer callback writes directly into a ring of buffers,
+// which are enqueued to OpenSL without any JNI calls or copying. Used when available, otherwise we fall back to Java AudioTrack.
+enum { SLES_BUFFERS = 3 };
+static int slesActive = 0;
+static SLObjectItf slesEngineObject = NULL;
+static SLEngineItf slesEngine = NULL;
+static SLObjectItf slesOutputMixObject = NULL;
+static SLObjectItf slesPlayerObject = NULL;
+static SLPlayItf slesPlay = NULL;
+static SLAndroidSimpleBufferQueueItf slesBufferQueue = NULL;
+static Uint8 * slesRingBuffer = NULL;
+static int slesBufferSize = 0;
+static int slesCurrentBuffer = 0;
+static int slesBufferOwned = 0; // Current buffer is taken from slesFreeBuffers and not enqueued yet
+static SDL_sem * slesFreeBuffers = NULL;
+
+// Sample format conversion and resampling, used when application requests format or rate which device cannot play natively.
+// Application mixes into its own buffer with requested format, and we convert it to native S16 at native device rate,
+// so AudioFlinger does not have to resample it once more, and SDL does not reject the format.
+enum { RESAMPLER_TAPS = 16, RESAMPLER_PHASES = 64, RESAMPLER_SHIFT = 14 };
+static struct
+{
+	int active;
+	int resample;
+	Uint16 format;
+	int channels;
+	int bytesPerSample;
+	int inFreq;
+	int outFreq;
+	Uint8 * appBuffer;
+	int appBufferSize;
+	Uint8 * outBuffer; // Used only with Java audio, OpenSL buffers are written directly
+	int outBufferSize;
+	int outBufferPos;
+	Sint16 * work[2]; // Deinterleaved input with filter history in front
+	int workFrames;
+	unsigned posFrac; // Position between two input frames, in 1/outFreq units
+	Sint16 coefs[RESAMPLER_PHASES][RESAMPLER_TAPS] __attribute__((aligned(16)));
+} audioConvert;
+
+static void ANDROIDAUD_FreeConversion(void)
+{
+	SDL_free(audioConvert.appBuffer);
+	SDL_free(audioConvert.outBuffer);
+	SDL_free(audioConvert.work[0]);
+	SDL_free(audioConvert.work[1]);
+	SDL_memset(&audioConvert, 0, sizeof(audioConvert));
+}
+
+// Windowed sinc polyphase filter, with cutoff lowered when downsampling to prevent aliasing
+static void ANDROIDAUD_BuildResamplerFilter(void)
+{
+	double cutoff = 0.97 * MIN(1.0, (double)audioConvert.outFreq / (double)audioConvert.inFreq);
+	int phase, tap;
+
+	for( phase = 0; phase < RESAMPLER_PHASES; phase++ )
+	{
+		double taps[RESAMPLER_TAPS];
+		double sum = 0.0;
+		int isum = 0, center = RESAMPLER_TAPS / 2 - 1;
+
+		for( tap = 0; tap < RESAMPLER_TAPS; tap++ )
+		{
+			double t = (double)(tap - center) - (double)phase / RESAMPLER_PHASES;
+			double x = M_PI * cutoff * t;
+			double w = (t + RESAMPLER_TAPS / 2) / RESAMPLER_TAPS; // Blackman window, 0..1 over filter length
+			taps[tap] = ( fabs(x) < 1e-9 ? 1.0 : sin(x) / x ) *
+						( 0.42 - 0.5 * cos(2.0 * M_PI * w) + 0.08 * cos(4.0 * M_PI * w) );
+			sum += taps[tap];
+		}
+		for( tap = 0; tap < RESAMPLER_TAPS; tap++ )
+		{
+			audioConvert.coefs[phase][tap] = (Sint16)floor(taps[tap] / sum * (1 << RESAMPLER_SHIFT) + 0.5);
+			isum += audioConvert.coefs[phase][tap];
+		}
+		// Make each phase sum exactly to unity gain, so DC offset does not produce a hum
+		audioConvert.coefs[phase][center] += (1 << RESAMPLER_SHIFT) - isum;
+	}
+}
+
+static int ANDROIDAUD_SetupConversion(SDL_AudioSpec *audioFormat, int deviceFreq)
+{
+	int maxInFrames, maxOutFrames;
+
+	ANDROIDAUD_FreeConversion();
+
+	switch( audioFormat->format )
+	{
+		case AUDIO_S8:
+		case AUDIO_S16LSB:
+			break;
+		case AUDIO_U8:
+		case AUDIO_U16LSB:
+		case AUDIO_U16MSB:
+		case AUDIO_S16MSB:
+#ifdef AUDIO_F32LSB
+		case AUDIO_F32LSB:
+#endif
+			audioConvert.active = 1;
+			break;
+		default:
+			return 0;
+	}
+	if( audioFormat->channels < 1 || audioFormat->channels > 2 )
+		return 0;
+
+	audioConvert.resample = ( deviceFreq > 0 && deviceFreq != audioFormat->freq );
+	if( !audioConvert.active && !audioConvert.resample )
+		return 1;
+
+	audioConvert.active = 1;
+	audioConvert.format = audioFormat->format;
+	audioConvert.channels = audioFormat->channels;
+	audioConvert.bytesPerSample = (audioFormat->format & 0xFF) / 8;
+	audioConvert.inFreq = audioFormat->freq;
+	audioConvert.outFreq = audioConvert.resample ? deviceFreq : audioFormat->freq;
+	audioConvert.appBufferSize = audioFormat->size;
+
+	maxInFrames = audioFormat->size / audioConvert.bytesPerSample / audioConvert.channels;
+	maxOutFrames = maxInFrames;
+	if( audioConvert.resample )
+		maxOutFrames = (int)(((Sint64)(maxInFrames + RESAMPLER_TAPS) * audioConvert.outFreq) / audioConvert.inFreq) + 2;
+	audioConvert.outBufferSize = maxOutFrames * audioConvert.channels * 2;
+
+	audioConvert.appBuffer = (Uint8 *)SDL_malloc(audioConvert.appBufferSize);
+	audioConvert.outBuffer = (Uint8 *)SDL_malloc(audioConvert.outBufferSize);
+	if( !audioConvert.appBuffer || !audioConvert.outBuffer )
+	{
+		ANDROIDAUD_FreeConversion();
+		return 0;
+	}
+	SDL_memset(audioConvert.appBuffer, audioFormat->silence, audioConvert.appBufferSize);
+
+	if( audioConvert.resample )
+	{
+		int ch;
+		for( ch = 0; ch < audioConvert.channels; ch++ )
+		{
+			audioConvert.work[ch] = (Sint16 *)SDL_malloc((maxInFrames + RESAMPLER_TAPS) * sizeof(Sint16));
+			if( !audioConvert.work[ch] )
+			{
+				ANDROIDAUD_FreeConversion();
+				return 0;
+			}
+			// Initial history is silence, it delays output by half of filter length
+			SDL_memset(audioConvert.work[ch], 0, RESAMPLER_TAPS / 2 * sizeof(Sint16));
+		}
+		audioConvert.workFrames = RESAMPLER_TAPS / 2;
+		ANDROIDAUD_BuildResamplerFilter();
+	}
+	return 1;
+}
+
+// Reads count samples located stride samples apart from application buffer, writes them contiguously as native S16
+static void ANDROIDAUD_DecodeSamples(const Uint8 *in, int stride, int count, Sint16 *out)
+{
+	int i;
+	switch( audioConvert.format )
+	{
+		case AUDIO_S8:
+			for( i = 0; i < count; i++, in += stride )
+				out[i] = (Sint16)(((Sint8)in[0]) << 8);
+			break;
+		case AUDIO_U8:
+			for( i = 0; i < count; i++, in += stride )
+				out[i] = (Sint16)((in[0] ^ 0x80) << 8);
+			break;
+		case AUDIO_S16LSB:
+			for( i = 0; i < count; i++, in += stride * 2 )
+				out[i] = (Sint16)(in[0] | (in[1] << 8));
+			break;
+		case AUDIO_U16LSB:
+			for( i = 0; i < count; i++, in += stride * 2 )
+				out[i] = (Sint16)((in[0] | (in[1] << 8)) ^ 0x8000);
+			break;
+		case AUDIO_S16MSB:
+			for( i = 0; i < count; i++, in += stride * 2 )
+				out[i] = (Sint16)(in[1] | (in[0] << 8));
+			break;
+		case AUDIO_U16MSB:
+			for( i = 0; i < count; i++, in += stride * 2 )
+				out[i] = (Sint16)((in[1] | (in[0] << 8)) ^ 0x8000);
+			break;
+#ifdef AUDIO_F32LSB
+		case AUDIO_F32LSB:
+			for( i = 0; i < count; i++, in += stride * 4 )
+			{
+				float f;
+				SDL_memcpy(&f, in, sizeof(f));
+				f *= 32768.0f;
+				out[i] = (Sint16)( f >= 32767.0f ? 32767 : f <= -32768.0f ? -32768 : (int)f );
+			}
+			break;
+#endif
+	}
+}
+
+static inline Sint16 ANDROIDAUD_ResamplerFilter(const Sint16 *in, const Sint16 *coefs)
+{
+	int sum;
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+	int32x4_t acc = vmull_s16(vld1_s16(in), vld1_s16(coefs));
+	int32x2_t acc2;
+	acc = vmlal_s16(acc, vld1_s16(in + 4), vld1_s16(coefs + 4));
+	acc = vmlal_s16(acc, vld1_s16(in + 8), vld1_s16(coefs + 8));
+	acc = vmlal_s16(acc, vld1_s16(in + 12), vld1_s16(coefs + 12));
+	acc2 = vadd_s32(vget_low_s32(acc), vget_high_s32(acc));
+	sum = vget_lane_s32(vpadd_s32(acc2, acc2), 0);
+#elif defined(__SSE2__)
+	__m128i acc = _mm_add_epi32(
+		_mm_madd_epi16(_mm_loadu_si128((const __m128i *)in), _mm_load_si128((const __m128i *)coefs)),
+		_mm_madd_epi16(_mm_loadu_si128((const __m128i *)(in + 8)), _mm_load_si128((const __m128i *)(coefs + 8))));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+	acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+	sum = _mm_cvtsi128_si32(acc);
+#else
+	int i;
+	sum = 0;
+	for( i = 0; i < RESAMPLER_TAPS; i++ )
+		sum += in[i] * coefs[i];
+#endif
+	sum = (sum + (1 << (RESAMPLER_SHIFT - 1))) >> RESAMPLER_SHIFT;
+	return (Sint16)( sum > 32767 ? 32767 : sum < -32768 ? -32768 : sum );
+}
+
+// Converts whole application buffer into out, returns amount of bytes written, which varies by one frame when resampling
+static int ANDROIDAUD_ConvertAudio(Uint8 *out)
+{
+	Sint16 *dst = (Sint16 *)out;
+	int inFrames = audioConvert.appBufferSize / audioConvert.bytesPerSample / audioConvert.channels;
+	int total, pos = 0, outFrames = 0, ch;
+	unsigned frac = audioConvert.posFrac;
+
+	if( !audioConvert.resample )
+	{
+		ANDROIDAUD_DecodeSamples(audioConvert.appBuffer, 1, inFrames * audioConvert.channels, dst);
+		return inFrames * audioConvert.channels * 2;
+	}
+
+	for( ch = 0; ch < audioConvert.channels; ch++ )
+		ANDROIDAUD_DecodeSamples(audioConvert.appBuffer + ch * audioConvert.bytesPerSample, audioConvert.channels,
+									inFrames, audioConvert.work[ch] + audioConvert.workFrames);
+	total = audioConvert.workFrames + inFrames;
+
+	while( pos + RESAMPLER_TAPS <= total )
+	{
+		const Sint16 *coefs = audioConvert.coefs[frac * RESAMPLER_PHASES / audioConvert.outFreq];
+		for( ch = 0; ch < audioConvert.channels; ch++ )
+			*dst++ = ANDROIDAUD_ResamplerFilter(audioConvert.work[ch] + pos, coefs);
+		outFrames++;
+		frac += audioConvert.inFreq;
+		pos += frac / audioConvert.outFreq;
+		frac %= audioConvert.outFreq;
+	}
+
+	// Keep unconsumed frames as filter history for the next buffer
+	for( ch = 0; ch < audioConvert.channels; ch++ )
+		SDL_memmove(audioConvert.work[ch], audioConvert.work[ch] + pos, (total - pos) * sizeof(Sint16));
+	audioConvert.workFrames = total - pos;
+	audioConvert.posFrac = frac;
+
+	return outFrames * audioConvert.channels * 2;
+}
+
 
 static Uint8 *ANDROIDAUD_GetAudioBuf(_THIS)
 {
+	if( slesActive && !slesBufferOwned )
+	{
+		// WaitAudio() gave up while playback was paused, SDL mixes into its fake stream until a buffer is played
+		if( SDL_SemTryWait(slesFreeBuffers) != 0 )
+			return(NULL);
+		slesBufferOwned = 1;
+	}
+	if( audioConvert.active )
+		return(audioConvert.appBuffer);
+	if( slesActive )
+		return(slesRingBuffer + slesCurrentBuffer * slesBufferSize);
 #ifdef SDL_AUDIO_APP_IGNORES_RETURNED_BUFFER_SIZE
 	return(shadowAppBuffer);
 #else
@@ -167,6 +451,105 @@ static Uint8 *ANDROIDAUD_GetAudioBuf(_THIS)
 }
 
 
+static void ANDROIDAUD_CloseOpenSLES(void)
+{
+	if( slesPlayerObject )
+		(*slesPlayerObject)->Destroy(slesPlayerObject);
+	slesPlayerObject = NULL;
+	slesPlay = NULL;
+	slesBufferQueue = NULL;
+	if( slesOutputMixObject )
+		(*slesOutputMixObject)->Destroy(slesOutputMixObject);
+	slesOutputMixObject = NULL;
+	if( slesEngineObject )
+		(*slesEngineObject)->Destroy(slesEngineObject);
+	slesEngineObject = NULL;
+	slesEngine = NULL;
+	if( slesFreeBuffers )
+		SDL_DestroySemaphore(slesFreeBuffers);
+	slesFreeBuffers = NULL;
+	SDL_free(slesRingBuffer);
+	slesRingBuffer = NULL;
+	slesBufferSize = 0;
+	slesBufferOwned = 0;
+	slesActive = 0;
+}
+
+// Called from OpenSL internal thread when a buffer was played
+static void ANDROIDAUD_OpenSLESBufferDone(SLAndroidSimpleBufferQueueItf bufferQueue, void *context)
+{
+	SDL_SemPost(slesFreeBuffers);
+}
+
+static int ANDROIDAUD_OpenOpenSLES(SDL_AudioSpec *audioFormat)
+{
+	SLDataLocator_AndroidSimpleBufferQueue locatorBufferQueue = { SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE, SLES_BUFFERS };
+	SLDataFormat_PCM formatPcm;
+	SLDataSource audioSource = { &locatorBufferQueue, &formatPcm };
+	SLDataLocator_OutputMix locatorOutputMix;
+	SLDataSink audioSink = { &locatorOutputMix, NULL };
+	const SLInterfaceID interfaces[1] = { SL_IID_ANDROIDSIMPLEBUFFERQUEUE };
+	const SLboolean required[1] = { SL_BOOLEAN_TRUE };
+
+	// OpenSL ES on Android plays only unsigned 8-bit samples, SDL S8 is signed
+	if( audioFormat->format != AUDIO_S16 || audioFormat->channels > 2 )
+		return 0;
+
+	if( slCreateEngine(&slesEngineObject, 0, NULL, 0, NULL, NULL) != SL_RESULT_SUCCESS ||
+		(*slesEngineObject)->Realize(slesEngineObject, SL_BOOLEAN_FALSE) != SL_RESULT_SUCCESS ||
+		(*slesEngineObject)->GetInterface(slesEngineObject, SL_IID_ENGINE, &slesEngine) != SL_RESULT_SUCCESS ||
+		(*slesEngine)->CreateOutputMix(slesEngine, &slesOutputMixObject, 0, NULL, NULL) != SL_RESULT_SUCCESS ||
+		(*slesOutputMixObject)->Realize(slesOutputMixObject, SL_BOOLEAN_FALSE) != SL_RESULT_SUCCESS )
+	{
+		__android_log_print(ANDROID_LOG_INFO, "libSDL", "ANDROIDAUD_OpenAudio(): cannot create OpenSL ES engine, using Java audio");
+		ANDROIDAUD_CloseOpenSLES();
+		return 0;
+	}
+
+	formatPcm.formatType = SL_DATAFORMAT_PCM;
+	formatPcm.numChannels = audioFormat->channels;
+	formatPcm.samplesPerSec = audioFormat->freq * 1000; // In milliHertz
+	formatPcm.bitsPerSample = SL_PCMSAMPLEFORMAT_FIXED_16;
+	formatPcm.containerSize = SL_PCMSAMPLEFORMAT_FIXED_16;
+	formatPcm.channelMask = ( audioFormat->channels == 2 ) ? (SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT) : SL_SPEAKER_FRONT_CENTER;
+	formatPcm.endianness = SL_BYTEORDER_LITTLEENDIAN;
+	locatorOutputMix.locatorType = SL_DATALOCATOR_OUTPUTMIX;
+	locatorOutputMix.outputMix = slesOutputMixObject;
+
+	if( (*slesEngine)->CreateAudioPlayer(slesEngine, &slesPlayerObject, &audioSource, &audioSink, 1, interfaces, required) != SL_RESULT_SUCCESS ||
+		(*slesPlayerObject)->Realize(slesPlayerObject, SL_BOOLEAN_FALSE) != SL_RESULT_SUCCESS ||
+		(*slesPlayerObject)->GetInterface(slesPlayerObject, SL_IID_PLAY, &slesPlay) != SL_RESULT_SUCCESS ||
+		(*slesPlayerObject)->GetInterface(slesPlayerObject, SL_IID_ANDROIDSIMPLEBUFFERQUEUE, &slesBufferQueue) != SL_RESULT_SUCCESS ||
+		(*slesBufferQueue)->RegisterCallback(slesBufferQueue, ANDROIDAUD_OpenSLESBufferDone, NULL) != SL_RESULT_SUCCESS )
+	{
+		__android_log_print(ANDROID_LOG_INFO, "libSDL", "ANDROIDAUD_OpenAudio(): cannot create OpenSL ES player for freq %d channels %d, using Java audio", audioFormat->freq, (int)audioFormat->channels);
+		ANDROIDAUD_CloseOpenSLES();
+		return 0;
+	}
+
+	// Application buffer size is used as is, there is no JNI overhead to hide with huge buffers
+	slesBufferSize = audioFormat->size;
+	slesCurrentBuffer = 0;
+	slesBufferOwned = 1;
+	slesRingBuffer = (Uint8 *)SDL_malloc(slesBufferSize * SLES_BUFFERS);
+	slesFreeBuffers = SDL_CreateSemaphore(SLES_BUFFERS - 1); // Current buffer is owned by SDL audio thread
+	if( !slesRingBuffer || !slesFreeBuffers )
+	{
+		ANDROIDAUD_CloseOpenSLES();
+		return 0;
+	}
+	SDL_memset(slesRingBuffer, audioFormat->silence, slesBufferSize * SLES_BUFFERS);
+
+	if( (*slesPlay)->SetPlayState(slesPlay, SL_PLAYSTATE_PLAYING) != SL_RESULT_SUCCESS )
+	{
+		ANDROIDAUD_CloseOpenSLES();
+		return 0;
+	}
+
+	slesActive = 1;
+	return 1;
+}
+
 #if SDL_VERSION_ATLEAST(1,3,0)
 static int ANDROIDAUD_OpenAudio (_THIS, const char *devname, int iscapture)
 {
@@ -179,18 +562,13 @@ static int ANDROIDAUD_OpenAudio (_THIS, SDL_AudioSpec *spec)
 #endif
 
 	int bytesPerSample;
+	int deviceFreq = 0;
+	SDL_AudioSpec deviceFormat;
 	JNIEnv * jniEnv = NULL;
 
 	this->hidden = NULL;
 
-	if( ! (audioFormat->format == AUDIO_S8 || audioFormat->format == AUDIO_S16) )
-	{
-		__android_log_print(ANDROID_LOG_ERROR, "libSDL", "Application requested unsupported audio format - only S8 and S16 are supported");
-		return (-1); // TODO: enable format conversion? Don't know how to do that in SDL
-	}
-
 	bytesPerSample = (audioFormat->format & 0xFF) / 8;
-	audioFormat->format = ( bytesPerSample == 2 ) ? AUDIO_S16 : AUDIO_S8;
 
 	__android_log_print(ANDROID_LOG_INFO, "libSDL", "ANDROIDAUD_OpenAudio(): app requested audio bytespersample %d freq %d channels %d samples %d", bytesPerSample, audioFormat->freq, (int)audioFormat->channels, (int)audioFormat->samples);
 
@@ -203,7 +581,7 @@ static int ANDROIDAUD_OpenAudio (_THIS, SDL_AudioSpec *spec)
 	}
 	
 	SDL_CalculateAudioSpec(audioFormat);
-	
+
 	(*jniVM)->AttachCurrentThread(jniVM, &jniEnv, NULL);
 
 	if( !jniEnv )
@@ -212,10 +590,41 @@ static int ANDROIDAUD_OpenAudio (_THIS, SDL_AudioSpec *spec)
 		return (-1);
 	}
 
+	if( JavaGetNativeSampleRate )
+		deviceFreq = (*jniEnv)->CallIntMethod( jniEnv, JavaAudioThread, JavaGetNativeSampleRate );
+
+	if( ! ANDROIDAUD_SetupConversion(audioFormat, deviceFreq) )
+	{
+		__android_log_print(ANDROID_LOG_ERROR, "libSDL", "Application requested unsupported audio format 0x%04x channels %d", (int)audioFormat->format, (int)audioFormat->channels);
+		return (-1);
+	}
+
+	// Device always plays S16 when converting, application keeps the format and rate it asked for
+	deviceFormat = *audioFormat;
+	if( audioConvert.active )
+	{
+		deviceFormat.format = AUDIO_S16;
+		deviceFormat.freq = audioConvert.outFreq;
+		deviceFormat.silence = 0;
+		deviceFormat.size = audioConvert.outBufferSize;
+		bytesPerSample = 2;
+		__android_log_print(ANDROID_LOG_INFO, "libSDL", "ANDROIDAUD_OpenAudio(): converting audio format 0x%04x freq %d to S16 freq %d", (int)audioFormat->format, audioFormat->freq, deviceFormat.freq);
+	}
+
+	if( ANDROIDAUD_OpenOpenSLES(&deviceFormat) )
+	{
+		__android_log_print(ANDROID_LOG_INFO, "libSDL", "ANDROIDAUD_OpenAudio(): app opened OpenSL ES audio bytespersample %d freq %d channels %d bufsize %d x %d", bytesPerSample, deviceFormat.freq, (int)deviceFormat.channels, deviceFormat.size, SLES_BUFFERS);
+#if SDL_VERSION_ATLEAST(1,3,0)
+		return(1);
+#else
+		return(0);
+#endif
+	}
+
 	// The returned audioBufferSize may be huge, up to 100 Kb for 44100 because user may have selected large audio buffer to get rid of choppy sound
 	audioBufferSize = (*jniEnv)->CallIntMethod( jniEnv, JavaAudioThread, JavaInitAudio, 
-					(jint)audioFormat->freq, (jint)audioFormat->channels, 
-					(jint)(( bytesPerSample == 2 ) ? 1 : 0), (jint)(audioFormat->size) );
+					(jint)deviceFormat.freq, (jint)deviceFormat.channels, 
+					(jint)(( bytesPerSample == 2 ) ? 1 : 0), (jint)(deviceFormat.size) );
 
 	if( audioBufferSize == 0 )
 	{
@@ -227,16 +636,23 @@ static int ANDROIDAUD_OpenAudio (_THIS, SDL_AudioSpec *spec)
 	/* We cannot call DetachCurrentThread() from main thread or we'll crash */
 	/* (*jniVM)->DetachCurrentThread(jniVM); */
 
-#ifdef SDL_AUDIO_APP_IGNORES_RETURNED_BUFFER_SIZE
-	shadowAppBufferSize = audioFormat->size;
-	shadowAppBuffer = malloc(shadowAppBufferSize);
 	shadowAppBufferPos = 0;
-	if( shadowAppBufferSize > audioBufferSize )
-		__android_log_print(ANDROID_LOG_FATAL, "libSDL", "ANDROIDAUD_OpenAudio(): Java returned audio buffer smaller than app requested, SDL will crash!");
+	if( audioConvert.active )
+	{
+		// Converted data is accumulated in Java buffer, application buffer size does not matter
+	}
+	else
+	{
+#ifdef SDL_AUDIO_APP_IGNORES_RETURNED_BUFFER_SIZE
+		shadowAppBufferSize = audioFormat->size;
+		shadowAppBuffer = malloc(shadowAppBufferSize);
+		if( shadowAppBufferSize > audioBufferSize )
+			__android_log_print(ANDROID_LOG_FATAL, "libSDL", "ANDROIDAUD_OpenAudio(): Java returned audio buffer smaller than app requested, SDL will crash!");
 #else
-	audioFormat->samples = audioBufferSize / bytesPerSample / audioFormat->channels;
-	audioFormat->size = audioBufferSize;
+		audioFormat->samples = audioBufferSize / bytesPerSample / audioFormat->channels;
+		audioFormat->size = audioBufferSize;
 #endif
+	}
 
 	SDL_CalculateAudioSpec(audioFormat);
 	__android_log_print(ANDROID_LOG_INFO, "libSDL", "ANDROIDAUD_OpenAudio(): app opened audio bytespersample %d freq %d channels %d bufsize %d, SDL returns bufsize %d", bytesPerSample, audioFormat->freq, (int)audioFormat->channels, audioBufferSize, audioFormat->size);
@@ -252,6 +668,15 @@ static void ANDROIDAUD_CloseAudio(_THIS)
 {
 	//__android_log_print(ANDROID_LOG_INFO, "libSDL", "ANDROIDAUD_CloseAudio()");
 	JNIEnv * jniEnv = NULL;
+
+	ANDROIDAUD_FreeConversion();
+
+	if( slesActive )
+	{
+		ANDROIDAUD_CloseOpenSLES();
+		return;
+	}
+
 	(*jniVM)->AttachCurrentThread(jniVM, &jniEnv, NULL);
 
 	(*jniEnv)->DeleteGlobalRef(jniEnv, audioBufferJNI);
@@ -272,6 +697,22 @@ static void ANDROIDAUD_CloseAudio(_THIS)
 /* This function waits until it is possible to write a full sound buffer */
 static void ANDROIDAUD_WaitAudio(_THIS)
 {
+	if( slesActive )
+	{
+		int status;
+		if( slesBufferOwned ) // Enqueue failed, the buffer is refilled on the next period
+		{
+			SDL_Delay(this->spec.samples * 1000 / this->spec.freq);
+			return;
+		}
+		// Playback may be paused for a long time, timeout only lets audio thread exit when SDL closes audio
+		do
+			status = SDL_SemWaitTimeout(slesFreeBuffers, 1000);
+		while( status == SDL_MUTEX_TIMEDOUT && this->enabled );
+		if( status == 0 )
+			slesBufferOwned = 1;
+		return;
+	}
 	/* We will block in PlayAudio(), do nothing here */
 #ifdef SDL_AUDIO_PREVENT_CHOPPING_WITH_DELAY
 	//ZX:
@@ -308,6 +749,9 @@ static void ANDROIDAUD_ThreadInit(_THIS)
 	JavaInitThread = (*jniEnvPlaying)->GetMethodID(jniEnvPlaying, JavaAudioThreadClass, "initAudioThread", "()I");
 	(*jniEnvPlaying)->CallIntMethod( jniEnvPlaying, JavaAudioThread, JavaInitThread );
 
+	if( slesActive )
+		return;
+
 	JavaGetBuffer = (*jniEnvPlaying)->GetMethodID(jniEnvPlaying, JavaAudioThreadClass, "getBuffer", "()[B");
 	audioBufferJNI = (*jniEnvPlaying)->CallObjectMethod( jniEnvPlaying, JavaAudioThread, JavaGetBuffer );
 	audioBufferJNI = (*jniEnvPlaying)->NewGlobalRef(jniEnvPlaying, audioBufferJNI);
@@ -322,11 +766,19 @@ static void ANDROIDAUD_ThreadInit(_THIS)
 		__android_log_print(ANDROID_LOG_ERROR, "libSDL", "ANDROIDAUD_ThreadInit(): JNI returns a copy of byte array - no audio will be played");
 
 	//__android_log_print(ANDROID_LOG_INFO, "libSDL", "ANDROIDAUD_ThreadInit()");
-	SDL_memset(audioBuffer, this->spec.silence, this->spec.size);
+	if( audioConvert.active )
+		SDL_memset(audioBuffer, 0, audioBufferSize);
+	else
+		SDL_memset(audioBuffer, this->spec.silence, this->spec.size);
 };
 
 static void ANDROIDAUD_ThreadDeinit(_THIS)
 {
+	if( slesActive )
+	{
+		(*jniVM)->DetachCurrentThread(jniVM);
+		return;
+	}
 	//(*jniEnvPlaying)->ReleaseByteArrayElements(jniEnvPlaying, audioBufferJNI, (jbyte *)audioBuffer, 0);
 	(*jniEnvPlaying)->ReleasePrimitiveArrayCritical(jniEnvPlaying, audioBufferJNI, (jbyte *)audioBuffer, 0);
 	// (*jniEnvPlaying)->DeleteGlobalRef(jniEnvPlaying, audioBufferJNI); // Application crashes here for some unknown reason
@@ -353,37 +805,69 @@ static void ANDROIDAUD_SendAudioToJava(void)
 	//	__android_log_print(ANDROID_LOG_INFO, "libSDL", "ANDROIDAUD_PlayAudio() JNI returns a copy of byte array - that's slow");
 }
 
-#ifdef SDL_AUDIO_APP_IGNORES_RETURNED_BUFFER_SIZE
-static void ANDROIDAUD_PlayAudio(_THIS)
+static void ANDROIDAUD_EnqueueOpenSLES(int size)
 {
-	int audioCopiedSize = MIN(shadowAppBufferSize, audioBufferSize - shadowAppBufferPos);
-	memcpy(audioBuffer + shadowAppBufferPos, shadowAppBuffer, audioCopiedSize);
-	shadowAppBufferPos += audioCopiedSize;
-	if( shadowAppBufferPos >= audioBufferSize )
+	// The ring moves on only with the queue, otherwise SDL would mix into a buffer which is still playing
+	if( (*slesBufferQueue)->Enqueue(slesBufferQueue, slesRingBuffer + slesCurrentBuffer * slesBufferSize, size) != SL_RESULT_SUCCESS )
+		return;
+	slesBufferOwned = 0;
+	slesCurrentBuffer = (slesCurrentBuffer + 1) % SLES_BUFFERS;
+}
+
+// Appends data to Java buffer, sending it to Java each time it gets full
+static void ANDROIDAUD_WriteToJava(const Uint8 *data, int size)
+{
+	while( size > 0 )
 	{
-		ANDROIDAUD_SendAudioToJava();
-		int audioCopiedRemaining = shadowAppBufferSize - audioCopiedSize;
-		memcpy(audioBuffer, shadowAppBuffer + audioCopiedSize, audioCopiedRemaining);
-		shadowAppBufferPos = audioCopiedRemaining;
+		int audioCopiedSize = MIN(size, audioBufferSize - shadowAppBufferPos);
+		memcpy(audioBuffer + shadowAppBufferPos, data, audioCopiedSize);
+		shadowAppBufferPos += audioCopiedSize;
+		data += audioCopiedSize;
+		size -= audioCopiedSize;
+		if( shadowAppBufferPos >= audioBufferSize )
+		{
+			ANDROIDAUD_SendAudioToJava();
+			shadowAppBufferPos = 0;
+		}
 	}
 }
-#else
+
 static void ANDROIDAUD_PlayAudio(_THIS)
 {
+	if( audioConvert.active )
+	{
+		if( slesActive )
+			ANDROIDAUD_EnqueueOpenSLES(ANDROIDAUD_ConvertAudio(slesRingBuffer + slesCurrentBuffer * slesBufferSize));
+		else
+			ANDROIDAUD_WriteToJava(audioConvert.outBuffer, ANDROIDAUD_ConvertAudio(audioConvert.outBuffer));
+		return;
+	}
+	if( slesActive )
+	{
+		ANDROIDAUD_EnqueueOpenSLES(slesBufferSize);
+		return;
+	}
+#ifdef SDL_AUDIO_APP_IGNORES_RETURNED_BUFFER_SIZE
+	ANDROIDAUD_WriteToJava(shadowAppBuffer, shadowAppBufferSize);
+#else
 	ANDROIDAUD_SendAudioToJava();
-}
 #endif
+}
 
 
 int SDL_ANDROID_PauseAudioPlayback(void)
 {
 	JNIEnv * jniEnv = NULL;
+	if( slesActive )
+		(*slesPlay)->SetPlayState(slesPlay, SL_PLAYSTATE_PAUSED);
 	(*jniVM)->AttachCurrentThread(jniVM, &jniEnv, NULL);
 	return (*jniEnv)->CallIntMethod( jniEnv, JavaAudioThread, JavaPauseAudioPlayback );
 };
 int SDL_ANDROID_ResumeAudioPlayback(void)
 {
 	JNIEnv * jniEnv = NULL;
+	if( slesActive )
+		(*slesPlay)->SetPlayState(slesPlay, SL_PLAYSTATE_PLAYING);
 	(*jniVM)->AttachCurrentThread(jniVM, &jniEnv, NULL);
 	return (*jniEnv)->CallIntMethod( jniEnv, JavaAudioThread, JavaResumeAudioPlayback );
 };
@@ -405,6 +889,9 @@ JNIEXPORT jint JNICALL JAVA_EXPORT_NAME(AudioThread_nativeAudioInitJavaCallbacks
 	JavaDeinitAudio = (*jniEnv)->GetMethodID(jniEnv, JavaAudioThreadClass, "deinitAudio", "()I");
 	JavaPauseAudioPlayback = (*jniEnv)->GetMethodID(jniEnv, JavaAudioThreadClass, "pauseAudioPlayback", "()I");
 	JavaResumeAudioPlayback = (*jniEnv)->GetMethodID(jniEnv, JavaAudioThreadClass, "resumeAudioPlayback", "()I");
+	JavaGetNativeSampleRate = (*jniEnv)->GetMethodID(jniEnv, JavaAudioThreadClass, "getNativeSampleRate", "()I");
+	if( !JavaGetNativeSampleRate )
+		(*jniEnv)->ExceptionClear(jniEnv); // Older Java code, play at application rate
 }
 
 JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved)
@@ -506,3 +993,152 @@ extern DECLSPEC JavaVM* SDL_ANDROID_JavaVM()
 {
 	return jniVM;
 }
+
+#ifdef TEST_MAIN
+
+/* Benchmark of the OpenSL ES output path, built as a native executable and run on the device:
+	$CC -O2 -DANDROID -DTEST_MAIN -DSDL_JAVA_PACKAGE_PATH=test -I../../../include SDL_androidaudio.c -lsdl-1.2 -lOpenSLES -llog -lm
+   (the SDL 1.3 headers rename main(), add -DSDL_MAIN_HANDLED there)
+   For every buffer size it runs the driver the same way SDL audio thread does, and prints
+   the deviation of the period between buffers from the nominal one (callback jitter),
+   and the time each buffer spends in OpenSL queue (output latency on top of the mixer).
+   Then it pauses the player for longer than WaitAudio() timeout, and checks that every
+   ring buffer is either enqueued, free or owned by the audio thread, which is what
+   SDL_ANDROID_PauseAudioPlayback() does when the app goes to background.
+   The Java AudioTrack path needs the Java activity, so it cannot be run from here.
+ */
+
+#include <stdio.h>
+#include <time.h>
+
+#define BENCH_SECONDS	4
+
+static SDL_AudioDevice benchDevice;
+static volatile int benchMeasure = 0;
+static double benchJitterSum, benchJitterMax, benchLatencySum, benchLatencyMax;
+static int benchPeriods, benchBuffers;
+
+static double BenchMs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int BenchAudioThread(void *unused)
+{
+	const double period = benchDevice.spec.samples * 1000.0 / benchDevice.spec.freq;
+	double enqueued[SLES_BUFFERS]; /* Buffers are played in the order they were enqueued */
+	int first = 0, queued = 0;
+	double last = 0, now, jitter;
+	Uint8 *stream;
+	int i, phase = 0;
+
+	while( benchDevice.enabled )
+	{
+		stream = ANDROIDAUD_GetAudioBuf(&benchDevice);
+		if( !stream )
+		{
+			SDL_Delay(period);
+			continue;
+		}
+		/* 441 Hz square wave */
+		for( i = 0; i < benchDevice.spec.size / 2; i++ )
+		{
+			((Sint16 *)stream)[i] = (phase % 100 < 50) ? 2000 : -2000;
+			if( i % benchDevice.spec.channels == benchDevice.spec.channels - 1 )
+				phase++;
+		}
+		ANDROIDAUD_PlayAudio(&benchDevice);
+		if( !slesBufferOwned )
+		{
+			enqueued[(first + queued) % SLES_BUFFERS] = BenchMs();
+			queued++;
+		}
+		ANDROIDAUD_WaitAudio(&benchDevice);
+		if( !slesBufferOwned )
+			continue;
+
+		now = BenchMs();
+		if( benchMeasure && last != 0 && queued > 0 )
+		{
+			jitter = fabs(now - last - period);
+			benchJitterSum += jitter;
+			if( jitter > benchJitterMax )
+				benchJitterMax = jitter;
+			benchPeriods++;
+			benchLatencySum += now - enqueued[first];
+			if( now - enqueued[first] > benchLatencyMax )
+				benchLatencyMax = now - enqueued[first];
+			benchBuffers++;
+		}
+		if( queued > 0 )
+		{
+			first = (first + 1) % SLES_BUFFERS;
+			queued--;
+		}
+		last = now;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const int sizes[] = { 256, 512, 1024, 2048, 4096 };
+	SLAndroidSimpleBufferQueueState state;
+	SDL_Thread *thread;
+	int i, errors = 0;
+
+	for( i = 0; i < (int)(sizeof(sizes) / sizeof(sizes[0])); i++ )
+	{
+		SDL_memset(&benchDevice, 0, sizeof(benchDevice));
+		benchDevice.spec.freq = 44100;
+		benchDevice.spec.format = AUDIO_S16;
+		benchDevice.spec.channels = 2;
+		benchDevice.spec.samples = sizes[i];
+		benchDevice.spec.size = sizes[i] * 2 * 2;
+		if( !ANDROIDAUD_OpenOpenSLES(&benchDevice.spec) )
+		{
+			printf("Cannot open OpenSL ES\n");
+			return 1;
+		}
+		benchJitterSum = benchJitterMax = benchLatencySum = benchLatencyMax = 0;
+		benchPeriods = benchBuffers = 0;
+		benchDevice.enabled = 1;
+#if SDL_VERSION_ATLEAST(1,3,0)
+		thread = SDL_CreateThread(BenchAudioThread, "BenchAudio", NULL);
+#else
+		thread = SDL_CreateThread(BenchAudioThread, NULL);
+#endif
+
+		SDL_Delay(500);
+		benchMeasure = 1;
+		SDL_Delay(BENCH_SECONDS * 1000);
+		benchMeasure = 0;
+		printf("%4d samples (%5.1f ms): period jitter mean %5.2f max %5.2f ms, queue latency mean %6.1f max %6.1f ms\n",
+			sizes[i], sizes[i] * 1000.0 / 44100,
+			benchJitterSum / (benchPeriods ? benchPeriods : 1), benchJitterMax,
+			benchLatencySum / (benchBuffers ? benchBuffers : 1), benchLatencyMax);
+
+		/* Nothing is played while paused, so the numbers must add up exactly */
+		(*slesPlay)->SetPlayState(slesPlay, SL_PLAYSTATE_PAUSED);
+		SDL_Delay(2500);
+		(*slesBufferQueue)->GetState(slesBufferQueue, &state);
+		if( state.count + SDL_SemValue(slesFreeBuffers) + slesBufferOwned != SLES_BUFFERS )
+		{
+			printf("Paused: %d buffers enqueued, %d free, %d owned by audio thread, ring has %d\n",
+				(int)state.count, (int)SDL_SemValue(slesFreeBuffers), slesBufferOwned, SLES_BUFFERS);
+			errors++;
+		}
+		(*slesPlay)->SetPlayState(slesPlay, SL_PLAYSTATE_PLAYING);
+		SDL_Delay(500);
+
+		benchDevice.enabled = 0;
+		SDL_WaitThread(thread, NULL);
+		ANDROIDAUD_CloseOpenSLES();
+	}
+	printf("%s\n", errors ? "Pause test FAILED" : "Pause test passed");
+	return errors != 0;
+}
+
+#endif /* TEST_MAIN */
@@ -33,6 +33,11 @@
 #include <setjmp.h>
 #endif
 
+#if defined(__arm__) && (defined(__LINUX__) || defined(__ANDROID__))
+#include <fcntl.h>
+#include <unistd.h>	/* For NEON check */
+#endif
+
 #define CPU_HAS_RDTSC	0x00000001
 #define CPU_HAS_MMX	0x00000002
 #define CPU_HAS_MMXEXT	0x00000004
@@ -41,6 +46,7 @@
 #define CPU_HAS_SSE	0x00000040
 #define CPU_HAS_SSE2	0x00000080
 #define CPU_HAS_ALTIVEC	0x00000100
+#define CPU_HAS_NEON	0x00000200
 
 #if SDL_ALTIVEC_BLITTERS && HAVE_SETJMP && !__MACOSX__
 /* This is the brute force way of detecting instruction sets...
@@ -381,6 +387,32 @@ static __inline__ int CPU_haveAltiVec(void)
 	return altivec; 
 }
 
+static __inline__ int CPU_haveNEON(void)
+{
+	int neon = 0;
+#if defined(__aarch64__)
+	neon = 1;	/* Advanced SIMD is mandatory on ARMv8 */
+#elif defined(__arm__) && (defined(__LINUX__) || defined(__ANDROID__))
+	/* The kernel passes HWCAP_NEON in the auxiliary vector;
+	   getauxval() is not available before Android 4.3 */
+	Uint32 auxv[2];
+	int fd = open("/proc/self/auxv", O_RDONLY);
+	if ( fd >= 0 ) {
+		while ( read(fd, auxv, sizeof(auxv)) == sizeof(auxv) ) {
+			if ( auxv[0] == 16 ) {	/* AT_HWCAP */
+				neon = (auxv[1] & (1 << 12)) != 0;	/* HWCAP_NEON */
+				break;
+			}
+			if ( auxv[0] == 0 ) {	/* AT_NULL */
+				break;
+			}
+		}
+		close(fd);
+	}
+#endif
+	return neon;
+}
+
 static Uint32 SDL_CPUFeatures = 0xFFFFFFFF;
 
 static Uint32 SDL_GetCPUFeatures(void)
@@ -411,6 +443,9 @@ static Uint32 SDL_GetCPUFeatures(void)
 		if ( CPU_haveAltiVec() ) {
 			SDL_CPUFeatures |= CPU_HAS_ALTIVEC;
 		}
+		if ( CPU_haveNEON() ) {
+			SDL_CPUFeatures |= CPU_HAS_NEON;
+		}
 	}
 	return SDL_CPUFeatures;
 }
@@ -479,6 +514,14 @@ SDL_bool SDL_HasAltiVec(void)
 	return SDL_FALSE;
 }
 
+SDL_bool SDL_HasNEON(void)
+{
+	if ( SDL_GetCPUFeatures() & CPU_HAS_NEON ) {
+		return SDL_TRUE;
+	}
+	return SDL_FALSE;
+}
+
 #ifdef TEST_MAIN
 
 #include <stdio.h>
@@ -493,6 +536,7 @@ int main()
 	printf("SSE: %d\n", SDL_HasSSE());
 	printf("SSE2: %d\n", SDL_HasSSE2());
 	printf("AltiVec: %d\n", SDL_HasAltiVec());
+	printf("NEON: %d\n", SDL_HasNEON());
 	return 0;
 }
 
@@ -76,6 +76,21 @@ extern SDL_loblit SDL_CalculateBlit1(SDL_Surface *surface, int complex);
 extern SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int complex);
 extern SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int complex);
 
+#if SDL_NEON_BLITTERS
+/* Functions found in SDL_blit_neon.c, use them only if SDL_BlitNEONEnabled() */
+extern int SDL_BlitNEONEnabled(void);
+extern void SDL_Blit_RGB888_RGB565NEON(SDL_BlitInfo *info);
+extern void SDL_Blit_RGB565_ARGB8888NEON(SDL_BlitInfo *info);
+extern void SDL_Blit_RGB565_ABGR8888NEON(SDL_BlitInfo *info);
+extern void SDL_Blit2to2KeyNEON(SDL_BlitInfo *info);
+extern void SDL_Blit565to565SurfaceAlphaNEON(SDL_BlitInfo *info);
+extern void SDL_BlitARGBto565PixelAlphaNEON(SDL_BlitInfo *info);
+extern void SDL_BlitRGBtoRGBSurfaceAlphaNEON(SDL_BlitInfo *info);
+extern void SDL_BlitRGBtoRGBPixelAlphaNEON(SDL_BlitInfo *info);
+extern void SDL_StretchBlendRowsNEON(Uint32 *row0, Uint32 *row1, Uint32 *dst,
+                                     int width, int weight);
+#endif
+
 /*
  * Useful macros for blitting routines
  */
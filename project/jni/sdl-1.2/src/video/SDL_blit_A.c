@@ -2750,6 +2750,11 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		if(SDL_HasMMX())
 			return Blit565to565SurfaceAlphaMMX;
 		else
+#endif
+#if SDL_NEON_BLITTERS
+		if(SDL_BlitNEONEnabled())
+			return SDL_Blit565to565SurfaceAlphaNEON;
+		else
 #endif
 			return Blit565to565SurfaceAlpha;
 		    }
@@ -2784,6 +2789,10 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 				if(!(surface->map->dst->flags & SDL_HWSURFACE)
 					&& SDL_HasAltiVec())
 					return BlitRGBtoRGBSurfaceAlphaAltivec;
+#endif
+#if SDL_NEON_BLITTERS
+				if(SDL_BlitNEONEnabled())
+					return SDL_BlitRGBtoRGBSurfaceAlphaNEON;
 #endif
 				return BlitRGBtoRGBSurfaceAlpha;
 			}
@@ -2819,8 +2828,13 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	       && sf->Gmask == 0xff00
 	       && ((sf->Rmask == 0xff && df->Rmask == 0x1f)
 		   || (sf->Bmask == 0xff && df->Bmask == 0x1f))) {
-		if(df->Gmask == 0x7e0)
+		if(df->Gmask == 0x7e0) {
+#if SDL_NEON_BLITTERS
+		    if(SDL_BlitNEONEnabled())
+			return SDL_BlitARGBto565PixelAlphaNEON;
+#endif
 		    return BlitARGBto565PixelAlpha;
+		}
 		else if(df->Gmask == 0x3e0)
 		    return BlitARGBto555PixelAlpha;
 	    }
@@ -2851,6 +2865,10 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 			if(!(surface->map->dst->flags & SDL_HWSURFACE)
 				&& SDL_HasAltiVec())
 				return BlitRGBtoRGBPixelAlphaAltivec;
+#endif
+#if SDL_NEON_BLITTERS
+			if(SDL_BlitNEONEnabled())
+				return SDL_BlitRGBtoRGBPixelAlphaNEON;
 #endif
 			return BlitRGBtoRGBPixelAlpha;
 		}
@@ -836,6 +836,9 @@ static Uint32 GetBlitFeatures( void )
 #if __MWERKS__
 #pragma altivec_model off
 #endif
+#elif SDL_NEON_BLITTERS
+/* Feature 1 is has-MMX, feature 8 is has-NEON */
+#define GetBlitFeatures() ((Uint32)((SDL_HasMMX() ? 1 : 0) | (SDL_BlitNEONEnabled() ? 8 : 0)))
 #else
 /* Feature 1 is has-MMX */
 #define GetBlitFeatures() ((Uint32)(SDL_HasMMX() ? 1 : 0))
@@ -2297,6 +2300,13 @@ static const struct blit_table normal_blit_2[] = {
       2, NULL, Blit_RGB565_32Altivec, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
     { 0x00007C00,0x000003E0,0x0000001F, 4, 0x00000000,0x00000000,0x00000000,
       2, NULL, Blit_RGB555_32Altivec, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+#endif
+#if SDL_NEON_BLITTERS
+    /* has-neon */
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x00FF0000,0x0000FF00,0x000000FF,
+      8, NULL, SDL_Blit_RGB565_ARGB8888NEON, NO_ALPHA | SET_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x000000FF,0x0000FF00,0x00FF0000,
+      8, NULL, SDL_Blit_RGB565_ABGR8888NEON, NO_ALPHA | SET_ALPHA },
 #endif
     { 0x0000F800,0x000007E0,0x0000001F, 4, 0x00FF0000,0x0000FF00,0x000000FF,
       0, NULL, Blit_RGB565_ARGB8888, SET_ALPHA },
@@ -2355,6 +2365,11 @@ static const struct blit_table normal_blit_4[] = {
     /* has-altivec */
     { 0x00000000,0x00000000,0x00000000, 2, 0x0000F800,0x000007E0,0x0000001F,
       2, NULL, Blit_RGB888_RGB565Altivec, NO_ALPHA },
+#endif
+#if SDL_NEON_BLITTERS
+    /* has-neon */
+    { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x0000F800,0x000007E0,0x0000001F,
+      8, NULL, SDL_Blit_RGB888_RGB565NEON, NO_ALPHA },
 #endif
     { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x0000F800,0x000007E0,0x0000001F,
       0, NULL, Blit_RGB888_RGB565, NO_ALPHA },
@@ -2401,8 +2416,13 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 	       If a particular case turns out to be useful we'll add it. */
 
 	    if(srcfmt->BytesPerPixel == 2
-	       && surface->map->identity)
+	       && surface->map->identity) {
+#if SDL_NEON_BLITTERS
+		if(SDL_BlitNEONEnabled())
+		    return SDL_Blit2to2KeyNEON;
+#endif
 		return Blit2to2Key;
+	    }
 	    else if(dstfmt->BytesPerPixel == 1)
 		return BlitNto1Key;
 	    else {
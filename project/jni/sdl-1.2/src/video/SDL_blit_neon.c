@@ -0,0 +1,478 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* ARM NEON blitters.
+   On armeabi-v7a this file is the only one built with NEON enabled, the
+   blitters are picked by SDL_blit_N.c and SDL_blit_A.c only when
+   SDL_BlitNEONEnabled() says the CPU has NEON.
+   All of them assume little endian 32-bit pixels, and handle 8 pixels
+   per iteration; the leftover pixels use the same math as the C blitters.
+ */
+
+#include "SDL_video.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_blit.h"
+
+#if SDL_NEON_BLITTERS
+
+#include <arm_neon.h>
+
+/* Set SDL_NEON_BLITTERS=0 to get the C blitters, for comparison */
+int SDL_BlitNEONEnabled(void)
+{
+	const char *hint = SDL_getenv("SDL_NEON_BLITTERS");
+
+	if ( hint && *hint == '0' ) {
+		return 0;
+	}
+	return SDL_HasNEON();
+}
+
+/* Split 8 RGB565 pixels into 5/6/5 bit components */
+#define UNPACK_565_NEON(p, r, g, b) { \
+	r = vreinterpretq_s16_u16(vshrq_n_u16(p, 11)); \
+	g = vreinterpretq_s16_u16(vandq_u16(vshrq_n_u16(p, 5), vdupq_n_u16(0x3f))); \
+	b = vreinterpretq_s16_u16(vandq_u16(p, vdupq_n_u16(0x1f))); \
+}
+
+#define PACK_565_NEON(r, g, b) \
+	vorrq_u16(vorrq_u16(vshlq_n_u16(vreinterpretq_u16_s16(r), 11), \
+	                    vshlq_n_u16(vreinterpretq_u16_s16(g), 5)), \
+	          vreinterpretq_u16_s16(b))
+
+/* d + ((s - d) * alpha >> 5), alpha in 0..32 */
+#define BLEND_565_NEON(d, s, alpha) \
+	vaddq_s16(d, vshrq_n_s16(vmulq_s16(vsubq_s16(s, d), alpha), 5))
+
+/* (s * alpha + d * (256 - alpha)) >> 8 = d + ((s - d) * alpha >> 8) */
+#define BLEND_8888_NEON(d, s, alpha, ialpha) \
+	vshrn_n_u16(vmlaq_u16(vmulq_u16(vmovl_u8(s), alpha), vmovl_u8(d), ialpha), 8)
+
+/* RGB 8-8-8 --> RGB 5-6-5 */
+void SDL_Blit_RGB888_RGB565NEON(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+
+	while ( height-- ) {
+		int n = width;
+		for ( ; n >= 8; n -= 8, srcp += 8, dstp += 8 ) {
+			uint8x8x4_t s = vld4_u8((const Uint8 *)srcp);
+			uint16x8_t d = vshll_n_u8(s.val[2], 8);
+			d = vsriq_n_u16(d, vshll_n_u8(s.val[1], 8), 5);
+			d = vsriq_n_u16(d, vshll_n_u8(s.val[0], 8), 11);
+			vst1q_u16(dstp, d);
+		}
+		for ( ; n; --n ) {
+			Uint32 s = *srcp++;
+			*dstp++ = (Uint16)(((s & 0x00F80000) >> 8) |
+			                   ((s & 0x0000FC00) >> 5) |
+			                   ((s & 0x000000F8) >> 3));
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* RGB 5-6-5 --> 8-8-8-8, r_index/b_index are the byte positions of red/blue */
+static __inline__ void Blit_RGB565_32NEON(SDL_BlitInfo *info, int r_index, int b_index)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint16 *srcp = (Uint16 *)info->s_pixels;
+	int srcskip = info->s_skip >> 1;
+	Uint8 *dstp = info->d_pixels;
+	int dstskip = info->d_skip;
+
+	while ( height-- ) {
+		int n = width;
+		for ( ; n >= 8; n -= 8, srcp += 8, dstp += 32 ) {
+			uint16x8_t p = vld1q_u16(srcp);
+			uint8x8_t r = vand_u8(vshrn_n_u16(p, 8), vdup_n_u8(0xf8));
+			uint8x8_t g = vand_u8(vshrn_n_u16(p, 3), vdup_n_u8(0xfc));
+			uint8x8_t b = vmovn_u16(vshlq_n_u16(p, 3));
+			uint8x8x4_t d;
+			/* replicate the high bits into the low ones, like the LUTs */
+			d.val[r_index] = vsri_n_u8(r, r, 5);
+			d.val[1] = vsri_n_u8(g, g, 6);
+			d.val[b_index] = vsri_n_u8(b, b, 5);
+			d.val[3] = vdup_n_u8(0xff);
+			vst4_u8(dstp, d);
+		}
+		for ( ; n; --n, dstp += 4 ) {
+			Uint16 s = *srcp++;
+			Uint8 r = (s >> 8) & 0xf8;
+			Uint8 g = (s >> 3) & 0xfc;
+			Uint8 b = (Uint8)(s << 3);
+			dstp[r_index] = r | (r >> 5);
+			dstp[1] = g | (g >> 6);
+			dstp[b_index] = b | (b >> 5);
+			dstp[3] = 0xff;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* RGB 5-6-5 --> ARGB 8-8-8-8 */
+void SDL_Blit_RGB565_ARGB8888NEON(SDL_BlitInfo *info)
+{
+	Blit_RGB565_32NEON(info, 2, 0);
+}
+
+/* RGB 5-6-5 --> ABGR 8-8-8-8 */
+void SDL_Blit_RGB565_ABGR8888NEON(SDL_BlitInfo *info)
+{
+	Blit_RGB565_32NEON(info, 0, 2);
+}
+
+/* 16-bit colorkey blit between identical formats */
+void SDL_Blit2to2KeyNEON(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint16 *srcp = (Uint16 *)info->s_pixels;
+	int srcskip = info->s_skip >> 1;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	Uint16 rgbmask = (Uint16)~info->src->Amask;
+	Uint16 ckey = (Uint16)info->src->colorkey & rgbmask;
+	uint16x8_t vmask = vdupq_n_u16(rgbmask);
+	uint16x8_t vkey = vdupq_n_u16(ckey);
+
+	while ( height-- ) {
+		int n = width;
+		for ( ; n >= 8; n -= 8, srcp += 8, dstp += 8 ) {
+			uint16x8_t s = vld1q_u16(srcp);
+			uint16x8_t d = vld1q_u16(dstp);
+			uint16x8_t key = vceqq_u16(vandq_u16(s, vmask), vkey);
+			vst1q_u16(dstp, vbslq_u16(key, d, s));
+		}
+		for ( ; n; --n, ++srcp, ++dstp ) {
+			if ( (*srcp & rgbmask) != ckey ) {
+				*dstp = *srcp;
+			}
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* RGB565->RGB565 blending with surface alpha */
+void SDL_Blit565to565SurfaceAlphaNEON(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint16 *srcp = (Uint16 *)info->s_pixels;
+	int srcskip = info->s_skip >> 1;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+	unsigned alpha = info->src->alpha >> 3;	/* downscale alpha to 5 bits */
+	int16x8_t valpha = vdupq_n_s16(alpha);
+
+	while ( height-- ) {
+		int n = width;
+		for ( ; n >= 8; n -= 8, srcp += 8, dstp += 8 ) {
+			uint16x8_t s = vld1q_u16(srcp);
+			uint16x8_t d = vld1q_u16(dstp);
+			int16x8_t sr, sg, sb, dr, dg, db;
+			UNPACK_565_NEON(s, sr, sg, sb);
+			UNPACK_565_NEON(d, dr, dg, db);
+			dr = BLEND_565_NEON(dr, sr, valpha);
+			dg = BLEND_565_NEON(dg, sg, valpha);
+			db = BLEND_565_NEON(db, sb, valpha);
+			vst1q_u16(dstp, PACK_565_NEON(dr, dg, db));
+		}
+		for ( ; n; --n ) {
+			Uint32 s = *srcp++;
+			Uint32 d = *dstp;
+			s = (s | s << 16) & 0x07e0f81f;
+			d = (d | d << 16) & 0x07e0f81f;
+			d += (s - d) * alpha >> 5;
+			d &= 0x07e0f81f;
+			*dstp++ = (Uint16)(d | d >> 16);
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* ARGB8888->RGB565 blending with pixel alpha */
+void SDL_BlitARGBto565PixelAlphaNEON(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+
+	while ( height-- ) {
+		int n = width;
+		for ( ; n >= 8; n -= 8, srcp += 8, dstp += 8 ) {
+			uint8x8x4_t s = vld4_u8((const Uint8 *)srcp);
+			uint16x8_t d = vld1q_u16(dstp);
+			uint16x8_t alpha = vmovl_u8(vshr_n_u8(s.val[3], 3));
+			int16x8_t sr, sg, sb, dr, dg, db;
+			/* alpha 31 becomes 32, so opaque pixels are copied exactly */
+			alpha = vsubq_u16(alpha, vceqq_u16(alpha, vdupq_n_u16(31)));
+			sr = vreinterpretq_s16_u16(vmovl_u8(vshr_n_u8(s.val[2], 3)));
+			sg = vreinterpretq_s16_u16(vmovl_u8(vshr_n_u8(s.val[1], 2)));
+			sb = vreinterpretq_s16_u16(vmovl_u8(vshr_n_u8(s.val[0], 3)));
+			UNPACK_565_NEON(d, dr, dg, db);
+			dr = BLEND_565_NEON(dr, sr, vreinterpretq_s16_u16(alpha));
+			dg = BLEND_565_NEON(dg, sg, vreinterpretq_s16_u16(alpha));
+			db = BLEND_565_NEON(db, sb, vreinterpretq_s16_u16(alpha));
+			vst1q_u16(dstp, PACK_565_NEON(dr, dg, db));
+		}
+		for ( ; n; --n, ++srcp, ++dstp ) {
+			Uint32 s = *srcp;
+			unsigned alpha = s >> 27; /* downscale alpha to 5 bits */
+			if ( alpha == (SDL_ALPHA_OPAQUE >> 3) ) {
+				*dstp = (Uint16)((s >> 8 & 0xf800) + (s >> 5 & 0x7e0) + (s >> 3  & 0x1f));
+			} else if ( alpha ) {
+				Uint32 d = *dstp;
+				s = ((s & 0xfc00) << 11) + (s >> 8 & 0xf800)
+				  + (s >> 3 & 0x1f);
+				d = (d | d << 16) & 0x07e0f81f;
+				d += (s - d) * alpha >> 5;
+				d &= 0x07e0f81f;
+				*dstp = (Uint16)(d | d >> 16);
+			}
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* RGB888->(A)RGB888 blending with surface alpha */
+void SDL_BlitRGBtoRGBSurfaceAlphaNEON(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	unsigned alpha = info->src->alpha;
+	uint16x8_t valpha = vdupq_n_u16(alpha);
+	uint16x8_t vialpha = vdupq_n_u16(256 - alpha);
+
+	while ( height-- ) {
+		int n = width;
+		for ( ; n >= 8; n -= 8, srcp += 8, dstp += 8 ) {
+			uint8x8x4_t s = vld4_u8((const Uint8 *)srcp);
+			uint8x8x4_t d = vld4_u8((const Uint8 *)dstp);
+			d.val[0] = BLEND_8888_NEON(d.val[0], s.val[0], valpha, vialpha);
+			d.val[1] = BLEND_8888_NEON(d.val[1], s.val[1], valpha, vialpha);
+			d.val[2] = BLEND_8888_NEON(d.val[2], s.val[2], valpha, vialpha);
+			d.val[3] = vdup_n_u8(0xff);
+			vst4_u8((Uint8 *)dstp, d);
+		}
+		for ( ; n; --n ) {
+			Uint32 s = *srcp++;
+			Uint32 d = *dstp;
+			Uint32 s1 = s & 0xff00ff;
+			Uint32 d1 = d & 0xff00ff;
+			d1 = (d1 + ((s1 - d1) * alpha >> 8)) & 0xff00ff;
+			s &= 0xff00;
+			d &= 0xff00;
+			d = (d + ((s - d) * alpha >> 8)) & 0xff00;
+			*dstp++ = d1 | d | 0xff000000;
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* ARGB888->(A)RGB888 blending with pixel alpha, keeps the destination alpha */
+void SDL_BlitRGBtoRGBPixelAlphaNEON(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+
+	while ( height-- ) {
+		int n = width;
+		for ( ; n >= 8; n -= 8, srcp += 8, dstp += 8 ) {
+			uint8x8x4_t s = vld4_u8((const Uint8 *)srcp);
+			uint8x8x4_t d = vld4_u8((const Uint8 *)dstp);
+			uint16x8_t alpha = vmovl_u8(s.val[3]);
+			uint16x8_t ialpha;
+			/* alpha 255 becomes 256, so opaque pixels are copied exactly */
+			alpha = vsubq_u16(alpha, vceqq_u16(alpha, vdupq_n_u16(SDL_ALPHA_OPAQUE)));
+			ialpha = vsubq_u16(vdupq_n_u16(256), alpha);
+			d.val[0] = BLEND_8888_NEON(d.val[0], s.val[0], alpha, ialpha);
+			d.val[1] = BLEND_8888_NEON(d.val[1], s.val[1], alpha, ialpha);
+			d.val[2] = BLEND_8888_NEON(d.val[2], s.val[2], alpha, ialpha);
+			vst4_u8((Uint8 *)dstp, d);
+		}
+		for ( ; n; --n, ++srcp, ++dstp ) {
+			Uint32 s = *srcp;
+			Uint32 alpha = s >> 24;
+			if ( alpha == SDL_ALPHA_OPAQUE ) {
+				*dstp = (s & 0x00ffffff) | (*dstp & 0xff000000);
+			} else if ( alpha ) {
+				Uint32 d = *dstp;
+				Uint32 dalpha = d & 0xff000000;
+				Uint32 s1 = s & 0xff00ff;
+				Uint32 d1 = d & 0xff00ff;
+				d1 = (d1 + ((s1 - d1) * alpha >> 8)) & 0xff00ff;
+				s &= 0xff00;
+				d &= 0xff00;
+				d = (d + ((s - d) * alpha >> 8)) & 0xff00;
+				*dstp = d1 | d | dalpha;
+			}
+		}
+		srcp += srcskip;
+		dstp += dstskip;
+	}
+}
+
+/* Vertical pass of the bilinear stretch in SDL_stretch.c, weight in 1..255 */
+void SDL_StretchBlendRowsNEON(Uint32 *row0, Uint32 *row1, Uint32 *dst,
+                              int width, int weight)
+{
+	uint16x8_t vweight = vdupq_n_u16(weight);
+	uint16x8_t viweight = vdupq_n_u16(256 - weight);
+
+	for ( ; width >= 8; width -= 8, row0 += 8, row1 += 8, dst += 8 ) {
+		uint8x8x4_t a = vld4_u8((const Uint8 *)row0);
+		uint8x8x4_t b = vld4_u8((const Uint8 *)row1);
+		a.val[0] = BLEND_8888_NEON(a.val[0], b.val[0], vweight, viweight);
+		a.val[1] = BLEND_8888_NEON(a.val[1], b.val[1], vweight, viweight);
+		a.val[2] = BLEND_8888_NEON(a.val[2], b.val[2], vweight, viweight);
+		a.val[3] = BLEND_8888_NEON(a.val[3], b.val[3], vweight, viweight);
+		vst4_u8((Uint8 *)dst, a);
+	}
+	for ( ; width; --width ) {
+		Uint32 a = *row0++;
+		Uint32 b = *row1++;
+		Uint32 rb = (((a & 0xff00ff) * (256 - weight) + (b & 0xff00ff) * weight) >> 8) & 0xff00ff;
+		Uint32 ga = (((a >> 8) & 0xff00ff) * (256 - weight) + ((b >> 8) & 0xff00ff) * weight) & 0xff00ff00;
+		*dst++ = rb | ga;
+	}
+}
+
+#endif /* SDL_NEON_BLITTERS */
+
+#ifdef TEST_MAIN
+
+/* Blitter benchmark, prints Mpixels/s of the blits the NEON blitters cover.
+   Run it once as is and once with SDL_NEON_BLITTERS=0 to compare with C.
+ */
+
+#include <stdio.h>
+
+#include "SDL.h"
+
+#define BENCH_W	320
+#define BENCH_H	240
+#define BENCH_BLITS	200
+
+static SDL_Surface *CreateBenchSurface(int bpp, Uint32 Amask, int fill)
+{
+	SDL_Surface *surface;
+	Uint8 *pixels;
+	int i;
+
+	if ( bpp == 16 ) {
+		surface = SDL_CreateRGBSurface(SDL_SWSURFACE, BENCH_W, BENCH_H, 16, 0xf800, 0x07e0, 0x001f, 0);
+	} else {
+		surface = SDL_CreateRGBSurface(SDL_SWSURFACE, BENCH_W, BENCH_H, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, Amask);
+	}
+	if ( surface ) {
+		pixels = (Uint8 *)surface->pixels;
+		for ( i = 0; i < surface->pitch * surface->h; ++i ) {
+			pixels[i] = (Uint8)(i * fill + (i >> 7));
+		}
+	}
+	return surface;
+}
+
+static void Bench(const char *name, int srcbpp, Uint32 srcAmask, int dstbpp, Uint32 flags, Uint8 alpha)
+{
+	SDL_Surface *src = CreateBenchSurface(srcbpp, srcAmask, 7);
+	SDL_Surface *dst = CreateBenchSurface(dstbpp, 0, 13);
+	Uint32 start, ticks;
+	int i;
+
+	if ( !src || !dst ) {
+		printf("%-28s: %s\n", name, SDL_GetError());
+		return;
+	}
+	if ( flags & SDL_SRCCOLORKEY ) {
+		SDL_SetColorKey(src, SDL_SRCCOLORKEY, *(Uint16 *)src->pixels);
+	}
+	if ( flags & SDL_SRCALPHA ) {
+		SDL_SetAlpha(src, SDL_SRCALPHA, alpha);
+	}
+
+	SDL_BlitSurface(src, NULL, dst, NULL);	/* map the surfaces */
+	start = SDL_GetTicks();
+	for ( i = 0; i < BENCH_BLITS; ++i ) {
+		SDL_BlitSurface(src, NULL, dst, NULL);
+	}
+	ticks = SDL_GetTicks() - start;
+
+	printf("%-28s: %8.1f Mpixels/s\n", name,
+	       (double)BENCH_W * BENCH_H * BENCH_BLITS / 1000.0 / (ticks ? ticks : 1));
+
+	SDL_FreeSurface(src);
+	SDL_FreeSurface(dst);
+}
+
+int main(int argc, char *argv[])
+{
+	if ( SDL_Init(SDL_INIT_TIMER) < 0 ) {
+		printf("SDL_Init: %s\n", SDL_GetError());
+		return 1;
+	}
+	printf("NEON: %d, NEON blitters: %s\n", SDL_HasNEON(),
+#if SDL_NEON_BLITTERS
+	       SDL_BlitNEONEnabled() ? "on" : "off"
+#else
+	       "not built"
+#endif
+	);
+
+	Bench("RGB888 -> RGB565", 32, 0, 16, 0, 0);
+	Bench("RGB565 -> ARGB8888", 16, 0, 32, 0, 0);
+	Bench("RGB565 colorkey", 16, 0, 16, SDL_SRCCOLORKEY, 0);
+	Bench("RGB565 surface alpha", 16, 0, 16, SDL_SRCALPHA, 100);
+	Bench("ARGB8888 -> RGB565 alpha", 32, 0xff000000, 16, SDL_SRCALPHA, SDL_ALPHA_OPAQUE);
+	Bench("RGB888 surface alpha", 32, 0, 32, SDL_SRCALPHA, 100);
+	Bench("ARGB8888 pixel alpha", 32, 0xff000000, 32, SDL_SRCALPHA, SDL_ALPHA_OPAQUE);
+
+	SDL_Quit();
+	return 0;
+}
+
+#endif /* TEST_MAIN */
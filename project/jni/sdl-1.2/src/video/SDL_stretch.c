@@ -196,86 +196,365 @@ void copy_row3(Uint8 *src, int src_w, Uint8 *dst, int dst_w)
 	}
 }
 
-/* Perform a stretch blit between two surfaces of the same format.
-   NOTE:  This function is not safe to call from multiple threads!
+
+/* Integer factor stretch, every source pixel is replicated n times.
+   The common cases write several pixels with one 32-bit store, they
+   need a 32-bit aligned destination row.
 */
-int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
-                    SDL_Surface *dst, SDL_Rect *dstrect)
+static void copy_row1_x2(Uint8 *src, int src_w, Uint8 *dst)
 {
-	int src_locked;
-	int dst_locked;
-	int pos, inc;
-	int dst_width;
-	int dst_maxrow;
-	int src_row, dst_row;
-	Uint8 *srcp = NULL;
-	Uint8 *dstp;
-	SDL_Rect full_src;
-	SDL_Rect full_dst;
-#ifdef USE_ASM_STRETCH
-	SDL_bool use_asm = SDL_TRUE;
-#ifdef __GNUC__
-	int u1, u2;
-#endif
-#endif /* USE_ASM_STRETCH */
-	const int bpp = dst->format->BytesPerPixel;
+	Uint16 *d = (Uint16 *)dst;
+	int i;
 
-	if ( src->format->BitsPerPixel != dst->format->BitsPerPixel ) {
-		SDL_SetError("Only works with same format surfaces");
-		return(-1);
+	for ( i=src_w; i>0; --i ) {
+		*d++ = (Uint16)(*src++ * 0x0101);
 	}
+}
 
-	/* Verify the blit rectangles */
-	if ( srcrect ) {
-		if ( (srcrect->x < 0) || (srcrect->y < 0) ||
-		     ((srcrect->x+srcrect->w) > src->w) ||
-		     ((srcrect->y+srcrect->h) > src->h) ) {
-			SDL_SetError("Invalid source blit rectangle");
-			return(-1);
+static void copy_row1_x4(Uint8 *src, int src_w, Uint8 *dst)
+{
+	Uint32 *d = (Uint32 *)dst;
+	int i;
+
+	for ( i=src_w; i>0; --i ) {
+		*d++ = (Uint32)*src++ * 0x01010101;
+	}
+}
+
+static void copy_row2_x2(Uint16 *src, int src_w, Uint16 *dst)
+{
+	Uint32 *d = (Uint32 *)dst;
+	int i;
+
+	for ( i=src_w; i>0; --i ) {
+		*d++ = (Uint32)*src++ * 0x00010001;
+	}
+}
+
+static void copy_row2_x4(Uint16 *src, int src_w, Uint16 *dst)
+{
+	Uint32 *d = (Uint32 *)dst;
+	Uint32 pixel;
+	int i;
+
+	for ( i=src_w; i>0; --i ) {
+		pixel = (Uint32)*src++ * 0x00010001;
+		d[0] = pixel;
+		d[1] = pixel;
+		d += 2;
+	}
+}
+
+#define DEFINE_COPY_ROW_XN(name, type)			\
+static void name(type *src, int src_w, type *dst, int n)	\
+{							\
+	int i, j;					\
+	type pixel;					\
+							\
+	for ( i=src_w; i>0; --i ) {			\
+		pixel = *src++;				\
+		for ( j=n; j>0; --j ) {			\
+			*dst++ = pixel;			\
+		}					\
+	}						\
+}
+DEFINE_COPY_ROW_XN(copy_row1_xn, Uint8)
+DEFINE_COPY_ROW_XN(copy_row2_xn, Uint16)
+DEFINE_COPY_ROW_XN(copy_row4_xn, Uint32)
+
+static void copy_row3_xn(Uint8 *src, int src_w, Uint8 *dst, int n)
+{
+	int i, j;
+
+	for ( i=src_w; i>0; --i ) {
+		for ( j=n; j>0; --j ) {
+			*dst++ = src[0];
+			*dst++ = src[1];
+			*dst++ = src[2];
 		}
-	} else {
-		full_src.x = 0;
-		full_src.y = 0;
-		full_src.w = src->w;
-		full_src.h = src->h;
-		srcrect = &full_src;
+		src += 3;
 	}
-	if ( dstrect ) {
-		if ( (dstrect->x < 0) || (dstrect->y < 0) ||
-		     ((dstrect->x+dstrect->w) > dst->w) ||
-		     ((dstrect->y+dstrect->h) > dst->h) ) {
-			SDL_SetError("Invalid destination blit rectangle");
-			return(-1);
+}
+
+static void copy_row_scaled(Uint8 *src, int src_w, Uint8 *dst,
+                            int bpp, int n, int aligned)
+{
+	if ( n == 1 ) {
+		SDL_memcpy(dst, src, src_w*bpp);
+		return;
+	}
+	switch (bpp) {
+	    case 1:
+		if ( aligned && n == 2 ) {
+			copy_row1_x2(src, src_w, dst);
+		} else if ( aligned && n == 4 ) {
+			copy_row1_x4(src, src_w, dst);
+		} else {
+			copy_row1_xn(src, src_w, dst, n);
 		}
-	} else {
-		full_dst.x = 0;
-		full_dst.y = 0;
-		full_dst.w = dst->w;
-		full_dst.h = dst->h;
-		dstrect = &full_dst;
+		break;
+	    case 2:
+		if ( aligned && n == 2 ) {
+			copy_row2_x2((Uint16 *)src, src_w, (Uint16 *)dst);
+		} else if ( aligned && n == 4 ) {
+			copy_row2_x4((Uint16 *)src, src_w, (Uint16 *)dst);
+		} else {
+			copy_row2_xn((Uint16 *)src, src_w, (Uint16 *)dst, n);
+		}
+		break;
+	    case 3:
+		copy_row3_xn(src, src_w, dst, n);
+		break;
+	    case 4:
+		copy_row4_xn((Uint32 *)src, src_w, (Uint32 *)dst, n);
+		break;
 	}
+}
 
-	/* Lock the destination if it's in hardware */
-	dst_locked = 0;
-	if ( SDL_MUSTLOCK(dst) ) {
-		if ( SDL_LockSurface(dst) < 0 ) {
-			SDL_SetError("Unable to lock destination surface");
+/* Per byte (a * (256 - f) + b * f) >> 8 of two 8-8-8-8 words, f in 0..255 */
+#define LERP_8888(a, b, f) \
+	((((((a) & 0x00ff00ff) * (256 - (f)) + ((b) & 0x00ff00ff) * (f)) >> 8) & 0x00ff00ff) | \
+	  (((((a) >> 8) & 0x00ff00ff) * (256 - (f)) + (((b) >> 8) & 0x00ff00ff) * (f)) & 0xff00ff00))
+
+/* Bilinear stretch state.  Source lines are filtered horizontally once
+   into 8-bit per channel words and kept in a two line cache, so every
+   output line only costs a vertical blend of the cached lines.
+*/
+static struct {
+	int src_w;
+	int dst_w;
+	int size;
+	void *buffer;
+	int *xofs;		/* left source pixel of each output pixel */
+	int *xfrac;		/* weight of the right source pixel, 0..255 */
+	Uint32 *line[2];	/* horizontally filtered source lines */
+	int cached[2];		/* source line held in line[], or -1 */
+	Uint32 *blend;		/* vertically blended line, 16 bpp only */
+	Uint32 *unpacked;	/* 16 bpp source line split into bytes */
+} linear;
+
+/* Map a 16.16 pixel center to the left sample and the weight of the right one */
+static __inline__ void linear_coord(int pos, int len, int *ofs, int *frac)
+{
+	if ( pos < 0 ) {
+		pos = 0;
+	}
+	*ofs = pos >> 16;
+	*frac = (pos >> 8) & 0xff;
+	if ( *ofs >= len-1 ) {
+		*ofs = len-1;
+		*frac = 0;
+	}
+}
+
+static int setup_linear(int src_w, int dst_w)
+{
+	int i;
+	int pos, inc;
+	int size;
+
+	size = dst_w*(2*sizeof(int) + 3*sizeof(Uint32)) + src_w*sizeof(Uint32);
+	if ( size > linear.size ) {
+		SDL_free(linear.buffer);
+		linear.buffer = SDL_malloc(size);
+		if ( !linear.buffer ) {
+			linear.size = 0;
+			linear.src_w = 0;
+			SDL_OutOfMemory();
 			return(-1);
 		}
-		dst_locked = 1;
+		linear.size = size;
+		linear.src_w = 0;
 	}
-	/* Lock the source if it's in hardware */
-	src_locked = 0;
-	if ( SDL_MUSTLOCK(src) ) {
-		if ( SDL_LockSurface(src) < 0 ) {
-			if ( dst_locked ) {
-				SDL_UnlockSurface(dst);
+	linear.line[0] = (Uint32 *)linear.buffer;
+	linear.line[1] = linear.line[0] + dst_w;
+	linear.blend = linear.line[1] + dst_w;
+	linear.unpacked = linear.blend + dst_w;
+	linear.xofs = (int *)(linear.unpacked + src_w);
+	linear.xfrac = linear.xofs + dst_w;
+	linear.cached[0] = -1;
+	linear.cached[1] = -1;
+
+	/* See if we need to rebuild the horizontal sample table */
+	if ( (src_w == linear.src_w) && (dst_w == linear.dst_w) ) {
+		return(0);
+	}
+	inc = (src_w << 16) / dst_w;
+	pos = inc/2 - 0x8000;
+	for ( i=0; i<dst_w; ++i ) {
+		linear_coord(pos, src_w, &linear.xofs[i], &linear.xfrac[i]);
+		pos += inc;
+	}
+	linear.src_w = src_w;
+	linear.dst_w = dst_w;
+	return(0);
+}
+
+static void unpack_row2(Uint16 *src, Uint32 *dst, int w, SDL_PixelFormat *fmt)
+{
+	Uint32 pixel;
+
+	while ( w-- ) {
+		pixel = *src++;
+		*dst++ = ((pixel & fmt->Rmask) >> fmt->Rshift) |
+		         (((pixel & fmt->Gmask) >> fmt->Gshift) << 8) |
+		         (((pixel & fmt->Bmask) >> fmt->Bshift) << 16) |
+		         (((pixel & fmt->Amask) >> fmt->Ashift) << 24);
+	}
+}
+
+static void pack_row2(Uint32 *src, Uint16 *dst, int w, SDL_PixelFormat *fmt)
+{
+	Uint32 pixel;
+
+	while ( w-- ) {
+		pixel = *src++;
+		*dst++ = (Uint16)(((pixel & 0xff) << fmt->Rshift) |
+		                  (((pixel >> 8) & 0xff) << fmt->Gshift) |
+		                  (((pixel >> 16) & 0xff) << fmt->Bshift) |
+		                  ((pixel >> 24) << fmt->Ashift));
+	}
+}
+
+static void filter_row(Uint32 *src, Uint32 *dst, int dst_w)
+{
+	const int *xofs = linear.xofs;
+	const int *xfrac = linear.xfrac;
+	Uint32 *p;
+	int i;
+
+	for ( i=0; i<dst_w; ++i ) {
+		p = src + xofs[i];
+		if ( xfrac[i] ) {
+			dst[i] = LERP_8888(p[0], p[1], xfrac[i]);
+		} else {
+			dst[i] = p[0];
+		}
+	}
+}
+
+static void blend_rows(Uint32 *row0, Uint32 *row1, Uint32 *dst, int w,
+                       int frac, int use_neon)
+{
+#if SDL_NEON_BLITTERS
+	if ( use_neon ) {
+		SDL_StretchBlendRowsNEON(row0, row1, dst, w, frac);
+		return;
+	}
+#endif
+	while ( w-- ) {
+		*dst++ = LERP_8888(*row0, *row1, frac);
+		++row0;
+		++row1;
+	}
+}
+
+/* Make sure source line 'row' of the stretch is in linear.line[index] */
+static void cache_line(SDL_Surface *src, SDL_Rect *srcrect, int row,
+                       int index, int dst_w)
+{
+	Uint8 *srcp;
+	Uint32 *line;
+	int cached;
+
+	if ( linear.cached[index] == row ) {
+		return;
+	}
+	if ( linear.cached[!index] == row ) {
+		/* The line moved from the bottom to the top of the window */
+		line = linear.line[0];
+		linear.line[0] = linear.line[1];
+		linear.line[1] = line;
+		cached = linear.cached[0];
+		linear.cached[0] = linear.cached[1];
+		linear.cached[1] = cached;
+		return;
+	}
+	srcp = (Uint8 *)src->pixels + ((srcrect->y+row)*src->pitch)
+	                            + (srcrect->x*src->format->BytesPerPixel);
+	if ( src->format->BytesPerPixel == 2 ) {
+		unpack_row2((Uint16 *)srcp, linear.unpacked, srcrect->w,
+		            src->format);
+		filter_row(linear.unpacked, linear.line[index], dst_w);
+	} else {
+		filter_row((Uint32 *)srcp, linear.line[index], dst_w);
+	}
+	linear.cached[index] = row;
+}
+
+static int stretch_linear(SDL_Surface *src, SDL_Rect *srcrect,
+                          SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	int i;
+	int pos, inc;
+	int row, frac;
+	int use_neon = 0;
+	Uint8 *dstp;
+	Uint32 *line;
+
+	if ( setup_linear(srcrect->w, dstrect->w) < 0 ) {
+		return(-1);
+	}
+#if SDL_NEON_BLITTERS
+	use_neon = SDL_BlitNEONEnabled();
+#endif
+
+	inc = (srcrect->h << 16) / dstrect->h;
+	pos = inc/2 - 0x8000;
+	for ( i=0; i<dstrect->h; ++i ) {
+		linear_coord(pos, srcrect->h, &row, &frac);
+		pos += inc;
+
+		cache_line(src, srcrect, row, 0, dstrect->w);
+		if ( frac ) {
+			cache_line(src, srcrect, row+1, 1, dstrect->w);
+		}
+
+		dstp = (Uint8 *)dst->pixels + ((dstrect->y+i)*dst->pitch)
+		                            + (dstrect->x*dst->format->BytesPerPixel);
+		if ( dst->format->BytesPerPixel == 4 ) {
+			if ( frac ) {
+				blend_rows(linear.line[0], linear.line[1],
+				           (Uint32 *)dstp, dstrect->w, frac, use_neon);
+			} else {
+				SDL_memcpy(dstp, linear.line[0], dstrect->w*4);
 			}
-			SDL_SetError("Unable to lock source surface");
-			return(-1);
+		} else {
+			line = linear.line[0];
+			if ( frac ) {
+				blend_rows(linear.line[0], linear.line[1],
+				           linear.blend, dstrect->w, frac, use_neon);
+				line = linear.blend;
+			}
+			pack_row2(line, (Uint16 *)dstp, dstrect->w, dst->format);
 		}
-		src_locked = 1;
 	}
+	return(0);
+}
+
+/* Nearest neighbour stretch.  Integer factors replicate pixels directly,
+   and output lines showing the same source line as the line above are
+   copied from that line instead of being scaled again.
+*/
+static int stretch_nearest(SDL_Surface *src, SDL_Rect *srcrect,
+                           SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	int pos, inc;
+	int dst_width;
+	int dst_maxrow;
+	int src_row, dst_row;
+	int hscale, vscale;
+	int aligned;
+	Uint8 *srcp = NULL;
+	Uint8 *dstp;
+	Uint8 *prevp;
+#ifdef USE_ASM_STRETCH
+	SDL_bool use_asm = SDL_TRUE;
+#ifdef __GNUC__
+	int u1, u2;
+#endif
+#endif /* USE_ASM_STRETCH */
+	const int bpp = dst->format->BytesPerPixel;
 
 	/* Set up the data... */
 	pos = 0x10000;
@@ -284,24 +563,57 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	dst_row = dstrect->y;
 	dst_width = dstrect->w*bpp;
 
+	/* Integer factors are stepped exactly, 16.16 drifts for 3x */
+	hscale = 0;
+	if ( (dstrect->w % srcrect->w) == 0 ) {
+		hscale = dstrect->w / srcrect->w;
+	}
+	vscale = 0;
+	if ( (dstrect->h % srcrect->h) == 0 ) {
+		vscale = dstrect->h / srcrect->h;
+	}
+	aligned = ((((unsigned long)dst->pixels + dstrect->x*bpp) & 3) == 0) &&
+	          ((dst->pitch & 3) == 0);
+
 #ifdef USE_ASM_STRETCH
 	/* Write the opcodes for this stretch */
-	if ( (bpp == 3) ||
+	if ( (bpp == 3) || hscale ||
 	     (generate_rowbytes(srcrect->w, dstrect->w, bpp) < 0) ) {
 		use_asm = SDL_FALSE;
 	}
 #endif
 
 	/* Perform the stretch blit */
+	prevp = NULL;
 	for ( dst_maxrow = dst_row+dstrect->h; dst_row<dst_maxrow; ++dst_row ) {
 		dstp = (Uint8 *)dst->pixels + (dst_row*dst->pitch)
 		                            + (dstrect->x*bpp);
-		while ( pos >= 0x10000L ) {
-			srcp = (Uint8 *)src->pixels + (src_row*src->pitch)
-			                            + (srcrect->x*bpp);
-			++src_row;
-			pos -= 0x10000L;
+		if ( vscale ) {
+			if ( ((dst_row - dstrect->y) % vscale) == 0 ) {
+				srcp = (Uint8 *)src->pixels + (src_row*src->pitch)
+				                            + (srcrect->x*bpp);
+				++src_row;
+				prevp = NULL;
+			}
+		} else {
+			if ( pos >= 0x10000L ) {
+				prevp = NULL;
+			}
+			while ( pos >= 0x10000L ) {
+				srcp = (Uint8 *)src->pixels + (src_row*src->pitch)
+				                            + (srcrect->x*bpp);
+				++src_row;
+				pos -= 0x10000L;
+			}
+			pos += inc;
 		}
+		if ( prevp ) {
+			/* Same source line as the line above, reuse it */
+			SDL_memcpy(dstp, prevp, dst_width);
+			prevp = dstp;
+			continue;
+		}
+		prevp = dstp;
 #ifdef USE_ASM_STRETCH
 		if (use_asm) {
 #ifdef __GNUC__
@@ -329,6 +641,9 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 #endif
 		} else
 #endif
+		if ( hscale ) {
+			copy_row_scaled(srcp, srcrect->w, dstp, bpp, hscale, aligned);
+		} else
 		switch (bpp) {
 		    case 1:
 			copy_row1(srcp, srcrect->w, dstp, dstrect->w);
@@ -345,7 +660,96 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 			          (Uint32 *)dstp, dstrect->w);
 			break;
 		}
-		pos += inc;
+	}
+	return(0);
+}
+
+static int stretch(SDL_Surface *src, SDL_Rect *srcrect,
+                   SDL_Surface *dst, SDL_Rect *dstrect, int filter)
+{
+	int src_locked;
+	int dst_locked;
+	int retval;
+	SDL_Rect full_src;
+	SDL_Rect full_dst;
+	const int bpp = dst->format->BytesPerPixel;
+
+	if ( src->format->BitsPerPixel != dst->format->BitsPerPixel ) {
+		SDL_SetError("Only works with same format surfaces");
+		return(-1);
+	}
+
+	/* Verify the blit rectangles */
+	if ( srcrect ) {
+		if ( (srcrect->x < 0) || (srcrect->y < 0) ||
+		     ((srcrect->x+srcrect->w) > src->w) ||
+		     ((srcrect->y+srcrect->h) > src->h) ) {
+			SDL_SetError("Invalid source blit rectangle");
+			return(-1);
+		}
+	} else {
+		full_src.x = 0;
+		full_src.y = 0;
+		full_src.w = src->w;
+		full_src.h = src->h;
+		srcrect = &full_src;
+	}
+	if ( dstrect ) {
+		if ( (dstrect->x < 0) || (dstrect->y < 0) ||
+		     ((dstrect->x+dstrect->w) > dst->w) ||
+		     ((dstrect->y+dstrect->h) > dst->h) ) {
+			SDL_SetError("Invalid destination blit rectangle");
+			return(-1);
+		}
+	} else {
+		full_dst.x = 0;
+		full_dst.y = 0;
+		full_dst.w = dst->w;
+		full_dst.h = dst->h;
+		dstrect = &full_dst;
+	}
+	if ( !srcrect->w || !srcrect->h || !dstrect->w || !dstrect->h ) {
+		return(0);
+	}
+
+	/* Filtering works on 16 and 32 bpp, and isn't needed for integer
+	   factors where it gives the same result as pixel replication.
+	*/
+	if ( filter ) {
+		if ( (bpp != 2) && (bpp != 4) ) {
+			filter = 0;
+		} else if ( ((dstrect->w % srcrect->w) == 0) &&
+		            ((dstrect->h % srcrect->h) == 0) ) {
+			filter = 0;
+		}
+	}
+
+	/* Lock the destination if it's in hardware */
+	dst_locked = 0;
+	if ( SDL_MUSTLOCK(dst) ) {
+		if ( SDL_LockSurface(dst) < 0 ) {
+			SDL_SetError("Unable to lock destination surface");
+			return(-1);
+		}
+		dst_locked = 1;
+	}
+	/* Lock the source if it's in hardware */
+	src_locked = 0;
+	if ( SDL_MUSTLOCK(src) ) {
+		if ( SDL_LockSurface(src) < 0 ) {
+			if ( dst_locked ) {
+				SDL_UnlockSurface(dst);
+			}
+			SDL_SetError("Unable to lock source surface");
+			return(-1);
+		}
+		src_locked = 1;
+	}
+
+	if ( filter ) {
+		retval = stretch_linear(src, srcrect, dst, dstrect);
+	} else {
+		retval = stretch_nearest(src, srcrect, dst, dstrect);
 	}
 
 	/* We need to unlock the surfaces if they're locked */
@@ -355,6 +759,24 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	if ( src_locked ) {
 		SDL_UnlockSurface(src);
 	}
-	return(0);
+	return(retval);
 }
 
+/* Perform a stretch blit between two surfaces of the same format.
+   NOTE:  This function is not safe to call from multiple threads!
+*/
+int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
+                    SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	return stretch(src, srcrect, dst, dstrect, 0);
+}
+
+/* Same as SDL_SoftStretch(), but with bilinear filtering for 16 and 32 bpp
+   surfaces.  Integer factors and other depths use pixel replication.
+   NOTE:  This function is not safe to call from multiple threads!
+*/
+int SDL_SoftStretchLinear(SDL_Surface *src, SDL_Rect *srcrect,
+                          SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	return stretch(src, srcrect, dst, dstrect, 1);
+}
@@ -27,3 +27,6 @@
 extern int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
                            SDL_Surface *dst, SDL_Rect *dstrect);
 
+/* Same as SDL_SoftStretch(), with bilinear filtering for 16 and 32 bpp */
+extern int SDL_SoftStretchLinear(SDL_Surface *src, SDL_Rect *srcrect,
+                                 SDL_Surface *dst, SDL_Rect *dstrect);
@@ -101,6 +101,7 @@ static struct private_yuvhwfuncs sw_yuvfuncs = {
 struct private_yuvhwdata {
 	SDL_Surface *stretch;
 	SDL_Surface *display;
+	int smooth;
 	Uint8 *pixels;
 	int *colortab;
 	Uint32 *rgb_2_pix;
@@ -937,6 +938,7 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	int i;
 	int CR, CB;
 	Uint32 Rmask, Gmask, Bmask;
+	const char *smooth;
 
 	/* Only RGB packed pixel conversion supported */
 	if ( (display->format->BytesPerPixel != 2) &&
@@ -985,6 +987,9 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	}
 	swdata->stretch = NULL;
 	swdata->display = display;
+	/* Filter non-integer stretches of the overlay, if asked to */
+	smooth = SDL_getenv("SDL_VIDEO_YUV_SMOOTH");
+	swdata->smooth = (smooth && (SDL_atoi(smooth) > 0));
 	swdata->pixels = (Uint8 *) SDL_malloc(width*height*2);
 	swdata->colortab = (int *)SDL_malloc(4*256*sizeof(int));
 	Cr_r_tab = &swdata->colortab[0*256];
@@ -1268,7 +1273,11 @@ int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 	}
 	if ( stretch ) {
 		display = swdata->display;
-		SDL_SoftStretch(swdata->stretch, src, display, dst);
+		if ( swdata->smooth ) {
+			SDL_SoftStretchLinear(swdata->stretch, src, display, dst);
+		} else {
+			SDL_SoftStretch(swdata->stretch, src, display, dst);
+		}
 	}
 	SDL_UpdateRects(display, 1, dst);
 
@@ -0,0 +1,324 @@
+/*
+Simple DirectMedia Layer
+Copyright (C) 2009-2014 Sergii Pylypenko
+
+This software is provided 'as-is', without any express or implied
+warranty.  In no event will the authors be held liable for any damages
+arising from the use of this software.
+
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it
+freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not
+   claim that you wrote the original software. If you use this software
+   in a product, an acknowledgment in the product documentation would be
+   appreciated but is not required. 
+2. Altered source versions must be plainly marked as such, and must not be
+   misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+/*
+Pixel conversion done on texture upload by ANDROID_UnlockHWSurface() and on
+screen readback by ANDROID_ReadScreenPixels(), kept apart from the video driver
+so it can be benchmarked on the host:
+	gcc -O2 -DANDROID -DTEST_MAIN -I../../../include SDL_androidconvert.c
+*/
+
+#include "SDL_stdinc.h"
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define CONVERT_RGB565_RGBA5551( pixel ) (0x1 | ( (pixel & 0xFFC0) | ( (pixel & 0x1F) << 1 ) ))
+
+// Convert one row, with colorkey the pixels equal to the key become fully transparent
+void ANDROID_ConvertRGB565ToRGBA5551(const Uint16 *src, Uint16 *dst, int w, int useColorkey, Uint16 key)
+{
+	int x = 0;
+	// Without colorkey the key compare is masked out, any source pixel may equal the key value
+	const Uint16 keyMask = useColorkey ? 0xFFFF : 0;
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+	{
+		const uint16x8_t maskRG = vdupq_n_u16(0xFFC0);
+		const uint16x8_t maskB = vdupq_n_u16(0x1F);
+		const uint16x8_t alpha = vdupq_n_u16(0x1);
+		const uint16x8_t vkey = vdupq_n_u16(key);
+		const uint16x8_t vkeyMask = vdupq_n_u16(keyMask);
+		for( ; x + 16 <= w; x += 16, src += 16, dst += 16 )
+		{
+			uint16x8_t p0 = vld1q_u16(src);
+			uint16x8_t p1 = vld1q_u16(src + 8);
+			uint16x8_t c0 = vorrq_u16(vorrq_u16(vandq_u16(p0, maskRG), vshlq_n_u16(vandq_u16(p0, maskB), 1)), alpha);
+			uint16x8_t c1 = vorrq_u16(vorrq_u16(vandq_u16(p1, maskRG), vshlq_n_u16(vandq_u16(p1, maskB), 1)), alpha);
+			vst1q_u16(dst, vbicq_u16(c0, vandq_u16(vceqq_u16(p0, vkey), vkeyMask)));
+			vst1q_u16(dst + 8, vbicq_u16(c1, vandq_u16(vceqq_u16(p1, vkey), vkeyMask)));
+		}
+	}
+#elif defined(__SSE2__)
+	{
+		const __m128i maskRG = _mm_set1_epi16((short)0xFFC0);
+		const __m128i maskB = _mm_set1_epi16(0x1F);
+		const __m128i alpha = _mm_set1_epi16(0x1);
+		const __m128i vkey = _mm_set1_epi16((short)key);
+		const __m128i vkeyMask = _mm_set1_epi16((short)keyMask);
+		for( ; x + 16 <= w; x += 16, src += 16, dst += 16 )
+		{
+			__m128i p0 = _mm_loadu_si128((const __m128i *)src);
+			__m128i p1 = _mm_loadu_si128((const __m128i *)(src + 8));
+			__m128i c0 = _mm_or_si128(_mm_or_si128(_mm_and_si128(p0, maskRG), _mm_slli_epi16(_mm_and_si128(p0, maskB), 1)), alpha);
+			__m128i c1 = _mm_or_si128(_mm_or_si128(_mm_and_si128(p1, maskRG), _mm_slli_epi16(_mm_and_si128(p1, maskB), 1)), alpha);
+			_mm_storeu_si128((__m128i *)dst, _mm_andnot_si128(_mm_and_si128(_mm_cmpeq_epi16(p0, vkey), vkeyMask), c0));
+			_mm_storeu_si128((__m128i *)(dst + 8), _mm_andnot_si128(_mm_and_si128(_mm_cmpeq_epi16(p1, vkey), vkeyMask), c1));
+		}
+	}
+#endif
+
+	for( ; x < w; x++, src++, dst++ )
+	{
+		Uint16 pixel = *src;
+		*dst = (useColorkey && pixel == key) ? 0 : CONVERT_RGB565_RGBA5551( pixel );
+	}
+}
+
+// Copy every step-th pixel of a row read back by glReadPixels(), w pixels are written.
+// Source pixels are 2 bytes for bpp 2 and RGBA for bpp 3 and 4.
+void ANDROID_DecimateRow(const Uint8 *src, Uint8 *dst, int w, int bpp, int step)
+{
+	int x = 0;
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+	// The structure loads split 2, 3 or 4 interleaved pixels into separate registers, the first one is kept
+	if( bpp == 4 )
+	{
+		const Uint32 *s = (const Uint32 *)src;
+		Uint32 *d = (Uint32 *)dst;
+		switch( step )
+		{
+			case 2:
+				for( ; x + 4 <= w; x += 4 )
+					vst1q_u32(d + x, vld2q_u32(s + x * 2).val[0]);
+				break;
+			case 3:
+				for( ; x + 4 <= w; x += 4 )
+					vst1q_u32(d + x, vld3q_u32(s + x * 3).val[0]);
+				break;
+			case 4:
+				for( ; x + 4 <= w; x += 4 )
+					vst1q_u32(d + x, vld4q_u32(s + x * 4).val[0]);
+				break;
+		}
+	}
+	else if( bpp == 2 )
+	{
+		const Uint16 *s = (const Uint16 *)src;
+		Uint16 *d = (Uint16 *)dst;
+		switch( step )
+		{
+			case 2:
+				for( ; x + 8 <= w; x += 8 )
+					vst1q_u16(d + x, vld2q_u16(s + x * 2).val[0]);
+				break;
+			case 3:
+				for( ; x + 8 <= w; x += 8 )
+					vst1q_u16(d + x, vld3q_u16(s + x * 3).val[0]);
+				break;
+			case 4:
+				for( ; x + 8 <= w; x += 8 )
+					vst1q_u16(d + x, vld4q_u16(s + x * 4).val[0]);
+				break;
+		}
+	}
+	else if( bpp == 3 && step == 1 )
+	{
+		for( ; x + 16 <= w; x += 16 )
+		{
+			uint8x16x4_t rgba = vld4q_u8(src + x * 4);
+			uint8x16x3_t rgb;
+			rgb.val[0] = rgba.val[0];
+			rgb.val[1] = rgba.val[1];
+			rgb.val[2] = rgba.val[2];
+			vst3q_u8(dst + x * 3, rgb);
+		}
+	}
+#elif defined(__SSE2__)
+	// Only the 2x case, SSE2 has no structure loads
+	if( bpp == 4 && step == 2 )
+	{
+		for( ; x + 4 <= w; x += 4 )
+		{
+			__m128 p0 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(src + x * 8)));
+			__m128 p1 = _mm_castsi128_ps(_mm_loadu_si128((const __m128i *)(src + x * 8 + 16)));
+			_mm_storeu_si128((__m128i *)(dst + x * 4), _mm_castps_si128(_mm_shuffle_ps(p0, p1, _MM_SHUFFLE(2, 0, 2, 0))));
+		}
+	}
+	else if( bpp == 2 && step == 2 )
+	{
+		// Sign extending the even pixels keeps them intact through the signed saturating pack
+		for( ; x + 8 <= w; x += 8 )
+		{
+			__m128i p0 = _mm_loadu_si128((const __m128i *)(src + x * 4));
+			__m128i p1 = _mm_loadu_si128((const __m128i *)(src + x * 4 + 16));
+			p0 = _mm_srai_epi32(_mm_slli_epi32(p0, 16), 16);
+			p1 = _mm_srai_epi32(_mm_slli_epi32(p1, 16), 16);
+			_mm_storeu_si128((__m128i *)(dst + x * 2), _mm_packs_epi32(p0, p1));
+		}
+	}
+#endif
+
+	switch( bpp )
+	{
+		case 2:
+			for( ; x < w; x++ )
+				((Uint16 *)dst)[x] = ((const Uint16 *)src)[x * step];
+			break;
+		case 3:
+			for( ; x < w; x++ )
+			{
+				const Uint8 * pixel = src + x * step * 4;
+				dst[x * 3 + 0] = pixel[0];
+				dst[x * 3 + 1] = pixel[1];
+				dst[x * 3 + 2] = pixel[2];
+			}
+			break;
+		case 4:
+			for( ; x < w; x++ )
+				((Uint32 *)dst)[x] = ((const Uint32 *)src)[x * step];
+			break;
+	}
+}
+
+#ifdef TEST_MAIN
+
+/* Checks the conversion against the plain C loop on every RGB565 value,
+   then prints Mpixels/s of both for a 640x480 surface, with and without colorkey.
+   Then the same for the readback row decimation, from a 1280x960 screen.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_W	640
+#define BENCH_H	480
+#define BENCH_FRAMES	200
+
+static void ConvertC(const Uint16 *src, Uint16 *dst, int w, int useColorkey, Uint16 key)
+{
+	int x;
+	for( x = 0; x < w; x++ )
+	{
+		Uint16 pixel = src[x];
+		if( useColorkey && pixel == key )
+			dst[x] = 0;
+		else
+			dst[x] = CONVERT_RGB565_RGBA5551( pixel );
+	}
+}
+
+static void DecimateC(const Uint8 *src, Uint8 *dst, int w, int bpp, int step)
+{
+	int x;
+	for( x = 0; x < w; x++ )
+		memcpy(dst + x * bpp, src + x * step * (bpp == 2 ? 2 : 4), bpp);
+}
+
+static double Seconds(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double Bench(void (*convert)(const Uint16 *, Uint16 *, int, int, Uint16), const Uint16 *src, Uint16 *dst, int useColorkey)
+{
+	double start = Seconds();
+	int frame, y;
+	for( frame = 0; frame < BENCH_FRAMES; frame++ )
+		for( y = 0; y < BENCH_H; y++ )
+			convert(src + y * BENCH_W, dst + y * BENCH_W, BENCH_W, useColorkey, 0xF81F);
+	return (double)BENCH_W * BENCH_H * BENCH_FRAMES / 1e6 / (Seconds() - start);
+}
+
+static double BenchDecimate(void (*decimate)(const Uint8 *, Uint8 *, int, int, int), const Uint8 *src, Uint8 *dst, int bpp)
+{
+	double start = Seconds();
+	int frame, y;
+	for( frame = 0; frame < BENCH_FRAMES; frame++ )
+		for( y = 0; y < BENCH_H; y++ )
+			decimate(src + y * 2 * BENCH_W * 2 * 4, dst + y * BENCH_W * 4, BENCH_W, bpp, 2);
+	return (double)BENCH_W * BENCH_H * BENCH_FRAMES / 1e6 / (Seconds() - start);
+}
+
+int main(int argc, char *argv[])
+{
+	static Uint16 src[BENCH_W * BENCH_H], dst[BENCH_W * BENCH_H], ref[BENCH_W * BENCH_H];
+	static Uint8 screen[BENCH_W * 2 * BENCH_H * 2 * 4], rows[BENCH_W * BENCH_H * 4], refRows[BENCH_W * BENCH_H * 4];
+	int i, w, bpp, step, useColorkey, errors = 0;
+
+	// All 65536 values, with every key, at odd widths to cover the leftover loop
+	for( i = 0; i < 65536; i++ )
+		src[i] = (Uint16)i;
+	for( useColorkey = 0; useColorkey < 2; useColorkey++ )
+		for( i = 0; i < 65536; i += 257 )
+			for( w = 65536 - 37; w <= 65536; w += 37 )
+			{
+				ConvertC(src, ref, w, useColorkey, (Uint16)i);
+				ANDROID_ConvertRGB565ToRGBA5551(src, dst, w, useColorkey, (Uint16)i);
+				if( memcmp(ref, dst, w * sizeof(Uint16)) != 0 )
+					errors++;
+			}
+	// Pixel 0x0001 must stay opaque when there is no colorkey
+	ANDROID_ConvertRGB565ToRGBA5551(src, dst, 32, 0, 0x1);
+	if( dst[1] != CONVERT_RGB565_RGBA5551( 1 ) )
+		errors++;
+	printf("%s\n", errors ? "MISMATCH" : "conversion matches C");
+
+	srand(1);
+	for( i = 0; i < BENCH_W * BENCH_H; i++ )
+		src[i] = (Uint16)(rand() & 0xFFFF);
+	for( useColorkey = 0; useColorkey < 2; useColorkey++ )
+		printf("RGB565 -> RGBA5551%s: C %8.1f Mpixels/s, %s %8.1f Mpixels/s\n", useColorkey ? " colorkey" : "         ",
+			Bench(ConvertC, src, ref, useColorkey),
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+			"NEON",
+#elif defined(__SSE2__)
+			"SSE2",
+#else
+			"C",
+#endif
+			Bench(ANDROID_ConvertRGB565ToRGBA5551, src, dst, useColorkey));
+
+	for( i = 0; i < (int)sizeof(screen); i++ )
+		screen[i] = (Uint8)rand();
+	for( bpp = 2; bpp <= 4; bpp++ )
+		for( step = 1; step <= 4; step++ )
+			for( w = 1; w <= 100; w++ )
+			{
+				DecimateC(screen + w * 4, refRows, w, bpp, step);
+				ANDROID_DecimateRow(screen + w * 4, rows, w, bpp, step);
+				if( memcmp(refRows, rows, w * bpp) != 0 )
+					errors++;
+			}
+	printf("%s\n", errors ? "MISMATCH" : "decimation matches C");
+	for( bpp = 2; bpp <= 4; bpp++ )
+		printf("%d bpp readback 2x decimation: C %8.1f Mpixels/s, %s %8.1f Mpixels/s\n", bpp * 8,
+			BenchDecimate(DecimateC, screen, refRows, bpp),
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+			"NEON",
+#elif defined(__SSE2__)
+			"SSE2",
+#else
+			"C",
+#endif
+			BenchDecimate(ANDROID_DecimateRow, screen, rows, bpp));
+	return errors != 0;
+}
+
+#endif /* TEST_MAIN */
@@ -64,14 +64,225 @@ extern SDL_Window * ANDROID_CurrentWindow;
 
 #endif
 
-static volatile int joystickEventsCount;
+// Events arrive from Java UI thread, sensor threads and main thread, and are passed to main thread
+// through lock-free ring buffer, so input threads never wait for SDL event queue lock held by application.
+// Each ring cell has a sequence number, which tells whether the cell is free or filled for the current ring lap,
+// zero-initialized ring is empty. Consecutive motion events are merged when ring is drained,
+// and only the latest value of each joystick axis is delivered on each SDL_PumpEvents() call.
+enum { EVENT_RING_SIZE = 1024, EVENT_RING_MASK = EVENT_RING_SIZE - 1 };
+enum { JOYSTICK_AXES_MAX = 32, JOYSTICK_AXIS_EVENTS_MAX = 64 };
+enum {
+	RING_MOUSEMOTION = 1, RING_MOUSEBUTTON, RING_KEY, RING_JOYBUTTON, RING_JOYBALL,
+	RING_MULTITOUCHBUTTON, RING_MULTITOUCHMOTION, RING_MOUSEWHEEL, RING_APPACTIVE
+};
+
+typedef struct
+{
+	volatile unsigned seq;
+	int type;
+	int args[5];
+} RingEvent_t;
+
+static RingEvent_t eventRing[EVENT_RING_SIZE];
+static volatile unsigned eventRingHead = 0; // Advanced by producers
+static unsigned eventRingTail = 0; // Advanced by main thread only
+static volatile unsigned eventRingDropped = 0;
+static unsigned eventRingDroppedLogged = 0;
+static unsigned eventRingMaxDepth = 0;
+
+static volatile int joystickAxes[MAX_MULTITOUCH_POINTERS+1][JOYSTICK_AXES_MAX];
+static volatile Uint32 joystickAxesChanged[MAX_MULTITOUCH_POINTERS+1];
+
 static int oldMouseButtons = 0;
 
-extern void SDL_ANDROID_PumpEvents()
+static void ANDROID_EventRingPush(int type, int a0, int a1, int a2, int a3, int a4)
+{
+	unsigned pos = eventRingHead;
+	RingEvent_t * ev;
+
+	for(;;)
+	{
+		int diff;
+		ev = &eventRing[pos & EVENT_RING_MASK];
+		diff = (int)(ev->seq - (pos & ~EVENT_RING_MASK));
+		if( diff == 0 )
+		{
+			if( __sync_bool_compare_and_swap(&eventRingHead, pos, pos + 1) )
+				break;
+		}
+		else if( diff < 0 )
+		{
+			// Application does not call SDL_PollEvent(), and main thread did not consume previous ring lap yet
+			__sync_fetch_and_add(&eventRingDropped, 1);
+			return;
+		}
+		pos = eventRingHead;
+	}
+
+	ev->type = type;
+	ev->args[0] = a0;
+	ev->args[1] = a1;
+	ev->args[2] = a2;
+	ev->args[3] = a3;
+	ev->args[4] = a4;
+	__sync_synchronize();
+	ev->seq = (pos & ~EVENT_RING_MASK) + 1;
+}
+
+static void ANDROID_DeliverEvent(const RingEvent_t *ev)
+{
+	SDL_keysym keysym;
+	int joy;
+
+	switch( ev->type )
+	{
+		case RING_MOUSEMOTION:
+			SDL_SendMouseMotion( ANDROID_CurrentWindow, 0, ev->args[0], ev->args[1] );
+			break;
+		case RING_MOUSEBUTTON:
+			if( ((oldMouseButtons & SDL_BUTTON(ev->args[1])) != 0) != ev->args[0] )
+			{
+				oldMouseButtons = (oldMouseButtons & ~SDL_BUTTON(ev->args[1])) | (ev->args[0] ? SDL_BUTTON(ev->args[1]) : 0);
+				SDL_SendMouseButton( ANDROID_CurrentWindow, ev->args[0], ev->args[1] );
+			}
+			break;
+		case RING_KEY:
+			keysym.scancode = ev->args[1];
+			if ( ev->args[1] < SDLK_LAST )
+				keysym.scancode = SDL_android_keysym_to_scancode[ev->args[1]];
+			keysym.sym = ev->args[1];
+			keysym.mod = KMOD_NONE;
+			keysym.unicode = 0;
+#if SDL_VERSION_ATLEAST(1,3,0)
+#else
+			if ( SDL_TranslateUNICODE )
+#endif
+				keysym.unicode = ev->args[2];
+			if( (keysym.unicode & 0xFF80) != 0 )
+				keysym.sym = SDLK_WORLD_0;
+
+			if( ev->args[0] == SDL_RELEASED )
+				keysym.unicode = 0;
+			else if( keysym.sym < 0x80 )
+				keysym.unicode = keysym.sym;
+
+			//__android_log_print(ANDROID_LOG_INFO, "libSDL","SDL_SendKeyboardKey sym %d scancode %d unicode %d", keysym.sym, keysym.scancode, keysym.unicode);
+
+			SDL_SendKeyboardKey( ev->args[0], &keysym );
+			break;
+		case RING_JOYBUTTON:
+			joy = ev->args[0];
+			if( SDL_ANDROID_CurrentJoysticks[joy] )
+				SDL_PrivateJoystickButton( SDL_ANDROID_CurrentJoysticks[joy], ev->args[1], ev->args[2] );
+			break;
+		case RING_JOYBALL:
+			joy = ev->args[0];
+			if( SDL_ANDROID_CurrentJoysticks[joy] )
+				SDL_PrivateJoystickBall( SDL_ANDROID_CurrentJoysticks[joy], ev->args[1], ev->args[2], ev->args[3] );
+			break;
+#if SDL_VERSION_ATLEAST(1,3,0)
+		case RING_MULTITOUCHBUTTON:
+			SDL_SendFingerDown(0, ev->args[0], ev->args[1] ? 1 : 0, (float)ev->args[2] / (float)window->w, (float)ev->args[3] / (float)window->h, ev->args[4]);
+			break;
+		case RING_MULTITOUCHMOTION:
+			SDL_SendTouchMotion(0, ev->args[0], 0, (float)ev->args[1] / (float)window->w, (float)ev->args[2] / (float)window->h, ev->args[3]);
+			break;
+		case RING_MOUSEWHEEL:
+			SDL_SendMouseWheel( ANDROID_CurrentWindow, ev->args[0], ev->args[1] );
+			break;
+#else
+		case RING_APPACTIVE:
+			SDL_PrivateAppActive(ev->args[0], SDL_APPACTIVE|SDL_APPINPUTFOCUS|SDL_APPMOUSEFOCUS);
+			break;
+#endif
+	}
+}
+
+// Motion event may be dropped, if the next event is a motion of the same pointer
+static int ANDROID_EventsMergeable(const RingEvent_t *ev, const RingEvent_t *next)
 {
-	joystickEventsCount = 0;
+	if( ev->type != next->type )
+		return 0;
+	if( ev->type == RING_MOUSEMOTION )
+		return 1;
+	if( ev->type == RING_MULTITOUCHMOTION )
+		return ev->args[0] == next->args[0];
+	if( ev->type == RING_JOYBALL )
+		return ev->args[0] == next->args[0] && ev->args[1] == next->args[1];
+	return 0;
+}
+
+static void ANDROID_EventRingDrain(void)
+{
+	RingEvent_t pending;
+	unsigned depth = eventRingHead - eventRingTail;
+	unsigned dropped = eventRingDropped;
 
+	if( depth > eventRingMaxDepth && depth <= EVENT_RING_SIZE )
+		eventRingMaxDepth = depth;
+	if( dropped != eventRingDroppedLogged )
+	{
+		__android_log_print(ANDROID_LOG_INFO, "libSDL", "Input event queue overflow, %u events dropped total, max queue depth %u", dropped, eventRingMaxDepth);
+		eventRingDroppedLogged = dropped;
+	}
+
+	pending.type = 0;
+	for(;;)
+	{
+		RingEvent_t * ev = &eventRing[eventRingTail & EVENT_RING_MASK];
+		RingEvent_t current;
+
+		if( ev->seq != (eventRingTail & ~EVENT_RING_MASK) + 1 )
+			break;
+		__sync_synchronize();
+		current = *ev;
+		__sync_synchronize();
+		ev->seq = (eventRingTail & ~EVENT_RING_MASK) + EVENT_RING_SIZE;
+		eventRingTail++;
+
+		if( pending.type && !ANDROID_EventsMergeable(&pending, &current) )
+			ANDROID_DeliverEvent(&pending);
+		pending = current;
+	}
+	if( pending.type )
+		ANDROID_DeliverEvent(&pending);
+}
+
+static void ANDROID_DeliverJoystickAxes(void)
+{
+	int joy, axis, count = 0;
+
+	for( joy = 0; joy < MAX_MULTITOUCH_POINTERS+1; joy++ )
+	{
+		Uint32 changed;
+		if( !joystickAxesChanged[joy] )
+			continue;
+		changed = __sync_fetch_and_and(&joystickAxesChanged[joy], 0);
+		for( axis = 0; changed; axis++, changed >>= 1 )
+		{
+			if( !(changed & 1) )
+				continue;
+			if( count >= JOYSTICK_AXIS_EVENTS_MAX )
+			{
+				// Do not flood SDL event queue, send the rest on the next SDL_PumpEvents() call
+				__sync_fetch_and_or(&joystickAxesChanged[joy], changed << axis);
+				break;
+			}
+			if( SDL_ANDROID_CurrentJoysticks[joy] )
+			{
+				SDL_PrivateJoystickAxis( SDL_ANDROID_CurrentJoysticks[joy], axis, joystickAxes[joy][axis] );
+				count++;
+			}
+		}
+	}
+}
+
+extern void SDL_ANDROID_PumpEvents()
+{
 	SDL_ANDROID_processMoveMouseWithKeyboard();
+
+	ANDROID_EventRingDrain();
+	ANDROID_DeliverJoystickAxes();
 };
 
 extern void SDL_ANDROID_MainThreadPushMouseMotion(int x, int y)
@@ -79,16 +290,12 @@ extern void SDL_ANDROID_MainThreadPushMouseMotion(int x, int y)
 	SDL_ANDROID_currentMouseX = x;
 	SDL_ANDROID_currentMouseY = y;
 
-	SDL_SendMouseMotion( ANDROID_CurrentWindow, 0, x, y );
+	ANDROID_EventRingPush( RING_MOUSEMOTION, x, y, 0, 0, 0 );
 }
 
 extern void SDL_ANDROID_MainThreadPushMouseButton(int pressed, int button)
 {
-	if( ((oldMouseButtons & SDL_BUTTON(button)) != 0) != pressed )
-	{
-		oldMouseButtons = (oldMouseButtons & ~SDL_BUTTON(button)) | (pressed ? SDL_BUTTON(button) : 0);
-		SDL_SendMouseButton( ANDROID_CurrentWindow, pressed, button );
-	}
+	ANDROID_EventRingPush( RING_MOUSEBUTTON, pressed, button, 0, 0, 0 );
 
 	if(pressed)
 		SDL_ANDROID_currentMouseButtons |= SDL_BUTTON(button);
@@ -98,8 +305,6 @@ extern void SDL_ANDROID_MainThreadPushMouseButton(int pressed, int button)
 
 extern void SDL_ANDROID_MainThreadPushKeyboardKey(int pressed, SDL_scancode key, int unicode)
 {
-	SDL_keysym keysym;
-
 	if( SDL_ANDROID_moveMouseWithArrowKeys && (
 		key == SDL_KEY(UP) || key == SDL_KEY(DOWN) ||
 		key == SDL_KEY(LEFT) || key == SDL_KEY(RIGHT) ) )
@@ -185,44 +390,16 @@ extern void SDL_ANDROID_MainThreadPushKeyboardKey(int pressed, SDL_scancode key,
 		return;
 	}
 
-	keysym.scancode = key;
-	if ( key < SDLK_LAST )
-		keysym.scancode = SDL_android_keysym_to_scancode[key];
-	keysym.sym = key;
-	keysym.mod = KMOD_NONE;
-	keysym.unicode = 0;
-#if SDL_VERSION_ATLEAST(1,3,0)
-#else
-	if ( SDL_TranslateUNICODE )
-#endif
-		keysym.unicode = unicode;
-	if( (keysym.unicode & 0xFF80) != 0 )
-		keysym.sym = SDLK_WORLD_0;
-
-	if( pressed == SDL_RELEASED )
-		keysym.unicode = 0;
-	else if( keysym.sym < 0x80 )
-		keysym.unicode = keysym.sym;
-
-	//__android_log_print(ANDROID_LOG_INFO, "libSDL","SDL_SendKeyboardKey sym %d scancode %d unicode %d", keysym.sym, keysym.scancode, keysym.unicode);
-
-	SDL_SendKeyboardKey( pressed, &keysym );
+	ANDROID_EventRingPush( RING_KEY, pressed, key, unicode, 0, 0 );
 }
 
 extern void SDL_ANDROID_MainThreadPushJoystickAxis(int joy, int axis, int value)
 {
-	if( ! ( joy < MAX_MULTITOUCH_POINTERS+1 && SDL_ANDROID_CurrentJoysticks[joy] ) )
+	if( ! ( joy < MAX_MULTITOUCH_POINTERS+1 && axis < JOYSTICK_AXES_MAX && SDL_ANDROID_CurrentJoysticks[joy] ) )
 		return;
 
-	if( joystickEventsCount > 64 )
-	{
-		//__android_log_print(ANDROID_LOG_INFO, "libSDL", "Too many joystick events in the queue - dropping some events");
-		return;
-	}
-
-	joystickEventsCount++;
-
-	SDL_PrivateJoystickAxis( SDL_ANDROID_CurrentJoysticks[joy], axis, MAX( -32768, MIN( 32767, value ) ) );
+	joystickAxes[joy][axis] = MAX( -32768, MIN( 32767, value ) );
+	__sync_fetch_and_or(&joystickAxesChanged[joy], (Uint32)1 << axis);
 }
 
 extern void SDL_ANDROID_MainThreadPushJoystickButton(int joy, int button, int pressed)
@@ -230,7 +407,7 @@ extern void SDL_ANDROID_MainThreadPushJoystickButton(int joy, int button, int pr
 	if( ! ( joy < MAX_MULTITOUCH_POINTERS+1 && SDL_ANDROID_CurrentJoysticks[joy] ) )
 		return;
 
-	SDL_PrivateJoystickButton( SDL_ANDROID_CurrentJoysticks[joy], button, pressed );
+	ANDROID_EventRingPush( RING_JOYBUTTON, joy, button, pressed, 0, 0 );
 }
 
 extern void SDL_ANDROID_MainThreadPushJoystickBall(int joy, int ball, int x, int y)
@@ -238,27 +415,27 @@ extern void SDL_ANDROID_MainThreadPushJoystickBall(int joy, int ball, int x, int
 	if( ! ( joy < MAX_MULTITOUCH_POINTERS+1 && SDL_ANDROID_CurrentJoysticks[joy] ) )
 		return;
 
-	SDL_PrivateJoystickBall( SDL_ANDROID_CurrentJoysticks[joy], ball, x, y );
+	ANDROID_EventRingPush( RING_JOYBALL, joy, ball, x, y, 0 );
 }
 
 extern void SDL_ANDROID_MainThreadPushMultitouchButton(int id, int pressed, int x, int y, int force)
 {
 #if SDL_VERSION_ATLEAST(1,3,0)
-	SDL_SendFingerDown(0, id, pressed ? 1 : 0, (float)x / (float)window->w, (float)y / (float)window->h, force);
+	ANDROID_EventRingPush( RING_MULTITOUCHBUTTON, id, pressed, x, y, force );
 #endif
 }
 
 extern void SDL_ANDROID_MainThreadPushMultitouchMotion(int id, int x, int y, int force)
 {
 #if SDL_VERSION_ATLEAST(1,3,0)
-	SDL_SendTouchMotion(0, id, 0, (float)x / (float)window->w, (float)y / (float)window->h, force);
+	ANDROID_EventRingPush( RING_MULTITOUCHMOTION, id, x, y, force, 0 );
 #endif
 }
 
 extern void SDL_ANDROID_MainThreadPushMouseWheel(int x, int y)
 {
 #if SDL_VERSION_ATLEAST(1,3,0)
-	SDL_SendMouseWheel( ANDROID_CurrentWindow, x, y );
+	ANDROID_EventRingPush( RING_MOUSEWHEEL, x, y, 0, 0, 0 );
 #endif
 }
 
@@ -268,7 +445,7 @@ extern void SDL_ANDROID_MainThreadPushAppActive(int active)
 				//if( ANDROID_CurrentWindow )
 				//	SDL_SendWindowEvent(ANDROID_CurrentWindow, SDL_WINDOWEVENT_MINIMIZED, 0, 0);
 #else
-	SDL_PrivateAppActive(active, SDL_APPACTIVE|SDL_APPINPUTFOCUS|SDL_APPMOUSEFOCUS);
+	ANDROID_EventRingPush( RING_APPACTIVE, active, 0, 0, 0, 0 );
 #endif
 }
 
@@ -135,8 +135,6 @@ static SDL_Rect *SDL_modelist[SDL_NUMMODES+1];
 
 //#define SDL_modelist		(this->hidden->SDL_modelist)
 
-typedef struct SDL_Texture private_hwdata;
-
 // Pointer to in-memory video surface
 int SDL_ANDROID_sFakeWindowWidth = 640;
 int SDL_ANDROID_sFakeWindowHeight = 480;
@@ -145,6 +143,51 @@ static SDL_Window *SDL_VideoWindow = NULL;
 SDL_Surface *SDL_CurrentVideoSurface = NULL;
 static int HwSurfaceCount = 0;
 static SDL_Surface ** HwSurfaceList = NULL;
+static int HwSurfaceListSize = 0;
+// Damaged screen area, accumulated from SDL_UpdateRects() calls until the next texture upload.
+// Only row ranges are tracked - a band spanning the whole texture width is contiguous in memory,
+// so it goes to glTexSubImage2D() directly, while narrower rects have to be repacked row by row.
+enum { DIRTY_BANDS_MAX = 8, DIRTY_BANDS_MERGE_GAP = 8 };
+typedef struct { int y0, y1; } DirtyBand_t;
+static DirtyBand_t DirtyBands[DIRTY_BANDS_MAX + 1];
+static int DirtyBandsCount = 0;
+static volatile int DirtyBandsFullScreenNeeded = 0; // Set by video thread when textures were recreated
+// Staging buffer for converted HW surface pixels, reused by all surfaces, because texture upload is synchronous
+static Uint16 * UnlockConvertBuffer = NULL;
+static int UnlockConvertBufferSize = 0;
+// Screen readback buffer, and source column for each column of video surface
+static Uint8 * ReadbackBuffer = NULL;
+static int ReadbackBufferSize = 0;
+static int * ReadbackColumns = NULL;
+static int ReadbackColumnsW = 0, ReadbackColumnsRealW = 0;
+// HW surface driver data: either own texture, or a rectangle inside shared atlas page texture.
+// Atlas surfaces share texture state, so their blend mode and alpha are applied to the page on each blit.
+struct private_hwdata
+{
+	SDL_Texture * texture;
+	int atlasPage; // Index into AtlasPages[], or -1 if surface owns the texture
+	SDL_Rect atlasRect;
+	int blendMode;
+	Uint8 alpha;
+};
+#ifdef SDL_COMPATIBILITY_HACKS_HW_SURFACES_TEXTURE_ATLAS
+// Small HW surfaces are packed into large textures with skyline packer, so sprites drawn one after another mostly use the same texture.
+// Freed rectangles are not reused, the page is destroyed when its last surface is freed.
+enum { ATLAS_PAGE_SIZE_MAX = 1024, ATLAS_SURFACE_SIZE_MAX = 256, ATLAS_PAGES_MAX = 32, ATLAS_PADDING = 1 };
+typedef struct { int x, y, w; } AtlasSkylineNode_t;
+typedef struct
+{
+	SDL_Texture * texture;
+	Uint32 format;
+	int surfaces; // Live surfaces allocated from this page
+	int skylineCount;
+	AtlasSkylineNode_t skyline[ATLAS_PAGE_SIZE_MAX + 1];
+} AtlasPage_t;
+static AtlasPage_t * AtlasPages[ATLAS_PAGES_MAX];
+static int AtlasPageSize = 0;
+static Uint8 * AtlasUploadBuffer = NULL; // Surface with edges extruded into padding, for linear filtering
+static int AtlasUploadBufferSize = 0; // In bytes
+#endif
 void * glLibraryHandle = NULL;
 void * gl2LibraryHandle = NULL;
 
@@ -358,6 +401,362 @@ SDL_Rect **ANDROID_ListModes(_THIS, SDL_PixelFormat *format, Uint32 flags)
 	return SDL_modelist;
 }
 
+#ifdef SDL_COMPATIBILITY_HACKS_HW_SURFACES_TEXTURE_ATLAS
+
+static int ANDROID_AtlasCreatePageTexture(AtlasPage_t *page)
+{
+	page->texture = SDL_CreateTexture(page->format, SDL_TEXTUREACCESS_STATIC, AtlasPageSize, AtlasPageSize);
+	if( !page->texture )
+		return -1;
+	if( SDL_ANDROID_VideoLinearFilter )
+		SDL_SetTextureScaleMode(page->texture, SDL_SCALEMODE_SLOW);
+	return 0;
+}
+
+// Returns lowest Y where rectangle of given size fits, when its left edge starts at skyline node index, or -1
+static int ANDROID_AtlasSkylineFit(const AtlasPage_t *page, int index, int w, int h)
+{
+	int x = page->skyline[index].x, y = 0, widthLeft = w;
+
+	if( x + w > AtlasPageSize )
+		return -1;
+	for( ; widthLeft > 0; index++ )
+	{
+		if( page->skyline[index].y > y )
+			y = page->skyline[index].y;
+		if( y + h > AtlasPageSize )
+			return -1;
+		widthLeft -= page->skyline[index].w;
+	}
+	return y;
+}
+
+static int ANDROID_AtlasPageAllocRect(AtlasPage_t *page, int w, int h, SDL_Rect *rect)
+{
+	AtlasSkylineNode_t * skyline = page->skyline;
+	int i, best = -1, bestY = 0, bestTop = AtlasPageSize + 1, bestWidth = AtlasPageSize + 1;
+
+	// Bottom-left rule: lowest top edge wins, narrower skyline segment breaks ties
+	for( i = 0; i < page->skylineCount; i++ )
+	{
+		int y = ANDROID_AtlasSkylineFit(page, i, w, h);
+		if( y < 0 )
+			continue;
+		if( y + h < bestTop || (y + h == bestTop && skyline[i].w < bestWidth) )
+		{
+			best = i;
+			bestY = y;
+			bestTop = y + h;
+			bestWidth = skyline[i].w;
+		}
+	}
+	if( best < 0 )
+		return -1;
+
+	rect->x = skyline[best].x;
+	rect->y = bestY;
+	rect->w = w;
+	rect->h = h;
+
+	memmove(skyline + best + 1, skyline + best, (page->skylineCount - best) * sizeof(AtlasSkylineNode_t));
+	skyline[best].x = rect->x;
+	skyline[best].y = bestTop;
+	skyline[best].w = w;
+	page->skylineCount++;
+
+	// Cut the nodes now covered by the new one
+	for( i = best + 1; i < page->skylineCount; )
+	{
+		int covered = skyline[i-1].x + skyline[i-1].w - skyline[i].x;
+		if( covered <= 0 )
+			break;
+		skyline[i].x += covered;
+		skyline[i].w -= covered;
+		if( skyline[i].w > 0 )
+			break;
+		memmove(skyline + i, skyline + i + 1, (page->skylineCount - i - 1) * sizeof(AtlasSkylineNode_t));
+		page->skylineCount--;
+	}
+	for( i = 0; i + 1 < page->skylineCount; )
+	{
+		if( skyline[i].y != skyline[i+1].y )
+		{
+			i++;
+			continue;
+		}
+		skyline[i].w += skyline[i+1].w;
+		memmove(skyline + i + 1, skyline + i + 2, (page->skylineCount - i - 2) * sizeof(AtlasSkylineNode_t));
+		page->skylineCount--;
+	}
+	return 0;
+}
+
+static int ANDROID_AtlasAlloc(struct private_hwdata *hwdata, Uint32 format, int w, int h)
+{
+	int i, freePage = -1;
+	SDL_Rect rect;
+
+	if( w > ATLAS_SURFACE_SIZE_MAX || h > ATLAS_SURFACE_SIZE_MAX )
+		return -1;
+	if( !AtlasPageSize )
+	{
+		SDL_RendererInfo info;
+		AtlasPageSize = ATLAS_PAGE_SIZE_MAX;
+		if( SDL_GetRendererInfo(&info) == 0 && info.max_texture_width > 0 )
+			{
+			if( AtlasPageSize > info.max_texture_width )
+				AtlasPageSize = info.max_texture_width;
+			if( AtlasPageSize > info.max_texture_height )
+				AtlasPageSize = info.max_texture_height;
+		}
+	}
+
+	for( i = 0; i < ATLAS_PAGES_MAX; i++ )
+	{
+		if( !AtlasPages[i] )
+		{
+			if( freePage < 0 )
+				freePage = i;
+			continue;
+		}
+		if( AtlasPages[i]->format == format && AtlasPages[i]->texture &&
+			ANDROID_AtlasPageAllocRect(AtlasPages[i], w + ATLAS_PADDING * 2, h + ATLAS_PADDING * 2, &rect) == 0 )
+			break;
+	}
+	if( i >= ATLAS_PAGES_MAX )
+	{
+		if( freePage < 0 )
+			return -1;
+		i = freePage;
+		AtlasPages[i] = (AtlasPage_t *)SDL_calloc(1, sizeof(AtlasPage_t));
+		if( !AtlasPages[i] )
+			return -1;
+		AtlasPages[i]->format = format;
+		AtlasPages[i]->skylineCount = 1;
+		AtlasPages[i]->skyline[0].w = AtlasPageSize;
+		if( ANDROID_AtlasCreatePageTexture(AtlasPages[i]) < 0 ||
+			ANDROID_AtlasPageAllocRect(AtlasPages[i], w + ATLAS_PADDING * 2, h + ATLAS_PADDING * 2, &rect) < 0 )
+		{
+			if( AtlasPages[i]->texture )
+				SDL_DestroyTexture(AtlasPages[i]->texture);
+			SDL_free(AtlasPages[i]);
+			AtlasPages[i] = NULL;
+			return -1;
+		}
+		DEBUGOUT("ANDROID_AtlasAlloc() created atlas page %d format %x size %d", i, format, AtlasPageSize);
+	}
+
+	AtlasPages[i]->surfaces++;
+	hwdata->atlasPage = i;
+	hwdata->atlasRect.x = rect.x + ATLAS_PADDING;
+	hwdata->atlasRect.y = rect.y + ATLAS_PADDING;
+	hwdata->atlasRect.w = w;
+	hwdata->atlasRect.h = h;
+	hwdata->texture = AtlasPages[i]->texture;
+	return 0;
+}
+
+static void ANDROID_AtlasFree(struct private_hwdata *hwdata)
+{
+	int index = hwdata->atlasPage;
+	AtlasPage_t * page = AtlasPages[index];
+
+	hwdata->atlasPage = -1;
+	hwdata->texture = NULL;
+	page->surfaces--;
+	if( page->surfaces > 0 )
+		return;
+	if( page->texture )
+		SDL_DestroyTexture(page->texture);
+	SDL_free(page);
+	AtlasPages[index] = NULL;
+	DEBUGOUT("ANDROID_AtlasFree() freed atlas page %d", index);
+}
+
+static void ANDROID_AtlasDestroyAll(void)
+{
+	int i;
+	for( i = 0; i < ATLAS_PAGES_MAX; i++ )
+	{
+		if( !AtlasPages[i] )
+			continue;
+		if( AtlasPages[i]->texture )
+			SDL_DestroyTexture(AtlasPages[i]->texture);
+		SDL_free(AtlasPages[i]);
+		AtlasPages[i] = NULL;
+	}
+	AtlasPageSize = 0;
+	SDL_free(AtlasUploadBuffer);
+	AtlasUploadBuffer = NULL;
+	AtlasUploadBufferSize = 0;
+}
+
+// Upload surface into its atlas rectangle. With linear filtering, edge pixels are replicated into the padding,
+// so scaled sprites do not pick up texels of their neighbours.
+static void ANDROID_AtlasUpload(struct private_hwdata *hwdata, const void *pixels, int pitch)
+{
+	SDL_Rect rect = hwdata->atlasRect;
+	int w = rect.w, h = rect.h, x, y;
+	int bpp = SDL_BYTESPERPIXEL(AtlasPages[hwdata->atlasPage]->format); // 2, or 4 with SDL_ANDROID_BITSPERPIXEL >= 24
+	int stride = (w + ATLAS_PADDING * 2) * bpp;
+	int size = stride * (h + ATLAS_PADDING * 2);
+	Uint8 * dst;
+
+	if( !SDL_ANDROID_VideoLinearFilter )
+	{
+		SDL_UpdateTexture(hwdata->texture, &rect, pixels, pitch);
+		return;
+	}
+
+	if( AtlasUploadBufferSize < size )
+	{
+		SDL_free(AtlasUploadBuffer);
+		AtlasUploadBuffer = (Uint8 *)SDL_malloc(size);
+		AtlasUploadBufferSize = AtlasUploadBuffer ? size : 0;
+		if( !AtlasUploadBuffer ) {
+			SDL_OutOfMemory();
+			return;
+		}
+	}
+
+	dst = AtlasUploadBuffer + stride * ATLAS_PADDING;
+	for( y = 0; y < h; y++, dst += stride )
+	{
+		const Uint8 * src = (const Uint8 *)pixels + y * pitch;
+		memcpy(dst + ATLAS_PADDING * bpp, src, w * bpp);
+		for( x = 0; x < ATLAS_PADDING; x++ )
+		{
+			memcpy(dst + x * bpp, src, bpp);
+			memcpy(dst + (ATLAS_PADDING + w + x) * bpp, src + (w - 1) * bpp, bpp);
+		}
+	}
+	for( y = 0; y < ATLAS_PADDING; y++ )
+	{
+		memcpy(AtlasUploadBuffer + stride * y, AtlasUploadBuffer + stride * ATLAS_PADDING, stride);
+		memcpy(AtlasUploadBuffer + stride * (ATLAS_PADDING + h + y), AtlasUploadBuffer + stride * (ATLAS_PADDING + h - 1), stride);
+	}
+
+	rect.x -= ATLAS_PADDING;
+	rect.y -= ATLAS_PADDING;
+	rect.w += ATLAS_PADDING * 2;
+	rect.h += ATLAS_PADDING * 2;
+	SDL_UpdateTexture(hwdata->texture, &rect, AtlasUploadBuffer, stride);
+}
+
+#endif
+
+// Create texture for HW surface, or allocate it inside atlas page, hwdata is reused when recreating textures after GL context loss
+static int ANDROID_CreateSurfaceTexture(SDL_Surface *surface, Uint32 format, int allowAtlas)
+{
+	struct private_hwdata * hwdata = surface->hwdata;
+
+	if( !hwdata )
+	{
+		hwdata = (struct private_hwdata *)SDL_calloc(1, sizeof(struct private_hwdata));
+		if( !hwdata )
+			return -1;
+		hwdata->atlasPage = -1;
+		hwdata->blendMode = SDL_BLENDMODE_NONE;
+		hwdata->alpha = SDL_ALPHA_OPAQUE;
+#ifdef SDL_COMPATIBILITY_HACKS_HW_SURFACES_TEXTURE_ATLAS
+		if( allowAtlas && ANDROID_AtlasAlloc(hwdata, format, surface->w, surface->h) == 0 )
+		{
+			surface->hwdata = hwdata;
+			return 0;
+		}
+#endif
+		surface->hwdata = hwdata;
+	}
+
+#ifdef SDL_COMPATIBILITY_HACKS_HW_SURFACES_TEXTURE_ATLAS
+	if( hwdata->atlasPage >= 0 )
+	{
+		AtlasPage_t * page = AtlasPages[hwdata->atlasPage];
+		// Whole page is recreated once, all surfaces inside it are then re-uploaded by the caller
+		if( !page->texture && ANDROID_AtlasCreatePageTexture(page) < 0 )
+			return -1;
+		hwdata->texture = page->texture;
+		return 0;
+	}
+#endif
+
+	hwdata->texture = SDL_CreateTexture(format, SDL_TEXTUREACCESS_STATIC, surface->w, surface->h);
+	if( !hwdata->texture )
+		return -1;
+	if( SDL_ANDROID_VideoLinearFilter )
+		SDL_SetTextureScaleMode(hwdata->texture, SDL_SCALEMODE_SLOW);
+	SDL_SetTextureBlendMode(hwdata->texture, hwdata->blendMode);
+	SDL_SetTextureAlphaMod(hwdata->texture, hwdata->alpha);
+	return 0;
+}
+
+// Destroy texture, but keep surface registered as HW surface, so the texture can be recreated
+static void ANDROID_DestroySurfaceTexture(SDL_Surface *surface)
+{
+	struct private_hwdata * hwdata = surface->hwdata;
+
+	if( !hwdata || !hwdata->texture )
+		return;
+#ifdef SDL_COMPATIBILITY_HACKS_HW_SURFACES_TEXTURE_ATLAS
+	if( hwdata->atlasPage >= 0 )
+	{
+		AtlasPage_t * page = AtlasPages[hwdata->atlasPage];
+		if( page->texture )
+			SDL_DestroyTexture(page->texture);
+		page->texture = NULL;
+		hwdata->texture = NULL;
+		return;
+	}
+#endif
+	SDL_DestroyTexture(hwdata->texture);
+	hwdata->texture = NULL;
+}
+
+static void ANDROID_FreeSurfaceHwData(SDL_Surface *surface)
+{
+	struct private_hwdata * hwdata = surface->hwdata;
+
+	if( !hwdata )
+		return;
+#ifdef SDL_COMPATIBILITY_HACKS_HW_SURFACES_TEXTURE_ATLAS
+	if( hwdata->atlasPage >= 0 )
+		ANDROID_AtlasFree(hwdata);
+#endif
+	if( hwdata->texture )
+		SDL_DestroyTexture(hwdata->texture);
+	SDL_free(hwdata);
+	surface->hwdata = NULL;
+}
+
+static void ANDROID_SetSurfaceBlendMode(SDL_Surface *surface, int blendMode, Uint8 alpha)
+{
+	struct private_hwdata * hwdata = surface->hwdata;
+
+	hwdata->blendMode = blendMode;
+	hwdata->alpha = alpha;
+	if( hwdata->atlasPage < 0 )
+	{
+		SDL_SetTextureBlendMode(hwdata->texture, blendMode);
+		SDL_SetTextureAlphaMod(hwdata->texture, alpha);
+	}
+}
+
+static void ANDROID_RegisterHwSurface(SDL_Surface *surface)
+{
+	if( HwSurfaceCount >= HwSurfaceListSize )
+	{
+		int size = HwSurfaceListSize ? HwSurfaceListSize * 2 : 64;
+		SDL_Surface ** list = (SDL_Surface **)SDL_realloc( HwSurfaceList, size * sizeof(SDL_Surface *) );
+		if( !list )
+			return;
+		HwSurfaceList = list;
+		HwSurfaceListSize = size;
+	}
+	HwSurfaceList[HwSurfaceCount] = surface;
+	HwSurfaceCount++;
+	DEBUGOUT("ANDROID_RegisterHwSurface() HwSurfaceCount %d HwSurfaceList %p", HwSurfaceCount, HwSurfaceList);
+}
+
 SDL_Surface *ANDROID_SetVideoMode(_THIS, SDL_Surface *current,
 				int width, int height, int bpp, Uint32 flags)
 {
@@ -394,6 +793,8 @@ SDL_Surface *ANDROID_SetVideoMode(_THIS, SDL_Surface *current,
 
 	HwSurfaceCount = 0;
 	HwSurfaceList = NULL;
+	HwSurfaceListSize = 0;
+	DirtyBandsCount = 0;
 	DEBUGOUT("ANDROID_SetVideoMode() HwSurfaceCount %d HwSurfaceList %p", HwSurfaceCount, HwSurfaceList);
 	
 	if( ! sdl_opengl )
@@ -467,22 +868,17 @@ SDL_Surface *ANDROID_SetVideoMode(_THIS, SDL_Surface *current,
 				return(NULL);
 			}
 			SDL_memset(current->pixels, 0, width * height * SDL_ANDROID_BYTESPERPIXEL);
-			current->hwdata = (struct private_hwdata *)SDL_CreateTexture(PixelFormatEnum, SDL_TEXTUREACCESS_STATIC, width, height);
-			if( !current->hwdata ) {
+			if( ANDROID_CreateSurfaceTexture(current, PixelFormatEnum, 0) < 0 ) {
 				__android_log_print(ANDROID_LOG_INFO, "libSDL", "Couldn't allocate texture for SDL_CurrentVideoSurface");
+				ANDROID_FreeSurfaceHwData(current);
 				SDL_free(current->pixels);
 				current->pixels = NULL;
 				SDL_OutOfMemory();
 				return(NULL);
 			}
-			if( SDL_ANDROID_VideoLinearFilter )
-				SDL_SetTextureScaleMode((SDL_Texture *)current->hwdata, SDL_SCALEMODE_SLOW);
 
 			// Register main video texture to be recreated when needed
-			HwSurfaceCount++;
-			HwSurfaceList = SDL_realloc( HwSurfaceList, HwSurfaceCount * sizeof(SDL_Surface *) );
-			HwSurfaceList[HwSurfaceCount-1] = current;
-			DEBUGOUT("ANDROID_SetVideoMode() HwSurfaceCount %d HwSurfaceList %p", HwSurfaceCount, HwSurfaceList);
+			ANDROID_RegisterHwSurface(current);
 		}
 		glViewport(0, 0, SDL_ANDROID_sRealWindowWidth, SDL_ANDROID_sRealWindowHeight);
 		glOrthof(0, SDL_ANDROID_sRealWindowWidth, SDL_ANDROID_sRealWindowHeight, 0, 0, 1);
@@ -534,12 +930,21 @@ void ANDROID_VideoQuit(_THIS)
 		if(HwSurfaceList)
 			SDL_free(HwSurfaceList);
 		HwSurfaceList = NULL;
+		HwSurfaceListSize = 0;
+		SDL_free(UnlockConvertBuffer);
+		UnlockConvertBuffer = NULL;
+		UnlockConvertBufferSize = 0;
+		SDL_free(ReadbackBuffer);
+		ReadbackBuffer = NULL;
+		ReadbackBufferSize = 0;
+		SDL_free(ReadbackColumns);
+		ReadbackColumns = NULL;
+		ReadbackColumnsW = 0;
 		DEBUGOUT("ANDROID_VideoQuit() out HwSurfaceCount %d HwSurfaceList %p", HwSurfaceCount, HwSurfaceList);
 
 		if( SDL_CurrentVideoSurface )
 		{
-			if( SDL_CurrentVideoSurface->hwdata )
-				SDL_DestroyTexture((struct SDL_Texture *)SDL_CurrentVideoSurface->hwdata);
+			ANDROID_FreeSurfaceHwData(SDL_CurrentVideoSurface);
 			if( SDL_CurrentVideoSurface->pixels )
 				SDL_free(SDL_CurrentVideoSurface->pixels);
 			SDL_CurrentVideoSurface->pixels = NULL;
@@ -548,6 +953,9 @@ void ANDROID_VideoQuit(_THIS)
 		if(SDL_VideoWindow)
 			SDL_DestroyWindow(SDL_VideoWindow);
 		SDL_VideoWindow = NULL;
+#ifdef SDL_COMPATIBILITY_HACKS_HW_SURFACES_TEXTURE_ATLAS
+		ANDROID_AtlasDestroyAll();
+#endif
 	}
 
 	SDL_ANDROID_sFakeWindowWidth = 0;
@@ -623,31 +1031,20 @@ static int ANDROID_AllocHWSurface(_THIS, SDL_Surface *surface)
 	}
 	SDL_memset(surface->pixels, 0, surface->h*surface->pitch);
 
-	surface->hwdata = (struct private_hwdata *)SDL_CreateTexture(format, SDL_TEXTUREACCESS_STATIC, surface->w, surface->h);
-	if( !surface->hwdata ) {
+	if( ANDROID_CreateSurfaceTexture(surface, format, 1) < 0 ) {
+		ANDROID_FreeSurfaceHwData(surface);
 		SDL_free(surface->pixels);
 		surface->pixels = NULL;
 		SDL_OutOfMemory();
 		return(-1);
 	}
 
-	if( SDL_ANDROID_VideoLinearFilter )
-		SDL_SetTextureScaleMode((SDL_Texture *)surface->hwdata, SDL_SCALEMODE_SLOW);
-
 	if( surface->format->Amask )
-	{
-		SDL_SetTextureAlphaMod((struct SDL_Texture *)surface->hwdata, SDL_ALPHA_OPAQUE);
-		SDL_SetTextureBlendMode((struct SDL_Texture *)surface->hwdata, SDL_BLENDMODE_BLEND);
-	}
+		ANDROID_SetSurfaceBlendMode(surface, SDL_BLENDMODE_BLEND, SDL_ALPHA_OPAQUE);
 	
 	surface->flags |= SDL_HWSURFACE | SDL_HWACCEL;
 	
-	HwSurfaceCount++;
-	DEBUGOUT("ANDROID_AllocHWSurface() in HwSurfaceCount %d HwSurfaceList %p", HwSurfaceCount, HwSurfaceList);
-	HwSurfaceList = SDL_realloc( HwSurfaceList, HwSurfaceCount * sizeof(SDL_Surface *) );
-	DEBUGOUT("ANDROID_AllocHWSurface() out HwSurfaceCount %d HwSurfaceList %p", HwSurfaceCount, HwSurfaceList);
-
-	HwSurfaceList[HwSurfaceCount-1] = surface;
+	ANDROID_RegisterHwSurface(surface);
 	
 	return 0;
 }
@@ -664,7 +1061,7 @@ static void ANDROID_FreeHWSurface(_THIS, SDL_Surface *surface)
 
 	if( !surface->hwdata )
 		return;
-	SDL_DestroyTexture((struct SDL_Texture *)surface->hwdata);
+	ANDROID_FreeSurfaceHwData(surface);
 
 	DEBUGOUT("ANDROID_FreeHWSurface() surface %p w %d h %d in HwSurfaceCount %d HwSurfaceList %p", surface, surface->w, surface->h, HwSurfaceCount, HwSurfaceList);
 
@@ -674,7 +1071,6 @@ static void ANDROID_FreeHWSurface(_THIS, SDL_Surface *surface)
 		{
 			HwSurfaceCount--;
 			memmove(HwSurfaceList + i, HwSurfaceList + i + 1, sizeof(SDL_Surface *) * (HwSurfaceCount - i) );
-			HwSurfaceList = SDL_realloc( HwSurfaceList, HwSurfaceCount * sizeof(SDL_Surface *) );
 			i = -1;
 			DEBUGOUT("ANDROID_FreeHWSurface() in HwSurfaceCount %d HwSurfaceList %p", HwSurfaceCount, HwSurfaceList);
 			break;
@@ -684,6 +1080,88 @@ static void ANDROID_FreeHWSurface(_THIS, SDL_Surface *surface)
 		SDL_SetError("ANDROID_FreeHWSurface: cannot find freed HW surface in HwSurfaceList array");
 }
 
+// Read whole screen with a single glReadPixels() call, and scale it down to video surface size.
+// GLES 1.1 context has no pixel buffer objects, so the read cannot be made asynchronous.
+static int ANDROID_ReadScreenPixels(SDL_Surface *surface)
+{
+	int fakeH = SDL_ANDROID_sFakeWindowHeight, fakeW = SDL_ANDROID_sFakeWindowWidth;
+	int realH = SDL_ANDROID_sWindowHeight, realW = SDL_ANDROID_sWindowWidth;
+	int bpp = surface->format->BytesPerPixel;
+	int readBpp = (bpp == 2) ? 2 : 4; // 24bpp is read as RGBA, GL_RGB + GL_UNSIGNED_BYTE is not guaranteed to work
+	int size = realW * realH * readBpp;
+	int x, y;
+
+	if( ReadbackBufferSize < size )
+	{
+		SDL_free(ReadbackBuffer);
+		ReadbackBuffer = (Uint8 *)SDL_malloc(size);
+		ReadbackBufferSize = ReadbackBuffer ? size : 0;
+		if( ! ReadbackBuffer ) {
+			SDL_OutOfMemory();
+			return(-1);
+		}
+	}
+	if( ReadbackColumnsW != fakeW || ReadbackColumnsRealW != realW )
+	{
+		SDL_free(ReadbackColumns);
+		ReadbackColumns = (int *)SDL_malloc(fakeW * sizeof(int));
+		if( ! ReadbackColumns ) {
+			ReadbackColumnsW = 0;
+			SDL_OutOfMemory();
+			return(-1);
+		}
+		for( x = 0; x < fakeW; x++ )
+			ReadbackColumns[x] = x * realW / fakeW;
+		ReadbackColumnsW = fakeW;
+		ReadbackColumnsRealW = realW;
+	}
+
+	SDL_RenderFlush(); // Renderer queues blits, draw them before reading the screen
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, realW, realH, (bpp == 2) ? GL_RGB : GL_RGBA, (bpp == 2) ? GL_UNSIGNED_SHORT_5_6_5 : GL_UNSIGNED_BYTE, ReadbackBuffer);
+
+	for( y = 0; y < fakeH; y++ )
+	{
+		// OpenGL rows go from bottom to top
+		const Uint8 * src = ReadbackBuffer + (realH - 1 - (realH * y / fakeH)) * realW * readBpp;
+		Uint8 * dst = (Uint8 *)surface->pixels + y * surface->pitch;
+		const int * columns = ReadbackColumns;
+
+		if( realW == fakeW && bpp == readBpp )
+		{
+			memcpy(dst, src, fakeW * bpp);
+			continue;
+		}
+		if( realW % fakeW == 0 )
+		{
+			// Integer factor, columns[x] is x * step
+			ANDROID_DecimateRow(src, dst, fakeW, bpp, realW / fakeW);
+			continue;
+		}
+		switch( bpp )
+		{
+			case 2:
+				for( x = 0; x < fakeW; x++ )
+					((Uint16 *)dst)[x] = ((const Uint16 *)src)[columns[x]];
+				break;
+			case 3:
+				for( x = 0; x < fakeW; x++, dst += 3 )
+				{
+					const Uint8 * pixel = src + columns[x] * 4;
+					dst[0] = pixel[0];
+					dst[1] = pixel[1];
+					dst[2] = pixel[2];
+				}
+				break;
+			case 4:
+				for( x = 0; x < fakeW; x++ )
+					((Uint32 *)dst)[x] = ((const Uint32 *)src)[columns[x]];
+				break;
+		}
+	}
+	return 0;
+}
+
 static int ANDROID_LockHWSurface(_THIS, SDL_Surface *surface)
 {
 	if( !SDL_ANDROID_InsideVideoThread() )
@@ -694,14 +1172,9 @@ static int ANDROID_LockHWSurface(_THIS, SDL_Surface *surface)
 
 	if( surface == SDL_CurrentVideoSurface )
 	{
-		// Copy pixels from pixelbuffer to video surface - this is slow!
-		Uint16 * row = NULL;
-		int fakeH = SDL_ANDROID_sFakeWindowHeight, fakeW = SDL_ANDROID_sFakeWindowWidth;
-		int realH = SDL_ANDROID_sWindowHeight, realW = SDL_ANDROID_sWindowWidth;
-		int x, y;
+		// Copy pixels from pixelbuffer to video surface - this is slow, it waits until GPU finishes drawing!
 		if( ! SDL_CurrentVideoSurface->pixels )
 		{
-			glPixelStorei(GL_PACK_ALIGNMENT, 1);
 			SDL_CurrentVideoSurface->pixels = SDL_malloc(SDL_ANDROID_sFakeWindowWidth * SDL_ANDROID_sFakeWindowHeight * SDL_ANDROID_BYTESPERPIXEL);
 			if ( ! SDL_CurrentVideoSurface->pixels ) {
 				__android_log_print(ANDROID_LOG_INFO, "libSDL", "Couldn't allocate buffer for SDL_CurrentVideoSurface");
@@ -711,33 +1184,18 @@ static int ANDROID_LockHWSurface(_THIS, SDL_Surface *surface)
 		}
 		if( ! SDL_CurrentVideoSurface->hwdata )
 		{
-			SDL_CurrentVideoSurface->hwdata = (struct private_hwdata *)SDL_CreateTexture(PixelFormatEnum, SDL_TEXTUREACCESS_STATIC, SDL_ANDROID_sFakeWindowWidth, SDL_ANDROID_sFakeWindowHeight);
-			if( !SDL_CurrentVideoSurface->hwdata ) {
+			if( ANDROID_CreateSurfaceTexture(SDL_CurrentVideoSurface, PixelFormatEnum, 0) < 0 ) {
 				__android_log_print(ANDROID_LOG_INFO, "libSDL", "Couldn't allocate texture for SDL_CurrentVideoSurface");
+				ANDROID_FreeSurfaceHwData(SDL_CurrentVideoSurface);
 				SDL_OutOfMemory();
 				return(-1);
 			}
-			if( SDL_ANDROID_VideoLinearFilter )
-				SDL_SetTextureScaleMode((SDL_Texture *)SDL_CurrentVideoSurface->hwdata, SDL_SCALEMODE_SLOW);
 			// Register main video texture to be recreated when needed
-			HwSurfaceCount++;
-			HwSurfaceList = SDL_realloc( HwSurfaceList, HwSurfaceCount * sizeof(SDL_Surface *) );
-			HwSurfaceList[HwSurfaceCount-1] = SDL_CurrentVideoSurface;
-			DEBUGOUT("ANDROID_SetVideoMode() HwSurfaceCount %d HwSurfaceList %p", HwSurfaceCount, HwSurfaceList);
+			ANDROID_RegisterHwSurface(SDL_CurrentVideoSurface);
 		}
 
-		row = SDL_stack_alloc(Uint16, SDL_ANDROID_sWindowWidth);
-
-		for(y=0; y<fakeH; y++)
-		{
-			// TODO: support 24bpp and 32bpp
-			glReadPixels(0, realH - 1 - (realH * y / fakeH),
-							realW, 1, GL_RGB, GL_UNSIGNED_SHORT_5_6_5, row);
-			for(x=0; x<fakeW; x++)
-				((Uint16 *)SDL_CurrentVideoSurface->pixels)[ fakeW * y + x ] = row[ x * fakeW / realW ];
-		}
-		
-		SDL_stack_free(row);
+		if( ANDROID_ReadScreenPixels(SDL_CurrentVideoSurface) < 0 )
+			return(-1);
 	}
 
 	if( !surface->hwdata )
@@ -769,7 +1227,8 @@ static void ANDROID_UnlockHWSurface(_THIS, SDL_Surface *surface)
 	SDL_PixelFormat format;
 	Uint32 hwformat = PixelFormatEnumColorkey;
 	int bpp;
-	SDL_Surface * converted = NULL;
+	const void * pixels = surface->pixels;
+	int pitch = surface->pitch;
 
 	if( !SDL_ANDROID_InsideVideoThread() )
 	{
@@ -777,7 +1236,7 @@ static void ANDROID_UnlockHWSurface(_THIS, SDL_Surface *surface)
 		return;
 	}
 
-	if( !surface->hwdata )
+	if( !surface->hwdata || !surface->hwdata->texture )
 		return;
 	
 	if( surface->format->Amask )
@@ -795,74 +1254,54 @@ static void ANDROID_UnlockHWSurface(_THIS, SDL_Surface *surface)
 	format.BitsPerPixel = bpp;
 	
 	// TODO: support 24bpp and 32bpp
-	if( format.BitsPerPixel == surface->format->BitsPerPixel &&
-		format.Rmask == surface->format->Rmask &&
-		format.Gmask == surface->format->Gmask &&
-		format.Bmask == surface->format->Bmask &&
-		format.Amask == surface->format->Amask )
-	{
-		converted = surface; // No need for conversion
-	}
-	else
+	if( ! ( format.BitsPerPixel == surface->format->BitsPerPixel &&
+			format.Rmask == surface->format->Rmask &&
+			format.Gmask == surface->format->Gmask &&
+			format.Bmask == surface->format->Bmask &&
+			format.Amask == surface->format->Amask ) )
 	{
-		Uint16 x, y;
-
-		converted = SDL_CreateRGBSurface(SDL_SWSURFACE, surface->w, surface->h, format.BitsPerPixel,
-											format.Rmask, format.Gmask, format.Bmask, format.Amask);
-		if( !converted ) {
-			SDL_OutOfMemory();
-			return;
-		}
+		int y;
+		int size = surface->w * surface->h;
 
-		#define CONVERT_RGB565_RGBA5551( pixel ) (0x1 | ( (pixel & 0xFFC0) | ( (pixel & 0x1F) << 1 ) ))
-		
-		if( surface->flags & SDL_SRCCOLORKEY )
+		if( UnlockConvertBufferSize < size )
 		{
-			DEBUGOUT("ANDROID_UnlockHWSurface() CONVERT_RGB565_RGBA5551 + colorkey");
-			for( y = 0; y < surface->h; y++ )
-			{
-				Uint16* src = (Uint16 *)( surface->pixels + surface->pitch * y );
-				Uint16* dst = (Uint16 *)( converted->pixels + converted->pitch * y );
-				Uint16 w = surface->w;
-				Uint16 key = surface->format->colorkey;
-				Uint16 pixel;
-				for( x = 0; x < w; x++, src++, dst++ )
-				{
-					pixel = *src;
-					*dst = (pixel == key) ? 0 : CONVERT_RGB565_RGBA5551( pixel );
-				}
+			SDL_free(UnlockConvertBuffer);
+			UnlockConvertBuffer = (Uint16 *)SDL_malloc(size * sizeof(Uint16));
+			UnlockConvertBufferSize = UnlockConvertBuffer ? size : 0;
+			if( !UnlockConvertBuffer ) {
+				SDL_OutOfMemory();
+				return;
 			}
 		}
-		else
+
+		DEBUGOUT("ANDROID_UnlockHWSurface() RGB565 -> RGBA5551 colorkey %d", (surface->flags & SDL_SRCCOLORKEY) != 0);
+		for( y = 0; y < surface->h; y++ )
 		{
-			DEBUGOUT("ANDROID_UnlockHWSurface() CONVERT_RGB565_RGBA5551");
-			for( y = 0; y < surface->h; y++ )
-			{
-				Uint16* src = (Uint16 *)( surface->pixels + surface->pitch * y );
-				Uint16* dst = (Uint16 *)( converted->pixels + converted->pitch * y );
-				Uint16 w = surface->w;
-				Uint16 pixel;
-				for( x = 0; x < w; x++, src++, dst++ )
-				{
-					pixel = *src;
-					*dst = CONVERT_RGB565_RGBA5551( pixel );
-				}
-			}
+			ANDROID_ConvertRGB565ToRGBA5551( (const Uint16 *)( surface->pixels + surface->pitch * y ),
+					UnlockConvertBuffer + surface->w * y, surface->w,
+					surface->flags & SDL_SRCCOLORKEY, surface->format->colorkey );
 		}
+		pixels = UnlockConvertBuffer;
+		pitch = surface->w * sizeof(Uint16); // Tightly packed, so texture upload will not need to repack it
 	}
 
+#ifdef SDL_COMPATIBILITY_HACKS_HW_SURFACES_TEXTURE_ATLAS
+	if( surface->hwdata->atlasPage >= 0 )
+	{
+		ANDROID_AtlasUpload(surface->hwdata, pixels, pitch);
+		return;
+	}
+#endif
+
 	SDL_Rect rect;
 	rect.x = 0;
 	rect.y = 0;
 	rect.w = surface->w;
 	rect.h = surface->h;
-	SDL_UpdateTexture((struct SDL_Texture *)surface->hwdata, &rect, converted->pixels, converted->pitch);
+	SDL_UpdateTexture(surface->hwdata->texture, &rect, pixels, pitch);
 
 	if( surface == SDL_CurrentVideoSurface ) // Special case
-		SDL_RenderCopy((struct SDL_Texture *)SDL_CurrentVideoSurface->hwdata, NULL, NULL);
-	
-	if( converted != surface )
-		SDL_FreeSurface(converted);
+		SDL_RenderCopy(SDL_CurrentVideoSurface->hwdata->texture, NULL, NULL);
 }
 
 // We're only blitting HW surface to screen, no other options provided (and if you need them your app designed wrong)
@@ -874,7 +1313,7 @@ int ANDROID_HWBlit(SDL_Surface* src, SDL_Rect* srcrect, SDL_Surface* dst, SDL_Re
 		return -1;
 	}
 
-	if( dst != SDL_CurrentVideoSurface || (! src->hwdata) )
+	if( dst != SDL_CurrentVideoSurface || ! src->hwdata || ! src->hwdata->texture )
 	{
 		//__android_log_print(ANDROID_LOG_INFO, "libSDL", "ANDROID_HWBlit(): blitting SW");
 		return(src->map->sw_blit(src, srcrect, dst, dstrect));
@@ -885,7 +1324,46 @@ int ANDROID_HWBlit(SDL_Surface* src, SDL_Rect* srcrect, SDL_Surface* dst, SDL_Re
 		return(-1);
 	}
 	
-	return SDL_RenderCopy((struct SDL_Texture *)src->hwdata, srcrect, dstrect);
+#ifdef SDL_COMPATIBILITY_HACKS_HW_SURFACES_TEXTURE_ATLAS
+	if( src->hwdata->atlasPage >= 0 )
+	{
+		// Page texture is shared, so apply this surface blend state, and translate source rect into the page
+		SDL_Rect rect;
+		if( srcrect )
+		{
+			rect = *srcrect;
+			if( rect.x < 0 )
+			{
+				rect.w += rect.x;
+				rect.x = 0;
+			}
+			if( rect.y < 0 )
+			{
+				rect.h += rect.y;
+				rect.y = 0;
+			}
+			if( rect.x + rect.w > src->w )
+				rect.w = src->w - rect.x;
+			if( rect.y + rect.h > src->h )
+				rect.h = src->h - rect.y;
+			if( rect.w <= 0 || rect.h <= 0 )
+				return 0;
+		}
+		else
+		{
+			rect.x = 0;
+			rect.y = 0;
+			rect.w = src->w;
+			rect.h = src->h;
+		}
+		rect.x += src->hwdata->atlasRect.x;
+		rect.y += src->hwdata->atlasRect.y;
+		SDL_SetTextureBlendMode(src->hwdata->texture, src->hwdata->blendMode);
+		SDL_SetTextureAlphaMod(src->hwdata->texture, src->hwdata->alpha);
+		return SDL_RenderCopy(src->hwdata->texture, &rect, dstrect);
+	}
+#endif
+	return SDL_RenderCopy(src->hwdata->texture, srcrect, dstrect);
 };
 
 static int ANDROID_CheckHWBlit(_THIS, SDL_Surface *src, SDL_Surface *dst)
@@ -944,7 +1422,7 @@ static int ANDROID_SetHWColorKey(_THIS, SDL_Surface *surface, Uint32 key)
 
 	ANDROID_UnlockHWSurface(this, surface); // Convert surface using colorkey
 
-	SDL_SetTextureBlendMode((struct SDL_Texture *)surface->hwdata, SDL_BLENDMODE_BLEND);
+	ANDROID_SetSurfaceBlendMode(surface, SDL_BLENDMODE_BLEND, surface->hwdata->alpha);
 
 	return 0;
 };
@@ -963,40 +1441,129 @@ static int ANDROID_SetHWAlpha(_THIS, SDL_Surface *surface, Uint8 value)
 	surface->flags |= SDL_SRCALPHA;
 
 	if( value == SDL_ALPHA_OPAQUE && ! (surface->flags & SDL_SRCCOLORKEY) )
-		SDL_SetTextureBlendMode((struct SDL_Texture *)surface->hwdata, SDL_BLENDMODE_NONE);
+		ANDROID_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE, value);
 	else
-		SDL_SetTextureBlendMode((struct SDL_Texture *)surface->hwdata, SDL_BLENDMODE_BLEND);
+		ANDROID_SetSurfaceBlendMode(surface, SDL_BLENDMODE_BLEND, value);
 	
-	return SDL_SetTextureAlphaMod((struct SDL_Texture *)surface->hwdata, value);
+	return 0;
 };
 
-static void ANDROID_FlipHWSurfaceInternal(int numrects, SDL_Rect *rects)
+static void ANDROID_AddDirtyRows(int y0, int y1)
+{
+	int i, first, last, best, bestGap;
+
+	// Bands are sorted and never touch each other, find all bands that overlap the new one
+	for( first = 0; first < DirtyBandsCount && DirtyBands[first].y1 + DIRTY_BANDS_MERGE_GAP < y0; first++ ) { }
+	for( last = first; last < DirtyBandsCount && DirtyBands[last].y0 <= y1 + DIRTY_BANDS_MERGE_GAP; last++ )
+	{
+		if( DirtyBands[last].y0 < y0 )
+			y0 = DirtyBands[last].y0;
+		if( DirtyBands[last].y1 > y1 )
+			y1 = DirtyBands[last].y1;
+	}
+
+	if( last == first )
+	{
+		memmove(DirtyBands + first + 1, DirtyBands + first, sizeof(DirtyBand_t) * (DirtyBandsCount - first));
+		DirtyBandsCount++;
+	}
+	else if( last > first + 1 )
+	{
+		memmove(DirtyBands + first + 1, DirtyBands + last, sizeof(DirtyBand_t) * (DirtyBandsCount - last));
+		DirtyBandsCount -= last - first - 1;
+	}
+	DirtyBands[first].y0 = y0;
+	DirtyBands[first].y1 = y1;
+
+	if( DirtyBandsCount <= DIRTY_BANDS_MAX )
+		return;
+
+	// Too many bands - join two neighbours with the smallest gap, uploading few extra rows is cheaper than an extra GL call
+	best = 0;
+	bestGap = DirtyBands[1].y0 - DirtyBands[0].y1;
+	for( i = 1; i < DirtyBandsCount - 1; i++ )
+	{
+		if( DirtyBands[i + 1].y0 - DirtyBands[i].y1 < bestGap )
+		{
+			best = i;
+			bestGap = DirtyBands[i + 1].y0 - DirtyBands[i].y1;
+		}
+	}
+	DirtyBands[best].y1 = DirtyBands[best + 1].y1;
+	memmove(DirtyBands + best + 1, DirtyBands + best + 2, sizeof(DirtyBand_t) * (DirtyBandsCount - best - 2));
+	DirtyBandsCount--;
+}
+
+static void ANDROID_AddDirtyRects(int numrects, const SDL_Rect *rects)
+{
+	int i;
+	int h = SDL_CurrentVideoSurface->h;
+
+	if( numrects == 0 ) // Whole screen
+	{
+		DirtyBands[0].y0 = 0;
+		DirtyBands[0].y1 = h;
+		DirtyBandsCount = 1;
+		return;
+	}
+	for( i = 0; i < numrects; i++ )
+	{
+		int y0 = rects[i].y, y1 = rects[i].y + rects[i].h;
+		if( y0 < 0 )
+			y0 = 0;
+		if( y1 > h )
+			y1 = h;
+		if( y0 >= y1 || rects[i].w <= 0 || rects[i].x >= SDL_CurrentVideoSurface->w || rects[i].x + rects[i].w <= 0 )
+			continue;
+		ANDROID_AddDirtyRows(y0, y1);
+	}
+}
+
+// Pixels may come from the video surface itself, or from a staging buffer with the same pitch in multithreaded mode
+static void ANDROID_UploadDirtyRects(const Uint8 *pixels, const DirtyBand_t *bands, int bandsCount)
+{
+	int i;
+	SDL_Rect band;
+
+	band.x = 0;
+	band.w = SDL_CurrentVideoSurface->w;
+	for( i = 0; i < bandsCount; i++ )
+	{
+		band.y = bands[i].y0;
+		band.h = bands[i].y1 - bands[i].y0;
+		//__android_log_print(ANDROID_LOG_INFO, "libSDL", "SDL_UpdateTexture: band %d: %04d:%04d", i, band.y, band.h);
+		SDL_UpdateTexture(SDL_CurrentVideoSurface->hwdata->texture, &band,
+			pixels + band.y * SDL_CurrentVideoSurface->pitch,
+			SDL_CurrentVideoSurface->pitch);
+	}
+}
+
+// Damage reported by SDL_UpdateRects(). Many applications draw outside of the rects they pass
+// (fheroes2 does that), so the rects are trusted only when the application declares it uses them properly.
+static void ANDROID_UpdateRectsDamage(int numrects, const SDL_Rect *rects)
+{
+#ifdef SDL_COMPATIBILITY_HACKS_PROPER_USADE_OF_SDL_UPDATERECTS
+	ANDROID_AddDirtyRects(numrects, rects);
+#else
+	ANDROID_AddDirtyRects(0, NULL);
+#endif
+}
+
+static void ANDROID_FlipHWSurfaceInternal(const Uint8 *pixels, const DirtyBand_t *bands, int bandsCount)
 {
 	//__android_log_print(ANDROID_LOG_INFO, "libSDL", "ANDROID_FlipHWSurface()");
-	if( SDL_CurrentVideoSurface->hwdata && SDL_CurrentVideoSurface->pixels && ! ( SDL_CurrentVideoSurface->flags & SDL_HWSURFACE ) )
+	if( SDL_CurrentVideoSurface->hwdata && SDL_CurrentVideoSurface->hwdata->texture && SDL_CurrentVideoSurface->pixels && ! ( SDL_CurrentVideoSurface->flags & SDL_HWSURFACE ) )
 	{
 		SDL_Rect rect;
 		rect.x = 0;
 		rect.y = 0;
 		rect.w = SDL_CurrentVideoSurface->w;
 		rect.h = SDL_CurrentVideoSurface->h;
-		if(numrects == 0)
-			SDL_UpdateTexture((struct SDL_Texture *)SDL_CurrentVideoSurface->hwdata, &rect, SDL_CurrentVideoSurface->pixels, SDL_CurrentVideoSurface->pitch);
-		else
-		{
-			int i;
-			for(i = 0; i < numrects; i++)
-			{
-				//__android_log_print(ANDROID_LOG_INFO, "libSDL", "SDL_UpdateTexture: rect %d: %04d:%04d:%04d:%04d", i, rects[i].x, rects[i].y, rects[i].w, rects[i].h);
-				SDL_UpdateTexture((struct SDL_Texture *)SDL_CurrentVideoSurface->hwdata, &rects[i],
-					SDL_CurrentVideoSurface->pixels + rects[i].y * SDL_CurrentVideoSurface->pitch +
-					rects[i].x * SDL_CurrentVideoSurface->format->BytesPerPixel,
-					SDL_CurrentVideoSurface->pitch);
-			}
-		}
+
+		ANDROID_UploadDirtyRects(pixels, bands, bandsCount);
 
 		if( !SDL_ANDROID_SystemBarAndKeyboardShown )
-			SDL_RenderCopy((struct SDL_Texture *)SDL_CurrentVideoSurface->hwdata, &rect, &rect);
+			SDL_RenderCopy(SDL_CurrentVideoSurface->hwdata->texture, &rect, &rect);
 		else
 		{
 			int x, y;
@@ -1019,14 +1586,22 @@ static void ANDROID_FlipHWSurfaceInternal(int numrects, SDL_Rect *rects)
 			dstrect.x = SDL_ANDROID_ScreenVisibleRect.x * SDL_ANDROID_sFakeWindowWidth / SDL_ANDROID_sRealWindowWidth;
 			dstrect.y = SDL_ANDROID_ScreenVisibleRect.y * SDL_ANDROID_sFakeWindowHeight / SDL_ANDROID_sRealWindowHeight;
 			//__android_log_print(ANDROID_LOG_INFO, "SDL", "SDL_Flip: %04d:%04d:%04d:%04d -> %04d:%04d:%04d:%04d vis %04d:%04d:%04d:%04d", rect.x, rect.y, rect.w, rect.h, dstrect.x, dstrect.y, dstrect.w, dstrect.h, SDL_ANDROID_ScreenVisibleRect.x, SDL_ANDROID_ScreenVisibleRect.y, SDL_ANDROID_ScreenVisibleRect.w, SDL_ANDROID_ScreenVisibleRect.h);
-			SDL_RenderCopy((struct SDL_Texture *)SDL_CurrentVideoSurface->hwdata, &rect, &dstrect);
+			SDL_RenderCopy(SDL_CurrentVideoSurface->hwdata->texture, &rect, &dstrect);
 		}
 
 		if( SDL_ANDROID_ShowScreenUnderFinger == ZOOM_MAGNIFIER )
 		{
 			SDL_Rect dstrect = SDL_ANDROID_ShowScreenUnderFingerRect;
 			rect = SDL_ANDROID_ShowScreenUnderFingerRectSrc;
-			SDL_RenderCopy((struct SDL_Texture *)SDL_CurrentVideoSurface->hwdata, &rect, &dstrect);
+			SDL_RenderCopy(SDL_CurrentVideoSurface->hwdata->texture, &rect, &dstrect);
+		}
+
+		// The copies above are only queued - draw them before the direct GL overlays below
+		SDL_RenderFlush();
+
+		if( SDL_ANDROID_ShowScreenUnderFinger == ZOOM_MAGNIFIER )
+		{
+			SDL_Rect dstrect = SDL_ANDROID_ShowScreenUnderFingerRect;
 			int buttons = SDL_GetMouseState(NULL, NULL);
 			// Do it old-fashioned way with direct GL calls
 			glPushMatrix();
@@ -1092,6 +1667,13 @@ static void ANDROID_FlipHWSurfaceInternal(int numrects, SDL_Rect *rects)
 	}
 };
 
+// Upload damage accumulated in DirtyBands directly from the video surface, and draw the screen
+static void ANDROID_FlipHWSurfaceDirty()
+{
+	ANDROID_FlipHWSurfaceInternal(SDL_CurrentVideoSurface->pixels, DirtyBands, DirtyBandsCount);
+	DirtyBandsCount = 0;
+}
+
 static int ANDROID_FlipHWSurface(_THIS, SDL_Surface *surface)
 {
 	if( !SDL_ANDROID_InsideVideoThread() )
@@ -1106,7 +1688,8 @@ static int ANDROID_FlipHWSurface(_THIS, SDL_Surface *surface)
 		return -1;
 	}
 
-	ANDROID_FlipHWSurfaceInternal(0, NULL);
+	ANDROID_AddDirtyRects(0, NULL);
+	ANDROID_FlipHWSurfaceDirty();
 
 	SDL_ANDROID_CallJavaSwapBuffers();
 
@@ -1127,11 +1710,8 @@ static void ANDROID_UpdateRects(_THIS, int numrects, SDL_Rect *rects)
 		return;
 	}
 
-#ifdef SDL_COMPATIBILITY_HACKS_PROPER_USADE_OF_SDL_UPDATERECTS
-	ANDROID_FlipHWSurfaceInternal(numrects, rects); // Fails for fheroes2, I'll add a compatibility option later.
-#else
-	ANDROID_FlipHWSurfaceInternal(0, NULL);
-#endif
+	ANDROID_UpdateRectsDamage(numrects, rects);
+	ANDROID_FlipHWSurfaceDirty();
 
 	SDL_ANDROID_CallJavaSwapBuffers();
 }
@@ -1161,11 +1741,9 @@ void SDL_ANDROID_VideoContextLost()
 	if( ! sdl_opengl )
 	{
 		int i;
+		// Surfaces keep their hwdata, with atlas placement and blend state, only textures are destroyed
 		for( i = 0; i < HwSurfaceCount; i++ )
-		{
-			SDL_DestroyTexture((struct SDL_Texture *)HwSurfaceList[i]->hwdata);
-			HwSurfaceList[i]->hwdata = NULL;
-		}
+			ANDROID_DestroySurfaceTexture(HwSurfaceList[i]);
 	}
 };
 
@@ -1208,14 +1786,11 @@ void SDL_ANDROID_VideoContextRecreated()
 				format = PixelFormatEnumAlpha;
 			if( HwSurfaceList[i] == SDL_CurrentVideoSurface )
 				format = PixelFormatEnum;
-			HwSurfaceList[i]->hwdata = (struct private_hwdata *)SDL_CreateTexture(format, SDL_TEXTUREACCESS_STATIC, HwSurfaceList[i]->w, HwSurfaceList[i]->h);
-			if( !HwSurfaceList[i]->hwdata )
+			if( ANDROID_CreateSurfaceTexture(HwSurfaceList[i], format, 0) < 0 )
 			{
 				SDL_OutOfMemory();
 				return;
 			}
-			if( SDL_ANDROID_VideoLinearFilter )
-				SDL_SetTextureScaleMode((SDL_Texture *)HwSurfaceList[i]->hwdata, SDL_SCALEMODE_SLOW);
 			if (flags & SDL_SRCALPHA)
 			{
 				int alpha = HwSurfaceList[i]->format->alpha;
@@ -1232,6 +1807,7 @@ void SDL_ANDROID_VideoContextRecreated()
 				ANDROID_UnlockHWSurface(NULL, HwSurfaceList[i]); // Re-fill texture with graphics
 			}
 		}
+		DirtyBandsFullScreenNeeded = 1; // Video surface may be modified by other thread while we were uploading it
 		SDL_ANDROID_CallJavaSwapBuffers(); // Swap buffers once to force screen redraw
 	}
 };
@@ -1250,7 +1826,18 @@ static void* ANDROID_GL_GetProcAddress(_THIS, const char *proc)
 };
 
 // Multithreaded video - this will free up some CPU time while GPU renders video inside SDL_Flip()
+// SDL_Flip() and SDL_UpdateRects() do not wait for the video thread, they copy damaged rows into one of the staging buffers,
+// and pass it through lock-free single-producer single-consumer queue, so application draws next frame
+// while video thread uploads the texture and swaps buffers. Compatibility mode keeps synchronous commands.
 enum videoThreadCmd_t { CMD_INIT, CMD_SETVIDEOMODE, CMD_QUIT, CMD_UPDATERECTS, CMD_FLIP };
+enum { VIDEO_PIPELINE_FRAMES = 2 }; // Set to 3 for triple buffering
+typedef struct
+{
+	Uint8 * pixels;
+	int size;
+	DirtyBand_t bands[DIRTY_BANDS_MAX + 1];
+	int bandsCount;
+} videoFrame_t;
 typedef struct
 {
 	SDL_mutex * mutex;
@@ -1271,6 +1858,10 @@ typedef struct
 	
 	int retcode;
 	SDL_Surface * retcode2;
+
+	videoFrame_t frames[VIDEO_PIPELINE_FRAMES];
+	volatile unsigned framesHead; // Written only by application thread
+	volatile unsigned framesTail; // Written only by video thread
 } videoThread_t;
 static videoThread_t videoThread;
 
@@ -1283,6 +1874,110 @@ void SDL_ANDROID_MultiThreadedVideoLoopInit()
 	videoThread.cond = SDL_CreateCond();
 	videoThread.cond2 = SDL_CreateCond();
 	videoThread.execute = 0;
+	videoThread.framesHead = 0;
+	videoThread.framesTail = 0;
+}
+
+static int ANDROID_VideoPipelined()
+{
+	return ! SDL_ANDROID_CompatibilityHacks;
+}
+
+// Called from video thread
+static void ANDROID_VideoPipelineRenderFrame()
+{
+	videoFrame_t * frame = &videoThread.frames[videoThread.framesTail % VIDEO_PIPELINE_FRAMES];
+
+	__sync_synchronize(); // Read frame contents only after reading framesHead
+	if( SDL_CurrentVideoSurface && SDL_CurrentVideoSurface->hwdata && SDL_CurrentVideoSurface->hwdata->texture )
+		ANDROID_UploadDirtyRects(frame->pixels, frame->bands, frame->bandsCount);
+	__sync_synchronize(); // Finish reading staging buffer before giving it back to application
+	videoThread.framesTail++;
+
+	SDL_mutexP(videoThread.mutex);
+	SDL_CondSignal(videoThread.cond2);
+	SDL_mutexV(videoThread.mutex);
+
+	// Staging buffer is free now, application may continue while we are drawing and swapping buffers
+	if( SDL_CurrentVideoSurface )
+	{
+		ANDROID_FlipHWSurfaceInternal(NULL, NULL, 0);
+		SDL_ANDROID_CallJavaSwapBuffers();
+	}
+}
+
+// Called from application thread
+static void ANDROID_VideoPipelineWait(unsigned maxFramesQueued)
+{
+	if( videoThread.framesHead - videoThread.framesTail <= maxFramesQueued )
+		return;
+	SDL_mutexP(videoThread.mutex);
+	while( videoThread.framesHead - videoThread.framesTail > maxFramesQueued )
+		SDL_CondWaitTimeout(videoThread.cond2, videoThread.mutex, 1000);
+	SDL_mutexV(videoThread.mutex);
+}
+
+// Called from application thread
+static void ANDROID_VideoPipelineSubmit(int numrects, SDL_Rect *rects)
+{
+	videoFrame_t * frame;
+	int i, size;
+
+	if( !SDL_CurrentVideoSurface || !SDL_CurrentVideoSurface->pixels )
+		return;
+
+	ANDROID_UpdateRectsDamage(numrects, rects);
+	if( DirtyBandsFullScreenNeeded )
+	{
+		DirtyBandsFullScreenNeeded = 0;
+		ANDROID_AddDirtyRects(0, NULL);
+	}
+
+	// Wait until the oldest staging buffer is uploaded, if all of them are queued
+	ANDROID_VideoPipelineWait(VIDEO_PIPELINE_FRAMES - 1);
+
+	frame = &videoThread.frames[videoThread.framesHead % VIDEO_PIPELINE_FRAMES];
+	size = SDL_CurrentVideoSurface->h * SDL_CurrentVideoSurface->pitch;
+	if( frame->size != size )
+	{
+		SDL_free(frame->pixels);
+		frame->pixels = SDL_malloc(size);
+		frame->size = frame->pixels ? size : 0;
+		if( ! frame->pixels )
+		{
+			__android_log_print(ANDROID_LOG_INFO, "libSDL", "Couldn't allocate staging buffer for video thread");
+			SDL_OutOfMemory();
+			return;
+		}
+	}
+
+	for( i = 0; i < DirtyBandsCount; i++ )
+	{
+		int offset = DirtyBands[i].y0 * SDL_CurrentVideoSurface->pitch;
+		memcpy(frame->pixels + offset, (Uint8 *)SDL_CurrentVideoSurface->pixels + offset,
+				(DirtyBands[i].y1 - DirtyBands[i].y0) * SDL_CurrentVideoSurface->pitch);
+		frame->bands[i] = DirtyBands[i];
+	}
+	frame->bandsCount = DirtyBandsCount;
+	DirtyBandsCount = 0;
+
+	__sync_synchronize(); // Frame contents must be visible to video thread before framesHead
+	videoThread.framesHead++;
+
+	SDL_mutexP(videoThread.mutex);
+	SDL_CondSignal(videoThread.cond);
+	SDL_mutexV(videoThread.mutex);
+}
+
+static void ANDROID_VideoPipelineFree()
+{
+	int i;
+	for( i = 0; i < VIDEO_PIPELINE_FRAMES; i++ )
+	{
+		SDL_free(videoThread.frames[i].pixels);
+		videoThread.frames[i].pixels = NULL;
+		videoThread.frames[i].size = 0;
+	}
 }
 
 void SDL_ANDROID_MultiThreadedVideoLoop()
@@ -1293,12 +1988,13 @@ void SDL_ANDROID_MultiThreadedVideoLoop()
 	{
 		int signalNeeded = 0;
 		int swapBuffersNeeded = 0;
-		int ret;
+		int ret = 0;
 		int currentTime;
 		SDL_mutexP(videoThread.mutex);
 		videoThread.threadReady = 1;
 		SDL_CondSignal(videoThread.cond2);
-		ret = SDL_CondWaitTimeout(videoThread.cond, videoThread.mutex, SDL_ANDROID_CompatibilityHacks ? nextUpdateDelay : 1000);
+		if( ! videoThread.execute && videoThread.framesHead == videoThread.framesTail )
+			ret = SDL_CondWaitTimeout(videoThread.cond, videoThread.mutex, SDL_ANDROID_CompatibilityHacks ? nextUpdateDelay : 1000);
 		if( videoThread.execute )
 		{
 			videoThread.threadReady = 0;
@@ -1315,6 +2011,8 @@ void SDL_ANDROID_MultiThreadedVideoLoop()
 					ANDROID_VideoQuit(videoThread._this);
 					break;
 				case CMD_UPDATERECTS:
+					if( SDL_CurrentVideoSurface )
+						ANDROID_UpdateRectsDamage(videoThread.numrects, videoThread.rects);
 					if( SDL_ANDROID_CompatibilityHacks ) // DIRTY HACK for MilkyTracker - DO NOT update screen when application requests that, update 50 ms later
 					{
 						if( nextUpdateDelay >= 100 )
@@ -1324,11 +2022,13 @@ void SDL_ANDROID_MultiThreadedVideoLoop()
 					}
 					else
 					{
-						ANDROID_FlipHWSurfaceInternal(videoThread.numrects, videoThread.rects);
+						ANDROID_FlipHWSurfaceDirty();
 						swapBuffersNeeded = 1;
 					}
 					break;
 				case CMD_FLIP:
+					if( SDL_CurrentVideoSurface )
+						ANDROID_AddDirtyRects(0, NULL);
 					if( SDL_ANDROID_CompatibilityHacks ) // DIRTY HACK for MilkyTracker - DO NOT update screen when application requests that, update 50 ms later
 					{
 						if( nextUpdateDelay >= 100 )
@@ -1338,7 +2038,7 @@ void SDL_ANDROID_MultiThreadedVideoLoop()
 					}
 					else
 					{
-						ANDROID_FlipHWSurfaceInternal(0, NULL);
+						ANDROID_FlipHWSurfaceDirty();
 						swapBuffersNeeded = 1;
 					}
 					break;
@@ -1349,7 +2049,10 @@ void SDL_ANDROID_MultiThreadedVideoLoop()
 		if( SDL_ANDROID_CompatibilityHacks && SDL_CurrentVideoSurface &&
 				( ret == SDL_MUTEX_TIMEDOUT || nextUpdateDelay <= 0 ) )
 		{
-			ANDROID_FlipHWSurfaceInternal(0, NULL);
+#ifndef SDL_COMPATIBILITY_HACKS_PROPER_USADE_OF_SDL_UPDATERECTS
+			ANDROID_AddDirtyRects(0, NULL); // Periodic redraw, application did not tell us what changed
+#endif
+			ANDROID_FlipHWSurfaceDirty();
 			swapBuffersNeeded = 1;
 			lastUpdate = SDL_GetTicks();
 			nextUpdateDelay = 100;
@@ -1361,6 +2064,8 @@ void SDL_ANDROID_MultiThreadedVideoLoop()
 		{
 			SDL_ANDROID_CallJavaSwapBuffers();
 		}
+		if( videoThread.framesHead != videoThread.framesTail )
+			ANDROID_VideoPipelineRenderFrame();
 	}
 }
 
@@ -1387,6 +2092,7 @@ SDL_Surface *ANDROID_SetVideoModeMT(_THIS, SDL_Surface *current, int width, int
 	{
 		return NULL;
 	}
+	ANDROID_VideoPipelineWait(0);
 	SDL_mutexP(videoThread.mutex);
 	while( ! videoThread.threadReady )
 		SDL_CondWaitTimeout(videoThread.cond2, videoThread.mutex, 1000);
@@ -1408,6 +2114,7 @@ SDL_Surface *ANDROID_SetVideoModeMT(_THIS, SDL_Surface *current, int width, int
 
 void ANDROID_VideoQuitMT(_THIS)
 {
+	ANDROID_VideoPipelineWait(0);
 	SDL_mutexP(videoThread.mutex);
 	while( ! videoThread.threadReady )
 		SDL_CondWaitTimeout(videoThread.cond2, videoThread.mutex, 1000);
@@ -1418,10 +2125,16 @@ void ANDROID_VideoQuitMT(_THIS)
 	while( videoThread.execute )
 		SDL_CondWaitTimeout(videoThread.cond2, videoThread.mutex, 1000);
 	SDL_mutexV(videoThread.mutex);
+	ANDROID_VideoPipelineFree();
 }
 
 void ANDROID_UpdateRectsMT(_THIS, int numrects, SDL_Rect *rects)
 {
+	if( ANDROID_VideoPipelined() )
+	{
+		ANDROID_VideoPipelineSubmit(numrects, rects);
+		return;
+	}
 	SDL_mutexP(videoThread.mutex);
 	while( ! videoThread.threadReady )
 		SDL_CondWaitTimeout(videoThread.cond2, videoThread.mutex, 1000);
@@ -1438,6 +2151,11 @@ void ANDROID_UpdateRectsMT(_THIS, int numrects, SDL_Rect *rects)
 
 int ANDROID_FlipHWSurfaceMT(_THIS, SDL_Surface *surface)
 {
+	if( ANDROID_VideoPipelined() )
+	{
+		ANDROID_VideoPipelineSubmit(0, NULL);
+		return 0;
+	}
 	SDL_mutexP(videoThread.mutex);
 	while( ! videoThread.threadReady )
 		SDL_CondWaitTimeout(videoThread.cond2, videoThread.mutex, 1000);
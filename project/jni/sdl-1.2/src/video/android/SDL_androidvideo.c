@@ -47,6 +47,9 @@ If you compile this code with SDL 1.3 or newer, or use in some other way, the li
 #include "../SDL_sysvideo.h"
 #include "../SDL_pixels_c.h"
 #include "../../events/SDL_events_c.h"
+#if !SDL_VERSION_ATLEAST(1,3,0)
+#include "SDL_video-1.3.h"
+#endif
 
 #include "../SDL_sysvideo.h"
 #include "SDL_androidvideo.h"
@@ -125,6 +128,9 @@ int SDL_ANDROID_CallJavaSwapBuffers()
 
 	if( !glContextLost )
 	{
+#if !SDL_VERSION_ATLEAST(1,3,0)
+		SDL_RenderFlush(); // Draw blits queued by the renderer, before drawing with GL directly
+#endif
 		// Clear part of screen not used by SDL - on Android the screen contains garbage after each frame
 		if( SDL_ANDROID_ForceClearScreenRectAmount > 0 )
 		{
@@ -77,6 +77,8 @@ extern void SDL_ANDROID_processMoveMouseWithKeyboard();
 extern int SDL_ANDROID_InsideVideoThread();
 extern void SDL_ANDROID_initFakeStdout();
 extern SDL_VideoDevice *ANDROID_CreateDevice_1_3(int devindex);
+extern void ANDROID_ConvertRGB565ToRGBA5551(const Uint16 *src, Uint16 *dst, int w, int useColorkey, Uint16 key); // SDL 1.2 only
+extern void ANDROID_DecimateRow(const Uint8 *src, Uint8 *dst, int w, int bpp, int step); // SDL 1.2 only
 extern void SDL_ANDROID_ProcessDeferredEvents();
 extern void SDL_ANDROID_WarpMouse(int x, int y);
 extern void SDL_ANDROID_DrawMouseCursor(int x, int y, int size, float alpha);
@@ -111,7 +111,7 @@ SDL_PROC_UNUSED(void, glDepthRangex, (GLclampx zNear, GLclampx zFar))
 SDL_PROC(void, glDisable, (GLenum cap))
 SDL_PROC(void, glDisableClientState, (GLenum array))
 SDL_PROC(void, glDrawArrays, (GLenum mode, GLint first, GLsizei count))
-SDL_PROC_UNUSED(void, glDrawElements,
+SDL_PROC(void, glDrawElements,
                 (GLenum mode, GLsizei count, GLenum type,
                  const GLvoid * indices))
 SDL_PROC(void, glEnable, (GLenum cap))
@@ -179,8 +179,8 @@ SDL_PROC_UNUSED(void, glPointParameterxv,
                 (GLenum pname, const GLfixed * params))
 SDL_PROC_UNUSED(void, glPointSizex, (GLfixed size))
 SDL_PROC_UNUSED(void, glPolygonOffsetx, (GLfixed factor, GLfixed units))
-SDL_PROC_UNUSED(void, glPopMatrix, (void))
-SDL_PROC_UNUSED(void, glPushMatrix, (void))
+SDL_PROC(void, glPopMatrix, (void))
+SDL_PROC(void, glPushMatrix, (void))
 SDL_PROC_UNUSED(void, glReadPixels,
                 (GLint x, GLint y, GLsizei width, GLsizei height,
                  GLenum format, GLenum type, GLvoid * pixels))
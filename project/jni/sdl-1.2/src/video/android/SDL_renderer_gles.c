@@ -116,6 +116,7 @@ static int GLES_RenderFillRects(SDL_Renderer * renderer,
 static int GLES_RenderCopy(SDL_Renderer * renderer, SDL_Texture * texture,
                            const SDL_Rect * srcrect,
                            const SDL_Rect * dstrect);
+static void GLES_RenderFlush(SDL_Renderer * renderer);
 static void GLES_RenderPresent(SDL_Renderer * renderer);
 static void GLES_DestroyTexture(SDL_Renderer * renderer,
                                 SDL_Texture * texture);
@@ -144,6 +145,32 @@ SDL_RenderDriver GL_ES_RenderDriver = {
      0}
 };
 
+/* Copies and filled rects are not drawn immediately, but queued as quads and drawn
+   with one glDrawElements() call per run of quads sharing the same texture and blend state.
+   A quad may join an earlier run, if it does not overlap any quad queued after that run
+   and no run in the other coordinate space was queued in between, so the drawing order
+   of overlapping quads is preserved. */
+#define GLES_BATCH_QUADS_MAX 1024
+#define GLES_BATCH_RUNS_MAX 128
+#define GLES_BATCH_LOOKBACK 8
+
+typedef struct
+{
+    GLfloat x, y;
+    GLfloat u, v;
+    GLubyte color[4];
+} GLES_BatchVertex;
+
+typedef struct
+{
+    SDL_Texture *texture;       /* NULL for filled rects */
+    int blendMode;
+    GLint filter;
+    SDL_bool windowSpace;       /* Coordinates are window pixels, same as glDrawTexiOES() uses */
+    SDL_Rect bounds;            /* Union of all quads in this run */
+    int quads;
+} GLES_BatchRun;
+
 typedef struct
 {
     SDL_GLContext context;
@@ -162,6 +189,13 @@ typedef struct
 #include "SDL_glesfuncs.h"
 #undef SDL_PROC
 
+    GLES_BatchRun batchRuns[GLES_BATCH_RUNS_MAX];
+    int batchRunCount;
+    int batchQuadCount;
+    Uint8 batchQuadRun[GLES_BATCH_QUADS_MAX];
+    GLES_BatchVertex batchVertices[GLES_BATCH_QUADS_MAX * 4];  /* In submission order */
+    GLES_BatchVertex batchStream[GLES_BATCH_QUADS_MAX * 4];    /* Sorted by run, passed to GL */
+    GLushort batchIndices[GLES_BATCH_QUADS_MAX * 6];
 } GLES_RenderData;
 
 typedef struct
@@ -172,6 +206,7 @@ typedef struct
     GLfloat texh;
     GLenum format;
     GLenum formattype;
+    GLint filter;
     void *pixels;
     int pitch;
     SDL_DirtyRectList dirty;
@@ -272,6 +307,7 @@ GLES_CreateRenderer(SDL_Window * window, Uint32 flags)
     renderer->RenderDrawRects = GLES_RenderDrawRects;
     renderer->RenderFillRects = GLES_RenderFillRects;
     renderer->RenderCopy = GLES_RenderCopy;
+    renderer->RenderFlush = GLES_RenderFlush;
     renderer->RenderPresent = GLES_RenderPresent;
     renderer->DestroyTexture = GLES_DestroyTexture;
     renderer->DestroyRenderer = GLES_DestroyRenderer;
@@ -347,6 +383,16 @@ GLES_CreateRenderer(SDL_Window * window, Uint32 flags)
     data->glGetIntegerv(GL_MAX_TEXTURE_SIZE, &value);
     renderer->info.max_texture_height = value;
 
+    for (value = 0; value < GLES_BATCH_QUADS_MAX; ++value) {
+        GLushort *indices = &data->batchIndices[value * 6];
+        indices[0] = value * 4 + 0;
+        indices[1] = value * 4 + 1;
+        indices[2] = value * 4 + 2;
+        indices[3] = value * 4 + 2;
+        indices[4] = value * 4 + 1;
+        indices[5] = value * 4 + 3;
+    }
+
     /* Set up parameters for rendering */
     data->blendMode = -1;
     data->glDisable(GL_DEPTH_TEST);
@@ -363,6 +409,8 @@ GLES_ActivateRenderer(SDL_Renderer * renderer)
     GLES_RenderData *data = (GLES_RenderData *) renderer->driverdata;
     SDL_Window *window = renderer->window;
 
+    GLES_RenderFlush(renderer);
+
     if (SDL_GL_MakeCurrent(window, data->context) < 0) {
         return -1;
     }
@@ -397,6 +445,7 @@ GLES_DisplayModeChanged(SDL_Renderer * renderer)
 {
     GLES_RenderData *data = (GLES_RenderData *) renderer->driverdata;
 
+    GLES_RenderFlush(renderer);
     data->updateSize = SDL_TRUE;
     return 0;
 }
@@ -491,6 +540,7 @@ GLES_CreateTexture(SDL_Renderer * renderer, SDL_Texture * texture)
 
     data->format = format;
     data->formattype = type;
+    data->filter = GL_NEAREST;
     renderdata->glBindTexture(data->type, data->texture);
     renderdata->glTexParameteri(data->type, GL_TEXTURE_MIN_FILTER,
                                 GL_NEAREST);
@@ -540,6 +590,19 @@ GLES_GetTexturePalette(SDL_Renderer * renderer, SDL_Texture * texture,
     return -1;
 }
 
+static SDL_bool
+GLES_BatchUsesTexture(GLES_RenderData * data, SDL_Texture * texture)
+{
+    int i;
+
+    for (i = 0; i < data->batchRunCount; ++i) {
+        if (data->batchRuns[i].texture == texture) {
+            return SDL_TRUE;
+        }
+    }
+    return SDL_FALSE;
+}
+
 static void
 SetupTextureUpdate(GLES_RenderData * renderdata, SDL_Texture * texture,
                    int pitch)
@@ -609,6 +672,10 @@ GLES_UpdateTexture(SDL_Renderer * renderer, SDL_Texture * texture,
     void * temp_ptr;
     int i;
 
+    if (GLES_BatchUsesTexture(renderdata, texture)) {
+        GLES_RenderFlush(renderer);
+    }
+
     renderdata->glGetError();
     renderdata->glEnable(data->type);
     SetupTextureUpdate(renderdata, texture, pitch);
@@ -716,6 +783,182 @@ GLES_SetBlendMode(GLES_RenderData * data, int blendMode, int isprimitive)
     }
 }
 
+static void
+GLES_SetWindowSpace(SDL_Renderer * renderer, SDL_bool enable)
+{
+    GLES_RenderData *data = (GLES_RenderData *) renderer->driverdata;
+    SDL_Window *window = renderer->window;
+
+    /* glDrawTexiOES() ignores the matrices, and the video driver sets its own ones,
+       so copies in that mode are drawn with a plain window pixel projection */
+    if (enable) {
+        data->glMatrixMode(GL_PROJECTION);
+        data->glPushMatrix();
+        data->glLoadIdentity();
+        data->glMatrixMode(GL_MODELVIEW);
+        data->glPushMatrix();
+        data->glLoadIdentity();
+#if SDL_VIDEO_RENDER_RESIZE
+        data->glOrthof(0.0, (GLfloat) window->display->desktop_mode.w,
+                       (GLfloat) window->display->desktop_mode.h, 0.0, 0.0, 1.0);
+#else
+        data->glOrthof(0.0, (GLfloat) window->w, (GLfloat) window->h,
+                       0.0, 0.0, 1.0);
+#endif
+    } else {
+        data->glMatrixMode(GL_PROJECTION);
+        data->glPopMatrix();
+        data->glMatrixMode(GL_MODELVIEW);
+        data->glPopMatrix();
+    }
+}
+
+static void
+GLES_BatchQuad(SDL_Renderer * renderer, SDL_Texture * texture, int blendMode,
+               GLint filter, SDL_bool windowSpace, const SDL_Rect * dstrect,
+               GLfloat minu, GLfloat minv, GLfloat maxu, GLfloat maxv,
+               const GLubyte * color)
+{
+    GLES_RenderData *data = (GLES_RenderData *) renderer->driverdata;
+    GLES_BatchRun *run = NULL;
+    GLES_BatchVertex *vertices;
+    int i;
+
+    if (data->batchQuadCount >= GLES_BATCH_QUADS_MAX ||
+        data->batchRunCount >= GLES_BATCH_RUNS_MAX) {
+        GLES_RenderFlush(renderer);
+    }
+
+    for (i = data->batchRunCount - 1;
+         i >= 0 && i >= data->batchRunCount - GLES_BATCH_LOOKBACK; --i) {
+        GLES_BatchRun *prev = &data->batchRuns[i];
+        /* Bounds in the other coordinate space can't be compared */
+        if (prev->windowSpace != windowSpace) {
+            break;
+        }
+        if (prev->texture == texture && prev->blendMode == blendMode &&
+            prev->filter == filter) {
+            run = prev;
+            break;
+        }
+        if (SDL_HasIntersection(&prev->bounds, dstrect)) {
+            break;
+        }
+    }
+    if (run) {
+        SDL_UnionRect(&run->bounds, dstrect, &run->bounds);
+    } else {
+        i = data->batchRunCount++;
+        run = &data->batchRuns[i];
+        run->texture = texture;
+        run->blendMode = blendMode;
+        run->filter = filter;
+        run->windowSpace = windowSpace;
+        run->bounds = *dstrect;
+        run->quads = 0;
+    }
+    run->quads++;
+    data->batchQuadRun[data->batchQuadCount] = i;
+
+    vertices = &data->batchVertices[data->batchQuadCount * 4];
+    data->batchQuadCount++;
+
+    vertices[0].x = vertices[2].x = (GLfloat) dstrect->x;
+    vertices[1].x = vertices[3].x = (GLfloat) (dstrect->x + dstrect->w);
+    vertices[0].y = vertices[1].y = (GLfloat) dstrect->y;
+    vertices[2].y = vertices[3].y = (GLfloat) (dstrect->y + dstrect->h);
+    vertices[0].u = vertices[2].u = minu;
+    vertices[1].u = vertices[3].u = maxu;
+    vertices[0].v = vertices[1].v = minv;
+    vertices[2].v = vertices[3].v = maxv;
+    for (i = 0; i < 4; ++i) {
+        SDL_memcpy(vertices[i].color, color, 4);
+    }
+}
+
+static void
+GLES_RenderFlush(SDL_Renderer * renderer)
+{
+    GLES_RenderData *data = (GLES_RenderData *) renderer->driverdata;
+    GLES_BatchVertex *stream = data->batchStream;
+    int runStart[GLES_BATCH_RUNS_MAX];
+    SDL_bool textured = SDL_FALSE;
+    SDL_bool windowSpace = SDL_FALSE;
+    int i, first;
+
+    if (!data->batchQuadCount) {
+        return;
+    }
+
+    /* Make each run contiguous, quads keep their submission order inside a run */
+    for (i = 0, first = 0; i < data->batchRunCount; ++i) {
+        runStart[i] = first;
+        first += data->batchRuns[i].quads;
+    }
+    for (i = 0; i < data->batchQuadCount; ++i) {
+        SDL_memcpy(&stream[runStart[data->batchQuadRun[i]]++ * 4],
+                   &data->batchVertices[i * 4], sizeof(GLES_BatchVertex) * 4);
+    }
+
+    data->glVertexPointer(2, GL_FLOAT, sizeof(GLES_BatchVertex), &stream[0].x);
+    data->glTexCoordPointer(2, GL_FLOAT, sizeof(GLES_BatchVertex), &stream[0].u);
+    data->glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(GLES_BatchVertex), stream[0].color);
+    data->glEnableClientState(GL_VERTEX_ARRAY);
+    data->glEnableClientState(GL_COLOR_ARRAY);
+
+    for (i = 0, first = 0; i < data->batchRunCount; ++i) {
+        GLES_BatchRun *run = &data->batchRuns[i];
+
+        if (run->texture) {
+            GLES_TextureData *texturedata = (GLES_TextureData *) run->texture->driverdata;
+            if (!textured) {
+                data->glEnable(GL_TEXTURE_2D);
+                data->glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+                textured = SDL_TRUE;
+            }
+            data->glBindTexture(texturedata->type, texturedata->texture);
+            if (texturedata->filter != run->filter) {
+                data->glTexParameteri(texturedata->type, GL_TEXTURE_MIN_FILTER,
+                                      run->filter);
+                data->glTexParameteri(texturedata->type, GL_TEXTURE_MAG_FILTER,
+                                      run->filter);
+                texturedata->filter = run->filter;
+            }
+            GLES_SetBlendMode(data, run->blendMode, 0);
+        } else {
+            if (textured) {
+                data->glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+                data->glDisable(GL_TEXTURE_2D);
+                textured = SDL_FALSE;
+            }
+            GLES_SetBlendMode(data, run->blendMode, 1);
+        }
+        if (run->windowSpace != windowSpace) {
+            windowSpace = run->windowSpace;
+            GLES_SetWindowSpace(renderer, windowSpace);
+        }
+
+        data->glDrawElements(GL_TRIANGLES, run->quads * 6, GL_UNSIGNED_SHORT,
+                             &data->batchIndices[first * 6]);
+        first += run->quads;
+    }
+
+    if (windowSpace) {
+        GLES_SetWindowSpace(renderer, SDL_FALSE);
+    }
+    if (textured) {
+        data->glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+        data->glDisable(GL_TEXTURE_2D);
+    }
+    data->glDisableClientState(GL_COLOR_ARRAY);
+    data->glDisableClientState(GL_VERTEX_ARRAY);
+    /* Current color is undefined after drawing with color array */
+    data->glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+
+    data->batchQuadCount = 0;
+    data->batchRunCount = 0;
+}
+
 static int
 GLES_RenderDrawPoints(SDL_Renderer * renderer, const SDL_Point * points,
                       int count)
@@ -724,6 +967,8 @@ GLES_RenderDrawPoints(SDL_Renderer * renderer, const SDL_Point * points,
     int i;
     GLshort *vertices;
 
+    GLES_RenderFlush(renderer);
+
     GLES_SetBlendMode(data, renderer->blendMode, 1);
 
     data->glColor4f((GLfloat) renderer->r * inv255f,
@@ -753,6 +998,8 @@ GLES_RenderDrawLines(SDL_Renderer * renderer, const SDL_Point * points,
     int i;
     GLshort *vertices;
 
+    GLES_RenderFlush(renderer);
+
     GLES_SetBlendMode(data, renderer->blendMode, 1);
 
     data->glColor4f((GLfloat) renderer->r * inv255f,
@@ -788,6 +1035,8 @@ GLES_RenderDrawRects(SDL_Renderer * renderer, const SDL_Rect ** rects,
     GLES_RenderData *data = (GLES_RenderData *) renderer->driverdata;
     int i;
 
+    GLES_RenderFlush(renderer);
+
     GLES_SetBlendMode(data, renderer->blendMode, 1);
 
     data->glColor4f((GLfloat) renderer->r * inv255f,
@@ -824,37 +1073,22 @@ static int
 GLES_RenderFillRects(SDL_Renderer * renderer, const SDL_Rect ** rects,
                      int count)
 {
-    GLES_RenderData *data = (GLES_RenderData *) renderer->driverdata;
+    int blendMode = renderer->blendMode;
+    GLubyte color[4];
     int i;
 
-    GLES_SetBlendMode(data, renderer->blendMode, 1);
-
-    data->glColor4f((GLfloat) renderer->r * inv255f,
-                    (GLfloat) renderer->g * inv255f,
-                    (GLfloat) renderer->b * inv255f,
-                    (GLfloat) renderer->a * inv255f);
+    if (blendMode == SDL_BLENDMODE_MASK) {
+        blendMode = SDL_BLENDMODE_NONE;
+    }
+    color[0] = renderer->r;
+    color[1] = renderer->g;
+    color[2] = renderer->b;
+    color[3] = renderer->a;
 
-    data->glEnableClientState(GL_VERTEX_ARRAY);
     for (i = 0; i < count; ++i) {
-        const SDL_Rect *rect = rects[i];
-        GLshort minx = rect->x;
-        GLshort maxx = rect->x + rect->w;
-        GLshort miny = rect->y;
-        GLshort maxy = rect->y + rect->h;
-        GLshort vertices[8];
-        vertices[0] = minx;
-        vertices[1] = miny;
-        vertices[2] = maxx;
-        vertices[3] = miny;
-        vertices[4] = minx;
-        vertices[5] = maxy;
-        vertices[6] = maxx;
-        vertices[7] = maxy;
-
-        data->glVertexPointer(2, GL_SHORT, 0, vertices);
-        data->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        GLES_BatchQuad(renderer, NULL, blendMode, GL_NEAREST, SDL_FALSE,
+                       rects[i], 0.0f, 0.0f, 0.0f, 0.0f, color);
     }
-    data->glDisableClientState(GL_VERTEX_ARRAY);
 
     return 0;
 }
@@ -866,20 +1100,24 @@ GLES_RenderCopy(SDL_Renderer * renderer, SDL_Texture * texture,
 
     GLES_RenderData *data = (GLES_RenderData *) renderer->driverdata;
     GLES_TextureData *texturedata = (GLES_TextureData *) texture->driverdata;
-    int minx, miny, maxx, maxy;
     GLfloat minu, maxu, minv, maxv;
+    GLubyte color[4];
+    GLint filter;
     int i;
     void *temp_buffer;          /* used for reformatting dirty rect pixels */
     void *temp_ptr;
 
-    data->glEnable(GL_TEXTURE_2D);
-
     if (texturedata->dirty.list) {
         SDL_DirtyRect *dirty;
         void *pixels;
         int bpp = SDL_BYTESPERPIXEL(texture->format);
         int pitch = texturedata->pitch;
 
+        if (GLES_BatchUsesTexture(data, texture)) {
+            GLES_RenderFlush(renderer);
+        }
+
+        data->glEnable(GL_TEXTURE_2D);
         SetupTextureUpdate(data, texture, pitch);
 
         data->glBindTexture(texturedata->type, texturedata->texture);
@@ -915,103 +1153,41 @@ GLES_RenderCopy(SDL_Renderer * renderer, SDL_Texture * texture,
             }
         }
         SDL_ClearDirtyRects(&texturedata->dirty);
+        data->glDisable(GL_TEXTURE_2D);
     }
 
-    data->glBindTexture(texturedata->type, texturedata->texture);
-
     if (texture->modMode) {
-        data->glColor4f((GLfloat) texture->r * inv255f,
-                        (GLfloat) texture->g * inv255f,
-                        (GLfloat) texture->b * inv255f,
-                        (GLfloat) texture->a * inv255f);
+        color[0] = texture->r;
+        color[1] = texture->g;
+        color[2] = texture->b;
+        color[3] = texture->a;
     } else {
-        data->glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+        color[0] = color[1] = color[2] = color[3] = 255;
     }
 
-    GLES_SetBlendMode(data, texture->blendMode, 0);
-
     switch (texture->scaleMode) {
-    case SDL_SCALEMODE_NONE:
-    case SDL_SCALEMODE_FAST:
-        data->glTexParameteri(texturedata->type, GL_TEXTURE_MIN_FILTER,
-                              GL_NEAREST);
-        data->glTexParameteri(texturedata->type, GL_TEXTURE_MAG_FILTER,
-                              GL_NEAREST);
-        break;
     case SDL_SCALEMODE_SLOW:
     case SDL_SCALEMODE_BEST:
-        data->glTexParameteri(texturedata->type, GL_TEXTURE_MIN_FILTER,
-                              GL_LINEAR);
-        data->glTexParameteri(texturedata->type, GL_TEXTURE_MAG_FILTER,
-                              GL_LINEAR);
+        filter = GL_LINEAR;
+        break;
+    default:
+        filter = GL_NEAREST;
         break;
     }
 
-    if (data->GL_OES_draw_texture_supported && data->useDrawTexture) {
-        /* this code is a little funny because the viewport is upside down vs SDL's coordinate system */
-        SDL_Window *window = renderer->window;
-        GLint cropRect[4];
-        cropRect[0] = srcrect->x;
-        cropRect[1] = srcrect->y + srcrect->h;
-        cropRect[2] = srcrect->w;
-        cropRect[3] = -srcrect->h;
-        data->glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_CROP_RECT_OES,
-                               cropRect);
-        //__android_log_print(ANDROID_LOG_INFO, "libSDL", "GLES_RenderCopy glDrawTexiOES(%d, %d, %d, %d) cropRect %d:%d:%d:%d", dstrect->x, window->display->desktop_mode.h - dstrect->y - dstrect->h, dstrect->w, dstrect->h, cropRect[0], cropRect[1], cropRect[2], cropRect[3]);
-        data->glDrawTexiOES(dstrect->x,
-#if SDL_VIDEO_RENDER_RESIZE
-                            window->display->desktop_mode.h - dstrect->y - dstrect->h,
-#else
-                            window->h - dstrect->y - dstrect->h,
-#endif
-                            0, dstrect->w, dstrect->h);
-    } else {
-
-        minx = dstrect->x;
-        miny = dstrect->y;
-        maxx = dstrect->x + dstrect->w;
-        maxy = dstrect->y + dstrect->h;
+    minu = (GLfloat) srcrect->x / texture->w;
+    minu *= texturedata->texw;
+    maxu = (GLfloat) (srcrect->x + srcrect->w) / texture->w;
+    maxu *= texturedata->texw;
+    minv = (GLfloat) srcrect->y / texture->h;
+    minv *= texturedata->texh;
+    maxv = (GLfloat) (srcrect->y + srcrect->h) / texture->h;
+    maxv *= texturedata->texh;
 
-        minu = (GLfloat) srcrect->x / texture->w;
-        minu *= texturedata->texw;
-        maxu = (GLfloat) (srcrect->x + srcrect->w) / texture->w;
-        maxu *= texturedata->texw;
-        minv = (GLfloat) srcrect->y / texture->h;
-        minv *= texturedata->texh;
-        maxv = (GLfloat) (srcrect->y + srcrect->h) / texture->h;
-        maxv *= texturedata->texh;
-
-        GLshort vertices[8];
-        GLfloat texCoords[8];
-
-        vertices[0] = minx;
-        vertices[1] = miny;
-        vertices[2] = maxx;
-        vertices[3] = miny;
-        vertices[4] = minx;
-        vertices[5] = maxy;
-        vertices[6] = maxx;
-        vertices[7] = maxy;
-
-        texCoords[0] = minu;
-        texCoords[1] = minv;
-        texCoords[2] = maxu;
-        texCoords[3] = minv;
-        texCoords[4] = minu;
-        texCoords[5] = maxv;
-        texCoords[6] = maxu;
-        texCoords[7] = maxv;
-
-        data->glVertexPointer(2, GL_SHORT, 0, vertices);
-        data->glEnableClientState(GL_VERTEX_ARRAY);
-        data->glTexCoordPointer(2, GL_FLOAT, 0, texCoords);
-        data->glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-        data->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-        data->glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-        data->glDisableClientState(GL_VERTEX_ARRAY);
-    }
-
-    data->glDisable(GL_TEXTURE_2D);
+    /* Quads replace glDrawTexiOES(), which cannot be batched, but they keep its coordinate system */
+    GLES_BatchQuad(renderer, texture, texture->blendMode, filter,
+                   data->GL_OES_draw_texture_supported && data->useDrawTexture,
+                   dstrect, minu, minv, maxu, maxv, color);
 
     return 0;
 }
@@ -1019,6 +1195,7 @@ GLES_RenderCopy(SDL_Renderer * renderer, SDL_Texture * texture,
 static void
 GLES_RenderPresent(SDL_Renderer * renderer)
 {
+    GLES_RenderFlush(renderer);
     SDL_GL_SwapWindow(renderer->window);
 }
 
@@ -1030,6 +1207,9 @@ GLES_DestroyTexture(SDL_Renderer * renderer, SDL_Texture * texture)
     if (!data) {
         return;
     }
+    if (GLES_BatchUsesTexture((GLES_RenderData *) renderer->driverdata, texture)) {
+        GLES_RenderFlush(renderer);
+    }
     if (data->texture) {
         glDeleteTextures(1, &data->texture);
     }
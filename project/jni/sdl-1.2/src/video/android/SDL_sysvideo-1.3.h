@@ -118,6 +118,7 @@ struct SDL_Renderer
                              Uint32 format, void * pixels, int pitch);
     int (*RenderWritePixels) (SDL_Renderer * renderer, const SDL_Rect * rect,
                               Uint32 format, const void * pixels, int pitch);
+    void (*RenderFlush) (SDL_Renderer * renderer);
     void (*RenderPresent) (SDL_Renderer * renderer);
     void (*DestroyTexture) (SDL_Renderer * renderer, SDL_Texture * texture);
 
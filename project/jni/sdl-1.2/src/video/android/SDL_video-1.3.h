@@ -1268,6 +1268,14 @@ extern DECLSPEC int SDLCALL SDL_RenderWritePixels(const SDL_Rect * rect,
                                                   const void *pixels,
                                                   int pitch);
 
+/**
+ *  \brief Force the rendering commands queued by the renderer to be sent to the GPU.
+ *
+ *  Call this before drawing with OpenGL directly, or reading back the screen,
+ *  because the renderer may batch SDL_RenderCopy() and SDL_RenderFillRect() calls.
+ */
+extern DECLSPEC void SDLCALL SDL_RenderFlush(void);
+
 /**
  *  \brief Update the screen with rendering performed.
  */
@@ -2942,6 +2942,20 @@ SDL_RenderWritePixels(const SDL_Rect * rect, Uint32 format,
                                        format, pixels, pitch);
 }
 
+void
+SDL_RenderFlush(void)
+{
+    SDL_Renderer *renderer;
+
+    if (!_this || !SDL_CurrentRenderer) {
+        return;
+    }
+    renderer = SDL_CurrentRenderer;
+    if (renderer->RenderFlush) {
+        renderer->RenderFlush(renderer);
+    }
+}
+
 void
 SDL_RenderPresent(void)
 {
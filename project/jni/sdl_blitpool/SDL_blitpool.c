@@ -99,6 +99,8 @@ typedef struct BlitEntry_tag {
 		int optimize;
 	} flag;
 	
+	int order;							/*	Post order (divided entries inherit it), for RemoveOverlapArea	*/
+	
 } BlitEntry;
 
 
@@ -113,6 +115,11 @@ struct BlitPool_tag {		/*	typedefed BlitPool in SDL_BlitPool.h	*/
 	allocator_func allocator;
 	releaser_func releaser;
 	
+	int num_thread;					/*	BlitPool_SetThreads	*/
+	int num_worker;
+	struct BandWorker_tag *worker;
+	SDL_sem *band_done;
+	
 	struct {
 		int converted_to_destrect;
 	} flag;
@@ -120,6 +127,63 @@ struct BlitPool_tag {		/*	typedefed BlitPool in SDL_BlitPool.h	*/
 
 
 
+typedef struct BandWorker_tag {
+	/*
+	//	Executes the entries clipped to a band [y0, y1) of the destination.
+	*/
+	
+	BlitPool *pool;
+	SDL_Thread *thread;
+	SDL_sem *start;
+	
+	Sint32 y0, y1;
+	int quit;
+	
+} BandWorker;
+
+
+
+typedef struct {
+	int order;							/*	BlitEntry order at the grid building	*/
+	BlitPool_BoundingBox destbox;
+} OverlapFront;
+
+
+typedef struct {
+	/*
+	//	Uniform grid of the opaque entries, for RemoveOverlapArea.
+	//	cell (cx, cy) = [x0 + (cx << shift), x0 + ((cx + 1) << shift)) x [y0 + (cy << shift), ...)
+	*/
+	
+	Sint32 x0, y0;
+	int shift;
+	int cols, rows;
+	
+	OverlapFront *front;
+	int num_front;
+	
+	int *cell_start;					/*	cols * rows + 1, offset in cell_item	*/
+	int *cell_item;						/*	index of front	*/
+	
+	int *stamp;							/*	last query_id per front, for the duplicated items	*/
+	int query_id;
+	
+	int *candidate;						/*	query result: index of front, sorted by order	*/
+	
+} OverlapGrid;
+
+
+
+/*	cell size = 1 << shift, grid is at most OVERLAP_GRID_MAX_CELLS x OVERLAP_GRID_MAX_CELLS	*/
+#define OVERLAP_GRID_MIN_SHIFT	4
+#define OVERLAP_GRID_MAX_CELLS	64
+
+/*	BlitPool_SetThreads	*/
+#define BLITPOOL_MAX_THREAD		8
+#define BAND_MIN_HEIGHT			16
+
+
+
 
 
 static void *DefaultAllocator(unsigned long nbyte);
@@ -133,6 +197,20 @@ static void ConvertBBoxToRect(BlitPool *pool);
 static int RemoveOverlapArea(BlitPool *pool);
 static int RemoveOutsideEntry(BlitPool *pool);
 
+static int BuildOverlapGrid(BlitPool *pool, OverlapGrid *grid);
+static int QueryOverlapGrid(OverlapGrid *grid, BlitEntry *back);
+static void FreeOverlapGrid(OverlapGrid *grid);
+static int CompareIndex(const void *a, const void *b);
+
+static int CanExecuteInBands(BlitPool *pool);
+static int StartBandWorkers(BlitPool *pool);
+static void StopBandWorkers(BlitPool *pool);
+static int SDLCALL BandWorkerMain(void *data);
+static void ExecuteInBands(BlitPool *pool);
+static void ExecuteBand(BlitPool *pool, Sint32 y0, Sint32 y1);
+static void ExecuteSurfaceInBand(SDL_Surface *dest, BlitEntry *p, SDL_Rect *clip);
+static void ExecuteFillInBand(SDL_Surface *dest, BlitEntry *p, SDL_Rect *clip);
+
 
 
 static void AddEntryToTail(BlitPool *pool, BlitEntry *entry);
@@ -170,6 +248,10 @@ BlitPool *BlitPool_CreatePool(Optional SDL_Surface *destsurf)
 	p->flag.converted_to_destrect = 0;
 	p->allocator = DefaultAllocator;
 	p->releaser = DefaultReleaser;
+	p->num_thread = 1;
+	p->num_worker = 0;
+	p->worker = NULL;
+	p->band_done = NULL;
 	
 	return p;
 }
@@ -198,6 +280,7 @@ void BlitPool_DeletePool(BlitPool *pool)
 	assert(pool != NULL);
 	
 	BlitPool_ReleaseEntry(pool);
+	StopBandWorkers(pool);
 	
 	free(pool);
 }
@@ -565,6 +648,12 @@ void BlitPool_Execute(BlitPool *pool)
 	ConvertBBoxToRect(pool);
 	
 	
+	if (pool->num_thread > 1 && CanExecuteInBands(pool) && StartBandWorkers(pool) == 0) {
+		ExecuteInBands(pool);
+		return;
+	}
+	
+	
 	for (p = pool->head; p != NULL; p = p->next) {
 		
 		/*
@@ -603,6 +692,397 @@ void BlitPool_Execute(BlitPool *pool)
 
 
 
+void BlitPool_SetThreads(BlitPool *pool, int num_thread)
+/*
+//	BlitPool_Execute divides the destination into num_thread horizontal bands,
+//	and executes them in parallel. num_thread <= 1 is serial (default).
+*/
+{
+	assert(pool != NULL);
+	
+	StopBandWorkers(pool);		/*	started again by next BlitPool_Execute	*/
+	
+	if (num_thread > BLITPOOL_MAX_THREAD) {
+		num_thread = BLITPOOL_MAX_THREAD;
+	}
+	
+	pool->num_thread = (num_thread > 1) ? num_thread : 1;
+}
+
+
+
+
+static int CanExecuteInBands(BlitPool *pool)
+/*
+//	Check the surfaces can be blitted from the worker threads.
+//	Must not lock (hardware, RLE, offset), SDL_LockSurface is not thread safe.
+*/
+{
+	BlitEntry *p;
+	SDL_Surface *dest;
+	SDL_Rect emptyrect;
+	
+	
+	dest = pool->destsurf;
+	
+	if ((dest->flags & SDL_HWSURFACE) || SDL_MUSTLOCK(dest)) {
+		return 0;
+	}
+	
+	if (dest->clip_rect.h < BAND_MIN_HEIGHT * 2) {
+		return 0;
+	}
+	
+	emptyrect.x = emptyrect.y = 0;
+	emptyrect.w = emptyrect.h = 0;
+	
+	for (p = pool->head; p != NULL; p = p->next) {
+		
+		if (p->type != BLIT_TYPE_SURFACE) {
+			continue;
+		}
+		
+		if (p->srcsurf->flags & SDL_HWSURFACE) {
+			return 0;
+		}
+		
+		/*
+		//	SDL_LowerBlit remaps the source when the destination changed,
+		//	do it here with empty rect (blit nothing), not in the workers.
+		//	Mapping may turn on RLE, so check MUSTLOCK after it.
+		*/
+		if (SDL_LowerBlit(p->srcsurf, &emptyrect, dest, &emptyrect) < 0) {
+			return 0;
+		}
+		
+		if (SDL_MUSTLOCK(p->srcsurf)) {
+			return 0;
+		}
+	}
+	
+	return 1;
+}
+
+
+
+
+static int StartBandWorkers(BlitPool *pool)
+/*
+//	If return not 0 then fail, and the pool falls back to serial.
+*/
+{
+	BandWorker *w;
+	int n;
+	
+	
+	if (pool->worker != NULL) {
+		return 0;
+	}
+	
+	n = pool->num_thread - 1;
+	
+	pool->band_done = SDL_CreateSemaphore(0);
+	pool->worker = (BandWorker *)calloc(n, sizeof(BandWorker));
+	
+	if (pool->band_done == NULL || pool->worker == NULL) {
+		goto fail;
+	}
+	
+	for (pool->num_worker = 0; pool->num_worker < n; pool->num_worker++) {
+		
+		w = &pool->worker[pool->num_worker];
+		w->pool = pool;
+		w->quit = 0;
+		
+		w->start = SDL_CreateSemaphore(0);
+		if (w->start == NULL) {
+			goto fail;
+		}
+		
+		w->thread = SDL_CreateThread(BandWorkerMain, w);
+		if (w->thread == NULL) {
+			SDL_DestroySemaphore(w->start);
+			goto fail;
+		}
+	}
+	
+	return 0;
+	
+fail:
+	StopBandWorkers(pool);
+	pool->num_thread = 1;
+	return 1;
+}
+
+
+
+
+static void StopBandWorkers(BlitPool *pool)
+{
+	BandWorker *w;
+	int i;
+	
+	
+	for (i = 0; i < pool->num_worker; i++) {
+		
+		w = &pool->worker[i];
+		w->quit = 1;
+		SDL_SemPost(w->start);
+		SDL_WaitThread(w->thread, NULL);
+		SDL_DestroySemaphore(w->start);
+	}
+	
+	pool->num_worker = 0;
+	
+	free(pool->worker);
+	pool->worker = NULL;
+	
+	if (pool->band_done != NULL) {
+		SDL_DestroySemaphore(pool->band_done);
+		pool->band_done = NULL;
+	}
+}
+
+
+
+
+static int SDLCALL BandWorkerMain(void *data)
+{
+	BandWorker *w;
+	
+	
+	w = (BandWorker *)data;
+	
+	for (;;) {
+		
+		SDL_SemWait(w->start);
+		
+		if (w->quit) {
+			break;
+		}
+		
+		ExecuteBand(w->pool, w->y0, w->y1);
+		
+		SDL_SemPost(w->pool->band_done);
+	}
+	
+	return 0;
+}
+
+
+
+
+static void ExecuteInBands(BlitPool *pool)
+/*
+//	Band i is executed by worker i, the last band by the calling thread.
+//	Every band walks the whole list in order, so the overlap order is kept.
+*/
+{
+	Sint32 y0, h;
+	int i, num_band;
+	
+	
+	y0 = pool->destsurf->clip_rect.y;
+	h = pool->destsurf->clip_rect.h;
+	
+	num_band = pool->num_worker + 1;
+	if (h / num_band < BAND_MIN_HEIGHT) {
+		num_band = h / BAND_MIN_HEIGHT;
+	}
+	
+	assert(num_band >= 2);
+	
+	for (i = 0; i < num_band - 1; i++) {
+		pool->worker[i].y0 = y0 + h * i / num_band;
+		pool->worker[i].y1 = y0 + h * (i + 1) / num_band;
+		SDL_SemPost(pool->worker[i].start);
+	}
+	
+	ExecuteBand(pool, y0 + h * (num_band - 1) / num_band, y0 + h);
+	
+	for (i = 0; i < num_band - 1; i++) {
+		SDL_SemWait(pool->band_done);
+	}
+}
+
+
+
+
+static void ExecuteBand(BlitPool *pool, Sint32 y0, Sint32 y1)
+{
+	BlitEntry *p;
+	SDL_Rect clip;
+	
+	
+	clip = pool->destsurf->clip_rect;
+	clip.y = y0;
+	clip.h = y1 - y0;
+	
+	for (p = pool->head; p != NULL; p = p->next) {
+		
+		switch (p->type) {
+		
+		case BLIT_TYPE_SURFACE:
+			ExecuteSurfaceInBand(pool->destsurf, p, &clip);
+			break;
+		
+		case BLIT_TYPE_COLORFILL:
+			ExecuteFillInBand(pool->destsurf, p, &clip);
+			break;
+		
+		case BLIT_TYPE_EMPTY:
+			break;
+			
+			IF_DEBUG(default: assert(0));
+		}
+	}
+}
+
+
+
+
+static void ExecuteSurfaceInBand(SDL_Surface *dest, BlitEntry *p, SDL_Rect *clip)
+/*
+//	Same clipping as SDL_UpperBlit, with the band as clip rect.
+*/
+{
+	SDL_Surface *src;
+	SDL_Rect sr, dr;
+	Sint32 sx, sy, dx, dy, w, h, d;
+	
+	
+	src = p->srcsurf;
+	
+	sx = p->srcrect.x;
+	sy = p->srcrect.y;
+	w = p->srcrect.w;
+	h = p->srcrect.h;
+	dx = p->destrect.x;
+	dy = p->destrect.y;
+	
+	/*	clip the source surface	*/
+	if (sx < 0) {
+		w += sx;
+		dx -= sx;
+		sx = 0;
+	}
+	if (sx + w > src->w) {
+		w = src->w - sx;
+	}
+	
+	if (sy < 0) {
+		h += sy;
+		dy -= sy;
+		sy = 0;
+	}
+	if (sy + h > src->h) {
+		h = src->h - sy;
+	}
+	
+	/*	clip the band	*/
+	if ((d = clip->x - dx) > 0) {
+		w -= d;
+		sx += d;
+		dx = clip->x;
+	}
+	if ((d = dx + w - (clip->x + clip->w)) > 0) {
+		w -= d;
+	}
+	
+	if ((d = clip->y - dy) > 0) {
+		h -= d;
+		sy += d;
+		dy = clip->y;
+	}
+	if ((d = dy + h - (clip->y + clip->h)) > 0) {
+		h -= d;
+	}
+	
+	if (w <= 0 || h <= 0) {
+		return;
+	}
+	
+	sr.x = sx;
+	sr.y = sy;
+	sr.w = dr.w = w;
+	sr.h = dr.h = h;
+	dr.x = dx;
+	dr.y = dy;
+	
+	SDL_LowerBlit(src, &sr, dest, &dr);
+}
+
+
+
+
+static void ExecuteFillInBand(SDL_Surface *dest, BlitEntry *p, SDL_Rect *clip)
+/*
+//	SDL_FillRect locks the surface always, so fill by oneself.
+*/
+{
+	Sint32 x0, y0, x1, y1, x, y, w;
+	Uint8 *row;
+	Uint32 color;
+	
+	
+	x0 = p->destrect.x;
+	y0 = p->destrect.y;
+	x1 = x0 + p->destrect.w;
+	y1 = y0 + p->destrect.h;
+	
+	if (x0 < clip->x) x0 = clip->x;
+	if (y0 < clip->y) y0 = clip->y;
+	if (x1 > clip->x + clip->w) x1 = clip->x + clip->w;
+	if (y1 > clip->y + clip->h) y1 = clip->y + clip->h;
+	
+	if (x1 <= x0 || y1 <= y0) {
+		return;
+	}
+	
+	w = x1 - x0;
+	color = p->color;
+	row = (Uint8 *)dest->pixels + y0 * dest->pitch + x0 * dest->format->BytesPerPixel;
+	
+	for (y = y0; y < y1; y++, row += dest->pitch) {
+		
+		switch (dest->format->BytesPerPixel) {
+		
+		case 1:
+			SDL_memset(row, color, w);
+			break;
+		
+		case 2:
+			for (x = 0; x < w; x++) {
+				((Uint16 *)row)[x] = (Uint16)color;
+			}
+			break;
+		
+		case 3:
+			for (x = 0; x < w * 3; x += 3) {
+				#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+				row[x + 0] = (Uint8)(color);
+				row[x + 1] = (Uint8)(color >> 8);
+				row[x + 2] = (Uint8)(color >> 16);
+				#else
+				row[x + 0] = (Uint8)(color >> 16);
+				row[x + 1] = (Uint8)(color >> 8);
+				row[x + 2] = (Uint8)(color);
+				#endif
+			}
+			break;
+		
+		case 4:
+			for (x = 0; x < w; x++) {
+				((Uint32 *)row)[x] = color;
+			}
+			break;
+		}
+	}
+}
+
+
+
+
 void BlitPool_Optimize(BlitPool *pool, BlitOptimizeFlag flag)
 /*
 //	Apply optimizations.
@@ -764,7 +1244,10 @@ static int RemoveOverlapArea(BlitPool *pool)
 	SDL_Rect srcrect;
 	BlitPool_BoundingBox destbox;
 	BlitEntry *new_entry;
-	BlitEntry *front, *back, *back_next;
+	BlitEntry *back, *back_next;
+	OverlapFront *front;
+	OverlapGrid grid;
+	int num_candidate, i;
 	int is_overlapped;
 	int divided;
 	
@@ -772,6 +1255,15 @@ static int RemoveOverlapArea(BlitPool *pool)
 	assert(pool != NULL);
 	
 	
+	/*
+	//	The front entries (opaque, optimizable) are registered to the grid,
+	//	and a back checks only the fronts in the cells it touches.
+	//	The fronts later than the back in the list, have greater order.
+	*/
+	if (BuildOverlapGrid(pool, &grid)) {
+		return 1;
+	}
+	
 	for (back = pool->head; back != NULL; back = back_next) {
 		
 		back_next = back->next;
@@ -781,15 +1273,13 @@ static int RemoveOverlapArea(BlitPool *pool)
 			continue;
 		}
 		
-		for (front = back->next; front != NULL; front = front->next) {
+		num_candidate = QueryOverlapGrid(&grid, back);
+		
+		for (i = 0; i < num_candidate; i++) {
 			
-			assert(back != front);
+			front = &grid.front[grid.candidate[i]];
 			
-			if (front->flag.optimize == BLIT_EXEC_NO_OPTIMIZE |		/*	skip no optimization entry	*/
-				front->trans == BLIT_ALPHA_TRANSPARENT				/*	skip transparent surface	*/
-			) {
-				continue;
-			}
+			assert(front->order > back->order);
 			
 			assert((back->destbox.x1 - back->destbox.x0) > 0);
 			assert((back->destbox.y1 - back->destbox.y0) > 0);
@@ -830,7 +1320,7 @@ static int RemoveOverlapArea(BlitPool *pool)
 					;											\
 				} else {										\
 					new_entry = DuplicateBlitEntry(pool, back);	\
-					IF_ALLOC_FAIL(if (new_entry == NULL) return 1);\
+					IF_ALLOC_FAIL(if (new_entry == NULL) { FreeOverlapGrid(&grid); return 1; });\
 					AddEntryToNext(pool, back, new_entry);		\
 					new_entry->srcrect.x = srcrect.x;			\
 					new_entry->srcrect.y = srcrect.y;			\
@@ -1247,8 +1737,6 @@ static int RemoveOverlapArea(BlitPool *pool)
 				IF_DEBUG(default: assert(0 && "FATAL: in RemoveOverlapArea"));
 			}
 			
-			assert(back != front);
-			
 			DeleteEntry(pool, back);
 			
 			if (divided) {
@@ -1261,6 +1749,8 @@ static int RemoveOverlapArea(BlitPool *pool)
 		}
 	}
 	
+	FreeOverlapGrid(&grid);
+	
 	return 0;
 	
 	#undef AddNewEntryBegin
@@ -1270,6 +1760,212 @@ static int RemoveOverlapArea(BlitPool *pool)
 
 
 
+static int BuildOverlapGrid(BlitPool *pool, OverlapGrid *grid)
+/*
+//	Number the entries, and register the front entries to the grid.
+//	If return not 0 then allocation failed.
+*/
+{
+	BlitEntry *p;
+	OverlapFront *f;
+	Sint32 x1, y1;
+	int order, num_cell, num_item;
+	int cx, cy, cx0, cy0, cx1, cy1, c, i;
+	
+	
+	SDL_memset(grid, 0, sizeof(*grid));
+	
+	x1 = y1 = 0;
+	order = 0;
+	
+	for (p = pool->head; p != NULL; p = p->next) {
+		
+		p->order = order++;
+		
+		if (p->flag.optimize == BLIT_EXEC_NO_OPTIMIZE |		/*	skip no optimization entry	*/
+			p->trans == BLIT_ALPHA_TRANSPARENT				/*	skip transparent surface	*/
+		) {
+			continue;
+		}
+		
+		if (grid->num_front == 0 || p->destbox.x0 < grid->x0) grid->x0 = p->destbox.x0;
+		if (grid->num_front == 0 || p->destbox.y0 < grid->y0) grid->y0 = p->destbox.y0;
+		if (grid->num_front == 0 || p->destbox.x1 > x1) x1 = p->destbox.x1;
+		if (grid->num_front == 0 || p->destbox.y1 > y1) y1 = p->destbox.y1;
+		
+		grid->num_front += 1;
+	}
+	
+	if (grid->num_front == 0) {
+		return 0;
+	}
+	
+	grid->shift = OVERLAP_GRID_MIN_SHIFT;
+	while (((x1 - grid->x0) >> grid->shift) >= OVERLAP_GRID_MAX_CELLS ||
+		((y1 - grid->y0) >> grid->shift) >= OVERLAP_GRID_MAX_CELLS
+	) {
+		grid->shift += 1;
+	}
+	
+	grid->cols = ((x1 - 1 - grid->x0) >> grid->shift) + 1;
+	grid->rows = ((y1 - 1 - grid->y0) >> grid->shift) + 1;
+	num_cell = grid->cols * grid->rows;
+	
+	grid->front = (OverlapFront *)malloc(grid->num_front * sizeof(OverlapFront));
+	grid->cell_start = (int *)calloc(num_cell + 1, sizeof(int));
+	grid->stamp = (int *)calloc(grid->num_front, sizeof(int));
+	grid->candidate = (int *)malloc(grid->num_front * sizeof(int));
+	
+	if (grid->front == NULL || grid->cell_start == NULL || grid->stamp == NULL || grid->candidate == NULL) {
+		FreeOverlapGrid(grid);
+		return 1;
+	}
+	
+	
+	#define GetCellRange(box)								\
+		cx0 = ((box).x0 - grid->x0) >> grid->shift;			\
+		cy0 = ((box).y0 - grid->y0) >> grid->shift;			\
+		cx1 = ((box).x1 - 1 - grid->x0) >> grid->shift;		\
+		cy1 = ((box).y1 - 1 - grid->y0) >> grid->shift;
+	
+	/*	count the items per cell (into cell_start[c + 1])	*/
+	i = 0;
+	for (p = pool->head; p != NULL; p = p->next) {
+		
+		if (p->flag.optimize == BLIT_EXEC_NO_OPTIMIZE |
+			p->trans == BLIT_ALPHA_TRANSPARENT
+		) {
+			continue;
+		}
+		
+		f = &grid->front[i++];
+		f->order = p->order;
+		f->destbox = p->destbox;
+		
+		GetCellRange(f->destbox);
+		for (cy = cy0; cy <= cy1; cy++) {
+			for (cx = cx0; cx <= cx1; cx++) {
+				grid->cell_start[cy * grid->cols + cx + 1] += 1;
+			}
+		}
+	}
+	
+	for (c = 0; c < num_cell; c++) {
+		grid->cell_start[c + 1] += grid->cell_start[c];
+	}
+	
+	num_item = grid->cell_start[num_cell];
+	grid->cell_item = (int *)malloc(num_item * sizeof(int));
+	
+	if (grid->cell_item == NULL) {
+		FreeOverlapGrid(grid);
+		return 1;
+	}
+	
+	/*	fill the items, cell_start[c] advances to the end of the cell c	*/
+	for (i = 0; i < grid->num_front; i++) {
+		
+		GetCellRange(grid->front[i].destbox);
+		for (cy = cy0; cy <= cy1; cy++) {
+			for (cx = cx0; cx <= cx1; cx++) {
+				c = cy * grid->cols + cx;
+				grid->cell_item[grid->cell_start[c]++] = i;
+			}
+		}
+	}
+	
+	for (c = num_cell; c > 0; c--) {
+		grid->cell_start[c] = grid->cell_start[c - 1];
+	}
+	grid->cell_start[0] = 0;
+	
+	#undef GetCellRange
+	
+	return 0;
+}
+
+
+
+
+static int QueryOverlapGrid(OverlapGrid *grid, BlitEntry *back)
+/*
+//	Collect the fronts of the back, to grid->candidate.
+//	return count of the candidates.
+*/
+{
+	int cx, cy, cx0, cy0, cx1, cy1, c, k, i;
+	int n;
+	
+	
+	if (grid->num_front == 0) {
+		return 0;
+	}
+	
+	cx0 = (back->destbox.x0 - grid->x0) >> grid->shift;
+	cy0 = (back->destbox.y0 - grid->y0) >> grid->shift;
+	cx1 = (back->destbox.x1 - 1 - grid->x0) >> grid->shift;
+	cy1 = (back->destbox.y1 - 1 - grid->y0) >> grid->shift;
+	
+	if (cx0 < 0) cx0 = 0;
+	if (cy0 < 0) cy0 = 0;
+	if (cx1 >= grid->cols) cx1 = grid->cols - 1;
+	if (cy1 >= grid->rows) cy1 = grid->rows - 1;
+	
+	grid->query_id += 1;
+	n = 0;
+	
+	for (cy = cy0; cy <= cy1; cy++) {
+		for (cx = cx0; cx <= cx1; cx++) {
+			
+			c = cy * grid->cols + cx;
+			
+			for (k = grid->cell_start[c]; k < grid->cell_start[c + 1]; k++) {
+				
+				i = grid->cell_item[k];
+				
+				if (grid->front[i].order <= back->order || grid->stamp[i] == grid->query_id) {
+					continue;
+				}
+				
+				grid->stamp[i] = grid->query_id;
+				grid->candidate[n++] = i;
+			}
+		}
+	}
+	
+	/*	front index is in order of the list	*/
+	if (n > 1) {
+		qsort(grid->candidate, n, sizeof(int), CompareIndex);
+	}
+	
+	return n;
+}
+
+
+
+
+static void FreeOverlapGrid(OverlapGrid *grid)
+{
+	free(grid->front);
+	free(grid->cell_start);
+	free(grid->cell_item);
+	free(grid->stamp);
+	free(grid->candidate);
+	
+	SDL_memset(grid, 0, sizeof(*grid));
+}
+
+
+
+
+static int CompareIndex(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+
+
+
 static int RemoveOutsideEntry(BlitPool *pool)
 /*
 //	Remove outside of the destination surface.
@@ -0,0 +1,140 @@
+/*
+//	Blit pool benchmark.
+//	usage: bench [entries] [threads] [frames]
+//	posts random fills/blits like planet.c, and prints entries/sec of
+//	BlitPool_Optimize and BlitPool_Execute (serial and banded).
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "SDL.h"
+#include "SDL_BlitPool.h"
+
+
+
+#define SCREEN_W	640
+#define SCREEN_H	480
+#define SPRITE_SIZE	64
+
+
+void PostRandomEntries(BlitPool *pool, SDL_Surface *sprite, int num_entry, unsigned int seed);
+void RunBench(SDL_Surface *screen, SDL_Surface *sprite, int num_entry, int num_thread, int num_frame);
+
+
+int main(int argc, char *argv[])
+{
+	SDL_Surface *screen, *sprite;
+	int num_entry, num_thread, num_frame;
+	
+	
+	num_entry = (argc > 1) ? atoi(argv[1]) : 2000;
+	num_thread = (argc > 2) ? atoi(argv[2]) : 4;
+	num_frame = (argc > 3) ? atoi(argv[3]) : 50;
+	
+	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0) {
+        fprintf(stderr, "Unable to init SDL: %s\n", SDL_GetError());
+        return 1;
+    }
+	
+	/*	offscreen, so the display does not limit the result	*/
+	screen = SDL_CreateRGBSurface(SDL_SWSURFACE, SCREEN_W, SCREEN_H, 32, 0xff0000, 0xff00, 0xff, 0);
+	sprite = SDL_CreateRGBSurface(SDL_SWSURFACE, SPRITE_SIZE, SPRITE_SIZE, 32, 0xff0000, 0xff00, 0xff, 0);
+	
+	if (screen == NULL || sprite == NULL) {
+		fprintf(stderr, "Unable to create surface: %s\n", SDL_GetError());
+		SDL_Quit();
+		return 1;
+	}
+	
+	SDL_FillRect(sprite, NULL, SDL_MapRGB(sprite->format, 0x40, 0x80, 0xff));
+	
+	RunBench(screen, sprite, num_entry, 1, num_frame);
+	if (num_thread > 1) {
+		RunBench(screen, sprite, num_entry, num_thread, num_frame);
+	}
+	
+	SDL_FreeSurface(sprite);
+	SDL_FreeSurface(screen);
+	SDL_Quit();
+	return 0;
+}
+
+
+
+void RunBench(SDL_Surface *screen, SDL_Surface *sprite, int num_entry, int num_thread, int num_frame)
+{
+	BlitPool *pool;
+	Uint32 tick, optimize_ms, execute_ms;
+	int i, num_executed;
+	
+	
+	pool = BlitPool_CreatePool(screen);
+	BlitPool_SetThreads(pool, num_thread);
+	
+	optimize_ms = execute_ms = 0;
+	num_executed = 0;
+	
+	for (i = 0; i < num_frame; i++) {
+		
+		PostRandomEntries(pool, sprite, num_entry, i);
+		
+		tick = SDL_GetTicks();
+		BlitPool_Optimize(pool, BLIT_OPT_ALL);
+		optimize_ms += SDL_GetTicks() - tick;
+		
+		num_executed += BlitPool_GetRectCount(pool);
+		
+		tick = SDL_GetTicks();
+		BlitPool_Execute(pool);
+		execute_ms += SDL_GetTicks() - tick;
+		
+		BlitPool_ReleaseEntry(pool);
+	}
+	
+	printf("threads=%d entries=%d frames=%d | optimize %lu ms, %.0f entries/sec | execute %lu ms, %.0f entries/sec\n",
+		num_thread, num_entry, num_frame,
+		(unsigned long)optimize_ms, (double)num_entry * num_frame * 1000.0 / (optimize_ms ? optimize_ms : 1),
+		(unsigned long)execute_ms, (double)num_executed * 1000.0 / (execute_ms ? execute_ms : 1)
+	);
+	
+	BlitPool_DeletePool(pool);
+}
+
+
+
+void PostRandomEntries(BlitPool *pool, SDL_Surface *sprite, int num_entry, unsigned int seed)
+/*
+//	Mostly opaque sprites, some transparent ones and fills, partly outside.
+*/
+{
+	SDL_Rect rect;
+	int i;
+	
+	
+	srand(seed);
+	
+	for (i = 0; i < num_entry; i++) {
+		
+		rect.x = rand() % (SCREEN_W + SPRITE_SIZE) - SPRITE_SIZE / 2;
+		rect.y = rand() % (SCREEN_H + SPRITE_SIZE) - SPRITE_SIZE / 2;
+		
+		switch (rand() % 8) {
+		case 0:
+			rect.w = 8 + rand() % (SPRITE_SIZE * 2);
+			rect.h = 8 + rand() % (SPRITE_SIZE * 2);
+			BlitPool_PostFill(pool, &rect, rand(), BLIT_ALPHA_OPAQUE);
+			break;
+			
+		case 1:
+			BlitPool_PostSurface(pool, sprite, NULL, &rect, BLIT_ALPHA_TRANSPARENT);
+			break;
+			
+		default:
+			BlitPool_PostSurface(pool, sprite, NULL, &rect, BLIT_ALPHA_OPAQUE);
+			break;
+		}
+	}
+}
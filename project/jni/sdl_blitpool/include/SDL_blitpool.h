@@ -192,6 +192,14 @@ extern void BlitPool_Optimize(BlitPool *pool, BlitOptimizeFlag flag);
 extern void BlitPool_Execute(BlitPool *pool);
 
 
+/*
+//	Execute by num_thread threads, each one blits a horizontal band of
+//	the destination. num_thread <= 1 is serial (default).
+//	Falls back to serial if a surface must be locked (hardware, RLE).
+*/
+extern void BlitPool_SetThreads(BlitPool *pool, int num_thread);
+
+
 
 
 /*
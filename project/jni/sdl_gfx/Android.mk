@@ -12,6 +12,15 @@ LOCAL_CPP_EXTENSION := .cpp
 # Note this simple makefile var substitution, you can find even simpler examples in different Android projects
 LOCAL_SRC_FILES := $(notdir $(wildcard $(LOCAL_PATH)/*.c))
 
+# The NEON rotozoom kernels are picked at runtime with SDL_HasNEON(), so on armeabi-v7a only their file is compiled with NEON
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_CFLAGS += -DGFX_NEON=1
+LOCAL_SRC_FILES := $(filter-out SDL_rotozoom_neon.c,$(LOCAL_SRC_FILES)) SDL_rotozoom_neon.c.neon
+endif
+ifeq ($(TARGET_ARCH_ABI),arm64-v8a)
+LOCAL_CFLAGS += -DGFX_NEON=1
+endif
+
 LOCAL_SHARED_LIBRARIES := sdl-$(SDL_VERSION)
 
 include $(BUILD_SHARED_LIBRARY)
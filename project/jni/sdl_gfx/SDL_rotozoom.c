@@ -14,6 +14,11 @@ LGPL (c) A. Schiffler
 #include <string.h>
 
 #include "SDL_rotozoom.h"
+#include "SDL_rotozoom_neon.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /* ---- Internally used structures */
 
@@ -73,6 +78,380 @@ Uint32 _colorkey(SDL_Surface *src)
  	return key;
 }
 
+/* ---- Smooth 32 bit kernels */
+
+/*
+The smooth zoomer and rotozoomer weight neighbouring pixels with 16.16 fractions
+as ((c1 - c0) * e >> 16) + c0. The SSE2 and NEON kernels use the same formula,
+so all code paths produce identical output.
+*/
+
+/*!
+\brief Interpolates between two 32 bit pixels with a 16 bit weight.
+*/
+static void _lerpRGBA(tColorRGBA *dp, const tColorRGBA *c0, const tColorRGBA *c1, int e)
+{
+	dp->r = (((c1->r - c0->r) * e) >> 16) + c0->r;
+	dp->g = (((c1->g - c0->g) * e) >> 16) + c0->g;
+	dp->b = (((c1->b - c0->b) * e) >> 16) + c0->b;
+	dp->a = (((c1->a - c0->a) * e) >> 16) + c0->a;
+}
+
+/*!
+\brief Blends two horizontally interpolated rows into one destination row.
+
+\param dp Destination bytes.
+\param t1 Upper row.
+\param t2 Lower row.
+\param ey Vertical weight (0..65535).
+\param n Number of bytes.
+*/
+static void _zoomBlendRowC(Uint8 *dp, const Uint8 *t1, const Uint8 *t2, int ey, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		dp[i] = (((t2[i] - t1[i]) * ey) >> 16) + t1[i];
+	}
+}
+
+/*!
+\brief Horizontally interpolates one source row.
+
+\param dp Destination pixels.
+\param sp Source row.
+\param xa Left source column per destination pixel.
+\param xb Right source column per destination pixel.
+\param ex Horizontal weight per destination pixel.
+\param n Number of pixels.
+*/
+static void _zoomInterpRowC(Uint32 *dp, const Uint32 *sp, const int *xa, const int *xb, const Uint16 *ex, int n)
+{
+	int x;
+
+	for (x = 0; x < n; x++) {
+		_lerpRGBA((tColorRGBA *) &dp[x], (const tColorRGBA *) &sp[xa[x]], (const tColorRGBA *) &sp[xb[x]], ex[x]);
+	}
+}
+
+/*!
+\brief Rotozooms a run of destination pixels whose 2x2 source neighbourhoods lie inside the source.
+
+The top left source pixel of destination pixel x is at byte offset
+off + (sdx >> 16) * xstep + (sdy >> 16) * ystep from 'pixels'; its right and
+lower neighbours are xstep and ystep bytes further. Negative steps mirror the source.
+
+\param dp Destination pixels.
+\param pixels Source pixels.
+\param off Byte offset of source column 0, row 0 (after mirroring).
+\param xstep Byte step to the next source column.
+\param ystep Byte step to the next source row.
+\param sdx Source x of the first pixel in 16.16 fixed point.
+\param sdy Source y of the first pixel in 16.16 fixed point.
+\param icos Source x increment per destination pixel.
+\param isin Source y increment per destination pixel.
+\param n Number of pixels.
+*/
+static void _transformSpanC(Uint32 *dp, const Uint8 *pixels, int off, int xstep, int ystep, 
+	int sdx, int sdy, int icos, int isin, int n)
+{
+	const Uint8 *sp;
+	tColorRGBA t1, t2;
+
+	for (; n > 0; n--) {
+		sp = pixels + off + (sdx >> 16) * xstep + (sdy >> 16) * ystep;
+		_lerpRGBA(&t1, (const tColorRGBA *) sp, (const tColorRGBA *) (sp + xstep), sdx & 0xffff);
+		_lerpRGBA(&t2, (const tColorRGBA *) (sp + ystep), (const tColorRGBA *) (sp + ystep + xstep), sdx & 0xffff);
+		_lerpRGBA((tColorRGBA *) dp, &t1, &t2, sdy & 0xffff);
+		sdx += icos;
+		sdy += isin;
+		dp++;
+	}
+}
+
+#ifdef __SSE2__
+/*!
+\brief Interpolates 16 bit lanes: ((b - a) * e >> 16) + a.
+
+The weights are unsigned 16 bit values; lanes above 32767 come out of the
+signed multiply short by exactly (b - a), which is added back.
+*/
+static __m128i _lerpSSE2(__m128i a, __m128i b, __m128i e)
+{
+	__m128i d = _mm_sub_epi16(b, a);
+
+	return _mm_add_epi16(a, _mm_add_epi16(_mm_mulhi_epi16(d, e), _mm_and_si128(d, _mm_srai_epi16(e, 15))));
+}
+
+/*!
+\brief Widens two 32 bit pixels to 16 bit lanes.
+*/
+static __m128i _pairSSE2(Uint32 p0, Uint32 p1)
+{
+	return _mm_unpacklo_epi8(_mm_unpacklo_epi32(_mm_cvtsi32_si128(p0), _mm_cvtsi32_si128(p1)), _mm_setzero_si128());
+}
+
+/*!
+\brief Weights for two pixels, one per group of four lanes.
+*/
+static __m128i _weightsSSE2(int e0, int e1)
+{
+	return _mm_set_epi16((short)e1, (short)e1, (short)e1, (short)e1, (short)e0, (short)e0, (short)e0, (short)e0);
+}
+
+static void _zoomBlendRowSSE2(Uint8 *dp, const Uint8 *t1, const Uint8 *t2, int ey, int n)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i e = _mm_set1_epi16((short)ey);
+	__m128i a, b, lo, hi;
+
+	for (; n >= 16; n -= 16, dp += 16, t1 += 16, t2 += 16) {
+		a = _mm_loadu_si128((const __m128i *)t1);
+		b = _mm_loadu_si128((const __m128i *)t2);
+		lo = _lerpSSE2(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero), e);
+		hi = _lerpSSE2(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero), e);
+		_mm_storeu_si128((__m128i *)dp, _mm_packus_epi16(lo, hi));
+	}
+	_zoomBlendRowC(dp, t1, t2, ey, n);
+}
+
+static void _zoomInterpRowSSE2(Uint32 *dp, const Uint32 *sp, const int *xa, const int *xb, const Uint16 *ex, int n)
+{
+	__m128i r;
+
+	for (; n >= 2; n -= 2, dp += 2, xa += 2, xb += 2, ex += 2) {
+		r = _lerpSSE2(_pairSSE2(sp[xa[0]], sp[xa[1]]), _pairSSE2(sp[xb[0]], sp[xb[1]]), _weightsSSE2(ex[0], ex[1]));
+		_mm_storel_epi64((__m128i *)dp, _mm_packus_epi16(r, r));
+	}
+	_zoomInterpRowC(dp, sp, xa, xb, ex, n);
+}
+
+static void _transformSpanSSE2(Uint32 *dp, const Uint8 *pixels, int off, int xstep, int ystep, 
+	int sdx, int sdy, int icos, int isin, int n)
+{
+	const Uint8 *p0, *p1;
+	__m128i ex, ey, t1, t2, r;
+
+	for (; n >= 2; n -= 2, dp += 2) {
+		p0 = pixels + off + (sdx >> 16) * xstep + (sdy >> 16) * ystep;
+		p1 = pixels + off + ((sdx + icos) >> 16) * xstep + ((sdy + isin) >> 16) * ystep;
+		ex = _weightsSSE2(sdx & 0xffff, (sdx + icos) & 0xffff);
+		ey = _weightsSSE2(sdy & 0xffff, (sdy + isin) & 0xffff);
+		t1 = _lerpSSE2(_pairSSE2(*(const Uint32 *)p0, *(const Uint32 *)p1), 
+			_pairSSE2(*(const Uint32 *)(p0 + xstep), *(const Uint32 *)(p1 + xstep)), ex);
+		t2 = _lerpSSE2(_pairSSE2(*(const Uint32 *)(p0 + ystep), *(const Uint32 *)(p1 + ystep)), 
+			_pairSSE2(*(const Uint32 *)(p0 + ystep + xstep), *(const Uint32 *)(p1 + ystep + xstep)), ex);
+		r = _lerpSSE2(t1, t2, ey);
+		_mm_storel_epi64((__m128i *)dp, _mm_packus_epi16(r, r));
+		sdx += 2 * icos;
+		sdy += 2 * isin;
+	}
+	_transformSpanC(dp, pixels, off, xstep, ystep, sdx, sdy, icos, isin, n);
+}
+#endif
+
+static void (*_zoomBlendRow)(Uint8 *dp, const Uint8 *t1, const Uint8 *t2, int ey, int n);
+static void (*_zoomInterpRow)(Uint32 *dp, const Uint32 *sp, const int *xa, const int *xb, const Uint16 *ex, int n);
+static void (*_transformSpan)(Uint32 *dp, const Uint8 *pixels, int off, int xstep, int ystep, 
+	int sdx, int sdy, int icos, int isin, int n);
+
+/*!
+\brief Picks the fastest kernels for this CPU on first use.
+*/
+static void _rotozoomInitKernels(void)
+{
+	if (_zoomBlendRow) {
+		return;
+	}
+#if defined(GFX_NEON)
+	if (SDL_HasNEON()) {
+		_zoomInterpRow = _zoomInterpRowNEON;
+		_transformSpan = _transformSpanNEON;
+		_zoomBlendRow = _zoomBlendRowNEON;
+		return;
+	}
+#endif
+#ifdef __SSE2__
+	_zoomInterpRow = _zoomInterpRowSSE2;
+	_transformSpan = _transformSpanSSE2;
+	_zoomBlendRow = _zoomBlendRowSSE2;
+#else
+	_zoomInterpRow = _zoomInterpRowC;
+	_transformSpan = _transformSpanC;
+	_zoomBlendRow = _zoomBlendRowC;
+#endif
+}
+
+/* ---- Row bands and worker threads */
+
+/*!
+\brief Maximum number of threads used by rotozoomSetThreads().
+*/
+#define ROTOZOOM_MAX_THREADS 8
+
+/*!
+\brief Destinations smaller than this many pixels are never split across threads.
+*/
+#define ROTOZOOM_THREAD_PIXELS (128*128)
+
+/*!
+\brief Size of the destination tiles the rotozoomer walks, so the source area
+read for one tile stays in the data cache.
+*/
+#define ROTOZOOM_TILE_W 64
+#define ROTOZOOM_TILE_H 32
+
+/*!
+\brief Renders destination rows y0 to y1-1 of a job as band number 'band'.
+*/
+typedef void (*tRotozoomBand)(void *data, int band, int y0, int y1);
+
+static struct {
+	int count;
+	SDL_mutex *lock;
+	SDL_sem *done;
+	SDL_sem *start[ROTOZOOM_MAX_THREADS];
+	SDL_Thread *thread[ROTOZOOM_MAX_THREADS];
+	int index[ROTOZOOM_MAX_THREADS];
+	int quit;
+	tRotozoomBand func;
+	void *data;
+	int rows;
+	int bands;
+} _rotozoomPool = { 1 };
+
+static int SDLCALL _rotozoomWorker(void *arg)
+{
+	int band = *(int *)arg;
+
+	for (;;) {
+		SDL_SemWait(_rotozoomPool.start[band]);
+		if (_rotozoomPool.quit) {
+			break;
+		}
+		_rotozoomPool.func(_rotozoomPool.data, band, 
+			_rotozoomPool.rows * band / _rotozoomPool.bands, 
+			_rotozoomPool.rows * (band + 1) / _rotozoomPool.bands);
+		SDL_SemPost(_rotozoomPool.done);
+	}
+	return 0;
+}
+
+/*!
+\brief Returns the number of bands to split 'dst' into.
+*/
+static int _rotozoomBands(SDL_Surface *dst)
+{
+	if (_rotozoomPool.count > 1 && dst->w * dst->h >= ROTOZOOM_THREAD_PIXELS) {
+		return _rotozoomPool.count;
+	}
+	return 1;
+}
+
+/*!
+\brief Runs a job over 'rows' destination rows split into at most 'bands' bands.
+
+Band 0 is rendered by the calling thread.
+*/
+static void _rotozoomRun(tRotozoomBand func, void *data, int rows, int bands)
+{
+	int i;
+
+	if (bands > 1) {
+		SDL_mutexP(_rotozoomPool.lock);
+		if (bands > _rotozoomPool.count) {
+			bands = _rotozoomPool.count;
+		}
+		if (bands > 1) {
+			_rotozoomPool.func = func;
+			_rotozoomPool.data = data;
+			_rotozoomPool.rows = rows;
+			_rotozoomPool.bands = bands;
+			for (i = 1; i < bands; i++) {
+				SDL_SemPost(_rotozoomPool.start[i]);
+			}
+			func(data, 0, 0, rows / bands);
+			for (i = 1; i < bands; i++) {
+				SDL_SemWait(_rotozoomPool.done);
+			}
+			SDL_mutexV(_rotozoomPool.lock);
+			return;
+		}
+		SDL_mutexV(_rotozoomPool.lock);
+	}
+	func(data, 0, 0, rows);
+}
+
+/*!
+\brief Sets the number of threads used for large smooth zooms and rotozooms.
+
+Destination surfaces of at least 128x128 pixels are split into bands of rows,
+one per thread; the calling thread renders the first band. The default of 1
+renders everything on the calling thread. Change the count while no other
+thread is inside a rotozoom call.
+
+\param threads Number of threads including the caller (1 to 8).
+
+\return The number of threads in use.
+*/
+int rotozoomSetThreads(int threads)
+{
+	int i;
+
+	if (threads < 1) threads = 1;
+	if (threads > ROTOZOOM_MAX_THREADS) threads = ROTOZOOM_MAX_THREADS;
+
+	if (_rotozoomPool.lock == NULL) {
+		if (threads == 1) {
+			return 1;
+		}
+		_rotozoomPool.lock = SDL_CreateMutex();
+		_rotozoomPool.done = SDL_CreateSemaphore(0);
+		if (_rotozoomPool.lock == NULL || _rotozoomPool.done == NULL) {
+			if (_rotozoomPool.lock) SDL_DestroyMutex(_rotozoomPool.lock);
+			if (_rotozoomPool.done) SDL_DestroySemaphore(_rotozoomPool.done);
+			_rotozoomPool.lock = NULL;
+			_rotozoomPool.done = NULL;
+			return 1;
+		}
+	}
+
+	SDL_mutexP(_rotozoomPool.lock);
+
+	/*
+	* Stop the current workers 
+	*/
+	_rotozoomPool.quit = 1;
+	for (i = 1; i < _rotozoomPool.count; i++) {
+		SDL_SemPost(_rotozoomPool.start[i]);
+		SDL_WaitThread(_rotozoomPool.thread[i], NULL);
+		SDL_DestroySemaphore(_rotozoomPool.start[i]);
+	}
+	_rotozoomPool.quit = 0;
+	_rotozoomPool.count = 1;
+
+	/*
+	* Start the new ones 
+	*/
+	for (i = 1; i < threads; i++) {
+		_rotozoomPool.index[i] = i;
+		_rotozoomPool.start[i] = SDL_CreateSemaphore(0);
+		if (_rotozoomPool.start[i] == NULL) {
+			break;
+		}
+		_rotozoomPool.thread[i] = SDL_CreateThread(_rotozoomWorker, &_rotozoomPool.index[i]);
+		if (_rotozoomPool.thread[i] == NULL) {
+			SDL_DestroySemaphore(_rotozoomPool.start[i]);
+			break;
+		}
+		_rotozoomPool.count = i + 1;
+	}
+
+	SDL_mutexV(_rotozoomPool.lock);
+
+	return _rotozoomPool.count;
+}
+
 
 /*! 
 \brief Internal 32 bit integer-factor averaging Shrinker.
@@ -91,10 +470,10 @@ Assumes dst surface was allocated with the correct dimensions.
 */
 int _shrinkSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int factorx, int factory)
 {
-	int x, y, dx, dy, sgap, dgap, ra, ga, ba, aa;
+	int x, y, dx, dy, n, ra, ga, ba, aa;
 	int n_average;
-	tColorRGBA *sp, *osp, *oosp;
-	tColorRGBA *dp;
+	Uint32 *sum, *cs;
+	Uint8 *sp, *dp;
 
 	/*
 	* Averaging integer shrink
@@ -104,62 +483,52 @@ int _shrinkSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int factorx, int fa
 	n_average = factorx*factory;
 
 	/*
-	* Scan destination
+	* Column sums of one row of boxes 
 	*/
-	sp = (tColorRGBA *) src->pixels;
-	sgap = src->pitch - src->w * 4;
-
-	dp = (tColorRGBA *) dst->pixels;
-	dgap = dst->pitch - dst->w * 4;
+	n = dst->w * factorx * 4;
+	if ((sum = (Uint32 *) malloc(n * sizeof(Uint32))) == NULL) {
+		return (-1);
+	}
 
+	/*
+	* Scan destination
+	*/
 	for (y = 0; y < dst->h; y++) {
 
-		osp=sp;
-		for (x = 0; x < dst->w; x++) {
+		/* Add up the source rows of this row of boxes, reading them front to back */
+		memset(sum, 0, n * sizeof(Uint32));
+		sp = (Uint8 *) src->pixels + y * factory * src->pitch;
+		for (dy = 0; dy < factory; dy++) {
+			for (x = 0; x < n; x++) {
+				sum[x] += sp[x];
+			}
+			sp += src->pitch;
+		}
 
-			/* Trace out source box and accumulate */
-			oosp=sp;
+		/* Add up the columns of each box and store result in destination */
+		cs = sum;
+		dp = (Uint8 *) dst->pixels + y * dst->pitch;
+		for (x = 0; x < dst->w; x++) {
 			ra=ga=ba=aa=0;
-			for (dy=0; dy < factory; dy++) {
-				for (dx=0; dx < factorx; dx++) {
-					ra += sp->r;
-					ga += sp->g;
-					ba += sp->b;
-					aa += sp->a;
-
-					sp++;
-				} 
-				/* src dx loop */
-				sp = (tColorRGBA *)((Uint8*)sp + (src->pitch - 4*factorx)); // next y
+			for (dx = 0; dx < factorx; dx++) {
+				ra += cs[0];
+				ga += cs[1];
+				ba += cs[2];
+				aa += cs[3];
+				cs += 4;
 			}
-			/* src dy loop */
-
-			/* next box-x */
-			sp = (tColorRGBA *)((Uint8*)oosp + 4*factorx);
-
-			/* Store result in destination */
-			dp->r = ra/n_average;
-			dp->g = ga/n_average;
-			dp->b = ba/n_average;
-			dp->a = aa/n_average;
-
-			/*
-			* Advance destination pointer 
-			*/
-			dp++;
+			((tColorRGBA *) dp)->r = ra/n_average;
+			((tColorRGBA *) dp)->g = ga/n_average;
+			((tColorRGBA *) dp)->b = ba/n_average;
+			((tColorRGBA *) dp)->a = aa/n_average;
+			dp += 4;
 		} 
 		/* dst x loop */
-
-		/* next box-y */
-		sp = (tColorRGBA *)((Uint8*)osp + src->pitch*factory);
-
-		/*
-		* Advance destination pointers 
-		*/
-		dp = (tColorRGBA *) ((Uint8 *) dp + dgap);
 	} 
 	/* dst y loop */
 
+	free(sum);
+
 	return (0);
 }
 
@@ -247,6 +616,165 @@ int _shrinkSurfaceY(SDL_Surface * src, SDL_Surface * dst, int factorx, int facto
 	return (0);
 }
 
+/*!
+\brief Work description of a smooth 32 bit zoom.
+*/
+typedef struct tZoomJob {
+	SDL_Surface *src;
+	SDL_Surface *dst;
+	int *xa, *xb;		/* left and right source column per destination column */
+	Uint16 *ex;		/* horizontal weight per destination column */
+	int *ya, *yb;		/* upper and lower source row per destination row */
+	Uint16 *ey;		/* vertical weight per destination row */
+	Uint32 *rows;		/* two interpolated source rows per band */
+	int sx;			/* horizontal source step in 16.16 fixed point */
+	int lin0, lin1;		/* destination columns whose source columns are exactly x * sx */
+	int xoff, xstep;	/* byte offset of source column 0 and byte step to the next column */
+} tZoomJob;
+
+/*!
+\brief Zooms one destination row straight from two source rows.
+
+Used for rows that share no source row with their neighbours, where caching
+the interpolated source rows would not pay off.
+*/
+static void _zoomFusedRowRGBA(tZoomJob *job, Uint32 *dp, int a, int b, int ey)
+{
+	Uint8 *pixels = (Uint8 *) job->src->pixels;
+	int pitch = job->src->pitch;
+	tColorRGBA *ra = (tColorRGBA *) (pixels + a * pitch);
+	tColorRGBA *rb = (tColorRGBA *) (pixels + b * pitch);
+	tColorRGBA t1, t2;
+	int x;
+
+	for (x = 0; x < job->dst->w; x++) {
+		if ((x == job->lin0) && (job->lin1 > x)) {
+			_transformSpan(dp + x, pixels, a * pitch + job->xoff, job->xstep, (b - a) * pitch, 
+				x * job->sx, ey, job->sx, 0, job->lin1 - x);
+			x = job->lin1 - 1;
+			continue;
+		}
+		_lerpRGBA(&t1, &ra[job->xa[x]], &ra[job->xb[x]], job->ex[x]);
+		_lerpRGBA(&t2, &rb[job->xa[x]], &rb[job->xb[x]], job->ex[x]);
+		_lerpRGBA((tColorRGBA *) &dp[x], &t1, &t2, ey);
+	}
+}
+
+/*!
+\brief Zooms destination rows y0 to y1-1 of a smooth 32 bit zoom.
+
+Source rows are interpolated horizontally once and kept while consecutive
+destination rows use them, so enlarging costs one vertical blend per row.
+*/
+static void _zoomBandRGBA(void *data, int band, int y0, int y1)
+{
+	tZoomJob *job = (tZoomJob *) data;
+	int w = job->dst->w;
+	int cached[2];
+	Uint32 *buf[2], *t1, *t2;
+	Uint8 *dp;
+	int y, a, b, s;
+
+	buf[0] = job->rows + 2 * w * band;
+	buf[1] = buf[0] + w;
+	cached[0] = cached[1] = -1;
+
+	for (y = y0; y < y1; y++) {
+		a = job->ya[y];
+		b = job->yb[y];
+		dp = (Uint8 *) job->dst->pixels + y * job->dst->pitch;
+		/*
+		* Rows that share no source row with their neighbours are zoomed in one pass 
+		*/
+		if ((cached[0] != a) && (cached[1] != a) && (cached[0] != b) && (cached[1] != b) &&
+			((y + 1 == y1) || ((job->ya[y + 1] != a) && (job->ya[y + 1] != b) && 
+			(job->yb[y + 1] != a) && (job->yb[y + 1] != b)))) {
+			_zoomFusedRowRGBA(job, (Uint32 *) dp, a, b, job->ey[y]);
+			continue;
+		}
+		/*
+		* Interpolate the source rows which are not cached yet 
+		*/
+		if ((cached[0] != a) && (cached[1] != a)) {
+			s = (cached[0] == b) ? 1 : 0;
+			_zoomInterpRow(buf[s], (Uint32 *) ((Uint8 *) job->src->pixels + a * job->src->pitch), 
+				job->xa, job->xb, job->ex, w);
+			cached[s] = a;
+		}
+		if ((cached[0] != b) && (cached[1] != b)) {
+			s = (cached[0] == a) ? 1 : 0;
+			_zoomInterpRow(buf[s], (Uint32 *) ((Uint8 *) job->src->pixels + b * job->src->pitch), 
+				job->xa, job->xb, job->ex, w);
+			cached[s] = b;
+		}
+		t1 = (cached[0] == a) ? buf[0] : buf[1];
+		t2 = (cached[0] == b) ? buf[0] : buf[1];
+
+		/*
+		* Blend them into the destination 
+		*/
+		if (job->ey[y] == 0) {
+			memcpy(dp, t1, w * 4);
+		} else {
+			_zoomBlendRow(dp, (Uint8 *) t1, (Uint8 *) t2, job->ey[y], w * 4);
+		}
+	}
+}
+
+/*!
+\brief Computes the source pixels and weights of a smooth zoom along one axis.
+
+Steps through the source exactly like the per-pixel interpolating zoomer did:
+positions never advance past the last source pixel, and mirrored zooms swap the
+two neighbours. Neighbours past the edge are clamped to it.
+
+\param step Source step per destination pixel in 16.16 fixed point.
+\param size Source size.
+\param n Destination size.
+\param flip Mirror flag.
+\param pa Returns the first neighbour per destination pixel.
+\param pb Returns the second neighbour per destination pixel.
+\param e Returns the weight of the second neighbour.
+\param lin0 Returns the first destination pixel whose source position is exactly i * step without clamping.
+\param lin1 Returns the end of that run of destination pixels.
+*/
+static void _zoomSetupAxis(int step, int size, int n, int flip, int *pa, int *pb, Uint16 *e, int *lin0, int *lin1)
+{
+	int i, pos, sum, csx, sstep;
+
+	pos = 0;
+	sum = 0;
+	csx = 0;
+	*lin0 = *lin1 = 0;
+	for (i = 0; i < n; i++) {
+		e[i] = csx & 0xffff;
+		if (flip) {
+			pa[i] = size - pos;
+			pb[i] = size - 1 - pos;
+		} else {
+			pa[i] = pos;
+			pb[i] = pos + 1;
+		}
+		if ((pa[i] < size) && (pb[i] < size) && (sum < size)) {
+			if (*lin0 == *lin1) {
+				*lin0 = i;
+				*lin1 = i + 1;
+			} else if (*lin1 == i) {
+				*lin1 = i + 1;
+			}
+		}
+		if (pa[i] > size - 1) pa[i] = size - 1;
+		if (pb[i] > size - 1) pb[i] = size - 1;
+
+		csx = (csx & 0xffff) + step;
+		sstep = csx >> 16;
+		sum += sstep;
+		if (sum < size) {
+			pos += sstep;
+		}
+	}
+}
+
 /*! 
 \brief Internal 32 bit Zoomer with optional anti-aliasing by bilinear interpolation.
 
@@ -264,15 +792,19 @@ Assumes dst surface was allocated with the correct dimensions.
 */
 int _zoomSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy, int smooth)
 {
-	int x, y, sx, sy, *sax, *say, *csax, *csay, csx, csy, ex, ey, t1, t2, sstep, lx, ly;
-	tColorRGBA *c00, *c01, *c10, *c11, *cswap;
+	int x, y, sx, sy, *sax, *say, *csax, *csay, csx, csy, sstep;
 	tColorRGBA *sp, *csp, *dp;
 	int dgap;
+	tZoomJob job;
+	int bands;
+	Uint8 *mem;
 
 	/*
-	* Variable setup 
+	* Interpolating Zoom 
 	*/
 	if (smooth) {
+		_rotozoomInitKernels();
+
 		/*
 		* For interpolation: assume source dimension is one pixel 
 		*/
@@ -281,11 +813,44 @@ int _zoomSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy,
 		*/
 		sx = (int) (65536.0 * (float) (src->w - 1) / (float) dst->w);
 		sy = (int) (65536.0 * (float) (src->h - 1) / (float) dst->h);
-	} else {
-		sx = (int) (65536.0 * (float) src->w / (float) dst->w);
-		sy = (int) (65536.0 * (float) src->h / (float) dst->h);
+
+		/*
+		* Allocate memory for the row cache, source positions and weights 
+		*/
+		bands = _rotozoomBands(dst);
+		mem = (Uint8 *) malloc(2 * dst->w * bands * sizeof(Uint32) + 
+			2 * (dst->w + dst->h) * sizeof(int) + (dst->w + dst->h) * sizeof(Uint16));
+		if (mem == NULL) {
+			return (-1);
+		}
+		job.src = src;
+		job.dst = dst;
+		job.rows = (Uint32 *) mem;
+		job.xa = (int *) (job.rows + 2 * dst->w * bands);
+		job.xb = job.xa + dst->w;
+		job.ya = job.xb + dst->w;
+		job.yb = job.ya + dst->h;
+		job.ex = (Uint16 *) (job.yb + dst->h);
+		job.ey = job.ex + dst->w;
+
+		_zoomSetupAxis(sx, src->w, dst->w, flipx, job.xa, job.xb, job.ex, &job.lin0, &job.lin1);
+		_zoomSetupAxis(sy, src->h, dst->h, flipy, job.ya, job.yb, job.ey, &y, &y);
+		job.sx = sx;
+		job.xoff = flipx ? 4 * src->w : 0;
+		job.xstep = flipx ? -4 : 4;
+
+		_rotozoomRun(_zoomBandRGBA, &job, dst->h, bands);
+
+		free(mem);
+		return (0);
 	}
 
+	/*
+	* Non-Interpolating Zoom 
+	*/
+	sx = (int) (65536.0 * (float) src->w / (float) dst->w);
+	sy = (int) (65536.0 * (float) src->h / (float) dst->h);
+
 	/*
 	* Allocate memory for row increments 
 	*/
@@ -304,7 +869,7 @@ int _zoomSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy,
 	dp = (tColorRGBA *) dst->pixels;
 
 	if (flipx) csp += (src->w-1);
-	if (flipy) csp += (src->pitch*(src->h-1));
+	if (flipy) csp = (tColorRGBA *) ((Uint8 *) csp + src->pitch*(src->h-1));
 
 	csx = 0;
 	csax = sax;
@@ -325,132 +890,39 @@ int _zoomSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy,
 
 	dgap = dst->pitch - dst->w * 4;
 
-	/*
-	* Switch between interpolating and non-interpolating code 
-	*/
-	if (smooth) {
-
-		/*
-		* Interpolating Zoom 
-		*/
-
-		/*
-		* Scan destination 
-		*/
-		ly = 0;
-		csay = say;
-		for (y = 0; y < dst->h; y++) {
+	csay = say;
+	for (y = 0; y < dst->h; y++) {
+		sp = csp;
+		csax = sax;
+		for (x = 0; x < dst->w; x++) {
 			/*
-			* Setup color source pointers 
+			* Draw 
 			*/
-			c00 = csp;	    
-			c01 = csp;
-			c01++;	    
-			c10 = (tColorRGBA *) ((Uint8 *) csp + src->pitch);
-			c11 = c10;
-			c11++;
-			csax = sax;
-			if (flipx) {
-				cswap = c00; c00=c01; c01=cswap;
-				cswap = c10; c10=c11; c11=cswap;
-			}
-			if (flipy) {
-				cswap = c00; c00=c10; c10=cswap;
-				cswap = c01; c01=c11; c11=cswap;
-			}
-			lx = 0;
-			for (x = 0; x < dst->w; x++) {
-				/*
-				* Interpolate colors 
-				*/
-				ex = (*csax & 0xffff);
-				ey = (*csay & 0xffff);
-				t1 = ((((c01->r - c00->r) * ex) >> 16) + c00->r) & 0xff;
-				t2 = ((((c11->r - c10->r) * ex) >> 16) + c10->r) & 0xff;
-				dp->r = (((t2 - t1) * ey) >> 16) + t1;
-				t1 = ((((c01->g - c00->g) * ex) >> 16) + c00->g) & 0xff;
-				t2 = ((((c11->g - c10->g) * ex) >> 16) + c10->g) & 0xff;
-				dp->g = (((t2 - t1) * ey) >> 16) + t1;
-				t1 = ((((c01->b - c00->b) * ex) >> 16) + c00->b) & 0xff;
-				t2 = ((((c11->b - c10->b) * ex) >> 16) + c10->b) & 0xff;
-				dp->b = (((t2 - t1) * ey) >> 16) + t1;
-				t1 = ((((c01->a - c00->a) * ex) >> 16) + c00->a) & 0xff;
-				t2 = ((((c11->a - c10->a) * ex) >> 16) + c10->a) & 0xff;
-				dp->a = (((t2 - t1) * ey) >> 16) + t1;
-
-				/*
-				* Advance source pointers 
-				*/
-				csax++;
-				sstep = (*csax >> 16);
-				lx += sstep;
-				if (lx >= src->w) sstep = 0;
-				if (flipx) sstep = -sstep;
-				c00 += sstep;
-				c01 += sstep;
-				c10 += sstep;
-				c11 += sstep;
-				/*
-				* Advance destination pointer 
-				*/
-				dp++;
-			}
+			*dp = *sp;
 			/*
-			* Advance source pointer 
+			* Advance source pointers 
 			*/
-			csay++;
-			sstep = (*csay >> 16);
-			ly += sstep;
-			if (ly >= src->h) sstep = 0;
-			sstep *= src->pitch;
-			if (flipy) sstep = -sstep;
-			csp = (tColorRGBA *) ((Uint8 *) csp + sstep);
-
+			csax++;
+			sstep = (*csax >> 16);
+			if (flipx) sstep = -sstep;
+			sp += sstep;
 			/*
-			* Advance destination pointers 
+			* Advance destination pointer 
 			*/
-			dp = (tColorRGBA *) ((Uint8 *) dp + dgap);
+			dp++;
 		}
-	} else {
-
 		/*
-		* Non-Interpolating Zoom 
+		* Advance source pointer 
 		*/
+		csay++;
+		sstep = (*csay >> 16) * src->pitch;
+		if (flipy) sstep = -sstep;
+		csp = (tColorRGBA *) ((Uint8 *) csp + sstep);
 
-		csay = say;
-		for (y = 0; y < dst->h; y++) {
-			sp = csp;
-			csax = sax;
-			for (x = 0; x < dst->w; x++) {
-				/*
-				* Draw 
-				*/
-				*dp = *sp;
-				/*
-				* Advance source pointers 
-				*/
-				csax++;
-				sstep = (*csax >> 16);
-				if (flipx) sstep = -sstep;
-				sp += sstep;
-				/*
-				* Advance destination pointer 
-				*/
-				dp++;
-			}
-			/*
-			* Advance source pointer 
-			*/
-			csay++;
-			sstep = (*csay >> 16) * src->pitch;
-			if (flipy) sstep = -sstep;
-			csp = (tColorRGBA *) ((Uint8 *) csp + sstep);
-
-			/*
-			* Advance destination pointers 
-			*/
-			dp = (tColorRGBA *) ((Uint8 *) dp + dgap);
-		}
+		/*
+		* Advance destination pointers 
+		*/
+		dp = (tColorRGBA *) ((Uint8 *) dp + dgap);
 	}
 
 	/*
@@ -575,6 +1047,177 @@ int _zoomSurfaceY(SDL_Surface * src, SDL_Surface * dst, int flipx, int flipy)
 	return (0);
 }
 
+/*!
+\brief Work description of a 32 bit rotozoom.
+*/
+typedef struct tTransformJob {
+	SDL_Surface *src;
+	SDL_Surface *dst;
+	int cx, cy;
+	int isin, icos;
+	int flipx, flipy;
+	int smooth;
+	int ax, ay, xd, yd;
+} tTransformJob;
+
+/*!
+\brief Floor of n / d for d > 0.
+*/
+static Sint64 _floorDiv(Sint64 n, Sint64 d)
+{
+	Sint64 q = n / d;
+
+	if ((n % d) != 0 && n < 0) q--;
+	return q;
+}
+
+/*!
+\brief Narrows [*x0, *x1) to the x for which lo <= ((s + x * d) >> 16) <= hi.
+
+The result stays inside the original range; an empty result has *x0 == *x1.
+*/
+static void _rotozoomClipSpan(int s, int d, int lo, int hi, int *x0, int *x1)
+{
+	Sint64 l = (Sint64) lo * 65536 - s;
+	Sint64 h = (Sint64) hi * 65536 + 0xffff - s;
+	Sint64 a, b;
+
+	if (d > 0) {
+		a = -_floorDiv(-l, d);
+		b = _floorDiv(h, d) + 1;
+	} else if (d < 0) {
+		a = -_floorDiv(h, -d);
+		b = _floorDiv(-l, -d) + 1;
+	} else {
+		a = (l <= 0 && h >= 0) ? *x0 : *x1;
+		b = *x1;
+	}
+	if (a > *x0) *x0 = (a < *x1) ? (int) a : *x1;
+	if (b < *x1) *x1 = (b > *x0) ? (int) b : *x0;
+}
+
+/*!
+\brief Rotozooms one destination pixel near the source edges with anti-aliasing.
+
+Neighbours past the source edges are clamped to the edge.
+*/
+static void _transformPixelRGBA(SDL_Surface * src, tColorRGBA * pc, int sdx, int sdy, int flipx, int flipy)
+{
+	int dx, dy, x1, y1, sw, sh;
+	tColorRGBA c00, c01, c10, c11, cswap, t1, t2;
+	tColorRGBA *row0, *row1;
+
+	dx = (sdx >> 16);
+	dy = (sdy >> 16);
+	if ((dx > -1) && (dy > -1) && (dx < src->w) && (dy < src->h)) {
+		sw = src->w - 1;
+		sh = src->h - 1;
+		if (flipx) dx = sw - dx;
+		if (flipy) dy = sh - dy;
+		x1 = (dx < sw) ? dx + 1 : dx;
+		y1 = (dy < sh) ? dy + 1 : dy;
+		row0 = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
+		row1 = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * y1);
+		c00 = row0[dx];
+		c01 = row0[x1];
+		c10 = row1[dx];
+		c11 = row1[x1];
+		if (flipx) {
+			cswap = c00; c00=c01; c01=cswap;
+			cswap = c10; c10=c11; c11=cswap;
+		}
+		if (flipy) {
+			cswap = c00; c00=c10; c10=cswap;
+			cswap = c01; c01=c11; c11=cswap;
+		}
+		/*
+		* Interpolate colors 
+		*/
+		_lerpRGBA(&t1, &c00, &c01, sdx & 0xffff);
+		_lerpRGBA(&t2, &c10, &c11, sdx & 0xffff);
+		_lerpRGBA(pc, &t1, &t2, sdy & 0xffff);
+	}
+}
+
+/*!
+\brief Rotozooms destination rows y0 to y1-1 of a 32 bit rotozoom.
+
+The rows are walked in tiles of ROTOZOOM_TILE_W x ROTOZOOM_TILE_H pixels. Each tile
+row is split into the run of pixels whose source neighbourhood lies fully inside
+the source, which goes to the kernel without any checks, and the pixels around
+it, which are clipped one by one.
+*/
+static void _transformBandRGBA(void *data, int band, int y0, int y1)
+{
+	tTransformJob *job = (tTransformJob *) data;
+	SDL_Surface *src = job->src;
+	SDL_Surface *dst = job->dst;
+	int sw = src->w - 1;
+	int sh = src->h - 1;
+	int x, y, tx, ty, tw, th, i0, i1, dy, sdx, sdy;
+	int xlo, xhi, ylo, yhi, off, xstep, ystep;
+	Uint32 *pc;
+
+	/*
+	* Source columns and rows inside the source, including their right and lower
+	* neighbours when smoothing, and the byte layout of the mirrored source 
+	*/
+	xlo = ylo = 0;
+	xhi = sw;
+	yhi = sh;
+	off = 0;
+	xstep = 4;
+	ystep = src->pitch;
+	if (job->smooth) {
+		if (job->flipx) xlo = 1; else xhi = sw - 1;
+		if (job->flipy) ylo = 1; else yhi = sh - 1;
+	}
+	if (job->flipx) {
+		off += 4 * (job->smooth ? sw + 1 : sw);
+		xstep = -xstep;
+	}
+	if (job->flipy) {
+		off += src->pitch * (job->smooth ? sh + 1 : sh);
+		ystep = -ystep;
+	}
+
+	for (ty = y0; ty < y1; ty += ROTOZOOM_TILE_H) {
+		th = (y1 - ty < ROTOZOOM_TILE_H) ? y1 - ty : ROTOZOOM_TILE_H;
+		for (tx = 0; tx < dst->w; tx += ROTOZOOM_TILE_W) {
+			tw = (dst->w - tx < ROTOZOOM_TILE_W) ? dst->w - tx : ROTOZOOM_TILE_W;
+			for (y = ty; y < ty + th; y++) {
+				dy = job->cy - y;
+				sdx = (job->ax + (job->isin * dy)) + job->xd;
+				sdy = (job->ay - (job->icos * dy)) + job->yd;
+				pc = (Uint32 *) ((Uint8 *) dst->pixels + dst->pitch * y);
+
+				i0 = tx;
+				i1 = tx + tw;
+				_rotozoomClipSpan(sdx, job->icos, xlo, xhi, &i0, &i1);
+				_rotozoomClipSpan(sdy, job->isin, ylo, yhi, &i0, &i1);
+
+				if (job->smooth) {
+					for (x = tx; x < i0; x++) {
+						_transformPixelRGBA(src, (tColorRGBA *) &pc[x], 
+							sdx + job->icos * x, sdy + job->isin * x, job->flipx, job->flipy);
+					}
+					_transformSpan(pc + i0, (Uint8 *) src->pixels, off, xstep, ystep, 
+						sdx + job->icos * i0, sdy + job->isin * i0, job->icos, job->isin, i1 - i0);
+					for (x = i1; x < tx + tw; x++) {
+						_transformPixelRGBA(src, (tColorRGBA *) &pc[x], 
+							sdx + job->icos * x, sdy + job->isin * x, job->flipx, job->flipy);
+					}
+				} else {
+					for (x = i0; x < i1; x++) {
+						pc[x] = *(Uint32 *) ((Uint8 *) src->pixels + off + 
+							((sdx + job->icos * x) >> 16) * xstep + ((sdy + job->isin * x) >> 16) * ystep);
+					}
+				}
+			}
+		}
+	}
+}
+
 /*! 
 \brief Internal 32 bit rotozoomer with optional anti-aliasing.
 
@@ -596,100 +1239,28 @@ Assumes dst surface was allocated with the correct dimensions.
 */
 void _transformSurfaceRGBA(SDL_Surface * src, SDL_Surface * dst, int cx, int cy, int isin, int icos, int flipx, int flipy, int smooth)
 {
-	int x, y, t1, t2, dx, dy, xd, yd, sdx, sdy, ax, ay, ex, ey, sw, sh;
-	tColorRGBA c00, c01, c10, c11, cswap;
-	tColorRGBA *pc, *sp;
-	int gap;
+	tTransformJob job;
 
-	/*
-	* Variable setup 
-	*/
-	xd = ((src->w - dst->w) << 15);
-	yd = ((src->h - dst->h) << 15);
-	ax = (cx << 16) - (icos * cx);
-	ay = (cy << 16) - (isin * cx);
-	sw = src->w - 1;
-	sh = src->h - 1;
-	pc = (tColorRGBA*) dst->pixels;
-	gap = dst->pitch - dst->w * 4;
+	_rotozoomInitKernels();
 
 	/*
-	* Switch between interpolating and non-interpolating code 
+	* Variable setup 
 	*/
-	if (smooth) {
-		for (y = 0; y < dst->h; y++) {
-			dy = cy - y;
-			sdx = (ax + (isin * dy)) + xd;
-			sdy = (ay - (icos * dy)) + yd;
-			for (x = 0; x < dst->w; x++) {
-				dx = (sdx >> 16);
-				dy = (sdy >> 16);
-				if ((dx > -1) && (dy > -1) && (dx < src->w) && (dy < src->h)) {
-					if (flipx) dx = sw - dx;
-					if (flipy) dy = sh - dy;
-					sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
-					sp += dx;
-					c00 = *sp;
-					sp += 1;
-					c01 = *sp;
-					sp = (tColorRGBA *) ((Uint8 *) sp + src->pitch);
-					c11 = *sp;
-					sp -= 1;
-					c10 = *sp;
-					if (flipx) {
-						cswap = c00; c00=c01; c01=cswap;
-						cswap = c10; c10=c11; c11=cswap;
-					}
-					if (flipy) {
-						cswap = c00; c00=c10; c10=cswap;
-						cswap = c01; c01=c11; c11=cswap;
-					}
-					/*
-					* Interpolate colors 
-					*/
-					ex = (sdx & 0xffff);
-					ey = (sdy & 0xffff);
-					t1 = ((((c01.r - c00.r) * ex) >> 16) + c00.r) & 0xff;
-					t2 = ((((c11.r - c10.r) * ex) >> 16) + c10.r) & 0xff;
-					pc->r = (((t2 - t1) * ey) >> 16) + t1;
-					t1 = ((((c01.g - c00.g) * ex) >> 16) + c00.g) & 0xff;
-					t2 = ((((c11.g - c10.g) * ex) >> 16) + c10.g) & 0xff;
-					pc->g = (((t2 - t1) * ey) >> 16) + t1;
-					t1 = ((((c01.b - c00.b) * ex) >> 16) + c00.b) & 0xff;
-					t2 = ((((c11.b - c10.b) * ex) >> 16) + c10.b) & 0xff;
-					pc->b = (((t2 - t1) * ey) >> 16) + t1;
-					t1 = ((((c01.a - c00.a) * ex) >> 16) + c00.a) & 0xff;
-					t2 = ((((c11.a - c10.a) * ex) >> 16) + c10.a) & 0xff;
-					pc->a = (((t2 - t1) * ey) >> 16) + t1;
-				}
-				sdx += icos;
-				sdy += isin;
-				pc++;
-			}
-			pc = (tColorRGBA *) ((Uint8 *) pc + gap);
-		}
-	} else {
-		for (y = 0; y < dst->h; y++) {
-			dy = cy - y;
-			sdx = (ax + (isin * dy)) + xd;
-			sdy = (ay - (icos * dy)) + yd;
-			for (x = 0; x < dst->w; x++) {
-				dx = (short) (sdx >> 16);
-				dy = (short) (sdy >> 16);
-				if (flipx) dx = (src->w-1)-dx;
-				if (flipy) dy = (src->h-1)-dy;
-				if ((dx >= 0) && (dy >= 0) && (dx < src->w) && (dy < src->h)) {
-					sp = (tColorRGBA *) ((Uint8 *) src->pixels + src->pitch * dy);
-					sp += dx;
-					*pc = *sp;
-				}
-				sdx += icos;
-				sdy += isin;
-				pc++;
-			}
-			pc = (tColorRGBA *) ((Uint8 *) pc + gap);
-		}
-	}
+	job.src = src;
+	job.dst = dst;
+	job.cx = cx;
+	job.cy = cy;
+	job.isin = isin;
+	job.icos = icos;
+	job.flipx = flipx;
+	job.flipy = flipy;
+	job.smooth = smooth;
+	job.xd = ((src->w - dst->w) << 15);
+	job.yd = ((src->h - dst->h) << 15);
+	job.ax = (cx << 16) - (icos * cx);
+	job.ay = (cy << 16) - (isin * cx);
+
+	_rotozoomRun(_transformBandRGBA, &job, dst->h, _rotozoomBands(dst));
 }
 
 /*!
@@ -1591,3 +2162,159 @@ SDL_Surface *shrinkSurface(SDL_Surface *src, int factorx, int factory)
 	rz_dst->h -= GUARD_ROWS;
 	return (rz_dst);
 }
+
+#ifdef TEST_MAIN
+
+#include <stdio.h>
+
+/*!
+\brief A surface to time: a zoom, a rotozoom (angle != 0) or an integer shrink.
+*/
+typedef struct tRotozoomTest {
+	const char *name;
+	int w, h;
+	double angle, zoom;
+	int shrink;
+} tRotozoomTest;
+
+/*!
+\brief A set of row kernels and a thread count to time the cases with.
+*/
+typedef struct tRotozoomTestPath {
+	const char *name;
+	void (*blend)(Uint8 *dp, const Uint8 *t1, const Uint8 *t2, int ey, int n);
+	void (*interp)(Uint32 *dp, const Uint32 *sp, const int *xa, const int *xb, const Uint16 *ex, int n);
+	void (*span)(Uint32 *dp, const Uint8 *pixels, int off, int xstep, int ystep, 
+		int sdx, int sdy, int icos, int isin, int n);
+	int threads;
+} tRotozoomTestPath;
+
+/* The sprite and full screen sizes the kernels were tuned on */
+static const tRotozoomTest _rotozoomTests[] = {
+	{ "256x256 zoom 2.0", 256, 256, 0.0, 2.0, 0 },
+	{ "640x480 zoom 0.3", 640, 480, 0.0, 0.3, 0 },
+	{ "640x480 zoom 0.9", 640, 480, 0.0, 0.9, 0 },
+	{ "640x480 zoom 2.0", 640, 480, 0.0, 2.0, 0 },
+	{ "256x256 rotozoom", 256, 256, 30.0, 1.0, 0 },
+	{ "640x480 rotozoom", 640, 480, 30.0, 1.0, 0 },
+	{ "256x256 shrink 2", 256, 256, 0.0, 1.0, 2 },
+	{ "640x480 shrink 2", 640, 480, 0.0, 1.0, 2 },
+};
+
+/*!
+\brief Returns the average time of one call in microseconds.
+*/
+static double _rotozoomTestTime(const tRotozoomTest *t, SDL_Surface *src, SDL_Surface *dst, int isin, int icos)
+{
+	Uint32 start, ticks;
+	int n = 0;
+
+	start = SDL_GetTicks();
+	do {
+		if (t->shrink) {
+			_shrinkSurfaceRGBA(src, dst, t->shrink, t->shrink);
+		} else if (t->angle != 0.0) {
+			_transformSurfaceRGBA(src, dst, dst->w / 2, (dst->h - GUARD_ROWS) / 2, isin, icos, 0, 0, 1);
+		} else {
+			_zoomSurfaceRGBA(src, dst, 0, 0, 1);
+		}
+		n++;
+		ticks = SDL_GetTicks() - start;
+	} while (ticks < 300);
+	return ticks * 1000.0 / n;
+}
+
+int main(int argc, char *argv[])
+{
+	tRotozoomTestPath paths[8];
+	int npaths = 0;
+	int i, j, x, y, w, h, isin, icos;
+	double c, s;
+	SDL_Surface *src, *dst;
+
+	if (SDL_Init(SDL_INIT_TIMER) < 0) {
+		printf("SDL_Init: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	paths[npaths].name = "C";
+	paths[npaths].blend = _zoomBlendRowC;
+	paths[npaths].interp = _zoomInterpRowC;
+	paths[npaths].span = _transformSpanC;
+	paths[npaths++].threads = 1;
+#ifdef __SSE2__
+	paths[npaths].name = "SSE2";
+	paths[npaths].blend = _zoomBlendRowSSE2;
+	paths[npaths].interp = _zoomInterpRowSSE2;
+	paths[npaths].span = _transformSpanSSE2;
+	paths[npaths++].threads = 1;
+#endif
+#if defined(GFX_NEON)
+	if (SDL_HasNEON()) {
+		paths[npaths].name = "NEON";
+		paths[npaths].blend = _zoomBlendRowNEON;
+		paths[npaths].interp = _zoomInterpRowNEON;
+		paths[npaths].span = _transformSpanNEON;
+		paths[npaths++].threads = 1;
+	}
+#endif
+	/* The fastest kernels again, split over 4 threads */
+	paths[npaths] = paths[npaths - 1];
+	paths[npaths++].threads = 4;
+
+	printf("%-20s", "us per call");
+	for (j = 0; j < npaths; j++) {
+		printf(" %7s%s", paths[j].name, paths[j].threads > 1 ? "x4" : "  ");
+	}
+	printf("\n");
+
+	for (i = 0; i < (int)(sizeof(_rotozoomTests) / sizeof(_rotozoomTests[0])); i++) {
+		const tRotozoomTest *t = &_rotozoomTests[i];
+
+		isin = icos = 0;
+		if (t->shrink) {
+			w = t->w / t->shrink;
+			h = t->h / t->shrink;
+		} else if (t->angle != 0.0) {
+			_rotozoomSurfaceSizeTrig(t->w, t->h, t->angle, t->zoom, t->zoom, &w, &h, &c, &s);
+			isin = (int)(s * 65536.0 / (t->zoom * t->zoom));
+			icos = (int)(c * 65536.0 / (t->zoom * t->zoom));
+		} else {
+			zoomSurfaceSize(t->w, t->h, t->zoom, t->zoom, &w, &h);
+		}
+		src = SDL_CreateRGBSurface(SDL_SWSURFACE, t->w, t->h, 32, 
+			0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+		dst = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h + (t->shrink ? 0 : GUARD_ROWS), 32, 
+			0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+		if (src == NULL || dst == NULL) {
+			printf("SDL_CreateRGBSurface: %s\n", SDL_GetError());
+			return 1;
+		}
+		for (y = 0; y < src->h; y++) {
+			Uint32 *p = (Uint32 *)((Uint8 *)src->pixels + y * src->pitch);
+			for (x = 0; x < src->w; x++) {
+				p[x] = (Uint32)(x * 2654435761u ^ y * 40503u);
+			}
+		}
+
+		printf("%-20s", t->name);
+		for (j = 0; j < npaths; j++) {
+			_zoomBlendRow = paths[j].blend;
+			_zoomInterpRow = paths[j].interp;
+			_transformSpan = paths[j].span;
+			rotozoomSetThreads(paths[j].threads);
+			printf(" %9.1f", _rotozoomTestTime(t, src, dst, isin, icos));
+			fflush(stdout);
+		}
+		printf("\n");
+
+		SDL_FreeSurface(src);
+		SDL_FreeSurface(dst);
+	}
+	rotozoomSetThreads(1);
+
+	SDL_Quit();
+	return 0;
+}
+
+#endif /* TEST_MAIN */
@@ -0,0 +1,116 @@
+/*  
+
+SDL_rotozoom_neon.c - NEON kernels for the 32 bit smooth zoomer and rotozoomer
+
+LGPL (c) A. Schiffler
+
+*/
+
+/*
+On armeabi-v7a this is the only sdl_gfx file built with NEON enabled,
+SDL_rotozoom.c calls into it only when SDL_HasNEON() is true.
+Leftover pixels are done here in plain C with the same arithmetic.
+*/
+
+#include "SDL_rotozoom_neon.h"
+
+#ifdef GFX_NEON
+
+#include <arm_neon.h>
+
+/*!
+\brief Interpolates 16 bit lanes: ((b - a) * e >> 16) + a.
+
+The weights are unsigned 16 bit values; lanes above 32767 come out of the
+signed multiply short by exactly (b - a), which is added back.
+*/
+static int16x8_t _lerpNEON(int16x8_t a, int16x8_t b, int16x8_t e)
+{
+	int16x8_t d = vsubq_s16(b, a);
+	int16x4_t lo = vshrn_n_s32(vmull_s16(vget_low_s16(d), vget_low_s16(e)), 16);
+	int16x4_t hi = vshrn_n_s32(vmull_s16(vget_high_s16(d), vget_high_s16(e)), 16);
+
+	return vaddq_s16(a, vaddq_s16(vcombine_s16(lo, hi), vandq_s16(d, vshrq_n_s16(e, 15))));
+}
+
+/*!
+\brief Widens two 32 bit pixels to 16 bit lanes.
+*/
+static int16x8_t _pairNEON(Uint32 p0, Uint32 p1)
+{
+	return vreinterpretq_s16_u16(vmovl_u8(vcreate_u8((Uint64)p0 | ((Uint64)p1 << 32))));
+}
+
+/*!
+\brief Weights for two pixels, one per group of four lanes.
+*/
+static int16x8_t _weightsNEON(int e0, int e1)
+{
+	return vcombine_s16(vdup_n_s16((Sint16)e0), vdup_n_s16((Sint16)e1));
+}
+
+static void _lerpPixel(Uint8 *dp, const Uint8 *c0, const Uint8 *c1, int e)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		dp[i] = (((c1[i] - c0[i]) * e) >> 16) + c0[i];
+	}
+}
+
+void _zoomBlendRowNEON(Uint8 *dp, const Uint8 *t1, const Uint8 *t2, int ey, int n)
+{
+	const int16x8_t e = vdupq_n_s16((Sint16)ey);
+
+	for (; n >= 8; n -= 8, dp += 8, t1 += 8, t2 += 8) {
+		int16x8_t a = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(t1)));
+		int16x8_t b = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(t2)));
+		vst1_u8(dp, vqmovun_s16(_lerpNEON(a, b, e)));
+	}
+	for (; n > 0; n--) {
+		*dp++ = (((*t2++ - *t1) * ey) >> 16) + *t1;
+		t1++;
+	}
+}
+
+void _zoomInterpRowNEON(Uint32 *dp, const Uint32 *sp, const int *xa, const int *xb, const Uint16 *ex, int n)
+{
+	for (; n >= 2; n -= 2, dp += 2, xa += 2, xb += 2, ex += 2) {
+		int16x8_t r = _lerpNEON(_pairNEON(sp[xa[0]], sp[xa[1]]), _pairNEON(sp[xb[0]], sp[xb[1]]), 
+			_weightsNEON(ex[0], ex[1]));
+		vst1_u8((Uint8 *)dp, vqmovun_s16(r));
+	}
+	if (n) {
+		_lerpPixel((Uint8 *)dp, (const Uint8 *)&sp[*xa], (const Uint8 *)&sp[*xb], *ex);
+	}
+}
+
+void _transformSpanNEON(Uint32 *dp, const Uint8 *pixels, int off, int xstep, int ystep, 
+	int sdx, int sdy, int icos, int isin, int n)
+{
+	const Uint8 *p0, *p1;
+	int16x8_t ex, ey, t1, t2;
+	Uint8 c0[4], c1[4];
+
+	for (; n >= 2; n -= 2, dp += 2) {
+		p0 = pixels + off + (sdx >> 16) * xstep + (sdy >> 16) * ystep;
+		p1 = pixels + off + ((sdx + icos) >> 16) * xstep + ((sdy + isin) >> 16) * ystep;
+		ex = _weightsNEON(sdx & 0xffff, (sdx + icos) & 0xffff);
+		ey = _weightsNEON(sdy & 0xffff, (sdy + isin) & 0xffff);
+		t1 = _lerpNEON(_pairNEON(*(const Uint32 *)p0, *(const Uint32 *)p1), 
+			_pairNEON(*(const Uint32 *)(p0 + xstep), *(const Uint32 *)(p1 + xstep)), ex);
+		t2 = _lerpNEON(_pairNEON(*(const Uint32 *)(p0 + ystep), *(const Uint32 *)(p1 + ystep)), 
+			_pairNEON(*(const Uint32 *)(p0 + ystep + xstep), *(const Uint32 *)(p1 + ystep + xstep)), ex);
+		vst1_u8((Uint8 *)dp, vqmovun_s16(_lerpNEON(t1, t2, ey)));
+		sdx += 2 * icos;
+		sdy += 2 * isin;
+	}
+	if (n) {
+		p0 = pixels + off + (sdx >> 16) * xstep + (sdy >> 16) * ystep;
+		_lerpPixel(c0, p0, p0 + xstep, sdx & 0xffff);
+		_lerpPixel(c1, p0 + ystep, p0 + ystep + xstep, sdx & 0xffff);
+		_lerpPixel((Uint8 *)dp, c0, c1, sdy & 0xffff);
+	}
+}
+
+#endif /* GFX_NEON */
@@ -0,0 +1,26 @@
+/*  
+
+SDL_rotozoom_neon.h - NEON kernels for the 32 bit smooth zoomer and rotozoomer
+
+LGPL (c) A. Schiffler
+
+*/
+
+#ifndef _SDL_rotozoom_neon_h
+#define _SDL_rotozoom_neon_h
+
+#include "SDL.h"
+
+/* 
+These match the C kernels in SDL_rotozoom.c bit for bit: every weight
+is applied as ((c1 - c0) * e >> 16) + c0 with e in 0..65535.
+*/
+
+#ifdef GFX_NEON
+void _zoomBlendRowNEON(Uint8 *dp, const Uint8 *t1, const Uint8 *t2, int ey, int n);
+void _zoomInterpRowNEON(Uint32 *dp, const Uint32 *sp, const int *xa, const int *xb, const Uint16 *ex, int n);
+void _transformSpanNEON(Uint32 *dp, const Uint8 *pixels, int off, int xstep, int ystep, 
+	int sdx, int sdy, int icos, int isin, int n);
+#endif
+
+#endif				/* _SDL_rotozoom_neon_h */
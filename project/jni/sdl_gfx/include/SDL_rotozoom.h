@@ -95,6 +95,12 @@ extern "C" {
 
 	SDL_ROTOZOOM_SCOPE SDL_Surface* rotateSurface90Degrees(SDL_Surface* src, int numClockwiseTurns);
 
+	/* 
+	Threading
+	*/
+
+	SDL_ROTOZOOM_SCOPE int rotozoomSetThreads(int threads);
+
 	/* Ends C function definitions when using C++ */
 #ifdef __cplusplus
 }
@@ -96,7 +96,11 @@ int IMG_Init(int flags)
 			result |= IMG_INIT_WEBP;
 		}
 	}
-	initialized |= result;
+	/* The loaders call this on every image, possibly from batch worker
+	   threads, so only write when something new was initialized */
+	if ( result & ~initialized ) {
+		initialized |= result;
+	}
 
 	return (initialized);
 }
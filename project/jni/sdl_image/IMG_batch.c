@@ -0,0 +1,660 @@
+/*
+  SDL_image:  An example image loading library for use with SDL
+  Copyright (C) 1997-2012 Sam Lantinga <slouken@libsdl.org>
+
+  This software is provided 'as-is', without any express or implied
+  warranty.  In no event will the authors be held liable for any damages
+  arising from the use of this software.
+
+  Permission is granted to anyone to use this software for any purpose,
+  including commercial applications, and to alter it and redistribute it
+  freely, subject to the following restrictions:
+
+  1. The origin of this software must not be misrepresented; you must not
+     claim that you wrote the original software. If you use this software
+     in a product, an acknowledgment in the product documentation would be
+     appreciated but is not required.
+  2. Altered source versions must be plainly marked as such, and must not be
+     misrepresented as being the original software.
+  3. This notice may not be removed or altered from any source distribution.
+*/
+
+/* Background batch loading of image files, with an optional disk cache
+   of decoded surfaces */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "SDL_image.h"
+#include "SDL_thread.h"
+#include "SDL_mutex.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define IMG_DISK_CACHE
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define IMG_BATCH_MAX_THREADS	8
+
+/* Per-file state */
+enum {
+	IMG_BATCH_PENDING,
+	IMG_BATCH_READY,
+	IMG_BATCH_FAILED,
+	IMG_BATCH_TAKEN
+};
+
+struct _IMG_Batch {
+	int count;
+	char **files;
+	SDL_Surface **surfaces;
+	char **errors;
+	int *state;
+
+	int flags;
+	int next;		/* next file a worker will pick up */
+	int done;		/* files finished, successfully or not */
+	int cancel;
+	SDL_mutex *lock;
+	SDL_cond *cond;
+	int nthreads;
+	SDL_Thread *threads[IMG_BATCH_MAX_THREADS];
+
+	/* 1x1 surfaces carrying the pixel formats decoded images are
+	   converted to, or NULL to keep the decoder's format */
+	SDL_Surface *opaque;
+	SDL_Surface *alpha;
+
+	char *cachedir;
+};
+
+/* The GIF and XPM decoders keep their state in static variables */
+static SDL_mutex *serial_lock = NULL;
+
+static char *cache_dir = NULL;
+
+int IMG_SetCacheDir(const char *dir)
+{
+#ifdef IMG_DISK_CACHE
+	if ( cache_dir ) {
+		SDL_free(cache_dir);
+		cache_dir = NULL;
+	}
+	if ( dir && *dir ) {
+		if ( mkdir(dir, 0755) < 0 ) {
+			struct stat st;
+			if ( stat(dir, &st) < 0 || !S_ISDIR(st.st_mode) ) {
+				IMG_SetError("Can't create cache directory %s", dir);
+				return(-1);
+			}
+		}
+		cache_dir = SDL_strdup(dir);
+	}
+	return(0);
+#else
+	if ( dir && *dir ) {
+		IMG_SetError("Image cache not supported on this platform");
+		return(-1);
+	}
+	return(0);
+#endif
+}
+
+#ifdef IMG_DISK_CACHE
+
+/*
+ * Cache files hold the converted surface as raw rows after a fixed
+ * header, with the pixels aligned so the file can be mapped and copied
+ * straight into a new surface.  The name is a hash of the source path,
+ * its size and mtime and the target pixel format; the header repeats
+ * the size and mtime so a stale or colliding entry is never used.
+ */
+#define IMG_CACHE_MAGIC		"SDLIMG01"
+#define IMG_CACHE_ALIGN		64
+#define IMG_CACHE_COLORKEY	0x01
+
+typedef struct {
+	char magic[8];
+	Uint32 w, h, pitch;
+	Uint32 bpp;
+	Uint32 Rmask, Gmask, Bmask, Amask;
+	Uint32 flags;		/* SDL_SRCCOLORKEY | SDL_SRCALPHA, IMG_CACHE_COLORKEY on 1.3 */
+	Uint32 colorkey;
+	Uint32 alpha;		/* per-surface alpha, the alpha mod on 1.3 */
+	Uint32 offset;		/* of the first row */
+	Uint32 srcsize;
+	Uint32 srcmtime;
+	Uint32 reserved;
+} IMG_CacheHeader;
+
+static Uint64 cache_hash(Uint64 h, const void *data, size_t len)
+{
+	const Uint8 *p = (const Uint8 *)data;
+	while ( len-- ) {
+		h ^= *p++;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
+
+static Uint64 cache_hash_format(Uint64 h, const SDL_Surface *target)
+{
+	Uint32 key[5];
+
+	SDL_memset(key, 0, sizeof(key));
+	if ( target ) {
+		key[0] = target->format->BitsPerPixel;
+		key[1] = target->format->Rmask;
+		key[2] = target->format->Gmask;
+		key[3] = target->format->Bmask;
+		key[4] = target->format->Amask;
+	}
+	return cache_hash(h, key, sizeof(key));
+}
+
+static void cache_path(char *path, size_t maxlen, const IMG_Batch *batch,
+                       const char *file, const struct stat *st)
+{
+	Uint64 h = 0xcbf29ce484222325ULL;
+	Uint32 key[2];
+
+	key[0] = (Uint32)st->st_size;
+	key[1] = (Uint32)st->st_mtime;
+	h = cache_hash(h, file, SDL_strlen(file));
+	h = cache_hash(h, key, sizeof(key));
+	h = cache_hash_format(h, batch->opaque);
+	h = cache_hash_format(h, batch->alpha);
+	SDL_snprintf(path, maxlen, "%s/%08x%08x.sdlimg", batch->cachedir,
+	             (Uint32)(h >> 32), (Uint32)h);
+}
+
+static SDL_Surface *cache_read(const char *path, const struct stat *st)
+{
+	SDL_Surface *surface = NULL;
+	const IMG_CacheHeader *hdr;
+	struct stat cst;
+	Uint8 *map;
+	int fd, y;
+
+	fd = open(path, O_RDONLY);
+	if ( fd < 0 ) {
+		return(NULL);
+	}
+	if ( fstat(fd, &cst) < 0 || cst.st_size < (off_t)sizeof(*hdr) ) {
+		close(fd);
+		return(NULL);
+	}
+	map = (Uint8 *)mmap(NULL, cst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if ( map == MAP_FAILED ) {
+		return(NULL);
+	}
+
+	hdr = (const IMG_CacheHeader *)map;
+	if ( SDL_memcmp(hdr->magic, IMG_CACHE_MAGIC, 8) == 0 &&
+	     hdr->srcsize == (Uint32)st->st_size &&
+	     hdr->srcmtime == (Uint32)st->st_mtime &&
+	     hdr->offset >= sizeof(*hdr) &&
+	     (Uint64)hdr->offset + (Uint64)hdr->pitch * hdr->h <= (Uint64)cst.st_size ) {
+		surface = SDL_CreateRGBSurface(SDL_SWSURFACE, hdr->w, hdr->h,
+		                               hdr->bpp, hdr->Rmask, hdr->Gmask,
+		                               hdr->Bmask, hdr->Amask);
+	}
+	if ( surface ) {
+		Uint32 len = surface->w * surface->format->BytesPerPixel;
+		if ( len > hdr->pitch ) {
+			SDL_FreeSurface(surface);
+			surface = NULL;
+		} else {
+			for ( y = 0; y < surface->h; ++y ) {
+				SDL_memcpy((Uint8 *)surface->pixels + y * surface->pitch,
+				           map + hdr->offset + y * hdr->pitch, len);
+			}
+#if SDL_VERSION_ATLEAST(1,3,0)
+			/* The blend mode follows from Amask, as for the
+			   surface that was cached */
+			if ( hdr->flags & IMG_CACHE_COLORKEY ) {
+				SDL_SetColorKey(surface, 1, hdr->colorkey);
+			}
+			SDL_SetSurfaceAlphaMod(surface, (Uint8)hdr->alpha);
+#else
+			if ( hdr->flags & SDL_SRCCOLORKEY ) {
+				SDL_SetColorKey(surface, SDL_SRCCOLORKEY, hdr->colorkey);
+			}
+			if ( hdr->flags & SDL_SRCALPHA ) {
+				SDL_SetAlpha(surface, SDL_SRCALPHA, (Uint8)hdr->alpha);
+			} else {
+				SDL_SetAlpha(surface, 0, 0);
+			}
+#endif
+		}
+	}
+	munmap(map, cst.st_size);
+	return(surface);
+}
+
+static void cache_write(const char *path, const struct stat *st,
+                        SDL_Surface *surface)
+{
+	IMG_CacheHeader hdr;
+	Uint8 pad[IMG_CACHE_ALIGN];
+	char tmp[1024];
+	FILE *fp;
+	Uint32 len;
+	int y, ok;
+
+	if ( surface->format->BitsPerPixel <= 8 ) {
+		/* Palettes aren't stored */
+		return;
+	}
+
+	SDL_memset(&hdr, 0, sizeof(hdr));
+	SDL_memcpy(hdr.magic, IMG_CACHE_MAGIC, 8);
+	len = surface->w * surface->format->BytesPerPixel;
+	hdr.w = surface->w;
+	hdr.h = surface->h;
+	hdr.pitch = (len + 3) & ~3;
+	hdr.bpp = surface->format->BitsPerPixel;
+	hdr.Rmask = surface->format->Rmask;
+	hdr.Gmask = surface->format->Gmask;
+	hdr.Bmask = surface->format->Bmask;
+	hdr.Amask = surface->format->Amask;
+#if SDL_VERSION_ATLEAST(1,3,0)
+	{
+		Uint32 colorkey;
+		Uint8 alpha = 255;
+		if ( SDL_GetColorKey(surface, &colorkey) == 0 ) {
+			hdr.flags = IMG_CACHE_COLORKEY;
+			hdr.colorkey = colorkey;
+		}
+		SDL_GetSurfaceAlphaMod(surface, &alpha);
+		hdr.alpha = alpha;
+	}
+#else
+	hdr.flags = surface->flags & (SDL_SRCCOLORKEY | SDL_SRCALPHA);
+	hdr.colorkey = surface->format->colorkey;
+	hdr.alpha = surface->format->alpha;
+#endif
+	hdr.offset = (sizeof(hdr) + IMG_CACHE_ALIGN - 1) & ~(IMG_CACHE_ALIGN - 1);
+	hdr.srcsize = (Uint32)st->st_size;
+	hdr.srcmtime = (Uint32)st->st_mtime;
+
+	/* Write to a private name and rename, so readers never see a
+	   partial file */
+	SDL_snprintf(tmp, sizeof(tmp), "%s.%lu", path, (unsigned long)SDL_ThreadID());
+	fp = fopen(tmp, "wb");
+	if ( !fp ) {
+		return;
+	}
+	SDL_memset(pad, 0, sizeof(pad));
+	ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1 &&
+	     fwrite(pad, hdr.offset - sizeof(hdr), 1, fp) == 1;
+	for ( y = 0; ok && y < surface->h; ++y ) {
+		ok = fwrite((Uint8 *)surface->pixels + y * surface->pitch, len, 1, fp) == 1 &&
+		     (hdr.pitch == len || fwrite(pad, hdr.pitch - len, 1, fp) == 1);
+	}
+	if ( fclose(fp) != 0 ) {
+		ok = 0;
+	}
+	if ( !ok || rename(tmp, path) < 0 ) {
+		remove(tmp);
+	}
+}
+
+#endif /* IMG_DISK_CACHE */
+
+/* Convert a freshly decoded image to the batch's target format */
+static SDL_Surface *IMG_BatchConvert(IMG_Batch *batch, SDL_Surface *image)
+{
+	SDL_Surface *target, *converted;
+	SDL_PixelFormat *sf, *tf;
+
+	target = image->format->Amask ? batch->alpha : batch->opaque;
+	if ( !target ) {
+		return(image);
+	}
+	sf = image->format;
+	tf = target->format;
+	if ( sf->BitsPerPixel == tf->BitsPerPixel &&
+	     sf->Rmask == tf->Rmask && sf->Gmask == tf->Gmask &&
+	     sf->Bmask == tf->Bmask && sf->Amask == tf->Amask ) {
+		return(image);
+	}
+	/* A software target keeps the blit free of any video driver calls */
+	converted = SDL_ConvertSurface(image, tf, SDL_SWSURFACE);
+	SDL_FreeSurface(image);
+	return(converted);
+}
+
+static SDL_Surface *IMG_BatchLoadFile(IMG_Batch *batch, const char *file)
+{
+	SDL_RWops *src;
+	SDL_Surface *image;
+	const char *ext;
+	int serial;
+#ifdef IMG_DISK_CACHE
+	char path[1024];
+	struct stat st;
+	int cacheable = 0;
+
+	if ( batch->cachedir && stat(file, &st) == 0 ) {
+		cache_path(path, sizeof(path), batch, file, &st);
+		image = cache_read(path, &st);
+		if ( image ) {
+			return(image);
+		}
+		cacheable = 1;
+	}
+#endif
+
+	src = SDL_RWFromFile(file, "rb");
+	if ( !src ) {
+		return(NULL);
+	}
+	ext = SDL_strrchr(file, '.');
+	if ( ext ) {
+		ext++;
+	}
+	serial = IMG_isGIF(src) || IMG_isXPM(src);
+	if ( serial ) {
+		SDL_mutexP(serial_lock);
+	}
+	image = IMG_LoadTyped_RW(src, 1, ext);
+	if ( serial ) {
+		SDL_mutexV(serial_lock);
+	}
+	if ( image ) {
+		image = IMG_BatchConvert(batch, image);
+	}
+#ifdef IMG_DISK_CACHE
+	if ( image && cacheable ) {
+		cache_write(path, &st, image);
+	}
+#endif
+	return(image);
+}
+
+static int SDLCALL IMG_BatchThread(void *data)
+{
+	IMG_Batch *batch = (IMG_Batch *)data;
+	SDL_Surface *image;
+	int i;
+
+	SDL_mutexP(batch->lock);
+	while ( !batch->cancel && batch->next < batch->count ) {
+		i = batch->next++;
+		SDL_mutexV(batch->lock);
+
+		image = IMG_BatchLoadFile(batch, batch->files[i]);
+
+		SDL_mutexP(batch->lock);
+		if ( image ) {
+			batch->surfaces[i] = image;
+			batch->state[i] = IMG_BATCH_READY;
+		} else {
+			/* The error string is per thread, keep a copy for the caller */
+			batch->errors[i] = SDL_strdup(IMG_GetError());
+			batch->state[i] = IMG_BATCH_FAILED;
+		}
+		batch->done++;
+		SDL_CondBroadcast(batch->cond);
+	}
+	SDL_mutexV(batch->lock);
+	return(0);
+}
+
+#if !SDL_VERSION_ATLEAST(1,3,0)
+/* Pick the formats SDL_DisplayFormat() and SDL_DisplayFormatAlpha()
+   would convert to, so the final conversion is a plain copy */
+static void IMG_BatchSetFormats(IMG_Batch *batch)
+{
+	SDL_Surface *screen = SDL_GetVideoSurface();
+	SDL_PixelFormat *vf;
+	Uint32 rmask = 0x00ff0000;
+	Uint32 bmask = 0x000000ff;
+
+	if ( !screen ) {
+		return;
+	}
+	vf = screen->format;
+	if ( vf->BitsPerPixel > 8 ) {
+		batch->opaque = SDL_CreateRGBSurface(SDL_SWSURFACE, 1, 1,
+		                                     vf->BitsPerPixel, vf->Rmask,
+		                                     vf->Gmask, vf->Bmask, vf->Amask);
+	}
+	switch ( vf->BytesPerPixel ) {
+	    case 2:
+		if ( vf->Rmask == 0x1f &&
+		     (vf->Bmask == 0xf800 || vf->Bmask == 0x7c00) ) {
+			rmask = 0xff;
+			bmask = 0xff0000;
+		}
+		break;
+	    case 3:
+	    case 4:
+		if ( vf->Rmask == 0xff && vf->Bmask == 0xff0000 ) {
+			rmask = 0xff;
+			bmask = 0xff0000;
+		}
+		break;
+	}
+	batch->alpha = SDL_CreateRGBSurface(SDL_SWSURFACE, 1, 1, 32,
+	                                    rmask, 0x0000ff00, bmask, 0xff000000);
+}
+#endif
+
+IMG_Batch *IMG_LoadBatch(const char **files, int count, int threads, int flags)
+{
+	IMG_Batch *batch;
+	int i;
+
+	if ( !files || count < 0 ) {
+		IMG_SetError("Passed a NULL file list");
+		return(NULL);
+	}
+	if ( threads <= 0 ) {
+#if defined(IMG_DISK_CACHE) && defined(_SC_NPROCESSORS_ONLN)
+		threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+		if ( threads <= 0 ) {
+			threads = 2;
+		}
+	}
+	if ( threads > IMG_BATCH_MAX_THREADS ) {
+		threads = IMG_BATCH_MAX_THREADS;
+	}
+	if ( threads > count ) {
+		threads = count;
+	}
+
+	/* Decoder libraries must be set up before several threads race
+	   through the lazy initialization in the loaders */
+	IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG | IMG_INIT_TIF | IMG_INIT_WEBP);
+	if ( !serial_lock ) {
+		serial_lock = SDL_CreateMutex();
+		if ( !serial_lock ) {
+			return(NULL);
+		}
+	}
+
+	batch = (IMG_Batch *)SDL_calloc(1, sizeof(*batch));
+	if ( !batch ) {
+		SDL_OutOfMemory();
+		return(NULL);
+	}
+	batch->count = count;
+	batch->flags = flags;
+	batch->files = (char **)SDL_calloc(count + 1, sizeof(char *));
+	batch->surfaces = (SDL_Surface **)SDL_calloc(count + 1, sizeof(SDL_Surface *));
+	batch->errors = (char **)SDL_calloc(count + 1, sizeof(char *));
+	batch->state = (int *)SDL_calloc(count + 1, sizeof(int));
+	batch->lock = SDL_CreateMutex();
+	batch->cond = SDL_CreateCond();
+	if ( !batch->files || !batch->surfaces || !batch->errors ||
+	     !batch->state || !batch->lock || !batch->cond ) {
+		SDL_OutOfMemory();
+		IMG_FreeBatch(batch);
+		return(NULL);
+	}
+	for ( i = 0; i < count; ++i ) {
+		batch->files[i] = SDL_strdup(files[i] ? files[i] : "");
+		if ( !batch->files[i] ) {
+			SDL_OutOfMemory();
+			IMG_FreeBatch(batch);
+			return(NULL);
+		}
+	}
+	if ( cache_dir ) {
+		batch->cachedir = SDL_strdup(cache_dir);
+	}
+#if !SDL_VERSION_ATLEAST(1,3,0)
+	if ( flags & IMG_BATCH_DISPLAY_FORMAT ) {
+		IMG_BatchSetFormats(batch);
+	}
+#endif
+
+	for ( i = 0; i < threads; ++i ) {
+#if SDL_VERSION_ATLEAST(1,3,0)
+		batch->threads[i] = SDL_CreateThread(IMG_BatchThread, "IMG_Batch", batch);
+#else
+		batch->threads[i] = SDL_CreateThread(IMG_BatchThread, batch);
+#endif
+		if ( !batch->threads[i] ) {
+			break;
+		}
+		batch->nthreads++;
+	}
+	if ( batch->nthreads == 0 && count > 0 ) {
+		/* No threads available, decode everything right here */
+		IMG_BatchThread(batch);
+	}
+	return(batch);
+}
+
+int IMG_BatchCount(IMG_Batch *batch)
+{
+	return batch ? batch->count : 0;
+}
+
+int IMG_BatchDone(IMG_Batch *batch)
+{
+	int done;
+
+	if ( !batch ) {
+		return(0);
+	}
+	SDL_mutexP(batch->lock);
+	done = batch->done;
+	SDL_mutexV(batch->lock);
+	return(done);
+}
+
+void IMG_BatchWait(IMG_Batch *batch)
+{
+	if ( !batch ) {
+		return;
+	}
+	SDL_mutexP(batch->lock);
+	while ( batch->done < batch->count ) {
+		SDL_CondWait(batch->cond, batch->lock);
+	}
+	SDL_mutexV(batch->lock);
+}
+
+SDL_Surface *IMG_BatchGet(IMG_Batch *batch, int index)
+{
+	SDL_Surface *image = NULL;
+
+	if ( !batch || index < 0 || index >= batch->count ) {
+		IMG_SetError("Invalid batch index");
+		return(NULL);
+	}
+	SDL_mutexP(batch->lock);
+	while ( batch->state[index] == IMG_BATCH_PENDING ) {
+		SDL_CondWait(batch->cond, batch->lock);
+	}
+	switch ( batch->state[index] ) {
+	    case IMG_BATCH_READY:
+		image = batch->surfaces[index];
+		batch->surfaces[index] = NULL;
+		batch->state[index] = IMG_BATCH_TAKEN;
+		break;
+	    case IMG_BATCH_FAILED:
+		IMG_SetError("%s", batch->errors[index]);
+		break;
+	    default:
+		IMG_SetError("Image %d was already taken from the batch", index);
+		break;
+	}
+	SDL_mutexV(batch->lock);
+
+#if !SDL_VERSION_ATLEAST(1,3,0)
+	/* Video memory surfaces can only be created on this thread */
+	if ( image && (batch->flags & IMG_BATCH_DISPLAY_FORMAT) ) {
+		SDL_Surface *screen = SDL_GetVideoSurface();
+		if ( screen && (screen->flags & SDL_HWSURFACE) ) {
+			SDL_Surface *converted;
+			if ( image->format->Amask ) {
+				converted = SDL_DisplayFormatAlpha(image);
+			} else {
+				converted = SDL_DisplayFormat(image);
+			}
+			if ( converted ) {
+				SDL_FreeSurface(image);
+				image = converted;
+			}
+		}
+	}
+#endif
+	return(image);
+}
+
+void IMG_FreeBatch(IMG_Batch *batch)
+{
+	int i;
+
+	if ( !batch ) {
+		return;
+	}
+	if ( batch->lock ) {
+		SDL_mutexP(batch->lock);
+		batch->cancel = 1;
+		SDL_mutexV(batch->lock);
+	}
+	for ( i = 0; i < batch->nthreads; ++i ) {
+		SDL_WaitThread(batch->threads[i], NULL);
+	}
+	for ( i = 0; i < batch->count; ++i ) {
+		if ( batch->files ) {
+			SDL_free(batch->files[i]);
+		}
+		if ( batch->surfaces && batch->surfaces[i] ) {
+			SDL_FreeSurface(batch->surfaces[i]);
+		}
+		if ( batch->errors ) {
+			SDL_free(batch->errors[i]);
+		}
+	}
+	if ( batch->opaque ) {
+		SDL_FreeSurface(batch->opaque);
+	}
+	if ( batch->alpha ) {
+		SDL_FreeSurface(batch->alpha);
+	}
+	if ( batch->cond ) {
+		SDL_DestroyCond(batch->cond);
+	}
+	if ( batch->lock ) {
+		SDL_DestroyMutex(batch->lock);
+	}
+	SDL_free(batch->cachedir);
+	SDL_free(batch->files);
+	SDL_free(batch->surfaces);
+	SDL_free(batch->errors);
+	SDL_free(batch->state);
+	SDL_free(batch);
+}
@@ -133,6 +133,40 @@ extern DECLSPEC SDL_Surface * SDLCALL IMG_LoadWEBP_RW(SDL_RWops *src);
 
 extern DECLSPEC SDL_Surface * SDLCALL IMG_ReadXPMFromArray(char **xpm);
 
+/* Batch loading: decode a list of files on background threads.
+   Call these from the thread that set the video mode.
+
+   IMG_LoadBatch() starts 'threads' workers (0 picks one per CPU) and
+   returns at once.  With IMG_BATCH_DISPLAY_FORMAT the workers convert
+   every image to the pixel format SDL_DisplayFormat() (or
+   SDL_DisplayFormatAlpha() for images with an alpha channel) would use,
+   so the images come back ready to blit.  GIF and XPM files are decoded
+   one at a time since those loaders are not reentrant; don't load such
+   files with IMG_Load() while a batch is running.
+ */
+typedef struct _IMG_Batch IMG_Batch;
+
+#define IMG_BATCH_DISPLAY_FORMAT	0x01
+
+extern DECLSPEC IMG_Batch * SDLCALL IMG_LoadBatch(const char **files, int count, int threads, int flags);
+/* Number of files in the batch, and how many have finished decoding */
+extern DECLSPEC int SDLCALL IMG_BatchCount(IMG_Batch *batch);
+extern DECLSPEC int SDLCALL IMG_BatchDone(IMG_Batch *batch);
+/* Block until every file has finished */
+extern DECLSPEC void SDLCALL IMG_BatchWait(IMG_Batch *batch);
+/* Take the image for files[index], waiting for it if needed.  The caller
+   owns the returned surface.  Returns NULL with the decoder's error set
+   if the file could not be loaded. */
+extern DECLSPEC SDL_Surface * SDLCALL IMG_BatchGet(IMG_Batch *batch, int index);
+/* Stop the workers and free any images that were not taken */
+extern DECLSPEC void SDLCALL IMG_FreeBatch(IMG_Batch *batch);
+
+/* Keep decoded (and converted) batch images as raw files in 'dir', keyed
+   by file name, size and modification time, so the next run can skip the
+   decoder.  NULL turns the cache off.  Returns 0, or -1 if the directory
+   can't be used. */
+extern DECLSPEC int SDLCALL IMG_SetCacheDir(const char *dir);
+
 /* We'll use SDL for reporting errors */
 #define IMG_SetError	SDL_SetError
 #define IMG_GetError	SDL_GetError
@@ -14,6 +14,15 @@ LOCAL_CPP_EXTENSION := .cpp
 
 LOCAL_SRC_FILES := $(notdir $(wildcard $(LOCAL_PATH)/*.c))
 
+# The NEON mixing kernels are picked at runtime with SDL_HasNEON() (by ABI on SDL 1.3), so on armeabi-v7a only their file is compiled with NEON
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+LOCAL_CFLAGS += -DMIX_NEON=1
+LOCAL_SRC_FILES := $(filter-out mixer_neon.c,$(LOCAL_SRC_FILES)) mixer_neon.c.neon
+endif
+ifeq ($(TARGET_ARCH_ABI),arm64-v8a)
+LOCAL_CFLAGS += -DMIX_NEON=1
+endif
+
 LOCAL_SHARED_LIBRARIES := sdl-$(SDL_VERSION)
 LOCAL_STATIC_LIBRARIES := flac mikmod
 
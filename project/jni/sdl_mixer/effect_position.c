@@ -95,19 +95,23 @@ void _Eff_PositionDeinit(void)
 }
 
 
-/* This just frees up the callback-specific data. */
+static void init_position_args(position_args *args);
+
+/*
+ * This just resets the callback-specific data. It's called from the audio
+ *  callback when a channel finishes, so the args are kept allocated for
+ *  the next effect on that channel and only freed in _Eff_PositionDeinit().
+ */
 static void _Eff_PositionDone(int channel, void *udata)
 {
     if (channel < 0) {
         if (pos_args_global != NULL) {
-            free(pos_args_global);
-            pos_args_global = NULL;
+            init_position_args(pos_args_global);
         }
     }
 
     else if (pos_args_array[channel] != NULL) {
-        free(pos_args_array[channel]);
-        pos_args_array[channel] = NULL;
+        init_position_args(pos_args_array[channel]);
     }
 }
 
@@ -591,6 +591,16 @@ extern DECLSPEC int SDLCALL Mix_PausedMusic(void);
 */
 extern DECLSPEC int SDLCALL Mix_SetMusicPosition(double position);
 
+/* Decode music on a background thread, about 'ms' milliseconds ahead of
+   playback, so the audio callback only copies already decoded samples and
+   decoding spikes don't cause dropouts even with small audio buffers.
+   0 turns it off, which is the default.  Call this while no music is
+   playing.  In this mode the music finished hook is called from the
+   decoding thread, with the audio locked.
+   This returns 0 if successful, or -1 on error.
+*/
+extern DECLSPEC int SDLCALL Mix_SetMusicDecodeAhead(int ms);
+
 /* Check the status of a specific channel.
    If the specified channel is -1, check all channels.
 */
@@ -29,6 +29,7 @@
 #include "SDL_mutex.h"
 #include "SDL_endian.h"
 #include "SDL_timer.h"
+#include "SDL_cpuinfo.h"
 
 #include "SDL_mixer.h"
 #include "load_aiff.h"
@@ -42,6 +43,11 @@
 
 #define __MIX_INTERNAL_EFFECT__
 #include "effects_internal.h"
+#include "mixer_neon.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 /* Magic numbers for various audio file formats */
 #define RIFF		0x46464952		/* "RIFF" */
@@ -82,9 +88,28 @@ static struct _Mix_Channel {
 
 static effect_info *posteffects = NULL;
 
+/* Removed effects are kept here for reuse, since channels that finish
+   playing drop their effects from inside the audio callback */
+static effect_info *free_effects = NULL;
+
+/* Copy of a channel's samples for its effects to work on in place */
+static Uint8 *mix_effect_buf = NULL;
+static int mix_effect_len = 0;
+
 static int num_channels;
 static int reserved_channels = 0;
 
+/* 32-bit mixing buffer for AUDIO_S16SYS, one entry per sample in the
+   device buffer.  Channels are multiply-added into it and the sum is
+   clamped once at the end, instead of SDL_MixAudio() reading, clamping
+   and writing the whole stream again for every channel. */
+static Sint32 *mix_accum = NULL;
+static int mix_accum_len = 0;
+static int mix_accum_used = 0;
+static void (*mix_accum_load)(Sint32 *accum, const Sint16 *stream, int samples);
+static void (*mix_accum_add)(Sint32 *accum, const Sint16 *src, int samples, int volume);
+static void (*mix_accum_store)(Sint16 *stream, const Sint32 *accum, int samples);
+
 
 /* Support for hooking into the mixer callback system */
 static void (*mix_postmix)(void *udata, Uint8 *stream, int len) = NULL;
@@ -240,7 +265,13 @@ static void *Mix_DoEffects(int chan, void *snd, int len)
 	if (e != NULL) {    /* are there any registered effects? */
 		/* if this is the postmix, we can just overwrite the original. */
 		if (!posteffect) {
-			buf = malloc(len);
+			/* channels are mixed one at a time, so they share one
+			   scratch buffer, preallocated in Mix_OpenAudio() */
+			if (len <= mix_effect_len) {
+				buf = mix_effect_buf;
+			} else {
+				buf = malloc(len);
+			}
 			if (buf == NULL) {
 				return(snd);
 			}
@@ -254,10 +285,152 @@ static void *Mix_DoEffects(int chan, void *snd, int len)
 		}
 	}
 
-	/* be sure to free() the return value if != snd ... */
+	/* be sure to call Mix_DoneEffects() on the return value... */
 	return(buf);
 }
 
+static void Mix_DoneEffects(void *buf, void *snd)
+{
+	if (buf != snd && buf != mix_effect_buf) {
+		free(buf);
+	}
+}
+
+
+/* Accumulator kernels; the accumulator holds samples times SDL_MIX_MAXVOLUME */
+static void accum_load_c(Sint32 *accum, const Sint16 *stream, int samples)
+{
+	while ( samples-- ) {
+		*accum++ = (Sint32)*stream++ << 7;
+	}
+}
+
+static void accum_add_c(Sint32 *accum, const Sint16 *src, int samples, int volume)
+{
+	while ( samples-- ) {
+		*accum++ += *src++ * volume;
+	}
+}
+
+static void accum_store_c(Sint16 *stream, const Sint32 *accum, int samples)
+{
+	Sint32 sample;
+
+	while ( samples-- ) {
+		sample = *accum++ >> 7;
+		if ( sample > 32767 ) {
+			sample = 32767;
+		} else if ( sample < -32768 ) {
+			sample = -32768;
+		}
+		*stream++ = (Sint16)sample;
+	}
+}
+
+#ifdef __SSE2__
+static void accum_load_sse2(Sint32 *accum, const Sint16 *stream, int samples)
+{
+	const __m128i zero = _mm_setzero_si128();
+
+	for ( ; samples >= 8; samples -= 8, stream += 8, accum += 8 ) {
+		__m128i s = _mm_loadu_si128((const __m128i *)stream);
+		/* sample<<16 then arithmetic shift down, giving sample<<7 */
+		_mm_storeu_si128((__m128i *)accum, _mm_srai_epi32(_mm_unpacklo_epi16(zero, s), 9));
+		_mm_storeu_si128((__m128i *)(accum+4), _mm_srai_epi32(_mm_unpackhi_epi16(zero, s), 9));
+	}
+	accum_load_c(accum, stream, samples);
+}
+
+static void accum_add_sse2(Sint32 *accum, const Sint16 *src, int samples, int volume)
+{
+	const __m128i vol = _mm_set1_epi16((short)volume);
+
+	for ( ; samples >= 8; samples -= 8, src += 8, accum += 8 ) {
+		__m128i s = _mm_loadu_si128((const __m128i *)src);
+		__m128i lo = _mm_mullo_epi16(s, vol);
+		__m128i hi = _mm_mulhi_epi16(s, vol);
+		__m128i a0 = _mm_loadu_si128((const __m128i *)accum);
+		__m128i a1 = _mm_loadu_si128((const __m128i *)(accum+4));
+		_mm_storeu_si128((__m128i *)accum, _mm_add_epi32(a0, _mm_unpacklo_epi16(lo, hi)));
+		_mm_storeu_si128((__m128i *)(accum+4), _mm_add_epi32(a1, _mm_unpackhi_epi16(lo, hi)));
+	}
+	accum_add_c(accum, src, samples, volume);
+}
+
+static void accum_store_sse2(Sint16 *stream, const Sint32 *accum, int samples)
+{
+	for ( ; samples >= 8; samples -= 8, stream += 8, accum += 8 ) {
+		__m128i a0 = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)accum), 7);
+		__m128i a1 = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)(accum+4)), 7);
+		_mm_storeu_si128((__m128i *)stream, _mm_packs_epi32(a0, a1));
+	}
+	accum_store_c(stream, accum, samples);
+}
+#endif /* __SSE2__ */
+
+#ifdef MIX_NEON
+static int mix_has_neon(void)
+{
+#if SDL_VERSION_ATLEAST(1,3,0)
+	/* SDL 1.3 has no SDL_HasNEON(), go by what the ABI guarantees */
+#if defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+	return 1;
+#else
+	return 0;
+#endif
+#else
+	return SDL_HasNEON();
+#endif
+}
+#endif
+
+static void init_accum(void)
+{
+	mix_accum_load = accum_load_c;
+	mix_accum_add = accum_add_c;
+	mix_accum_store = accum_store_c;
+#ifdef __SSE2__
+	mix_accum_load = accum_load_sse2;
+	mix_accum_add = accum_add_sse2;
+	mix_accum_store = accum_store_sse2;
+#endif
+#ifdef MIX_NEON
+	if ( mix_has_neon() ) {
+		const char *hint = getenv("SDL_NEON_AUDIO");
+		if ( !hint || *hint != '0' ) {
+			mix_accum_load = _Mix_AccumLoadNEON;
+			mix_accum_add = _Mix_AccumAddNEON;
+			mix_accum_store = _Mix_AccumStoreNEON;
+		}
+	}
+#endif
+
+	mix_accum_len = 0;
+	if ( mixer.format == AUDIO_S16SYS ) {
+		mix_accum = (Sint32 *) malloc((mixer.size / 2) * sizeof(Sint32));
+		if ( mix_accum ) {
+			mix_accum_len = mixer.size / 2;
+		}
+	}
+}
+
+/* Mix 'len' bytes of a channel at byte offset 'index' of the stream */
+static void mix_samples(Uint8 *stream, int index, Uint8 *src, int len,
+                        int volume, int *accumulating)
+{
+	if ( volume == 0 ) {
+		return;
+	}
+	if ( accumulating ) {
+		if ( ! *accumulating ) {
+			mix_accum_load(mix_accum, (Sint16 *)stream, mix_accum_used);
+			*accumulating = 1;
+		}
+		mix_accum_add(mix_accum + index/2, (Sint16 *)src, len/2, volume);
+	} else {
+		SDL_MixAudio(stream+index, src, len, volume);
+	}
+}
 
 /* Mixing function */
 static void mix_channels(void *udata, Uint8 *stream, int len)
@@ -265,6 +438,8 @@ static void mix_channels(void *udata, Uint8 *stream, int len)
 	Uint8 *mix_input;
 	int i, mixable, volume = SDL_MIX_MAXVOLUME;
 	Uint32 sdl_ticks;
+	int accumulated = 0;
+	int *accumulating = NULL;
 
 #if SDL_VERSION_ATLEAST(1, 3, 0)
 	/* Need to initialize the stream in SDL 1.3+ */
@@ -277,6 +452,10 @@ static void mix_channels(void *udata, Uint8 *stream, int len)
 	}
 
 	/* Mix any playing channels... */
+	if ( mix_accum && len/2 <= mix_accum_len ) {
+		accumulating = &accumulated;
+		mix_accum_used = len/2;
+	}
 	sdl_ticks = SDL_GetTicks();
 	for ( i=0; i<num_channels; ++i ) {
 		if( ! mix_channel[i].paused ) {
@@ -317,9 +496,8 @@ static void mix_channels(void *udata, Uint8 *stream, int len)
 					}
 
 					mix_input = Mix_DoEffects(i, mix_channel[i].samples, mixable);
-					SDL_MixAudio(stream+index,mix_input,mixable,volume);
-					if (mix_input != mix_channel[i].samples)
-						free(mix_input);
+					mix_samples(stream, index, mix_input, mixable, volume, accumulating);
+					Mix_DoneEffects(mix_input, mix_channel[i].samples);
 
 					mix_channel[i].samples += mixable;
 					mix_channel[i].playing -= mixable;
@@ -341,9 +519,8 @@ static void mix_channels(void *udata, Uint8 *stream, int len)
 					}
 
 					mix_input = Mix_DoEffects(i, mix_channel[i].chunk->abuf, remaining);
-					SDL_MixAudio(stream+index, mix_input, remaining, volume);
-					if (mix_input != mix_channel[i].chunk->abuf)
-						free(mix_input);
+					mix_samples(stream, index, mix_input, remaining, volume, accumulating);
+					Mix_DoneEffects(mix_input, mix_channel[i].chunk->abuf);
 
 					--mix_channel[i].looping;
 					mix_channel[i].samples = mix_channel[i].chunk->abuf + remaining;
@@ -359,6 +536,10 @@ static void mix_channels(void *udata, Uint8 *stream, int len)
 		}
 	}
 
+	if ( accumulated ) {
+		mix_accum_store((Sint16 *)stream, mix_accum, mix_accum_used);
+	}
+
 	/* rcg06122001 run posteffects... */
 	Mix_DoEffects(MIX_CHANNEL_POST, stream, len);
 
@@ -436,6 +617,9 @@ int Mix_OpenAudio(int frequency, Uint16 format, int nchannels, int chunksize)
 	}
 	Mix_VolumeMusic(SDL_MIX_MAXVOLUME);
 
+	init_accum();
+	mix_effect_buf = (Uint8 *) malloc(mixer.size);
+	mix_effect_len = mix_effect_buf ? mixer.size : 0;
 	_Mix_InitEffects();
 
 	/* This list is (currently) decided at build time. */
@@ -1099,6 +1283,17 @@ void Mix_CloseAudio(void)
 			SDL_CloseAudio();
 			free(mix_channel);
 			mix_channel = NULL;
+			free(mix_accum);
+			mix_accum = NULL;
+			mix_accum_len = 0;
+			free(mix_effect_buf);
+			mix_effect_buf = NULL;
+			mix_effect_len = 0;
+			while (free_effects != NULL) {
+				effect_info *next = free_effects->next;
+				free(free_effects);
+				free_effects = next;
+			}
 
 			/* rcg06042009 report available decoders at runtime. */
 			free(chunk_decoders);
@@ -1261,7 +1456,7 @@ int Mix_GroupNewer(int tag)
 static int _Mix_register_effect(effect_info **e, Mix_EffectFunc_t f,
 				Mix_EffectDone_t d, void *arg)
 {
-	effect_info *new_e = malloc(sizeof (effect_info));
+	effect_info *new_e;
 
 	if (!e) {
 		Mix_SetError("Internal error");
@@ -1273,6 +1468,13 @@ static int _Mix_register_effect(effect_info **e, Mix_EffectFunc_t f,
 		return(0);
 	}
 
+	new_e = free_effects;
+	if (new_e != NULL) {
+		free_effects = new_e->next;
+	} else {
+		new_e = malloc(sizeof (effect_info));
+	}
+
 	if (new_e == NULL) {
 		Mix_SetError("Out of memory");
 		return(0);
@@ -1319,7 +1521,8 @@ static int _Mix_remove_effect(int channel, effect_info **e, Mix_EffectFunc_t f)
 			if (cur->done_callback != NULL) {
 				cur->done_callback(channel, cur->udata);
 			}
-			free(cur);
+			cur->next = free_effects;
+			free_effects = cur;
 
 			if (prev == NULL) {   /* removing first item of list? */
 				*e = next;
@@ -1352,7 +1555,8 @@ static int _Mix_remove_all_effects(int channel, effect_info **e)
 		if (cur->done_callback != NULL) {
 			cur->done_callback(channel, cur->udata);
 		}
-		free(cur);
+		cur->next = free_effects;
+		free_effects = cur;
 	}
 	*e = NULL;
 
@@ -0,0 +1,78 @@
+/*
+    SDL_mixer:  An audio mixer library based on the SDL library
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+
+/* On armeabi-v7a this is the only mixer file built with NEON enabled,
+   mixer.c calls into it only when SDL_HasNEON() is true.  Leftover
+   samples are done in C so the results match the C kernels exactly.
+ */
+
+#include "SDL_stdinc.h"
+#include "mixer_neon.h"
+
+#ifdef MIX_NEON
+
+#include <arm_neon.h>
+
+void _Mix_AccumLoadNEON(Sint32 *accum, const Sint16 *stream, int samples)
+{
+	for ( ; samples >= 8; samples -= 8, stream += 8, accum += 8 ) {
+		int16x8_t s = vld1q_s16(stream);
+		vst1q_s32(accum, vshll_n_s16(vget_low_s16(s), 7));
+		vst1q_s32(accum+4, vshll_n_s16(vget_high_s16(s), 7));
+	}
+	while ( samples-- ) {
+		*accum++ = (Sint32)*stream++ << 7;
+	}
+}
+
+void _Mix_AccumAddNEON(Sint32 *accum, const Sint16 *src, int samples, int volume)
+{
+	for ( ; samples >= 8; samples -= 8, src += 8, accum += 8 ) {
+		int16x8_t s = vld1q_s16(src);
+		vst1q_s32(accum, vmlal_n_s16(vld1q_s32(accum), vget_low_s16(s), (Sint16)volume));
+		vst1q_s32(accum+4, vmlal_n_s16(vld1q_s32(accum+4), vget_high_s16(s), (Sint16)volume));
+	}
+	while ( samples-- ) {
+		*accum++ += *src++ * volume;
+	}
+}
+
+void _Mix_AccumStoreNEON(Sint16 *stream, const Sint32 *accum, int samples)
+{
+	Sint32 sample;
+
+	for ( ; samples >= 8; samples -= 8, stream += 8, accum += 8 ) {
+		vst1q_s16(stream, vcombine_s16(vqshrn_n_s32(vld1q_s32(accum), 7),
+		                               vqshrn_n_s32(vld1q_s32(accum+4), 7)));
+	}
+	while ( samples-- ) {
+		sample = *accum++ >> 7;
+		if ( sample > 32767 ) {
+			sample = 32767;
+		} else if ( sample < -32768 ) {
+			sample = -32768;
+		}
+		*stream++ = (Sint16)sample;
+	}
+}
+
+#endif /* MIX_NEON */
@@ -0,0 +1,33 @@
+/*
+    SDL_mixer:  An audio mixer library based on the SDL library
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Library General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Library General Public License for more details.
+
+    You should have received a copy of the GNU Library General Public
+    License along with this library; if not, write to the Free
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+
+/* NEON kernels for the 32-bit mixing accumulator in mixer.c.
+   The accumulator holds samples scaled by SDL_MIX_MAXVOLUME (128),
+   so every channel is added with one multiply-add and the result is
+   clamped only once, when it is stored back to the stream.
+ */
+
+#ifdef MIX_NEON
+void _Mix_AccumLoadNEON(Sint32 *accum, const Sint16 *stream, int samples);
+void _Mix_AccumAddNEON(Sint32 *accum, const Sint16 *src, int samples, int volume);
+void _Mix_AccumStoreNEON(Sint16 *stream, const Sint32 *accum, int samples);
+#endif
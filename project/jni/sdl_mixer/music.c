@@ -130,6 +130,35 @@ static int native_midi_ok;
 /* Used to calculate fading steps */
 static int ms_per_step;
 
+/* Decode-ahead mode: a thread decodes the music into a ring of samples
+   in the device format, at full volume, and the audio callback copies
+   them out applying the music volume.  The ring has one writer and one
+   reader, so it needs no lock; ahead_lock is held by the thread while it
+   touches the decoders, and by anything else that does, after the audio
+   lock.  The audio callback never takes it.
+ */
+#if defined(__GNUC__)
+#define AHEAD_BARRIER()	__sync_synchronize()
+#else
+#define AHEAD_BARRIER()
+#endif
+
+static int volatile music_ahead = 0;
+static SDL_AudioSpec ahead_spec;
+static SDL_Thread *ahead_thread = NULL;
+static SDL_mutex *ahead_lock = NULL;
+static SDL_cond *ahead_cond = NULL;
+static Uint8 *ahead_ring = NULL;
+static Uint32 ahead_size;		/* power of two */
+static Uint32 volatile ahead_head;	/* written by the thread */
+static Uint32 volatile ahead_tail;	/* written by the audio callback */
+static Uint8 *ahead_chunk = NULL;
+static int volatile ahead_quit;
+static int volatile ahead_ended;	/* decoder ran out, loop or stop it */
+static int volatile ahead_eof;		/* nothing more to decode */
+static int volatile ahead_halt;		/* halt requested by the callback */
+static int ahead_volume = MIX_MAX_VOLUME;
+
 /* rcg06042009 report available decoders at runtime. */
 static const char **music_decoders = NULL;
 static int num_decoders = 0;
@@ -164,6 +193,7 @@ static int  music_internal_play(Mix_Music *music, double position);
 static int  music_internal_position(double position);
 static int  music_internal_playing();
 static void music_internal_halt(void);
+static void music_decoder_volume(int volume);
 
 
 /* Support for hooking when the music has finished */
@@ -207,92 +237,118 @@ static int music_halt_or_loop (void)
 
 
 
-/* Mixing function */
-void music_mixer(void *udata, Uint8 *stream, int len)
+/* Advance the fade by one step, returns 0 when a fade out has ended */
+static int music_internal_fade(void)
 {
-	int left = 0;
-
-	if ( music_playing && music_active ) {
-		/* Handle fading */
-		if ( music_playing->fading != MIX_NO_FADING ) {
-			if ( music_playing->fade_step++ < music_playing->fade_steps ) {
-				int volume;
-				int fade_step = music_playing->fade_step;
-				int fade_steps = music_playing->fade_steps;
-
-				if ( music_playing->fading == MIX_FADING_OUT ) {
-					volume = (music_volume * (fade_steps-fade_step)) / fade_steps;
-				} else { /* Fading in */
-					volume = (music_volume * fade_step) / fade_steps;
-				}
-				music_internal_volume(volume);
-			} else {
-				if ( music_playing->fading == MIX_FADING_OUT ) {
-					music_internal_halt();
-					if ( music_finished_hook ) {
-						music_finished_hook();
-					}
-					return;
-				}
-				music_playing->fading = MIX_NO_FADING;
+	if ( music_playing->fading != MIX_NO_FADING ) {
+		if ( music_playing->fade_step++ < music_playing->fade_steps ) {
+			int volume;
+			int fade_step = music_playing->fade_step;
+			int fade_steps = music_playing->fade_steps;
+
+			if ( music_playing->fading == MIX_FADING_OUT ) {
+				volume = (music_volume * (fade_steps-fade_step)) / fade_steps;
+			} else { /* Fading in */
+				volume = (music_volume * fade_step) / fade_steps;
+			}
+			music_internal_volume(volume);
+		} else {
+			if ( music_playing->fading == MIX_FADING_OUT ) {
+				return 0;
 			}
+			music_playing->fading = MIX_NO_FADING;
 		}
-		
-		if (music_halt_or_loop() == 0)
-			return;
-		
-		
-		switch (music_playing->type) {
+	}
+	return 1;
+}
+
+/* Decode some music into the stream, returns the number of bytes left
+   when the music ran out */
+static int music_decode(Uint8 *stream, int len)
+{
+	int left = 0;
+
+	switch (music_playing->type) {
 #ifdef CMD_MUSIC
-			case MUS_CMD:
-				/* The playing is done externally */
-				break;
+		case MUS_CMD:
+			/* The playing is done externally */
+			break;
 #endif
 #ifdef WAV_MUSIC
-			case MUS_WAV:
-				left = WAVStream_PlaySome(stream, len);
-				break;
+		case MUS_WAV:
+			left = WAVStream_PlaySome(stream, len);
+			break;
 #endif
 #ifdef MOD_MUSIC
-			case MUS_MOD:
-				left = MOD_playAudio(music_playing->data.module, stream, len);
-				break;
+		case MUS_MOD:
+			left = MOD_playAudio(music_playing->data.module, stream, len);
+			break;
 #endif
 #ifdef MID_MUSIC
 #ifdef USE_TIMIDITY_MIDI
-			case MUS_MID:
-				if ( timidity_ok ) {
-					int samples = len / samplesize;
-  					Timidity_PlaySome(stream, samples);
-				}
-				break;
+		case MUS_MID:
+			if ( timidity_ok ) {
+				int samples = len / samplesize;
+				Timidity_PlaySome(stream, samples);
+			}
+			break;
 #endif
 #endif
 #ifdef OGG_MUSIC
-			case MUS_OGG:
-				
-				left = OGG_playAudio(music_playing->data.ogg, stream, len);
-				break;
+		case MUS_OGG:
+			
+			left = OGG_playAudio(music_playing->data.ogg, stream, len);
+			break;
 #endif
 #ifdef FLAC_MUSIC
-			case MUS_FLAC:
-				left = FLAC_playAudio(music_playing->data.flac, stream, len);
-				break;
+		case MUS_FLAC:
+			left = FLAC_playAudio(music_playing->data.flac, stream, len);
+			break;
 #endif
 #ifdef MP3_MUSIC
-			case MUS_MP3:
-				left = (len - smpeg.SMPEG_playAudio(music_playing->data.mp3, stream, len));
-				break;
+		case MUS_MP3:
+			left = (len - smpeg.SMPEG_playAudio(music_playing->data.mp3, stream, len));
+			break;
 #endif
 #ifdef MP3_MAD_MUSIC
-			case MUS_MP3_MAD:
-				left = mad_getSamples(music_playing->data.mp3_mad, stream, len);
-				break;
+		case MUS_MP3_MAD:
+			left = mad_getSamples(music_playing->data.mp3_mad, stream, len);
+			break;
 #endif
-			default:
-				/* Unknown music type?? */
-				break;
+		default:
+			/* Unknown music type?? */
+			break;
+	}
+	return(left);
+}
+
+static void music_ahead_mixer(Uint8 *stream, int len);
+
+/* Mixing function */
+void music_mixer(void *udata, Uint8 *stream, int len)
+{
+	int left = 0;
+
+	if ( music_ahead ) {
+		music_ahead_mixer(stream, len);
+		return;
+	}
+
+	if ( music_playing && music_active ) {
+		/* Handle fading */
+		if ( ! music_internal_fade() ) {
+			music_internal_halt();
+			if ( music_finished_hook ) {
+				music_finished_hook();
+			}
+			return;
 		}
+		
+		if (music_halt_or_loop() == 0)
+			return;
+		
+		
+		left = music_decode(stream, len);
 	}
 
 	/* Handle seamless music looping */
@@ -301,6 +357,276 @@ void music_mixer(void *udata, Uint8 *stream, int len)
 	}
 }
 
+/* Mix 16-bit samples with the volume (times 65536) moving by 'step' each
+   sample, so fades are smooth within a callback */
+static Sint32 music_ahead_ramp(Sint16 *stream, const Sint16 *src, int samples,
+                               Sint32 volume, Sint32 step)
+{
+	Sint32 sample;
+
+	while ( samples-- ) {
+		sample = *stream + ((*src++ * (volume >> 9)) >> 14);
+		if ( sample > 32767 ) {
+			sample = 32767;
+		} else if ( sample < -32768 ) {
+			sample = -32768;
+		}
+		*stream++ = (Sint16)sample;
+		volume += step;
+	}
+	return(volume);
+}
+
+/* Audio callback side of the decode-ahead mode */
+static void music_ahead_mixer(Uint8 *stream, int len)
+{
+	Uint32 avail, pos;
+	int frame, samples, vol0, vol1, n;
+	Sint32 volume, step;
+
+	if ( !music_playing || !music_active || ahead_halt ) {
+		return;
+	}
+
+	vol0 = ahead_volume;
+	if ( ! music_internal_fade() ) {
+		/* The thread halts the music and calls the hook */
+		ahead_halt = 1;
+		SDL_CondSignal(ahead_cond);
+		return;
+	}
+	vol1 = ahead_volume;
+
+	frame = (ahead_spec.format & 0xFF) / 8 * ahead_spec.channels;
+	avail = ahead_head - ahead_tail;
+	AHEAD_BARRIER();
+	if ( (Uint32)len > avail ) {
+		len = avail;
+	}
+	len -= len % frame;
+
+	samples = len / ((ahead_spec.format & 0xFF) / 8);
+	volume = vol0 << 16;
+	step = samples ? ((vol1 - vol0) * 65536) / samples : 0;
+	while ( len > 0 ) {
+		pos = ahead_tail & (ahead_size - 1);
+		n = ahead_size - pos;
+		if ( n > len ) {
+			n = len;
+		}
+		if ( ahead_spec.format == AUDIO_S16SYS ) {
+			volume = music_ahead_ramp((Sint16 *)stream,
+			                          (Sint16 *)(ahead_ring + pos),
+			                          n / 2, volume, step);
+		} else {
+			SDL_MixAudio(stream, ahead_ring + pos, n, vol1);
+		}
+		AHEAD_BARRIER();
+		ahead_tail += n;
+		stream += n;
+		len -= n;
+	}
+	SDL_CondSignal(ahead_cond);
+
+	if ( ahead_eof && ahead_head == ahead_tail ) {
+		ahead_halt = 1;
+	}
+}
+
+/* Drop the decoded samples, with the audio and ahead_lock held */
+static void music_ahead_flush(void)
+{
+	if ( music_ahead ) {
+		ahead_head = ahead_tail = 0;
+		ahead_ended = 0;
+		ahead_eof = 0;
+		ahead_halt = 0;
+		SDL_CondSignal(ahead_cond);
+	}
+}
+
+/* Lock out both the audio callback and the decoding thread */
+static void music_lock(void)
+{
+	SDL_LockAudio();
+	if ( ahead_lock ) {
+		SDL_mutexP(ahead_lock);
+	}
+}
+
+static void music_unlock(void)
+{
+	if ( ahead_lock ) {
+		SDL_mutexV(ahead_lock);
+	}
+	SDL_UnlockAudio();
+}
+
+/* Decode one chunk into the ring, with ahead_lock held */
+static void music_ahead_fill(void)
+{
+	int len = ahead_spec.size;
+	int frame = (ahead_spec.format & 0xFF) / 8 * ahead_spec.channels;
+	Uint32 pos;
+	int n;
+
+	memset(ahead_chunk, ahead_spec.silence, len);
+	if ( music_internal_playing() ) {
+		len -= music_decode(ahead_chunk, len);
+		len -= len % frame;
+	} else {
+		len = 0;
+	}
+	if ( len < (int)ahead_spec.size ) {
+		ahead_ended = 1;
+	}
+
+	pos = ahead_head & (ahead_size - 1);
+	n = ahead_size - pos;
+	if ( n > len ) {
+		n = len;
+	}
+	memcpy(ahead_ring + pos, ahead_chunk, n);
+	memcpy(ahead_ring, ahead_chunk + n, len - n);
+	AHEAD_BARRIER();
+	ahead_head += len;
+}
+
+/* Loop or stop the music, with the audio and ahead_lock held */
+static void music_ahead_end(void)
+{
+	if ( ahead_halt ) {
+		if ( music_playing ) {
+			music_internal_halt();
+			music_ahead_flush();
+			if ( music_finished_hook ) {
+				music_finished_hook();
+			}
+		}
+		ahead_halt = 0;
+	} else if ( ahead_ended ) {
+		ahead_ended = 0;
+		if ( music_playing && music_loops && --music_loops ) {
+			/* The decoded end of the previous loop stays in the ring */
+			Mix_Fading current_fade = music_playing->fading;
+			int volume = ahead_volume;
+			music_internal_play(music_playing, 0.0);
+			music_playing->fading = current_fade;
+			ahead_volume = volume;
+		} else {
+			ahead_eof = 1;
+		}
+	}
+}
+
+static int SDLCALL music_ahead_run(void *unused)
+{
+	SDL_mutexP(ahead_lock);
+	while ( ! ahead_quit ) {
+		if ( ahead_halt || ahead_ended ) {
+			/* Take the locks in the same order as everybody else */
+			SDL_mutexV(ahead_lock);
+			music_lock();
+			music_ahead_end();
+			music_unlock();
+			SDL_mutexP(ahead_lock);
+		} else if ( music_playing && !ahead_eof &&
+		            ahead_size - (ahead_head - ahead_tail) >= ahead_spec.size ) {
+			music_ahead_fill();
+		} else {
+			SDL_CondWaitTimeout(ahead_cond, ahead_lock, 10);
+		}
+	}
+	SDL_mutexV(ahead_lock);
+	return(0);
+}
+
+static void music_ahead_stop(void)
+{
+	SDL_LockAudio();
+	music_ahead = 0;
+	SDL_UnlockAudio();
+
+	if ( ahead_thread ) {
+		ahead_quit = 1;
+		SDL_CondSignal(ahead_cond);
+		SDL_WaitThread(ahead_thread, NULL);
+		ahead_thread = NULL;
+	}
+	SDL_LockAudio();
+	if ( ahead_lock ) {
+		SDL_DestroyMutex(ahead_lock);
+		ahead_lock = NULL;
+	}
+	SDL_UnlockAudio();
+	if ( ahead_cond ) {
+		SDL_DestroyCond(ahead_cond);
+		ahead_cond = NULL;
+	}
+	free(ahead_ring);
+	ahead_ring = NULL;
+	free(ahead_chunk);
+	ahead_chunk = NULL;
+}
+
+int Mix_SetMusicDecodeAhead(int ms)
+{
+	Uint32 bytes;
+
+	if ( ahead_spec.size == 0 ) {
+		Mix_SetError("Audio device hasn't been opened");
+		return(-1);
+	}
+	SDL_LockAudio();
+	if ( music_playing ) {
+		SDL_UnlockAudio();
+		Mix_SetError("Music is playing");
+		return(-1);
+	}
+	SDL_UnlockAudio();
+
+	music_ahead_stop();
+	if ( ms <= 0 ) {
+		return(0);
+	}
+
+	/* At least two callbacks worth, rounded up to a power of two */
+	bytes = (Uint32)((double)ms * ahead_spec.freq / 1000.0) *
+	        ((ahead_spec.format & 0xFF) / 8) * ahead_spec.channels;
+	if ( bytes < 2 * ahead_spec.size ) {
+		bytes = 2 * ahead_spec.size;
+	}
+	for ( ahead_size = 1; ahead_size < bytes; ahead_size <<= 1 ) {
+		/* keep going */
+	}
+
+	ahead_ring = (Uint8 *)malloc(ahead_size);
+	ahead_chunk = (Uint8 *)malloc(ahead_spec.size);
+	ahead_lock = SDL_CreateMutex();
+	ahead_cond = SDL_CreateCond();
+	if ( !ahead_ring || !ahead_chunk || !ahead_lock || !ahead_cond ) {
+		music_ahead_stop();
+		Mix_SetError("Out of memory");
+		return(-1);
+	}
+	ahead_head = ahead_tail = 0;
+	ahead_quit = 0;
+	ahead_ended = 0;
+	ahead_eof = 0;
+	ahead_halt = 0;
+	ahead_thread = SDL_CreateThread(music_ahead_run, NULL);
+	if ( ahead_thread == NULL ) {
+		music_ahead_stop();
+		Mix_SetError("Couldn't create music decoding thread");
+		return(-1);
+	}
+
+	SDL_LockAudio();
+	music_ahead = 1;
+	SDL_UnlockAudio();
+	return(0);
+}
+
 /* Initialize the music players with a certain desired audio format */
 int open_music(SDL_AudioSpec *mixer)
 {
@@ -356,6 +682,7 @@ int open_music(SDL_AudioSpec *mixer)
 
 	music_playing = NULL;
 	music_stopped = 0;
+	ahead_spec = *mixer;
 	Mix_VolumeMusic(SDL_MIX_MAXVOLUME);
 
 	/* Calculate the number of ms for each callback */
@@ -552,19 +879,20 @@ void Mix_FreeMusic(Mix_Music *music)
 {
 	if ( music ) {
 		/* Stop the music if it's currently playing */
-		SDL_LockAudio();
+		music_lock();
 		if ( music == music_playing ) {
 			/* Wait for any fade out to finish */
 			while ( music->fading == MIX_FADING_OUT ) {
-				SDL_UnlockAudio();
+				music_unlock();
 				SDL_Delay(100);
-				SDL_LockAudio();
+				music_lock();
 			}
 			if ( music == music_playing ) {
 				music_internal_halt();
+				music_ahead_flush();
 			}
 		}
-		SDL_UnlockAudio();
+		music_unlock();
 		switch (music->type) {
 #ifdef CMD_MUSIC
 			case MUS_CMD:
@@ -720,6 +1048,11 @@ static int music_internal_play(Mix_Music *music, double position)
 		break;
 	}
 
+	/* Decode at full volume, the music volume is applied while mixing */
+	if ( music_ahead && retval == 0 ) {
+		music_decoder_volume(MIX_MAX_VOLUME);
+	}
+
 	/* Set the playback position, note any errors if an offset is used */
 	if ( retval == 0 ) {
 		if ( position > 0.0 ) {
@@ -758,17 +1091,18 @@ int Mix_FadeInMusicPos(Mix_Music *music, int loops, int ms, double position)
 	music->fade_steps = ms/ms_per_step;
 
 	/* Play the puppy */
-	SDL_LockAudio();
+	music_lock();
 	/* If the current music is fading out, wait for the fade to complete */
 	while ( music_playing && (music_playing->fading == MIX_FADING_OUT) ) {
-		SDL_UnlockAudio();
+		music_unlock();
 		SDL_Delay(100);
-		SDL_LockAudio();
+		music_lock();
 	}
 	music_active = 1;
 	music_loops = loops;
+	music_ahead_flush();
 	retval = music_internal_play(music, position);
-	SDL_UnlockAudio();
+	music_unlock();
 
 	return(retval);
 }
@@ -828,17 +1162,20 @@ int Mix_SetMusicPosition(double position)
 {
 	int retval;
 
-	SDL_LockAudio();
+	music_lock();
 	if ( music_playing ) {
 		retval = music_internal_position(position);
 		if ( retval < 0 ) {
 			Mix_SetError("Position not implemented for music type");
+		} else {
+			/* Start decoding ahead again from the new position */
+			music_ahead_flush();
 		}
 	} else {
 		Mix_SetError("Music isn't playing");
 		retval = -1;
 	}
-	SDL_UnlockAudio();
+	music_unlock();
 
 	return(retval);
 }
@@ -855,6 +1192,16 @@ static void music_internal_initialize_volume(void)
 
 /* Set the music volume */
 static void music_internal_volume(int volume)
+{
+	if ( music_ahead ) {
+		/* Applied when the decoded samples are mixed */
+		ahead_volume = volume;
+	} else {
+		music_decoder_volume(volume);
+	}
+}
+
+static void music_decoder_volume(int volume)
 {
 	switch (music_playing->type) {
 #ifdef CMD_MUSIC
@@ -993,11 +1340,12 @@ static void music_internal_halt(void)
 }
 int Mix_HaltMusic(void)
 {
-	SDL_LockAudio();
+	music_lock();
 	if ( music_playing ) {
 		music_internal_halt();
+		music_ahead_flush();
 	}
-	SDL_UnlockAudio();
+	music_unlock();
 
 	return(0);
 }
@@ -1153,7 +1501,8 @@ int Mix_PlayingMusic(void)
 
 	SDL_LockAudio();
 	if ( music_playing ) {
-		playing = music_internal_playing();
+		/* Decoded music plays on until the callback halts it */
+		playing = music_ahead ? 1 : music_internal_playing();
 	}
 	SDL_UnlockAudio();
 
@@ -1195,6 +1544,8 @@ int Mix_GetSynchroValue(void)
 void close_music(void)
 {
 	Mix_HaltMusic();
+	music_ahead_stop();
+	ahead_spec.size = 0;
 #ifdef CMD_MUSIC
 	Mix_SetMusicCMD(NULL);
 #endif
@@ -268,9 +268,11 @@ mad_getSamples(mad_data *mp3_mad, Uint8 *stream, int len) {
 		mp3_mad->cvt.buf = mp3_mad->output_buffer;
 		mp3_mad->cvt.len = mp3_mad->output_end;
 		
-		mp3_mad->output_end = (int)(mp3_mad->output_end * mp3_mad->cvt.len_ratio);
-		/*assert(mp3_mad->output_end <= MAD_OUTPUT_BUFFER_SIZE);*/
 		SDL_ConvertAudio(&mp3_mad->cvt);
+		/* The resampler output varies by a frame or so from frame
+		   to frame, use what it actually produced */
+		mp3_mad->output_end = mp3_mad->cvt.len_cvt;
+		/*assert(mp3_mad->output_end <= MAD_OUTPUT_BUFFER_SIZE);*/
 	  }
 	}
 
@@ -159,6 +159,7 @@ WAVStream *WAVStream_LoadSong_RW(SDL_RWops *rw, const char *magic)
 			free(wave);
 			return(NULL);
 		}
+		wave->frame_size = (wavespec.format & 0xFF) / 8 * wavespec.channels;
 		SDL_BuildAudioCVT(&wave->cvt,
 			wavespec.format, wavespec.channels, wavespec.freq,
 			mixer.format, mixer.channels, mixer.freq);
@@ -170,64 +171,93 @@ WAVStream *WAVStream_LoadSong_RW(SDL_RWops *rw, const char *magic)
 void WAVStream_Start(WAVStream *wave)
 {
 	SDL_RWseek (wave->rw, wave->start, RW_SEEK_SET);
+	wave->len_available = 0;
 	music = wave;
 }
 
+/* Reads and converts the next chunk of the stream, sized for a mixer
+   buffer of 'len' bytes.  Returns 0 at the end of the stream. */
+static int WAVStream_GetSome(int len)
+{
+	long pos;
+	int original_len;
+
+	pos = SDL_RWtell(music->rw);
+	original_len = (int)((double)len/music->cvt.len_ratio);
+	original_len -= original_len % music->frame_size;
+	if ( original_len < music->frame_size ) {
+		original_len = music->frame_size;
+	}
+	if ( music->chunk_len != original_len ) {
+		if ( music->cvt.buf != NULL ) {
+			free(music->cvt.buf);
+		}
+		music->cvt.buf=(Uint8 *)malloc(original_len*music->cvt.len_mult);
+		if ( music->cvt.buf == NULL ) {
+			music->chunk_len = 0;
+			return 0;
+		}
+		music->chunk_len = original_len;
+	}
+	if ( (music->stop - pos) < original_len ) {
+		original_len = (int)(music->stop - pos);
+	}
+	original_len = SDL_RWread(music->rw, music->cvt.buf,1,original_len);
+	/* The converters work on whole frames, a partial one at the end
+	   of the data is dropped */
+	original_len -= original_len % music->frame_size;
+	if ( original_len <= 0 ) {
+		SDL_RWseek(music->rw, music->stop, RW_SEEK_SET);
+		return 0;
+	}
+	music->cvt.len = original_len;
+	SDL_ConvertAudio(&music->cvt);
+	music->len_available = music->cvt.len_cvt;
+	music->snd_available = music->cvt.buf;
+	return 1;
+}
+
 /* Play some of a stream previously started with WAVStream_Start() */
 int WAVStream_PlaySome(Uint8 *stream, int len)
 {
 	long pos;
 	int left = 0;
 
-	if ( music && ((pos=SDL_RWtell(music->rw)) < music->stop) ) {
-		if ( music->cvt.needed ) {
-			int original_len;
-
-			original_len=(int)((double)len/music->cvt.len_ratio);
-			if ( music->cvt.len != original_len ) {
-				int worksize;
-				if ( music->cvt.buf != NULL ) {
-					free(music->cvt.buf);
-				}
-				worksize = original_len*music->cvt.len_mult;
-				music->cvt.buf=(Uint8 *)malloc(worksize);
-				if ( music->cvt.buf == NULL ) {
-					return 0;
-				}
-				music->cvt.len = original_len;
-			}
-			if ( (music->stop - pos) < original_len ) {
-				left = (original_len - (music->stop - pos));
-				original_len -= left;
-				left = (int)((double)left*music->cvt.len_ratio);
-			}
-			original_len = SDL_RWread(music->rw, music->cvt.buf,1,original_len);
-			/* At least at the time of writing, SDL_ConvertAudio()
-			   does byte-order swapping starting at the end of the
-			   buffer. Thus, if we are reading 16-bit samples, we
-			   had better make damn sure that we get an even
-			   number of bytes, or we'll get garbage.
-			 */
-			if ( (music->cvt.src_format & 0x0010) && (original_len & 1) ) {
-				original_len--;
+	if ( music && music->cvt.needed ) {
+		/* The resampler holds back a few frames of each chunk and
+		   gives them with the next one, so the converted output is
+		   buffered rather than expected to match 'len' */
+		while ( len > 0 ) {
+			int mixable;
+
+			if ( ! music->len_available && ! WAVStream_GetSome(len) ) {
+				left = len;
+				break;
 			}
-			music->cvt.len = original_len;
-			SDL_ConvertAudio(&music->cvt);
-			SDL_MixAudio(stream, music->cvt.buf, music->cvt.len_cvt, wavestream_volume);
-		} else {
-			Uint8 *data;
-			if ( (music->stop - pos) < len ) {
-				left = (len - (music->stop - pos));
-				len -= left;
+			mixable = len;
+			if ( mixable > music->len_available ) {
+				mixable = music->len_available;
 			}
-			data = SDL_stack_alloc(Uint8, len);
-			if (data)
-			{		
-				SDL_RWread(music->rw, data, len, 1);
-				SDL_MixAudio(stream, data, len, wavestream_volume);
-				SDL_stack_free(data);
-			}	
+			SDL_MixAudio(stream, music->snd_available, mixable, wavestream_volume);
+			music->len_available -= mixable;
+			music->snd_available += mixable;
+			stream += mixable;
+			len -= mixable;
+		}
+	} else
+	if ( music && ((pos=SDL_RWtell(music->rw)) < music->stop) ) {
+		Uint8 *data;
+		if ( (music->stop - pos) < len ) {
+			left = (len - (music->stop - pos));
+			len -= left;
 		}
+		data = SDL_stack_alloc(Uint8, len);
+		if (data)
+		{		
+			SDL_RWread(music->rw, data, len, 1);
+			SDL_MixAudio(stream, data, len, wavestream_volume);
+			SDL_stack_free(data);
+		}	
 	}
 	return left;
 }
@@ -259,7 +289,8 @@ int WAVStream_Active(void)
 	int active;
 
 	active = 0;
-	if ( music && (SDL_RWtell(music->rw) < music->stop) ) {
+	if ( music && (music->len_available ||
+	               (SDL_RWtell(music->rw) < music->stop)) ) {
 		active = 1;
 	}
 	return(active);
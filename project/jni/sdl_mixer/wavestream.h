@@ -31,7 +31,11 @@ typedef struct {
 	SDL_bool freerw;
 	long  start;
 	long  stop;
+	int frame_size;
 	SDL_AudioCVT cvt;
+	int chunk_len;
+	int len_available;
+	Uint8 *snd_available;
 } WAVStream;
 
 /* Initialize the WAVStream player, with the given mixer settings
@@ -60,6 +60,18 @@
 #define CACHED_BITMAP	0x01
 #define CACHED_PIXMAP	0x02
 
+/* Glyphs kept per font, and the size of their hash table */
+#define GLYPH_CACHE_SIZE	512
+#define GLYPH_HASH_SIZE		1024	/* power of two */
+
+/* Size of the glyph atlas used by TTF_LayoutUNICODE() */
+#define ATLAS_SIZE	512
+
+/* Kinds of rendered strings */
+#define RENDER_SOLID	0
+#define RENDER_SHADED	1
+#define RENDER_BLENDED	2
+
 /* Cached glyph information */
 typedef struct cached_glyph {
 	int stored;
@@ -73,8 +85,32 @@ typedef struct cached_glyph {
 	int yoffset;
 	int advance;
 	Uint16 cached;
+
+	/* Font settings the glyph was rendered with, see Glyph_Style() */
+	Uint32 style;
+	/* Hash chain and least recently used list, as cache indices */
+	int hash_next;
+	int lru_prev;
+	int lru_next;
+	/* Where the pixmap is in the font atlas, if atlas_gen is current */
+	int atlas_x;
+	int atlas_y;
+	int atlas_gen;
 } c_glyph;
 
+/* Cached rendered string */
+typedef struct cached_string {
+	int mode;
+	Uint32 style;
+	SDL_Color fg;
+	SDL_Color bg;
+	Uint16 *text;
+	int len;
+	Uint32 hash;
+	Uint32 used;
+	SDL_Surface *surface;
+} c_string;
+
 /* The structure used to hold internal font information */
 struct _TTF_Font {
 	/* Freetype2 maintains all sorts of useful info itself */
@@ -102,9 +138,27 @@ struct _TTF_Font {
 	int underline_offset;
 	int underline_height;
 
-	/* Cache for style-transformed glyphs */
+	/* Cache for style-transformed glyphs, the least recently used
+	   glyph is replaced when it's full */
 	c_glyph *current;
-	c_glyph cache[257]; /* 257 is a prime */
+	c_glyph *cache;
+	int *cache_hash;
+	int cache_used;
+	int lru_head;
+	int lru_tail;
+
+	/* Rendered strings, see TTF_SetFontRenderCache() */
+	c_string *strings;
+	int num_strings;
+	Uint32 strings_clock;
+
+	/* Glyph pixmaps packed in rows, for TTF_LayoutUNICODE() */
+	SDL_Surface *atlas;
+	int atlas_gen;
+	int atlas_changes;
+	int shelf_x;
+	int shelf_y;
+	int shelf_h;
 
 	/* We are responsible for closing the font stream */
 	SDL_RWops *src;
@@ -562,16 +616,43 @@ static void Flush_Glyph( c_glyph* glyph )
 static void Flush_Cache( TTF_Font* font )
 {
 	int i;
-	int size = sizeof( font->cache ) / sizeof( font->cache[0] );
 
-	for( i = 0; i < size; ++i ) {
-		if( font->cache[i].cached ) {
-			Flush_Glyph( &font->cache[i] );
+	for( i = 0; i < font->cache_used; ++i ) {
+		Flush_Glyph( &font->cache[i] );
+	}
+	font->cache_used = 0;
+	font->lru_head = font->lru_tail = -1;
+	if( font->cache_hash ) {
+		for( i = 0; i < GLYPH_HASH_SIZE; ++i ) {
+			font->cache_hash[i] = -1;
 		}
+	}
+	font->current = NULL;
+}
 
+static void Flush_Strings( TTF_Font* font )
+{
+	int i;
+
+	for( i = 0; i < font->num_strings; ++i ) {
+		if( font->strings[i].surface ) {
+			SDL_FreeSurface( font->strings[i].surface );
+			font->strings[i].surface = NULL;
+		}
+		free( font->strings[i].text );
+		font->strings[i].text = NULL;
 	}
 }
 
+/* The font settings that change how glyphs are rendered.  Glyphs are
+   cached per setting, so switching styles back and forth keeps them. */
+static Uint32 Glyph_Style( const TTF_Font* font )
+{
+	return (font->style & ~TTF_STYLE_NO_GLYPH_CHANGE) |
+	       (TTF_GetFontHinting( font ) << 4) |
+	       (font->outline << 8);
+}
+
 static FT_Error Load_Glyph( TTF_Font* font, Uint16 ch, c_glyph* cached, int want )
 {
 	FT_Face face;
@@ -886,16 +967,90 @@ static FT_Error Load_Glyph( TTF_Font* font, Uint16 ch, c_glyph* cached, int want
 	return 0;
 }
 
+static void Unlink_Glyph( TTF_Font* font, int i )
+{
+	c_glyph *glyph = &font->cache[i];
+
+	if( glyph->lru_prev >= 0 ) {
+		font->cache[glyph->lru_prev].lru_next = glyph->lru_next;
+	} else {
+		font->lru_head = glyph->lru_next;
+	}
+	if( glyph->lru_next >= 0 ) {
+		font->cache[glyph->lru_next].lru_prev = glyph->lru_prev;
+	} else {
+		font->lru_tail = glyph->lru_prev;
+	}
+}
+
+static void Touch_Glyph( TTF_Font* font, int i )
+{
+	c_glyph *glyph = &font->cache[i];
+
+	glyph->lru_prev = -1;
+	glyph->lru_next = font->lru_head;
+	if( font->lru_head >= 0 ) {
+		font->cache[font->lru_head].lru_prev = i;
+	} else {
+		font->lru_tail = i;
+	}
+	font->lru_head = i;
+}
+
 static FT_Error Find_Glyph( TTF_Font* font, Uint16 ch, int want )
 {
 	int retval = 0;
-	int hsize = sizeof( font->cache ) / sizeof( font->cache[0] );
+	Uint32 style = Glyph_Style( font );
+	int h, i, *link;
+
+	if( !font->cache ) {
+		font->cache = (c_glyph *)calloc( GLYPH_CACHE_SIZE, sizeof( c_glyph ) );
+		font->cache_hash = (int *)malloc( GLYPH_HASH_SIZE * sizeof( int ) );
+		if( !font->cache || !font->cache_hash ) {
+			free( font->cache );
+			free( font->cache_hash );
+			font->cache = NULL;
+			font->cache_hash = NULL;
+			return FT_Err_Out_Of_Memory;
+		}
+		Flush_Cache( font );
+	}
 
-	int h = ch % hsize;
-	font->current = &font->cache[h];
+	h = ((ch * 2654435761U) ^ style) & (GLYPH_HASH_SIZE - 1);
+	for( i = font->cache_hash[h]; i >= 0; i = font->cache[i].hash_next ) {
+		if( font->cache[i].cached == ch && font->cache[i].style == style ) {
+			break;
+		}
+	}
 
-	if (font->current->cached != ch)
-		Flush_Glyph( font->current );
+	if( i >= 0 ) {
+		if( font->lru_head != i ) {
+			Unlink_Glyph( font, i );
+			Touch_Glyph( font, i );
+		}
+	} else {
+		/* Take a free entry, or the least recently used one */
+		if( font->cache_used < GLYPH_CACHE_SIZE ) {
+			i = font->cache_used++;
+		} else {
+			c_glyph *old = &font->cache[font->lru_tail];
+			i = font->lru_tail;
+			Unlink_Glyph( font, i );
+			link = &font->cache_hash[((old->cached * 2654435761U) ^ old->style) & (GLYPH_HASH_SIZE - 1)];
+			while( *link != i ) {
+				link = &font->cache[*link].hash_next;
+			}
+			*link = old->hash_next;
+			Flush_Glyph( old );
+		}
+		font->cache[i].cached = ch;
+		font->cache[i].style = style;
+		font->cache[i].atlas_gen = -1;
+		font->cache[i].hash_next = font->cache_hash[h];
+		font->cache_hash[h] = i;
+		Touch_Glyph( font, i );
+	}
+	font->current = &font->cache[i];
 
 	if ( (font->current->stored & want) != want ) {
 		retval = Load_Glyph( font, ch, font->current, want );
@@ -907,6 +1062,13 @@ void TTF_CloseFont( TTF_Font* font )
 {
 	if ( font ) {
 		Flush_Cache( font );
+		free( font->cache );
+		free( font->cache_hash );
+		Flush_Strings( font );
+		free( font->strings );
+		if ( font->atlas ) {
+			SDL_FreeSurface( font->atlas );
+		}
 		if ( font->face ) {
 			FT_Done_Face( font->face );
 		}
@@ -1290,7 +1452,7 @@ SDL_Surface *TTF_RenderUTF8_Solid(TTF_Font *font,
 	return(textbuf);
 }
 
-SDL_Surface *TTF_RenderUNICODE_Solid(TTF_Font *font,
+static SDL_Surface *Render_UNICODE_Solid(TTF_Font *font,
 				const Uint16 *text, SDL_Color fg)
 {
 	int xstart;
@@ -1559,7 +1721,7 @@ SDL_Surface *TTF_RenderUTF8_Shaded(TTF_Font *font,
 	return(textbuf);
 }
 
-SDL_Surface* TTF_RenderUNICODE_Shaded( TTF_Font* font,
+static SDL_Surface* Render_UNICODE_Shaded( TTF_Font* font,
 				       const Uint16* text,
 				       SDL_Color fg,
 				       SDL_Color bg )
@@ -1834,7 +1996,7 @@ SDL_Surface *TTF_RenderUTF8_Blended(TTF_Font *font,
 	return(textbuf);
 }
 
-SDL_Surface *TTF_RenderUNICODE_Blended(TTF_Font *font,
+static SDL_Surface *Render_UNICODE_Blended(TTF_Font *font,
 				const Uint16 *text, SDL_Color fg)
 {
 	int xstart;
@@ -2031,17 +2193,361 @@ SDL_Surface *TTF_RenderGlyph_Blended(TTF_Font *font, Uint16 ch, SDL_Color fg)
 	return(textbuf);
 }
 
-void TTF_SetFontStyle( TTF_Font* font, int style )
+static SDL_Surface *Render_UNICODE(TTF_Font *font, int mode,
+				const Uint16 *text, SDL_Color fg, SDL_Color bg)
 {
-	int prev_style = font->style;
-	font->style = style | font->face_style;
+	switch (mode) {
+	    case RENDER_SOLID:
+		return Render_UNICODE_Solid(font, text, fg);
+	    case RENDER_SHADED:
+		return Render_UNICODE_Shaded(font, text, fg, bg);
+	    default:
+		return Render_UNICODE_Blended(font, text, fg);
+	}
+}
 
-	/* Flush the cache if the style has changed.
-	 * Ignore UNDERLINE which does not impact glyph drawning.
-	 * */
-	if ( (font->style | TTF_STYLE_NO_GLYPH_CHANGE ) != ( prev_style | TTF_STYLE_NO_GLYPH_CHANGE )) {
-		Flush_Cache( font );
+/* Return a shared surface from the string cache, or render and cache it */
+static SDL_Surface *Render_Cached(TTF_Font *font, int mode,
+				const Uint16 *text, SDL_Color fg, SDL_Color bg)
+{
+	SDL_Surface *textbuf;
+	c_string *entry, *slot;
+	Uint32 style, hash;
+	int i, len;
+
+	if ( !font->num_strings ) {
+		return Render_UNICODE(font, mode, text, fg, bg);
+	}
+
+	style = Glyph_Style(font) | (font->style & TTF_STYLE_NO_GLYPH_CHANGE) |
+	        ((font->kerning != 0) << 6) | (TTF_byteswapped << 7);
+	if ( mode != RENDER_SHADED ) {
+		bg.r = bg.g = bg.b = 0;
+	}
+	hash = 2166136261U;
+	for ( len = 0; text[len]; ++len ) {
+		hash = (hash ^ text[len]) * 16777619U;
+	}
+
+	slot = &font->strings[0];
+	for ( i = 0; i < font->num_strings; ++i ) {
+		entry = &font->strings[i];
+		if ( entry->surface && entry->hash == hash && entry->len == len &&
+		     entry->mode == mode && entry->style == style &&
+		     entry->fg.r == fg.r && entry->fg.g == fg.g && entry->fg.b == fg.b &&
+		     entry->bg.r == bg.r && entry->bg.g == bg.g && entry->bg.b == bg.b &&
+		     memcmp(entry->text, text, len * sizeof(*text)) == 0 ) {
+			entry->used = ++font->strings_clock;
+			++entry->surface->refcount;
+			return entry->surface;
+		}
+		if ( !entry->surface || entry->used < slot->used ) {
+			if ( slot->surface ) {
+				slot = entry;
+			}
+		}
+	}
+
+	textbuf = Render_UNICODE(font, mode, text, fg, bg);
+	if ( textbuf == NULL ) {
+		return NULL;
+	}
+
+	/* Replace the least recently used string */
+	if ( slot->surface ) {
+		SDL_FreeSurface(slot->surface);
+		slot->surface = NULL;
+	}
+	free(slot->text);
+	slot->text = (Uint16 *)malloc((len + 1) * sizeof(*text));
+	if ( slot->text == NULL ) {
+		return textbuf;
+	}
+	memcpy(slot->text, text, (len + 1) * sizeof(*text));
+	slot->len = len;
+	slot->hash = hash;
+	slot->mode = mode;
+	slot->style = style;
+	slot->fg = fg;
+	slot->bg = bg;
+	slot->used = ++font->strings_clock;
+	slot->surface = textbuf;
+	++textbuf->refcount;
+	return textbuf;
+}
+
+SDL_Surface *TTF_RenderUNICODE_Solid(TTF_Font *font,
+				const Uint16 *text, SDL_Color fg)
+{
+	return Render_Cached(font, RENDER_SOLID, text, fg, fg);
+}
+
+SDL_Surface *TTF_RenderUNICODE_Shaded(TTF_Font *font,
+				const Uint16 *text, SDL_Color fg, SDL_Color bg)
+{
+	return Render_Cached(font, RENDER_SHADED, text, fg, bg);
+}
+
+SDL_Surface *TTF_RenderUNICODE_Blended(TTF_Font *font,
+				const Uint16 *text, SDL_Color fg)
+{
+	return Render_Cached(font, RENDER_BLENDED, text, fg, fg);
+}
+
+int TTF_SetFontRenderCache(TTF_Font *font, int entries)
+{
+	c_string *strings = NULL;
+
+	if ( entries < 0 ) {
+		entries = 0;
+	}
+	if ( entries ) {
+		strings = (c_string *)calloc(entries, sizeof(*strings));
+		if ( strings == NULL ) {
+			TTF_SetError("Out of memory");
+			return -1;
+		}
+	}
+	Flush_Strings(font);
+	free(font->strings);
+	font->strings = strings;
+	font->num_strings = entries;
+	return 0;
+}
+
+/* Clear the atlas, invalidating every glyph position in it */
+static int Reset_Atlas(TTF_Font *font)
+{
+	int i;
+
+	if ( font->atlas == NULL ) {
+		SDL_Palette *palette;
+
+		font->atlas = SDL_CreateRGBSurface(SDL_SWSURFACE, ATLAS_SIZE, ATLAS_SIZE, 8, 0, 0, 0, 0);
+		if ( font->atlas == NULL ) {
+			return -1;
+		}
+		/* Grayscale, so the coverage values show up if it's blitted */
+		palette = font->atlas->format->palette;
+		for ( i = 0; i < palette->ncolors; ++i ) {
+			palette->colors[i].r = i;
+			palette->colors[i].g = i;
+			palette->colors[i].b = i;
+		}
+	}
+	SDL_FillRect(font->atlas, NULL, 0);
+	font->atlas_gen++;
+	font->atlas_changes++;
+	font->shelf_x = font->shelf_y = font->shelf_h = 0;
+	return 0;
+}
+
+/* Make sure the glyph pixmap is in the atlas, returns -1 if it's full */
+static int Atlas_Glyph(TTF_Font *font, c_glyph *glyph)
+{
+	int w = glyph->pixmap.width;
+	int h = glyph->pixmap.rows;
+	Uint8 *src, *dst;
+	int row;
+
+	if ( glyph->atlas_gen == font->atlas_gen ) {
+		return 0;
+	}
+
+	/* Glyphs are packed left to right in shelves, with a pixel of
+	   padding so filtering doesn't pick up the neighbours */
+	if ( font->shelf_x + w > ATLAS_SIZE ) {
+		font->shelf_y += font->shelf_h + 1;
+		font->shelf_x = 0;
+		font->shelf_h = 0;
+	}
+	if ( font->shelf_y + h > ATLAS_SIZE || w > ATLAS_SIZE ) {
+		return -1;
+	}
+
+	src = glyph->pixmap.buffer;
+	dst = (Uint8 *)font->atlas->pixels + font->shelf_y * font->atlas->pitch + font->shelf_x;
+	for ( row = 0; row < h; ++row ) {
+		memcpy(dst, src, w);
+		src += glyph->pixmap.pitch;
+		dst += font->atlas->pitch;
+	}
+	glyph->atlas_x = font->shelf_x;
+	glyph->atlas_y = font->shelf_y;
+	glyph->atlas_gen = font->atlas_gen;
+	font->atlas_changes++;
+
+	font->shelf_x += w + 1;
+	if ( font->shelf_h < h ) {
+		font->shelf_h = h;
+	}
+	return 0;
+}
+
+/* Lay the text out like TTF_RenderUNICODE_Blended(), returns -2 if the
+   atlas ran out of room */
+static int Layout_UNICODE(TTF_Font *font, const Uint16 *text,
+				TTF_GlyphQuad *quads, int maxquads)
+{
+	int xstart;
+	int width;
+	const Uint16 *ch;
+	int swapped;
+	int count;
+	c_glyph *glyph;
+	FT_Error error;
+	FT_Long use_kerning;
+	FT_UInt prev_index = 0;
+
+	/* check kerning */
+	use_kerning = FT_HAS_KERNING( font->face ) && font->kerning;
+
+	xstart = 0;
+	count = 0;
+	swapped = TTF_byteswapped;
+	for ( ch=text; *ch; ++ch ) {
+		Uint16 c = *ch;
+		if ( c == UNICODE_BOM_NATIVE ) {
+			swapped = 0;
+			if ( text == ch ) {
+				++text;
+			}
+			continue;
+		}
+		if ( c == UNICODE_BOM_SWAPPED ) {
+			swapped = 1;
+			if ( text == ch ) {
+				++text;
+			}
+			continue;
+		}
+		if ( swapped ) {
+			c = SDL_Swap16(c);
+		}
+		error = Find_Glyph(font, c, CACHED_METRICS|CACHED_PIXMAP);
+		if( error ) {
+			TTF_SetFTError("Couldn't find glyph", error);
+			return -1;
+		}
+		glyph = font->current;
+		width = glyph->pixmap.width;
+		if (font->outline <= 0 && width > glyph->maxx - glyph->minx) {
+			width = glyph->maxx - glyph->minx;
+		}
+		/* do kerning, if possible AC-Patch */
+		if ( use_kerning && prev_index && glyph->index ) {
+			FT_Vector delta; 
+			FT_Get_Kerning( font->face, prev_index, glyph->index, ft_kerning_default, &delta ); 
+			xstart += delta.x >> 6;
+		}
+		/* Compensate for the wrap around bug with negative minx's */
+		if ( (ch == text) && (glyph->minx < 0) ) {
+			xstart -= glyph->minx;
+		}
+
+		if ( width > 0 && glyph->pixmap.rows > 0 ) {
+			if ( Atlas_Glyph(font, glyph) < 0 ) {
+				return -2;
+			}
+			if ( count < maxquads ) {
+				quads[count].x = xstart + glyph->minx;
+				quads[count].y = glyph->yoffset;
+				quads[count].w = width;
+				quads[count].h = glyph->pixmap.rows;
+				quads[count].sx = glyph->atlas_x;
+				quads[count].sy = glyph->atlas_y;
+			}
+			++count;
+		}
+
+		xstart += glyph->advance;
+		if ( TTF_HANDLE_STYLE_BOLD(font) ) {
+			xstart += font->glyph_overhang;
+		}
+		prev_index = glyph->index;
+	}
+	return count;
+}
+
+int TTF_LayoutText(TTF_Font *font, const char *text,
+				TTF_GlyphQuad *quads, int maxquads)
+{
+	Uint16 *unicode_text;
+	int unicode_len;
+	int count;
+
+	/* Copy the Latin-1 text to a UNICODE text buffer */
+	unicode_len = strlen(text);
+	unicode_text = (Uint16 *)ALLOCA((1+unicode_len+1)*(sizeof *unicode_text));
+	if ( unicode_text == NULL ) {
+		TTF_SetError("Out of memory");
+		return -1;
+	}
+	*unicode_text = UNICODE_BOM_NATIVE;
+	LATIN1_to_UNICODE(unicode_text+1, text, unicode_len);
+
+	count = TTF_LayoutUNICODE(font, unicode_text, quads, maxquads);
+
+	FREEA(unicode_text);
+	return count;
+}
+
+int TTF_LayoutUTF8(TTF_Font *font, const char *text,
+				TTF_GlyphQuad *quads, int maxquads)
+{
+	Uint16 *unicode_text;
+	int unicode_len;
+	int count;
+
+	/* Copy the UTF-8 text to a UNICODE text buffer */
+	unicode_len = strlen(text);
+	unicode_text = (Uint16 *)ALLOCA((1+unicode_len+1)*(sizeof *unicode_text));
+	if ( unicode_text == NULL ) {
+		TTF_SetError("Out of memory");
+		return -1;
 	}
+	*unicode_text = UNICODE_BOM_NATIVE;
+	UTF8_to_UNICODE(unicode_text+1, text, unicode_len);
+
+	count = TTF_LayoutUNICODE(font, unicode_text, quads, maxquads);
+
+	FREEA(unicode_text);
+	return count;
+}
+
+int TTF_LayoutUNICODE(TTF_Font *font, const Uint16 *text,
+				TTF_GlyphQuad *quads, int maxquads)
+{
+	int count;
+
+	if ( font->atlas == NULL && Reset_Atlas(font) < 0 ) {
+		return -1;
+	}
+	count = Layout_UNICODE(font, text, quads, maxquads);
+	if ( count == -2 ) {
+		/* Start over with an empty atlas */
+		Reset_Atlas(font);
+		count = Layout_UNICODE(font, text, quads, maxquads);
+		if ( count == -2 ) {
+			TTF_SetError("Text doesn't fit in the glyph atlas");
+			count = -1;
+		}
+	}
+	return count;
+}
+
+SDL_Surface *TTF_GetFontAtlas(TTF_Font *font, int *generation)
+{
+	if ( generation ) {
+		*generation = font->atlas_changes;
+	}
+	return font->atlas;
+}
+
+void TTF_SetFontStyle( TTF_Font* font, int style )
+{
+	/* Glyphs are cached per style, see Glyph_Style() */
+	font->style = style | font->face_style;
 }
 
 int TTF_GetFontStyle( const TTF_Font* font )
@@ -2052,7 +2558,6 @@ int TTF_GetFontStyle( const TTF_Font* font )
 void TTF_SetFontOutline( TTF_Font* font, int outline )
 {
 	font->outline = outline;
-	Flush_Cache( font );
 }
 
 int TTF_GetFontOutline( const TTF_Font* font )
@@ -2070,8 +2575,6 @@ void TTF_SetFontHinting( TTF_Font* font, int hinting )
 		font->hinting = FT_LOAD_NO_HINTING;
 	else
 		font->hinting = 0;
-
-	Flush_Cache( font );
 }
 
 int TTF_GetFontHinting( const TTF_Font* font )
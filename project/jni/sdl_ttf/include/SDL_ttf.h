@@ -216,6 +216,48 @@ extern DECLSPEC SDL_Surface * SDLCALL TTF_RenderUNICODE_Blended(TTF_Font *font,
 extern DECLSPEC SDL_Surface * SDLCALL TTF_RenderGlyph_Blended(TTF_Font *font,
 						Uint16 ch, SDL_Color fg);
 
+/* Keep up to 'entries' rendered strings per font, so rendering the same
+   text again with the same font settings and colors returns the surface
+   rendered the first time instead of rasterizing it again.  While this is
+   on, the TTF_Render{Text,UTF8,UNICODE}_* surfaces are shared and must not
+   be modified; free them with SDL_FreeSurface() as usual.
+   0 turns the cache off, which is the default.
+   This function returns 0, or -1 if there was an error.
+*/
+extern DECLSPEC int SDLCALL TTF_SetFontRenderCache(TTF_Font *font, int entries);
+
+/* A glyph of laid out text: the rectangle at x,y (relative to the top left
+   of the text, as TTF_RenderUNICODE_Blended() would draw it) of size w,h
+   is drawn with the same size rectangle at sx,sy of the font atlas.
+*/
+typedef struct {
+	int x, y;
+	int w, h;
+	int sx, sy;
+} TTF_GlyphQuad;
+
+/* Lay out the given text with the glyphs packed in the font atlas, for
+   drawing it with textured quads instead of a rendered surface.  Up to
+   'maxquads' glyphs are stored in 'quads'.  The underline and strikethrough
+   styles are left to the caller.
+   This function returns the number of glyphs, which can be more than
+   'maxquads', or -1 if there was an error.
+*/
+extern DECLSPEC int SDLCALL TTF_LayoutText(TTF_Font *font,
+				const char *text, TTF_GlyphQuad *quads, int maxquads);
+extern DECLSPEC int SDLCALL TTF_LayoutUTF8(TTF_Font *font,
+				const char *text, TTF_GlyphQuad *quads, int maxquads);
+extern DECLSPEC int SDLCALL TTF_LayoutUNICODE(TTF_Font *font,
+				const Uint16 *text, TTF_GlyphQuad *quads, int maxquads);
+
+/* Get the font atlas, an 8-bit surface holding the glyph coverage (0-255),
+   or NULL if nothing was laid out yet.  'generation' changes whenever the
+   atlas does, so it has to be uploaded again.  When the atlas is full it is
+   cleared, so only the quads of the last TTF_Layout* call are sure to match
+   its current contents.
+*/
+extern DECLSPEC SDL_Surface * SDLCALL TTF_GetFontAtlas(TTF_Font *font, int *generation);
+
 /* For compatibility with previous versions, here are the old functions */
 #define TTF_RenderText(font, text, fg, bg)	\
 	TTF_RenderText_Shaded(font, text, fg, bg)